@@ -0,0 +1,121 @@
+#include "BitDepthConverter.h"
+#include <mferror.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BIT_DEPTH_SSE2 1
+#endif
+
+// 4x4 Bayer 矩阵，换算成 16 位样点低 8 位上的偏移（均值 128，等价于四舍五入）
+static const UINT16 BAYER4[4][4] = {
+    {  8, 136,  40, 168 },
+    { 200,  72, 232, 104 },
+    {  56, 184,  24, 152 },
+    { 248, 120, 216,  88 },
+};
+static const UINT16 NO_DITHER[4] = { 128, 128, 128, 128 };
+
+BitDepthConverter::BitDepthConverter() : m_pBands(&ParallelBands::Shared()) {}
+
+// 读一个样点并转成高位对齐的 16 位：P010 已高位对齐（Shift = 0），I010 在低 10 位（Shift = 6）
+template <int Shift>
+static inline UINT32 Load16(UINT16 s) {
+    return Shift ? static_cast<UINT32>(s & 0x3FF) << Shift : s;
+}
+
+static inline BYTE Narrow(UINT32 v, UINT32 d) {
+    return static_cast<BYTE>((std::min)(v + d, 65535u) >> 8);
+}
+
+#ifdef BIT_DEPTH_SSE2
+// 8 个样点：高位对齐、加抖动（饱和）后取高 8 位，结果在每个 16 位通道的低字节
+template <int Shift>
+static inline __m128i Narrow8(const UINT16* p, __m128i dither) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (Shift) v = _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x3FF)), Shift);
+    return _mm_srli_epi16(_mm_adds_epu16(v, dither), 8);
+}
+#endif
+
+// 一行连续样点（亮度，或 P010 交错的 UV）；pairs 为 true 时相邻两个样点（U、V）共用一个抖动值
+template <int Shift>
+static void NarrowRow(const UINT16* pSrc, BYTE* pDst, UINT32 count, const UINT16 d[4], bool pairs) {
+    UINT32 x = 0;
+#ifdef BIT_DEPTH_SSE2
+    // 每 16 个样点一组，组起点是 4（成对时是 8）的倍数，抖动图样在组内固定
+    __m128i dither = pairs ? _mm_setr_epi16(d[0], d[0], d[1], d[1], d[2], d[2], d[3], d[3]) :
+        _mm_setr_epi16(d[0], d[1], d[2], d[3], d[0], d[1], d[2], d[3]);
+    for (; x + 16 <= count; x += 16) {
+        __m128i lo = Narrow8<Shift>(pSrc + x, dither);
+        __m128i hi = Narrow8<Shift>(pSrc + x + 8, dither);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < count; x++) {
+        pDst[x] = Narrow(Load16<Shift>(pSrc[x]), d[(pairs ? x / 2 : x) & 3]);
+    }
+}
+
+// I010 的 U、V 两个平面交错写成 NV12 的 UV 行
+static void NarrowInterleaveRow(const UINT16* pU, const UINT16* pV, BYTE* pDst, UINT32 count, const UINT16 d[4]) {
+    UINT32 x = 0;
+#ifdef BIT_DEPTH_SSE2
+    __m128i dither = _mm_setr_epi16(d[0], d[1], d[2], d[3], d[0], d[1], d[2], d[3]);
+    for (; x + 8 <= count; x += 8) {
+        __m128i u = Narrow8<6>(pU + x, dither);
+        __m128i v = Narrow8<6>(pV + x, dither);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x * 2), _mm_or_si128(u, _mm_slli_epi16(v, 8)));
+    }
+#endif
+    for (; x < count; x++) {
+        pDst[x * 2] = Narrow(Load16<6>(pU[x]), d[x & 3]);
+        pDst[x * 2 + 1] = Narrow(Load16<6>(pV[x]), d[x & 3]);
+    }
+}
+
+template <typename T>
+static T* Row(BYTE* pPlane, LONG stride, UINT32 row) {
+    return reinterpret_cast<T*>(pPlane + static_cast<ptrdiff_t>(row) * stride);
+}
+
+HRESULT BitDepthConverter::ConvertToNV12(const ImagePlanes& src, const ImagePlanes& dst) {
+    if (!IsSupported(src.subtype) || dst.subtype != VideoSubtype::NV12) return MF_E_INVALIDMEDIATYPE;
+    if (src.width != dst.width || src.height != dst.height) return MF_E_INVALIDMEDIATYPE;
+    for (UINT32 i = 0; i < src.planeCount; i++) {
+        if (src.data[i] == nullptr) return E_POINTER;
+    }
+    if (dst.data[0] == nullptr || dst.data[1] == nullptr) return E_POINTER;
+
+    const bool p010 = (src.subtype == VideoSubtype::P010);
+    const bool dither = m_dither;
+    const UINT32 width = src.width, height = src.height;
+    const UINT32 chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+
+    // 按色度行分带，每个色度行对应两行亮度
+    auto band = [&](UINT32 rowBegin, UINT32 rowEnd) {
+        for (UINT32 cy = rowBegin; cy < rowEnd; cy++) {
+            for (UINT32 y = cy * 2; y < (std::min)(cy * 2 + 2, height); y++) {
+                const UINT16* d = dither ? BAYER4[y & 3] : NO_DITHER;
+                const UINT16* pY = Row<const UINT16>(src.data[0], src.stride[0], y);
+                BYTE* pOut = Row<BYTE>(dst.data[0], dst.stride[0], y);
+                if (p010) NarrowRow<0>(pY, pOut, width, d, false);
+                else NarrowRow<6>(pY, pOut, width, d, false);
+            }
+
+            // 色度用错开两行的图样，避免与亮度的抖动重合
+            const UINT16* d = dither ? BAYER4[(cy + 2) & 3] : NO_DITHER;
+            BYTE* pUV = Row<BYTE>(dst.data[1], dst.stride[1], cy);
+            if (p010) {
+                NarrowRow<0>(Row<const UINT16>(src.data[1], src.stride[1], cy), pUV, chromaWidth * 2, d, true);
+            }
+            else {
+                NarrowInterleaveRow(Row<const UINT16>(src.data[1], src.stride[1], cy),
+                    Row<const UINT16>(src.data[2], src.stride[2], cy), pUV, chromaWidth, d);
+            }
+        }
+    };
+    if (m_pBands) m_pBands->Run(chromaHeight, 8, band);
+    else band(0, chromaHeight);
+    return S_OK;
+}
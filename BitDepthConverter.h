@@ -0,0 +1,27 @@
+#pragma once
+#include <windows.h>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+
+// 10 位（P010/I010）→ 8 位 NV12
+// H.264 编码器和 8 位的下游只接受 NV12；直接丢掉低 2 位会在平滑渐变上产生色带，
+// 默认先加 4x4 有序抖动再截断。SSE2 每次处理 16 个样点，输出行按行带并行
+class BitDepthConverter {
+public:
+    BitDepthConverter();
+
+    static bool IsSupported(VideoSubtype subtype) { return IsHighBitDepth(subtype); }
+
+    // dst 必须是与 src 尺寸相同的 NV12
+    HRESULT ConvertToNV12(const ImagePlanes& src, const ImagePlanes& dst);
+
+    // 关闭抖动时按四舍五入截断
+    void SetDither(bool dither) { m_dither = dither; }
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+private:
+    bool m_dither = true;
+    ParallelBands* m_pBands = nullptr;
+};
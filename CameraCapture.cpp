@@ -7,6 +7,10 @@
 #include <vector>
 #include <mfapi.h>
 #include <uuids.h>
+#include <codecapi.h>
+#include <algorithm>
+#include <functional>
+#include <sstream>
 
 
 
@@ -31,24 +35,72 @@ CameraCapture::CameraCapture() : m_lastFpsTime(std::chrono::steady_clock::now())
 
 CameraCapture::~CameraCapture() { Cleanup(); }
 
+// 在工作线程中执行一个启动阶段：加入 MTA 并记录到启动时间线
+static HRESULT RunStartupStage(StartupTimeline& timeline, const char* name, const std::function<HRESULT()>& stage) {
+    HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    HRESULT hr = S_OK;
+    {
+        StartupStageScope scope(timeline, name);
+        hr = scope.Result(stage());
+    }
+    if (SUCCEEDED(hrCom)) CoUninitialize();
+    return hr;
+}
+
 HRESULT CameraCapture::Initialize() {
     HRESULT hr = S_OK;
+    m_startupTimeline.Start();
+
+    // 调用线程加入 MTA，后台阶段创建的 COM 对象在工作线程退出后仍然有效
+    m_comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
 
     // 初始化Media Foundation
-    hr = MFStartup(MF_VERSION);
+    {
+        StartupStageScope stage(m_startupTimeline, "MFStartup");
+        hr = stage.Result(MFStartup(MF_VERSION));
+    }
     if (FAILED(hr)) return hr;
 
-    // 枚举可用相机
-    hr = EnumerateCameras();
-    if (FAILED(hr)) return hr;
+    // 以下阶段互不依赖，并发执行：枚举相机 | 分配缓冲 | D3D11 设备（调用线程）
+    auto enumerateTask = std::async(std::launch::async, [this] {
+        return RunStartupStage(m_startupTimeline, "EnumerateCameras", [this] { return EnumerateCameras(); });
+    });
+
+    auto bufferTask = std::async(std::launch::async, [this] {
+        return RunStartupStage(m_startupTimeline, "AllocateBuffers", [this] {
+            // 设备模式缓存不可用时每次启动都重新枚举，不影响采集
+            if (FAILED(m_formatNegotiator.Initialize())) {
+                MFLOG_WARN("Device profile cache unavailable.");
+            }
+
+            // 分配预录缓冲
+            HRESULT hr = m_preRoll.Initialize(m_preRollBudget);
+            if (FAILED(hr)) return hr;
+
+            // 解码帧缓存只由 ProcessThread 填充，不需要预取
+            return m_frameCache.Initialize(m_frameCacheBudget);
+        });
+    });
 
     // 创建D3D11设备和交换链
-    hr = CreateD3D11DeviceAndSwapChain();
-    if (FAILED(hr)) return hr;
+    HRESULT hrDevice = S_OK;
+    {
+        StartupStageScope stage(m_startupTimeline, "CreateD3D11Device");
+        hrDevice = stage.Result(CreateD3D11DeviceAndSwapChain());
+    }
+
+    // MFT 在后台预热，不阻塞首帧；解码前由 WaitForCodecs 等待完成
+    if (SUCCEEDED(hrDevice)) {
+        m_codecInit = std::async(std::launch::async, [this] {
+            return RunStartupStage(m_startupTimeline, "InitializeMFT", [this] { return InitializeMFT(); });
+        }).share();
+    }
 
-     // 初始化MFT
-     hr = InitializeMFT();
-     if (FAILED(hr)) return hr;
+    HRESULT hrEnumerate = enumerateTask.get();
+    HRESULT hrBuffers = bufferTask.get();
+    if (FAILED(hrEnumerate)) return hrEnumerate;
+    if (FAILED(hrDevice)) return hrDevice;
+    if (FAILED(hrBuffers)) return hrBuffers;
 
     // 启动线程
     // std::thread processThread(ProcessThread, this);
@@ -61,67 +113,67 @@ HRESULT CameraCapture::Initialize() {
     return hr;
 }
 
-HRESULT CameraCapture::EnumerateCameras() {
-    HRESULT hr = S_OK;
-    ComPtr<IMFAttributes> pAttributes;
-    IMFActivate** ppDevices = nullptr;
-    UINT32 count = 0;
+HRESULT CameraCapture::WaitForCodecs() {
+    if (!m_codecInit.valid()) return MF_E_NOT_INITIALIZED;
+    return m_codecInit.get();
+}
 
-    // 创建属性
-    hr = MFCreateAttributes(&pAttributes, 1);
+HRESULT CameraCapture::EnumerateCameras() {
+    // 注册表只在第一次完整枚举，之后随热插拔通知增量更新
+    HRESULT hr = m_deviceRegistry.Initialize();
     if (FAILED(hr)) return hr;
 
-    // 设置设备类型为视频捕获设备
-    hr = pAttributes->SetGUID(
-        MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE,
-        MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID
-    );
-    if (FAILED(hr)) return hr;
+    return RefreshCameraList();
+}
 
-    // 枚举设备
-    hr = MFEnumDeviceSources(pAttributes.Get(), &ppDevices, &count);
-    if (FAILED(hr)) return hr;
+bool CameraCapture::IsCameraListStale() const {
+    return m_deviceRegistry.GetGeneration() != m_cameraListGeneration;
+}
 
-    // 获取每个设备的信息
-    for (UINT32 i = 0; i < count; i++) {
+HRESULT CameraCapture::RefreshCameraList() {
+    UINT64 generation = m_deviceRegistry.GetGeneration();
+    std::vector<CameraInfo> cameras;
+    for (const auto& device : m_deviceRegistry.GetDevices()) {
         CameraInfo info;
-        
-        // 获取友好名称
-        WCHAR* friendlyName = nullptr;
-        UINT32 friendlyNameLength = 0;
-        hr = ppDevices[i]->GetAllocatedString(
-            MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME,
-            &friendlyName,
-            &friendlyNameLength
-        );
-        if (SUCCEEDED(hr)) {
-            info.friendlyName = friendlyName;
-            CoTaskMemFree(friendlyName);
-        }
+        info.friendlyName = device.friendlyName;
+        info.symbolicLink = device.symbolicLink;
+        cameras.push_back(info);
+    }
 
-        // 获取符号链接
-        WCHAR* symbolicLink = nullptr;
-        UINT32 symbolicLinkLength = 0;
-        hr = ppDevices[i]->GetAllocatedString(
-            MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_SYMBOLIC_LINK,
-            &symbolicLink,
-            &symbolicLinkLength
-        );
-        if (SUCCEEDED(hr)) {
-            info.symbolicLink = symbolicLink;
-            CoTaskMemFree(symbolicLink);
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+
+        // 设备增减后下标会变化，按符号链接重新映射当前、待切换和热备相机；已拔出的相机映射为 -1
+        auto remap = [this, &cameras](int oldIndex) {
+            if (oldIndex < 0 || oldIndex >= static_cast<int>(m_cameraList.size())) return -1;
+            const std::wstring& link = m_cameraList[oldIndex].symbolicLink;
+            for (size_t i = 0; i < cameras.size(); i++) {
+                if (_wcsicmp(cameras[i].symbolicLink.c_str(), link.c_str()) == 0) return static_cast<int>(i);
+            }
+            return -1;
+        };
+
+        m_selectedCameraIndex = remap(m_selectedCameraIndex);
+        m_pendingReader.cameraIndex = remap(m_pendingReader.cameraIndex);
+        if (m_pendingReader.cameraIndex < 0) m_pendingReader = StandbyReader();
+        for (auto it = m_standbyReaders.begin(); it != m_standbyReaders.end();) {
+            it->cameraIndex = remap(it->cameraIndex);
+            it = (it->cameraIndex < 0) ? m_standbyReaders.erase(it) : it + 1;
         }
+        std::deque<int> recent;
+        for (int index : m_recentCameras) {
+            int mapped = remap(index);
+            if (mapped >= 0) recent.push_back(mapped);
+        }
+        m_recentCameras.swap(recent);
 
-        m_cameraList.push_back(info);
-    }
-
-    // 释放设备数组
-    for (UINT32 i = 0; i < count; i++) {
-        ppDevices[i]->Release();
+        m_cameraList.swap(cameras);
+        m_cameraListGeneration = generation;
     }
-    CoTaskMemFree(ppDevices);
 
-    return hr;
+    // 新插入的相机可能成为热备候选
+    ScheduleStandbyRefresh();
+    return S_OK;
 }
 
 HRESULT CameraCapture::SelectCamera(int index) {
@@ -129,97 +181,386 @@ HRESULT CameraCapture::SelectCamera(int index) {
         return E_INVALIDARG;
     }
 
-    m_selectedCameraIndex = index;
-    
+    // 已经在等待切换到这台相机
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        if (m_pendingReader.pReader && m_pendingReader.cameraIndex == index) return S_OK;
+    }
+
+    // 上一次未完成的切换作废，它的读取器已经开始采集，停止后由热备刷新重新打开
+    CancelPendingReader();
+
+    // 有热备读取器时只登记切换请求，后台线程读到新相机的关键帧后由 RenderFrame 原子替换，期间继续输出当前相机
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        NoteCameraUsedLocked(index);
+        auto it = std::find_if(m_standbyReaders.begin(), m_standbyReaders.end(),
+            [index](const StandbyReader& standby) { return standby.cameraIndex == index; });
+        if (it != m_standbyReaders.end() && m_pSourceReader && !m_pendingThread.joinable()) {
+            m_pendingReader = *it;
+            m_standbyReaders.erase(it);
+            m_pendingKeyframe.Reset();
+            m_pendingFailed = false;
+            m_pendingThread = std::thread(&CameraCapture::ReadPendingReader, this, m_pendingReader.pReader, ++m_pendingGeneration);
+            return S_OK;
+        }
+    }
+
     // 如果已经初始化了源读取器，先清理
-    if (m_pSourceReader) {
-        m_pSourceReader->Flush(MF_SOURCE_READER_FIRST_VIDEO_STREAM);
-        m_pSourceReader.Reset();
+    ComPtr<IMFSourceReader> pOldReader;
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_selectedCameraIndex = index;
+        pOldReader.Swap(m_pSourceReader);
     }
+    StopSourceReader(pOldReader.Get());
+    pOldReader.Reset();
 
     // 创建新的源读取器
-    return CreateMediaSourceReader(m_cameraList[index].symbolicLink);
+    HRESULT hr = S_OK;
+    {
+        StartupStageScope stage(m_startupTimeline, "OpenCamera");
+        hr = stage.Result(CreateMediaSourceReader(m_cameraList[index].symbolicLink));
+    }
+    if (SUCCEEDED(hr)) ScheduleStandbyRefresh();
+    return hr;
+}
+
+HRESULT CameraCapture::EnableHotStandby(size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_standbyCount = count;
+    }
+    ScheduleStandbyRefresh();
+    return S_OK;
+}
+
+void CameraCapture::NoteCameraUsedLocked(int index) {
+    m_recentCameras.erase(std::remove(m_recentCameras.begin(), m_recentCameras.end(), index), m_recentCameras.end());
+    m_recentCameras.push_front(index);
+}
+
+void CameraCapture::ScheduleStandbyRefresh() {
+    // 打开设备很慢，放到后台进行；刷新进行中再次请求时由同一线程再跑一轮，调用方从不等待
+    std::lock_guard<std::mutex> lock(m_readerMutex);
+    if (m_standbyCount == 0 && m_standbyReaders.empty()) return;
+    m_standbyRefreshRequested = true;
+    if (m_standbyRefreshRunning) return;
+    m_standbyRefreshRunning = true;
+
+    m_standbyRefresh = std::async(std::launch::async, [this] {
+        HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(m_readerMutex);
+                if (!m_standbyRefreshRequested) {
+                    m_standbyRefreshRunning = false;
+                    break;
+                }
+                m_standbyRefreshRequested = false;
+            }
+            RefreshStandbyReaders();
+        }
+        if (SUCCEEDED(hrCom)) CoUninitialize();
+    });
+}
+
+void CameraCapture::RefreshStandbyReaders() {
+    std::vector<int> wanted;
+    std::vector<CameraInfo> wantedCameras;
+    std::vector<StandbyReader> released;
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+
+        // 最可能切换到的相机：最近使用过的优先，其余按列表顺序；排除当前和待切换的相机
+        auto excluded = [this](int index) {
+            return index == m_selectedCameraIndex || index == m_pendingReader.cameraIndex;
+        };
+        for (int index : m_recentCameras) {
+            if (wanted.size() >= m_standbyCount) break;
+            if (!excluded(index)) wanted.push_back(index);
+        }
+        for (int index = 0; index < static_cast<int>(m_cameraList.size()) && wanted.size() < m_standbyCount; index++) {
+            if (!excluded(index) && std::find(wanted.begin(), wanted.end(), index) == wanted.end()) wanted.push_back(index);
+        }
+
+        // 关闭不再需要的热备读取器（在锁外释放）
+        for (auto it = m_standbyReaders.begin(); it != m_standbyReaders.end();) {
+            if (std::find(wanted.begin(), wanted.end(), it->cameraIndex) == wanted.end()) {
+                released.push_back(*it);
+                it = m_standbyReaders.erase(it);
+            }
+            else {
+                wanted.erase(std::find(wanted.begin(), wanted.end(), it->cameraIndex));
+                ++it;
+            }
+        }
+        for (int index : wanted) wantedCameras.push_back(m_cameraList[index]);
+    }
+    released.clear();
+
+    for (const CameraInfo& camera : wantedCameras) {
+        StandbyReader standby;
+        HRESULT hr = OpenSourceReader(camera.symbolicLink, &standby.pReader);
+        if (FAILED(hr)) {
+            MFLOG_WARN("Failed to prepare standby reader for %ls", camera.friendlyName.c_str());
+            continue;
+        }
+
+        // 打开期间相机列表可能已刷新，按符号链接取当前下标
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        for (size_t i = 0; i < m_cameraList.size(); i++) {
+            if (m_cameraList[i].symbolicLink == camera.symbolicLink) standby.cameraIndex = static_cast<int>(i);
+        }
+        if (standby.cameraIndex >= 0) m_standbyReaders.push_back(standby);
+    }
+}
+
+// 停止读取器的采集：清空已排队的采样并关闭媒体源（相机随之停止输出），读取器之后不再可用。
+// 同步模式下另一线程阻塞在 ReadSample 时，关闭媒体源使其返回
+void CameraCapture::StopSourceReader(IMFSourceReader* pReader, bool flush) {
+    if (pReader == nullptr) return;
+    if (flush) pReader->Flush(MF_SOURCE_READER_FIRST_VIDEO_STREAM);
+
+    ComPtr<IMFMediaSource> pSource;
+    if (SUCCEEDED(pReader->GetServiceForStream(MF_SOURCE_READER_MEDIASOURCE, GUID_NULL, IID_PPV_ARGS(&pSource)))) {
+        pSource->Stop();
+        pSource->Shutdown();
+    }
+}
+
+// 请求相机立即输出 IDR（UVC 1.5 编码相机通过 ICodecAPI 支持），不支持时返回错误
+static HRESULT RequestSourceKeyframe(IMFSourceReader* pReader) {
+    ComPtr<ICodecAPI> pCodecApi;
+    HRESULT hr = pReader->GetServiceForStream(MF_SOURCE_READER_FIRST_VIDEO_STREAM, GUID_NULL, IID_PPV_ARGS(&pCodecApi));
+    if (FAILED(hr)) return hr;
+
+    VARIANT value;
+    VariantInit(&value);
+    value.vt = VT_UI4;
+    value.ulVal = 1;
+    return pCodecApi->SetValue(&CODECAPI_AVEncVideoForceKeyFrame, &value);
 }
 
+// 待切换读取器的后台读取线程：丢弃关键帧之前的采样，读到关键帧后交给 RenderFrame，不占用活动相机的读取循环。
+// GOP 过长时每隔 m_standbySwitchTimeout 请求一次关键帧，始终不在非 IDR 帧上切换
+void CameraCapture::ReadPendingReader(ComPtr<IMFSourceReader> pReader, UINT64 generation) {
+    HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    // 原始格式每一帧都可以直接切换
+    ComPtr<IMFMediaType> pType;
+    VideoFormat format = {};
+    if (SUCCEEDED(pReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType))) {
+        VideoFormatFromMediaType(pType.Get(), &format);
+    }
+    bool compressed = format.subtype == VideoSubtype::H264 || format.subtype == VideoSubtype::HEVC;
+
+    auto lastRequest = std::chrono::steady_clock::now();
+    while (true) {
+        ComPtr<IMFSample> pCandidate;
+        DWORD streamIndex = 0, flags = 0;
+        LONGLONG timestamp = 0;
+        HRESULT hr = pReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &streamIndex, &flags, &timestamp, &pCandidate);
+
+        {
+            std::lock_guard<std::mutex> lock(m_readerMutex);
+            if (generation != m_pendingGeneration) break;
+            if (FAILED(hr) || (flags & (MF_SOURCE_READERF_ERROR | MF_SOURCE_READERF_ENDOFSTREAM))) {
+                m_pendingFailed = true;
+                break;
+            }
+            if (pCandidate && (!compressed || MFGetAttributeUINT32(pCandidate.Get(), MFSampleExtension_CleanPoint, FALSE))) {
+                m_pendingKeyframe = pCandidate;
+                m_pendingFlags = flags;
+                break;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastRequest > m_standbySwitchTimeout) {
+            lastRequest = now;
+            if (FAILED(RequestSourceKeyframe(pReader.Get()))) {
+                MFLOG_WARN("Standby camera cannot force a keyframe, waiting for its next IDR.");
+            }
+        }
+    }
+
+    if (SUCCEEDED(hrCom)) CoUninitialize();
+}
+
+// 作废待切换请求：停止其读取线程和读取器
+void CameraCapture::CancelPendingReader() {
+    StandbyReader pending;
+    std::thread reader;
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_pendingGeneration++;
+        pending = m_pendingReader;
+        m_pendingReader = StandbyReader();
+        m_pendingKeyframe.Reset();
+        m_pendingFailed = false;
+        reader.swap(m_pendingThread);
+    }
+    StopSourceReader(pending.pReader.Get(), false);
+    if (reader.joinable()) reader.join();
+}
+
+HRESULT CameraCapture::PollPendingReader(ComPtr<IMFSample>& pSample, DWORD* pdwFlags) {
+    ComPtr<IMFSample> pKeyframe;
+    ComPtr<IMFSourceReader> pOldReader;
+    DWORD flags = 0;
+    std::thread reader;
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        if (!m_pendingReader.pReader) return S_FALSE;
+        if (m_pendingFailed) {
+            MFLOG_WARN("Standby reader failed, staying on the current camera.");
+        }
+        else if (!m_pendingKeyframe) {
+            return S_FALSE;
+        }
+        else {
+            pOldReader = m_pSourceReader;
+            m_pSourceReader = m_pendingReader.pReader;
+            m_selectedCameraIndex = m_pendingReader.cameraIndex;
+            m_pendingReader = StandbyReader();
+            pKeyframe.Swap(m_pendingKeyframe);
+            flags = m_pendingFlags;
+            reader.swap(m_pendingThread);
+        }
+    }
+    if (!pKeyframe) {
+        CancelPendingReader();
+        return S_FALSE;
+    }
+
+    // 读取线程交出关键帧后已经退出
+    if (reader.joinable()) reader.join();
+
+    // 被替换的读取器停止采集，不再占用相机和 USB 带宽；需要时热备刷新会重新打开
+    StopSourceReader(pOldReader.Get());
+    pOldReader.Reset();
+
+    // 新相机的时间戳接在上一帧之后，预录缓冲和复用器看到的是连续的码流
+    m_rebaseTimestamps = true;
+
+    // 格式不同（分辨率、编码）时进行中的直通录像不能继续写入，预录内容也不能和新码流拼接；
+    // 关键帧标记为不连续，ProcessThread 据此重建解码器
+    VideoFormat oldFormat = m_captureFormat;
+    UpdateCaptureFormat();
+    if (!IsSameVideoFormat(oldFormat, m_captureFormat)) {
+        if (m_preRoll.IsRecording()) {
+            MFLOG_WARN("Capture format changed on camera switch, stopping event recording.");
+            m_preRoll.Stop();
+        }
+        m_preRoll.Clear();
+        pKeyframe->SetUINT32(MFSampleExtension_Discontinuity, TRUE);
+    }
+
+    ScheduleStandbyRefresh();
+
+    pSample = pKeyframe;
+    *pdwFlags = flags;
+    return S_OK;
+}
 
 HRESULT CameraCapture::CreateMediaSourceReader(const std::wstring& symbolicLink) {
+    ComPtr<IMFSourceReader> pReader;
+    HRESULT hr = OpenSourceReader(symbolicLink, &pReader);
+    if (FAILED(hr)) return hr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_pSourceReader = pReader;
+    }
+    m_rebaseTimestamps = true;
+    return UpdateCaptureFormat();
+}
+
+HRESULT CameraCapture::OpenSourceReader(const std::wstring& symbolicLink, IMFSourceReader** ppReader) {
     HRESULT hr = S_OK;
     ComPtr<IMFAttributes> pAttributes;
     ComPtr<IMFMediaSource> pMediaSource;
+    ComPtr<IMFSourceReader> pReader;
 
     // 创建属性
     hr = MFCreateAttributes(&pAttributes, 2);
     if (FAILED(hr)) {
-        std::cerr << "Failed to create attributes: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to create attributes: 0x%08lx", hr);
         return hr;
     }
 
     hr=pAttributes->SetGUID(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE, MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID);
     if (FAILED(hr)) {
-        std::cerr << "Failed to set source type: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to set source type: 0x%08lx", hr);
         return hr;
     }
     // 设置符号链接
     hr = pAttributes->SetString(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_SYMBOLIC_LINK, symbolicLink.c_str());
     if (FAILED(hr)) {
-        std::cerr << "Failed to set symbolic link: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to set symbolic link: 0x%08lx", hr);
         return hr;
     }
 
     // 创建媒体源
     hr = MFCreateDeviceSource(pAttributes.Get(), &pMediaSource);
     if (FAILED(hr)) {
-        std::cerr << "Failed to create device source: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to create device source: 0x%08lx", hr);
         return hr;
     }
 
     // 创建源读取器
-    hr = MFCreateSourceReaderFromMediaSource(pMediaSource.Get(), pAttributes.Get(), &m_pSourceReader);
+    hr = MFCreateSourceReaderFromMediaSource(pMediaSource.Get(), pAttributes.Get(), &pReader);
     if (FAILED(hr)) {
-        std::cerr << "Failed to create source reader: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to create source reader: 0x%08lx", hr);
         return hr;
     }
 
-    // 设置输出类型为H264
+    // 按端到端开销选择相机原生模式，不再固定请求 H264 3840x2160@25；只考虑管线能处理的 H264/NV12/P010/I010。
+    // 预录缓冲和直通录像只接受 H264 码流，启用预录时优先只在 H264 模式中选择
     ComPtr<IMFMediaType> pType;
-    hr = MFCreateMediaType(&pType);
-    if (FAILED(hr)) {
-        std::cerr << "Failed to create media type: " << std::hex << hr << std::endl;
-        return hr;
+    FormatCandidate chosen;
+    NegotiationTarget target = m_formatTarget;
+    target.requireH264 = m_preRollBudget > 0;
+    hr = m_formatNegotiator.Negotiate(pReader.Get(), symbolicLink, target, &pType, &chosen);
+    if (hr == MF_E_INVALIDMEDIATYPE && target.requireH264) {
+        MFLOG_WARN("Camera has no H.264 mode, event recording will encode the NV12/P010 frames.");
+        target.requireH264 = false;
+        hr = m_formatNegotiator.Negotiate(pReader.Get(), symbolicLink, target, &pType, &chosen);
     }
-
-    hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
     if (FAILED(hr)) {
-        std::cerr << "Failed to set major type: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to negotiate capture format: 0x%08lx", hr);
         return hr;
     }
+    MFLOG_INFO("Capture format: %s %ux%u@%u/%u", VideoSubtypeName(chosen.subtype), chosen.width, chosen.height,
+        chosen.fpsNum, chosen.fpsDen);
 
-    hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
+    hr = pReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, pType.Get());
     if (FAILED(hr)) {
-        std::cerr << "Failed to set subtype: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to set current media type: 0x%08lx", hr);
         return hr;
     }
 
-    // 设置分辨率
-    hr = MFSetAttributeSize(pType.Get(), MF_MT_FRAME_SIZE, 3840, 2160);
-    if (FAILED(hr)) {
-        std::cerr << "Failed to set frame size: " << std::hex << hr << std::endl;
-        return hr;
-    }
+    *ppReader = pReader.Detach();
+    return hr;
+}
 
-    // 设置帧率
-    hr = MFSetAttributeRatio(pType.Get(), MF_MT_FRAME_RATE, 25, 1);
+HRESULT CameraCapture::UpdateCaptureFormat() {
+    ComPtr<IMFMediaType> pType;
+    HRESULT hr = m_pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType);
     if (FAILED(hr)) {
-        std::cerr << "Failed to set frame rate: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to get current media type: 0x%08lx", hr);
         return hr;
     }
 
-    hr = m_pSourceReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, pType.Get());
+    VideoFormat format;
+    hr = VideoFormatFromMediaType(pType.Get(), &format);
     if (FAILED(hr)) {
-        std::cerr << "Failed to set current media type: " << std::hex << hr << std::endl;
+        MFLOG_ERROR("Failed to parse current media type: 0x%08lx", hr);
         return hr;
     }
-
+    std::lock_guard<std::mutex> lock(m_captureFormatMutex);
+    m_captureFormat = format;
     return hr;
 }
 
@@ -229,14 +570,50 @@ HRESULT CameraCapture::RenderFrame() {
         DWORD streamIndex = 0;
         LONGLONG llTimeStamp = 0;
 
-        HRESULT hr = m_pSourceReader->ReadSample(
-            MF_SOURCE_READER_FIRST_VIDEO_STREAM,
-            0,
-            &streamIndex,
-            &dwFlags,
-            &llTimeStamp,
-            &pSample
-        );
+        // 有待切换的热备读取器时先读它，切换前仍输出当前相机的画面
+        HRESULT hr = PollPendingReader(pSample, &dwFlags);
+        if (hr == S_FALSE) {
+            hr = m_pSourceReader->ReadSample(
+                MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+                0,
+                &streamIndex,
+                &dwFlags,
+                &llTimeStamp,
+                &pSample
+            );
+        }
+
+        // 切换相机后平移时间戳，保持输出连续
+        if (SUCCEEDED(hr) && pSample) {
+            LONGLONG sampleTime = 0, sampleDuration = 0;
+            if (SUCCEEDED(pSample->GetSampleTime(&sampleTime))) {
+                if (m_rebaseTimestamps) {
+                    m_timestampOffset = (m_lastSampleEnd > 0) ? m_lastSampleEnd - sampleTime : 0;
+                    m_rebaseTimestamps = false;
+                }
+                sampleTime += m_timestampOffset;
+                pSample->SetSampleTime(sampleTime);
+                if (FAILED(pSample->GetSampleDuration(&sampleDuration))) sampleDuration = m_captureFormat.frameDuration;
+                m_lastSampleEnd = sampleTime + sampleDuration;
+            }
+        }
+
+        // 只有流格式变化时才重新查询媒体类型
+        if (SUCCEEDED(hr) && (dwFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)) {
+            UpdateCaptureFormat();
+        }
+
+        // H264 采样进入预录缓冲，录像触发后同时直接写入复用器；
+        // 原始 NV12/P010/I010 先编码成 H264 再进入（格式协商不会选择其它原始格式）
+        if (SUCCEEDED(hr) && pSample) {
+            if (m_captureFormat.subtype == VideoSubtype::H264) m_preRoll.Push(pSample.Get());
+            else if (m_preRollBudget > 0 && CanEncodeCapture()) EncodeForPreRoll(pSample.Get());
+
+            if (m_startupTimeline.MarkFirstFrame()) {
+                std::istringstream report(m_startupTimeline.Report());
+                for (std::string line; std::getline(report, line);) MFLOG_INFO("%s", line.c_str());
+            }
+        }
 
       /*  if (SUCCEEDED(hr) && pSample) {
             std::lock_guard<std::mutex> lock(m_sampleMutex);
@@ -248,13 +625,300 @@ HRESULT CameraCapture::RenderFrame() {
     return S_OK;
 }
 
+// 只在读取线程调用，采集格式也只在这个线程改写
+bool CameraCapture::CanEncodeCapture() const {
+    return m_captureFormat.subtype == VideoSubtype::NV12 || BitDepthConverter::IsSupported(m_captureFormat.subtype);
+}
+
+// 相机输出原始帧时由 MFTCodecHelper 编码（位深转换、旋转、场景切换 IDR、降噪都在 PrepareEncoderInput 中），
+// 编码后的 H264 采样和相机码流一样进入预录缓冲
+HRESULT CameraCapture::EncodeForPreRoll(IMFSample* pSample) {
+    HRESULT hr = WaitForCodecs();
+    if (FAILED(hr)) return hr;
+
+    std::vector<ComPtr<IMFSample>> encoded;
+    hr = m_CodecHelper.EncodeFrame(pSample, m_captureFormat, encoded);
+    for (auto& sample : encoded) m_preRoll.Push(sample.Get());
+    return hr;
+}
+
+HRESULT CameraCapture::StartEventRecording(const std::wstring& outputFilePath) {
+    if (!m_pSourceReader) return MF_E_NOT_INITIALIZED;
+    if (m_preRoll.IsRecording()) return MF_E_INVALIDREQUEST;
+
+    // 直通写入器不重新编码：H264 采集写相机的码流，NV12/P010/I010 采集写预录编码器的码流
+    ComPtr<IMFMediaType> pType;
+    HRESULT hr = S_OK;
+    VideoFormat captureFormat = GetCaptureFormat();
+    if (captureFormat.subtype == VideoSubtype::H264) {
+        hr = m_pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType);
+    }
+    else if (FormatNegotiator::IsPipelineSubtype(captureFormat.subtype)) {
+        hr = m_CodecHelper.GetEncoderOutputType(&pType);
+    }
+    else {
+        MFLOG_WARN("Event recording needs an H.264, NV12 or P010 capture format, current format is %s.",
+            VideoSubtypeName(captureFormat.subtype));
+        return MF_E_INVALIDMEDIATYPE;
+    }
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to get the recording media type: 0x%08lx", hr);
+        return hr;
+    }
+
+    ComPtr<IMFSinkWriter> pWriter;
+    DWORD streamIndex = 0;
+    hr = CreateH264PassthroughWriter(outputFilePath, pType.Get(), &pWriter, &streamIndex);
+    if (FAILED(hr)) return hr;
+
+    return m_preRoll.Trigger(pWriter.Get(), streamIndex);
+}
+
+HRESULT CameraCapture::StopEventRecording() {
+    return m_preRoll.Stop();
+}
+
+HRESULT CameraCapture::GetRewindFrame(LONGLONG hnsTime, IMFSample** ppSample) {
+    return m_frameCache.Lookup(hnsTime, ppSample);
+}
+
+HRESULT CameraCapture::GetRewindFrameScaled(LONGLONG hnsTime, UINT32 width, UINT32 height, ScaleFilter filter,
+    IMFSample** ppSample) {
+    if (ppSample == nullptr) return E_POINTER;
+    *ppSample = nullptr;
+
+    // 按帧插入缓存时的格式缩放：切换相机或流变化后解码器格式已经不同，缓存里仍可能是旧格式的帧
+    ComPtr<IMFSample> pSource;
+    VideoFormat srcFormat = {};
+    HRESULT hr = m_frameCache.Lookup(hnsTime, &pSource, &srcFormat);
+    if (FAILED(hr)) return hr;
+
+    if (!VideoScaler::IsSupported(srcFormat.subtype)) return MF_E_INVALIDMEDIATYPE;
+
+    // 目标格式只换分辨率，平面布局按最小行跨度计算
+    ComPtr<IMFMediaType> pDstType;
+    VideoFormat dstFormat = {};
+    hr = MFCreateMediaType(&pDstType);
+    if (SUCCEEDED(hr)) hr = pDstType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (SUCCEEDED(hr)) hr = pDstType->SetGUID(MF_MT_SUBTYPE, srcFormat.subtypeGuid);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeSize(pDstType.Get(), MF_MT_FRAME_SIZE, width, height);
+    if (SUCCEEDED(hr)) hr = VideoFormatFromMediaType(pDstType.Get(), &dstFormat);
+    if (FAILED(hr)) return hr;
+
+    ComPtr<IMFMediaBuffer> pSrcBuffer, pDstBuffer;
+    ComPtr<IMFSample> pScaled;
+    hr = pSource->ConvertToContiguousBuffer(&pSrcBuffer);
+    if (SUCCEEDED(hr)) hr = CreateSingleBufferIMFSample(dstFormat.frameBytes, &pScaled);
+    if (SUCCEEDED(hr)) hr = pScaled->GetBufferByIndex(0, &pDstBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pSrcData = nullptr, * pDstData = nullptr;
+    DWORD srcLength = 0, dstMax = 0;
+    hr = pSrcBuffer->Lock(&pSrcData, nullptr, &srcLength);
+    if (FAILED(hr)) return hr;
+    hr = pDstBuffer->Lock(&pDstData, &dstMax, nullptr);
+    if (SUCCEEDED(hr)) {
+        ImagePlanes src = {}, dst = {};
+        hr = ImagePlanesFromBuffer(srcFormat, pSrcData, srcLength, &src);
+        if (SUCCEEDED(hr)) hr = ImagePlanesFromBuffer(dstFormat, pDstData, dstMax, &dst);
+        if (SUCCEEDED(hr)) {
+            std::lock_guard<std::mutex> lock(m_scalerMutex);
+            hr = m_analyticsScaler.Configure(srcFormat.subtype, srcFormat.width, srcFormat.height, width, height, filter);
+            if (SUCCEEDED(hr)) hr = m_analyticsScaler.Scale(src, dst);
+        }
+        pDstBuffer->Unlock();
+    }
+    pSrcBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    LONGLONG sampleTime = 0, sampleDuration = 0;
+    if (SUCCEEDED(pSource->GetSampleTime(&sampleTime))) pScaled->SetSampleTime(sampleTime);
+    if (SUCCEEDED(pSource->GetSampleDuration(&sampleDuration))) pScaled->SetSampleDuration(sampleDuration);
+    pDstBuffer->SetCurrentLength(dstFormat.frameBytes);
+
+    *ppSample = pScaled.Detach();
+    return S_OK;
+}
+
+void CameraCapture::SetPreviewCrop(const CropRect& crop) {
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    m_previewCrop = crop;
+    m_previewDirty = true;
+}
+
+void CameraCapture::SetOrientation(FrameOrientation orientation) {
+    {
+        std::lock_guard<std::mutex> lock(m_previewMutex);
+        m_orientation = orientation;
+        m_previewDirty = true;
+    }
+    m_CodecHelper.SetEncoderOrientation(orientation);
+}
+
+HRESULT CameraCapture::SetLensCalibration(const LensCalibration& calibration) {
+    if (calibration.width == 0 || calibration.height == 0 || calibration.fx <= 0.0 || calibration.fy <= 0.0 ||
+        calibration.zoom <= 0.0) {
+        return E_INVALIDARG;
+    }
+    std::lock_guard<std::mutex> lock(m_dewarpMutex);
+    m_dewarper.SetCalibration(calibration);
+    m_dewarpEnabled = true;
+    return S_OK;
+}
+
+void CameraCapture::ClearLensCalibration() {
+    std::lock_guard<std::mutex> lock(m_dewarpMutex);
+    m_dewarpEnabled = false;
+}
+
+HRESULT CameraCapture::DewarpFrames(std::vector<ComPtr<IMFSample>>& samples, const VideoFormat& format) {
+    std::lock_guard<std::mutex> lock(m_dewarpMutex);
+    if (!m_dewarpEnabled || samples.empty()) return S_OK;
+    if (!LensDewarper::IsSupported(format.subtype)) return S_OK;
+
+    // 重映射表只在标定或分辨率变化时重建；标定无法建表时关闭校正，避免每帧重试
+    HRESULT hr = m_dewarper.Configure(format);
+    if (FAILED(hr)) {
+        MFLOG_WARN("Lens correction disabled, calibration rejected: 0x%08lx", hr);
+        m_dewarpEnabled = false;
+        return hr;
+    }
+
+    for (auto& sample : samples) {
+        ComPtr<IMFSample> pCorrected;
+        hr = m_dewarper.ProcessSample(sample.Get(), format, &pCorrected);
+        if (FAILED(hr)) return hr;
+        sample = pCorrected;
+    }
+    return S_OK;
+}
+
+HRESULT CameraCapture::ConvertPreviewFrame(IMFSample* pDecoded, const VideoFormat& decodedFormat, PreviewFrame& frame) {
+    VideoFormat format = decodedFormat;
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    auto start = std::chrono::steady_clock::now();
+
+    // 90/270 度安装：解码帧先转置（分块 SIMD 转置，输出来自池），裁剪区域随之转置；剩下的翻转融合进转换的坐标表
+    HRESULT hr = S_OK;
+    ComPtr<IMFSample> pSource = pDecoded;
+    CropRect crop = m_previewCrop;
+    if (SwapsAxes(m_orientation)) {
+        pSource.Reset();
+        hr = m_previewRotator.RotateSample(pDecoded, format, FrameOrientation::Transpose, &pSource);
+        if (FAILED(hr)) return hr;
+        format = m_previewRotator.GetOutputFormat();
+        std::swap(crop.x, crop.y);
+        std::swap(crop.width, crop.height);
+    }
+
+    // 只有解码格式、裁剪区域或方向变化时才重新计算坐标表；10 位解码格式输出 RGB10A2，保留全部精度
+    bool highBitDepth = IsHighBitDepth(format.subtype);
+    if (m_previewDirty || format.hash != m_previewConfigHash) {
+        hr = m_previewConverter.Configure(format, crop, m_previewWidth, m_previewHeight,
+            highBitDepth ? RgbLayout::RGB10A2 : RgbLayout::RGBA, FlipsOf(m_orientation));
+        if (FAILED(hr)) return hr;
+        m_previewConfigHash = format.hash;
+        m_previewDirty = false;
+    }
+
+    ComPtr<IMFMediaBuffer> pBuffer;
+    hr = pSource->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pData = nullptr;
+    DWORD length = 0;
+    hr = pBuffer->Lock(&pData, nullptr, &length);
+    if (FAILED(hr)) return hr;
+
+    ImagePlanes planes = {};
+    hr = ImagePlanesFromBuffer(format, pData, length, &planes);
+    if (SUCCEEDED(hr)) {
+        // 帧数据已经锁定，统计在同一次访问里完成，不再单独读一遍；转置不影响直方图和锐度
+        if (FrameStatistics::IsSupported(format.subtype)) m_frameStats.AnalyzeSample(pDecoded, planes, format);
+
+        frame.format = highBitDepth ? DXGI_FORMAT_R10G10B10A2_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+        frame.pixels.resize(static_cast<size_t>(m_previewWidth) * m_previewHeight * 4);
+        hr = m_previewConverter.Convert(planes, frame.pixels.data(), static_cast<LONG>(m_previewWidth * 4));
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        m_previewConvertMs = (m_previewConvertMs == 0.0) ? ms : m_previewConvertMs * 0.9 + ms * 0.1;
+    }
+    pBuffer->Unlock();
+    return hr;
+}
+
+bool CameraCapture::SkipStaticPreview(IMFSample* pDecoded, const VideoFormat& format) {
+    if (!ChangeDetector::IsSupported(format.subtype)) return false;
+
+    // 裁剪区域或解码格式变化后，下一帧必须刷新预览
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    if (m_previewDirty || format.hash != m_previewConfigHash) m_changeDetector.Reset();
+
+    ChangeResult change;
+    bool repeat = SUCCEEDED(m_changeDetector.AnalyzeSample(pDecoded, format, &change)) && change.repeat;
+    m_staticSceneStats.detector = m_changeDetector.GetStats();
+    if (repeat) {
+        // 画面没有可见变化，沿用上一帧的统计
+        m_frameStats.RepeatSample(pDecoded);
+        m_staticSceneStats.skippedPreviews++;
+        m_staticSceneStats.skippedUploadBytes += static_cast<UINT64>(m_previewWidth) * m_previewHeight * 4;
+        m_staticSceneStats.savedCpuMs += m_previewConvertMs;
+    }
+    return repeat;
+}
+
+void CameraCapture::ReportStaticScene() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastStaticReport < std::chrono::seconds(1)) return;
+    m_lastStaticReport = now;
+
+    StaticSceneStats stats = GetStaticSceneStats();
+    if (stats.detector.frames == 0 || stats.skippedPreviews == 0) return;
+    MFLOG_INFO("Static scene: %llu/%llu frames repeated, saved %.1f ms CPU, %llu MB upload and %llu presents (detection %.3f ms/frame)",
+        stats.skippedPreviews, stats.detector.frames, stats.savedCpuMs, stats.skippedUploadBytes / (1024 * 1024),
+        stats.skippedPreviews, stats.detector.analyzeMs / stats.detector.frames);
+}
+
+void CameraCapture::SetFrameStatsSettings(const FrameStatsSettings& settings) {
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    m_frameStats.SetSettings(settings);
+}
+
+void CameraCapture::SetChangeDetectorSettings(const ChangeDetectorSettings& settings) {
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    m_changeDetector.SetSettings(settings);
+}
+
+StaticSceneStats CameraCapture::GetStaticSceneStats() {
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    return m_staticSceneStats;
+}
+
+HRESULT CameraCapture::SetBackBufferFormat(DXGI_FORMAT format) {
+    if (format == m_backBufferFormat) return S_OK;
+
+    // ResizeBuffers 要求先释放所有对后台缓冲的引用
+    m_pContext->OMSetRenderTargets(0, nullptr, nullptr);
+    m_pRenderTargetView.Reset();
+    HRESULT hr = m_pSwapChain->ResizeBuffers(0, m_previewWidth, m_previewHeight, format, 0);
+    if (FAILED(hr)) return hr;
+
+    ComPtr<ID3D11Texture2D> pBackBuffer;
+    hr = m_pSwapChain->GetBuffer(0, IID_PPV_ARGS(&pBackBuffer));
+    if (FAILED(hr)) return hr;
+    hr = m_pDevice->CreateRenderTargetView(pBackBuffer.Get(), nullptr, &m_pRenderTargetView);
+    if (FAILED(hr)) return hr;
+
+    m_backBufferFormat = format;
+    return S_OK;
+}
+
 HRESULT CameraCapture::CreateD3D11DeviceAndSwapChain() {
     HRESULT hr = S_OK;
     DXGI_SWAP_CHAIN_DESC sd = {};
     sd.BufferCount = 2;
-    sd.BufferDesc.Width = 3840;
-    sd.BufferDesc.Height = 2160;
-    sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    sd.BufferDesc.Width = m_previewWidth;
+    sd.BufferDesc.Height = m_previewHeight;
+    sd.BufferDesc.Format = m_backBufferFormat;
     sd.BufferDesc.RefreshRate.Numerator = 25;
     sd.BufferDesc.RefreshRate.Denominator = 1;
     sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
@@ -306,6 +970,18 @@ void CameraCapture::UpdateFps() {
 }
 
 void CameraCapture::Cleanup() {
+    // 等待后台 MFT 初始化和热备刷新结束，避免在其运行时关闭 Media Foundation
+    if (m_codecInit.valid()) m_codecInit.wait();
+    if (m_standbyRefresh.valid()) m_standbyRefresh.wait();
+    m_deviceRegistry.Shutdown();
+    CancelPendingReader();
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_standbyReaders.clear();
+    }
+
+    m_preRoll.Stop();
+    m_frameCache.Shutdown();
     m_stopThreads = true;
     m_sampleCV.notify_all();
     m_renderCV.notify_all();
@@ -313,7 +989,18 @@ void CameraCapture::Cleanup() {
     if (m_pSourceReader) {
         m_pSourceReader->Flush(MF_SOURCE_READER_FIRST_VIDEO_STREAM);
     }
+
+    // 编解码器归还共享池；没有其它相机在使用时释放空闲实例，保证在 MFShutdown 之前析构
+    m_CodecHelper.ReleaseCodecs();
+    if (MFTPool::Shared().GetStats().activeInstances == 0) {
+        MFTPool::Shared().Trim();
+    }
     MFShutdown();
+
+    if (m_comInitialized) {
+        CoUninitialize();
+        m_comInitialized = false;
+    }
 }
 
 // 新增MFT初始化函数
@@ -337,11 +1024,57 @@ void ProcessThread(CameraCapture* capture) {
             ComPtr<IMFSample> pSample = capture->m_sampleQueue.front();
             capture->m_sampleQueue.pop();
             lock.unlock();
-            capture->m_CodecHelper.DecodeH264ToTexture(pSample, 0, nullptr); // TODO: 实现解码逻辑
-        
+
+            // MFT 在后台预热，首个采样可能需要等待其完成
+            if (FAILED(capture->WaitForCodecs())) continue;
+
+            // 读取线程切换相机时会改写采集格式，这里只用锁内取到的快照
+            VideoFormat captureFormat = capture->GetCaptureFormat();
+            std::vector<ComPtr<IMFSample>> decodedSamples;
+            VideoFormat decodedFormat = {};
+            if (captureFormat.subtype == VideoSubtype::H264) {
+                // 切换到格式不同的相机后，解码器按新码流重新借出和设置
+                if (MFGetAttributeUINT32(pSample.Get(), MFSampleExtension_Discontinuity, FALSE)) {
+                    capture->m_CodecHelper.ResetDecoder();
+                }
+                capture->m_CodecHelper.DecodeH264ToSamples(pSample, captureFormat, decodedSamples);
+                decodedFormat = capture->m_CodecHelper.GetDecoderOutputFormat();
+            }
+            else if (FormatNegotiator::IsPipelineSubtype(captureFormat.subtype)) {
+                // 原始 NV12/P010/I010 不经解码器，复制一份后与解码帧走同一条路径；
+                // 回看缓存会长时间持有帧，直接引用采集采样会耗尽读取器的缓冲
+                ComPtr<IMFSample> pFrame;
+                LONGLONG sampleTime = 0, sampleDuration = 0;
+                if (FAILED(CreateAndCopySingleBufferIMFSample(pSample.Get(), &pFrame)) || !pFrame) continue;
+                if (SUCCEEDED(pSample->GetSampleTime(&sampleTime))) pFrame->SetSampleTime(sampleTime);
+                if (SUCCEEDED(pSample->GetSampleDuration(&sampleDuration))) pFrame->SetSampleDuration(sampleDuration);
+                decodedSamples.push_back(pFrame);
+                decodedFormat = captureFormat;
+            }
+            else {
+                continue;
+            }
+
+            // 广角镜头先做畸变校正，回看缓存、预览和分析都使用校正后的帧
+            capture->DewarpFrames(decodedSamples, decodedFormat);
+
+            // 解码帧进入回看缓存
+            for (auto& decoded : decodedSamples) {
+                capture->m_frameCache.Insert(decoded.Get(), decodedFormat);
+            }
+            if (decodedSamples.empty()) continue;
+
+            // 画面没有变化时保留上一次的预览，跳过转换、纹理上传和 Present
+            bool repeat = capture->SkipStaticPreview(decodedSamples.back().Get(), decodedFormat);
+            capture->ReportStaticScene();
+            if (repeat) continue;
+
+            // 只预览最新的一帧：一趟完成裁剪、缩放和 RGBA 转换
+            PreviewFrame previewFrame;
+            if (FAILED(capture->ConvertPreviewFrame(decodedSamples.back().Get(), decodedFormat, previewFrame))) continue;
 
             std::lock_guard<std::mutex> renderLock(capture->m_renderMutex);
-            capture->m_renderQueue.push();
+            capture->m_renderQueue.push(std::move(previewFrame));
             capture->m_renderCV.notify_one();
         }
     }
@@ -353,17 +1086,22 @@ void RenderThread(CameraCapture* capture) {
         capture->m_renderCV.wait(lock, [capture] { return !capture->m_renderQueue.empty() || capture->m_stopThreads; });
 
         if (!capture->m_renderQueue.empty()) {
-            std::vector<BYTE> frameData = capture->m_renderQueue.front();
+            PreviewFrame frame = std::move(capture->m_renderQueue.front());
             capture->m_renderQueue.pop();
             lock.unlock();
 
+            // 帧数据已由预览阶段转换为预览尺寸的 RGBA 或 RGB10A2
+            UINT32 width = capture->m_previewWidth, height = capture->m_previewHeight;
+            if (frame.pixels.size() < static_cast<size_t>(width) * height * 4) continue;
+            if (FAILED(capture->SetBackBufferFormat(frame.format))) continue;
+
             // 创建Direct3D 11纹理
             D3D11_TEXTURE2D_DESC desc = {};
-            desc.Width = 3840;
-            desc.Height = 2160;
+            desc.Width = width;
+            desc.Height = height;
             desc.MipLevels = 1;
             desc.ArraySize = 1;
-            desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            desc.Format = frame.format;
             desc.SampleDesc.Count = 1;
             desc.Usage = D3D11_USAGE_DEFAULT;
             desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
@@ -374,7 +1112,7 @@ void RenderThread(CameraCapture* capture) {
             if (FAILED(hr)) continue;
 
             // 更新纹理数据
-            capture->m_pContext->UpdateSubresource(pTexture.Get(), 0, nullptr, frameData.data(), 3840 * 4, 0);
+            capture->m_pContext->UpdateSubresource(pTexture.Get(), 0, nullptr, frame.pixels.data(), width * 4, 0);
 
             // 设置渲染目标
             capture->m_pContext->OMSetRenderTargets(1, capture->m_pRenderTargetView.GetAddressOf(), nullptr);
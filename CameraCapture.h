@@ -15,12 +15,25 @@
 #include <vector>
 #include <string>
 #include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <future>
 #include <mftransform.h>
 #include <mfobjects.h>
 #include "MFTCodecHelper.h"
+#include "DeviceRegistry.h"
+#include "PreRollBuffer.h"
+#include "DecodedFrameCache.h"
+#include "FormatNegotiator.h"
+#include "StartupTimeline.h"
+#include "VideoScaler.h"
+#include "CropScaleConverter.h"
+#include "FrameRotator.h"
+#include "ChangeDetector.h"
+#include "LensDewarper.h"
+#include "FrameStatistics.h"
 
 #pragma comment(lib, "mfplat.lib")
 #pragma comment(lib, "mfreadwrite.lib")
@@ -41,6 +54,20 @@ struct CameraInfo {
     std::wstring symbolicLink;
 };
 
+// 预览阶段输出的一帧：预览尺寸、每像素 4 字节，format 为对应的纹理格式
+struct PreviewFrame {
+    std::vector<BYTE> pixels;
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+};
+
+// 静止画面跳过的工作量：重复帧不做预览转换（CPU），也不上传纹理、不 Present（GPU）
+struct StaticSceneStats {
+    ChangeDetectorStats detector;
+    UINT64 skippedPreviews = 0;         // 跳过的预览转换、上传和 Present 次数
+    UINT64 skippedUploadBytes = 0;
+    double savedCpuMs = 0.0;            // 按预览转换的平均耗时估算
+};
+
 class CameraCapture {
 public:
     ComPtr<IMFSourceReader> m_pSourceReader;
@@ -48,6 +75,7 @@ public:
     ComPtr<ID3D11DeviceContext> m_pContext;
     ComPtr<IDXGISwapChain> m_pSwapChain;
     ComPtr<ID3D11RenderTargetView> m_pRenderTargetView;
+    DXGI_FORMAT m_backBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;  // 10 位预览帧到来时切换为 R10G10B10A2
     
     // 帧率统计相关
     std::chrono::steady_clock::time_point m_lastFpsTime;
@@ -58,9 +86,13 @@ public:
     std::vector<CameraInfo> m_cameraList;
     int m_selectedCameraIndex = -1;
 
+    // 设备注册表：缓存相机身份，随热插拔通知增量更新
+    DeviceRegistry m_deviceRegistry;
+    UINT64 m_cameraListGeneration = 0;
+
     // 新增队列和线程相关成员变量
     std::queue<ComPtr<IMFSample>> m_sampleQueue;
-    std::queue<std::vector<BYTE>> m_renderQueue;
+    std::queue<PreviewFrame> m_renderQueue;
     std::mutex m_sampleMutex, m_renderMutex;
     std::condition_variable m_sampleCV, m_renderCV;
     bool m_stopThreads = true;
@@ -71,13 +103,106 @@ public:
     ComPtr<IMFMediaType> m_pOutputType;
     MFTCodecHelper m_CodecHelper;
 
+    // 采集格式协商，目标默认为 H264 3840x2160@25
+    FormatNegotiator m_formatNegotiator;
+    NegotiationTarget m_formatTarget;
+
+    // 当前采集格式，设置媒体类型或流变化时在读取线程解析一次；其它线程经 GetCaptureFormat 在锁内取快照
+    mutable std::mutex m_captureFormatMutex;
+    VideoFormat m_captureFormat = {};
+
+    // 事件录像预录缓冲（按字节预算，默认 64MB；不为 0 时格式协商优先只在 H264 模式中选择）
+    PreRollBuffer m_preRoll;
+    size_t m_preRollBudget = 64 * 1024 * 1024;
+
+    // 实时回看的解码帧缓存（按字节预算，默认 256MB）
+    DecodedFrameCache m_frameCache;
+    size_t m_frameCacheBudget = 256 * 1024 * 1024;
+
+    // 预览交换链尺寸：预览显示在小窗口里，不按 4K 采集分辨率创建
+    UINT32 m_previewWidth = 1280;
+    UINT32 m_previewHeight = 720;
+
+    // 分析用小图的缩放器，系数表在尺寸不变时复用
+    std::mutex m_scalerMutex;
+    VideoScaler m_analyticsScaler;
+
+    // 镜头畸变校正：解码帧按标定重映射后再进入回看缓存、预览和分析，由 ProcessThread 调用
+    std::mutex m_dewarpMutex;
+    LensDewarper m_dewarper;
+    bool m_dewarpEnabled = false;
+    HRESULT DewarpFrames(std::vector<ComPtr<IMFSample>>& samples, const VideoFormat& format);
+
+    // 预览阶段：解码帧（原始 NV12/P010/I010 采集帧不经解码）一趟裁剪、缩放、翻转到预览尺寸并转换为 RGBA（10 位解码格式转换为 RGB10A2），由 ProcessThread 调用
+    std::mutex m_previewMutex;
+    CropScaleConverter m_previewConverter;
+    CropRect m_previewCrop;                     // 宽或高为 0 表示整帧
+    FrameOrientation m_orientation = FrameOrientation::Identity;
+    FrameRotator m_previewRotator;              // 90/270 度安装时先转置解码帧
+    UINT64 m_previewConfigHash = 0;             // 上次配置时的解码格式哈希
+    bool m_previewDirty = true;
+    double m_previewConvertMs = 0.0;            // 预览转换耗时的滑动平均
+    HRESULT ConvertPreviewFrame(IMFSample* pDecoded, const VideoFormat& decodedFormat, PreviewFrame& frame);
+
+    // 帧统计在预览转换锁定解码帧时顺带计算，与预览状态一起由 m_previewMutex 保护；读取走无锁快照
+    FrameStatistics m_frameStats;
+
+    // 静止画面检测：解码帧与上一次预览的帧没有可见变化时 ProcessThread 不再转换和提交预览
+    ChangeDetector m_changeDetector;            // 与统计一起由 m_previewMutex 保护
+    StaticSceneStats m_staticSceneStats;
+    std::chrono::steady_clock::time_point m_lastStaticReport;
+    bool SkipStaticPreview(IMFSample* pDecoded, const VideoFormat& format);
+    void ReportStaticScene();
+
+    // 渲染线程调用：交换链缓冲格式与预览帧不一致时重建缓冲和渲染目标视图
+    HRESULT SetBackBufferFormat(DXGI_FORMAT format);
+
+    // 热备读取器：为最可能切换到的相机预先打开并协商好格式，但不读取采样
+    struct StandbyReader {
+        int cameraIndex = -1;
+        ComPtr<IMFSourceReader> pReader;
+    };
+    std::mutex m_readerMutex;                   // 保护活动/热备/待切换读取器的交换
+    std::vector<StandbyReader> m_standbyReaders;
+    StandbyReader m_pendingReader;              // 等待关键帧后成为活动读取器
+    std::thread m_pendingThread;                // 读取待切换读取器直到关键帧，不阻塞 RenderFrame
+    UINT64 m_pendingGeneration = 0;             // 每次登记或作废切换时递增，旧的读取线程据此退出
+    ComPtr<IMFSample> m_pendingKeyframe;        // 读取线程交出的关键帧，RenderFrame 取走时切换
+    DWORD m_pendingFlags = 0;
+    bool m_pendingFailed = false;
+    std::chrono::milliseconds m_standbySwitchTimeout{ 2000 };  // 超过此时间还没有关键帧时向相机请求
+    size_t m_standbyCount = 0;
+    std::deque<int> m_recentCameras;            // 最近选择的相机在前
+    std::future<void> m_standbyRefresh;
+    bool m_standbyRefreshRunning = false;
+    bool m_standbyRefreshRequested = false;
+    LONGLONG m_timestampOffset = 0;             // 切换相机后保持时间戳连续
+    LONGLONG m_lastSampleEnd = 0;
+    bool m_rebaseTimestamps = false;
+
     HRESULT EnumerateCameras();
     HRESULT CreateMediaSourceReader(const std::wstring& symbolicLink);
+    HRESULT OpenSourceReader(const std::wstring& symbolicLink, IMFSourceReader** ppReader);
+    void NoteCameraUsedLocked(int index);
+    void ScheduleStandbyRefresh();
+    void RefreshStandbyReaders();
+    void ReadPendingReader(ComPtr<IMFSourceReader> pReader, UINT64 generation);
+    void CancelPendingReader();
+    HRESULT PollPendingReader(ComPtr<IMFSample>& pSample, DWORD* pdwFlags);
+    bool CanEncodeCapture() const;
+    HRESULT EncodeForPreRoll(IMFSample* pSample);
+    static void StopSourceReader(IMFSourceReader* pReader, bool flush = true);
     HRESULT CreateD3D11DeviceAndSwapChain();
     void UpdateFps();
     void Cleanup();
     HRESULT InitializeMFT();
 
+    // 启动时间线与后台 MFT 预热
+    StartupTimeline m_startupTimeline;
+    std::shared_future<HRESULT> m_codecInit;
+    bool m_comInitialized = false;
+    HRESULT UpdateCaptureFormat();
+
 public:
     CameraCapture();
     ~CameraCapture();
@@ -85,12 +210,76 @@ public:
     // 获取可用相机列表
     const std::vector<CameraInfo>& GetCameraList() const { return m_cameraList; }
     
+    // 设备注册表在相机插拔后已变化、GetCameraList 需要刷新时返回 true
+    bool IsCameraListStale() const;
+
+    // 从注册表取最新相机列表（不重新枚举），当前及热备相机的下标按符号链接重新映射
+    HRESULT RefreshCameraList();
+
     // 选择相机
     HRESULT SelectCamera(int index);
     
+    // 热备模式：为最可能切换到的 count 个相机保持已打开、已协商的读取器，0 表示关闭
+    HRESULT EnableHotStandby(size_t count);
+
     // 获取当前选中的相机索引
     int GetSelectedCameraIndex() const { return m_selectedCameraIndex; }
 
     HRESULT Initialize();
     HRESULT RenderFrame();
+
+    // 等待后台 MFT 初始化完成，返回其结果
+    HRESULT WaitForCodecs();
+
+    // 共享编解码器池的命中/未命中次数和创建耗时
+    static MFTPoolStats GetCodecPoolStats() { return MFTPool::Shared().GetStats(); }
+
+    // 启动各阶段耗时及首帧时间
+    const StartupTimeline& GetStartupTimeline() const { return m_startupTimeline; }
+
+    // 触发事件录像：写出预录内容并继续写入实时码流。H264 采集直接写相机码流，NV12/P010/I010 采集写预录时编码的码流；
+    // 其它采集格式返回 MF_E_INVALIDMEDIATYPE
+    HRESULT StartEventRecording(const std::wstring& outputFilePath);
+
+    // 停止事件录像
+    HRESULT StopEventRecording();
+
+    // 当前采集格式的快照，任意线程调用
+    VideoFormat GetCaptureFormat() const {
+        std::lock_guard<std::mutex> lock(m_captureFormatMutex);
+        return m_captureFormat;
+    }
+
+    // 实时回看：获取缓存中覆盖 hnsTime 的解码帧
+    HRESULT GetRewindFrame(LONGLONG hnsTime, IMFSample** ppSample);
+
+    // 同上，但缩小到 width x height（像素格式与解码输出相同），只需要小图的分析代码不必读取全分辨率帧
+    HRESULT GetRewindFrameScaled(LONGLONG hnsTime, UINT32 width, UINT32 height, ScaleFilter filter, IMFSample** ppSample);
+
+    // 预览交换链尺寸，须在 Initialize 之前设置
+    void SetPreviewSize(UINT32 width, UINT32 height) { m_previewWidth = width; m_previewHeight = height; }
+
+    // 预览只显示解码帧中的这一区域（数字变焦），宽或高为 0 恢复整帧
+    void SetPreviewCrop(const CropRect& crop);
+
+    // 相机安装方向（倒装、竖装），预览和编码器输入都按此旋转；裁剪区域仍按解码帧坐标给出
+    void SetOrientation(FrameOrientation orientation);
+
+    // 原始格式（NV12/P010）采集编码进预录缓冲前的时域降噪，默认关闭；H264 采集不经过编码器，不受影响
+    void SetEncoderDenoise(bool enable, const TemporalDenoiseSettings& settings = TemporalDenoiseSettings()) {
+        m_CodecHelper.SetEncoderDenoise(enable, settings);
+    }
+
+    // 广角镜头的畸变校正标定，从下一帧开始生效；ClearLensCalibration 关闭校正
+    HRESULT SetLensCalibration(const LensCalibration& calibration);
+    void ClearLensCalibration();
+
+    // 最新一帧的亮度统计（直方图、曝光、截断比例、锐度），任意线程调用不加锁；还没有统计过任何帧时返回 false。
+    // 每个预览帧的统计也写在解码采样的 FrameStatistics_Stats 属性上，回看缓存取出的帧同样带有
+    bool GetFrameStatistics(FrameStats* pStats) const { return m_frameStats.GetLatest(pStats); }
+    void SetFrameStatsSettings(const FrameStatsSettings& settings);
+
+    // 静止画面检测的阈值；预览因画面未变化而跳过的转换、上传和 Present 统计
+    void SetChangeDetectorSettings(const ChangeDetectorSettings& settings);
+    StaticSceneStats GetStaticSceneStats();
 };
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "ChangeDetector.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CHANGE_DETECTOR_SSE2 1
+#endif
+
+// {5C2A1E47-8D3B-4F6A-9E21-7B0C4D9F3A18}
+const GUID ChangeDetector_RepeatFrame = { 0x5c2a1e47, 0x8d3b, 0x4f6a, { 0x9e, 0x21, 0x7b, 0x0c, 0x4d, 0x9f, 0x3a, 0x18 } };
+
+static const UINT32 BLOCK_SIZE = 16;
+
+bool ChangeDetector::IsSupported(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ChangeDetector::Reset() {
+    m_width = m_height = 0;
+    m_repeatRun = 0;
+}
+
+// 一个抽样行：逐块累加 16 字节的 SAD，同时把当前样点存入候选参考行
+static void SadRow(const BYTE* pRow, const BYTE* pRef, BYTE* pCandidate, UINT32 width, UINT32 blocksX, UINT32* pBlockSad) {
+    for (UINT32 bx = 0; bx < blocksX; bx++) {
+        // 宽度不是 16 的倍数时最后一块与前一块重叠，仍然只读行内数据
+        const BYTE* p = pRow + (std::min)(bx * BLOCK_SIZE, width - BLOCK_SIZE);
+        const BYTE* r = pRef + bx * BLOCK_SIZE;
+#ifdef CHANGE_DETECTOR_SSE2
+        __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i sad = _mm_sad_epu8(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(r)));
+        pBlockSad[bx] += static_cast<UINT32>(_mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pCandidate + bx * BLOCK_SIZE), cur);
+#else
+        UINT32 sum = 0;
+        for (UINT32 i = 0; i < BLOCK_SIZE; i++) sum += static_cast<UINT32>(std::abs(p[i] - r[i]));
+        pBlockSad[bx] += sum;
+        memcpy(pCandidate + bx * BLOCK_SIZE, p, BLOCK_SIZE);
+#endif
+    }
+}
+
+HRESULT ChangeDetector::Analyze(const ImagePlanes& frame, ChangeResult* pResult) {
+    if (pResult == nullptr || frame.data[0] == nullptr) return E_POINTER;
+    if (!IsSupported(frame.subtype)) return MF_E_INVALIDMEDIATYPE;
+    if (frame.width < BLOCK_SIZE || frame.height < BLOCK_SIZE) return MF_E_INVALIDMEDIATYPE;
+
+    auto start = std::chrono::steady_clock::now();
+    const UINT32 rowStep = (std::max)(m_settings.rowStep, 1u);
+    const UINT32 rowsPerBlock = (BLOCK_SIZE + rowStep - 1) / rowStep;
+    const UINT32 rowBytes = ((frame.width + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE;
+
+    // 没有可比较的参考：本帧按变化帧处理，只建立参考
+    bool fresh = (frame.width != m_width || frame.height != m_height);
+    if (fresh) {
+        m_width = frame.width;
+        m_height = frame.height;
+        m_blocksX = rowBytes / BLOCK_SIZE;
+        m_blocksY = (frame.height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        m_reference.assign(static_cast<size_t>(rowBytes) * m_blocksY * rowsPerBlock, 0);
+        m_candidate.assign(m_reference.size(), 0);
+        m_blockSad.assign(m_blocksX, 0);
+    }
+
+    ChangeResult result;
+    result.totalBlocks = m_blocksX * m_blocksY;
+    const UINT32 threshold = m_settings.blockThreshold * BLOCK_SIZE * rowsPerBlock;
+
+    for (UINT32 by = 0; by < m_blocksY; by++) {
+        std::fill(m_blockSad.begin(), m_blockSad.end(), 0);
+        // 最后一行块与前一行块重叠，和列方向相同
+        UINT32 top = (std::min)(by * BLOCK_SIZE, frame.height - BLOCK_SIZE);
+        for (UINT32 k = 0; k < rowsPerBlock; k++) {
+            const BYTE* pRow = frame.data[0] + static_cast<ptrdiff_t>(top + k * rowStep) * frame.stride[0];
+            size_t offset = (static_cast<size_t>(by) * rowsPerBlock + k) * rowBytes;
+            SadRow(pRow, &m_reference[offset], &m_candidate[offset], frame.width, m_blocksX, m_blockSad.data());
+        }
+        for (UINT32 bx = 0; bx < m_blocksX; bx++) {
+            if (m_blockSad[bx] > threshold) result.changedBlocks++;
+        }
+    }
+
+    m_stats.frames++;
+    bool changed = fresh || result.changedBlocks >= (std::max)(m_settings.minChangedBlocks, 1u);
+    if (!changed && m_settings.maxRepeats != 0 && m_repeatRun + 1 >= m_settings.maxRepeats) {
+        m_stats.forcedRefreshes++;
+        changed = true;
+    }
+
+    if (changed) {
+        // 送出的帧成为新的参考
+        m_reference.swap(m_candidate);
+        m_repeatRun = 0;
+    }
+    else {
+        m_repeatRun++;
+        m_stats.repeats++;
+    }
+
+    result.repeat = !changed;
+    *pResult = result;
+    m_stats.analyzeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return S_OK;
+}
+
+HRESULT ChangeDetector::AnalyzeSample(IMFSample* pSample, const VideoFormat& format, ChangeResult* pResult) {
+    if (pSample == nullptr || pResult == nullptr) return E_POINTER;
+
+    Microsoft::WRL::ComPtr<IMFMediaBuffer> pBuffer;
+    HRESULT hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pData = nullptr;
+    DWORD length = 0;
+    hr = pBuffer->Lock(&pData, nullptr, &length);
+    if (FAILED(hr)) return hr;
+
+    ImagePlanes planes = {};
+    hr = ImagePlanesFromBuffer(format, pData, length, &planes);
+    if (SUCCEEDED(hr)) hr = Analyze(planes, pResult);
+    pBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    return pSample->SetUINT32(ChangeDetector_RepeatFrame, pResult->repeat ? TRUE : FALSE);
+}
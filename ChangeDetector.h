@@ -0,0 +1,60 @@
+#pragma once
+#include <windows.h>
+#include <mfidl.h>
+#include <vector>
+#include "VideoFormat.h"
+
+// 采样属性（UINT32）：非零表示该帧与上一个送出的帧相比没有可见变化，下游可以跳过编码、上传和 Present
+extern const GUID ChangeDetector_RepeatFrame;
+
+struct ChangeDetectorSettings {
+    UINT32 rowStep = 2;             // 抽样网格：16x16 块内每隔 rowStep 行取一行（每行 16 个连续样点）
+    UINT32 blockThreshold = 4;      // 块内平均每样点绝对差超过此值算变化块，低于它的差异视为噪声
+    UINT32 minChangedBlocks = 1;    // 变化块达到此数量时整帧算变化
+    UINT32 maxRepeats = 250;        // 连续重复帧上限，到达后强制按变化帧送出，避免画面长时间不刷新；0 表示不限
+};
+
+struct ChangeResult {
+    bool repeat = false;
+    UINT32 changedBlocks = 0;
+    UINT32 totalBlocks = 0;
+};
+
+struct ChangeDetectorStats {
+    UINT64 frames = 0;              // 分析的帧数
+    UINT64 repeats = 0;             // 判为重复的帧数
+    UINT64 forcedRefreshes = 0;     // 因 maxRepeats 强制送出的帧数
+    double analyzeMs = 0.0;         // 累计分析耗时
+};
+
+// 静止画面检测
+// 在亮度平面的抽样网格上按 16x16 块计算 SAD（SSE2 psadbw），与上一个送出的帧比较；
+// 重复帧不更新参考，缓慢的变化会逐帧累积直到超过阈值。只看 8 位亮度（NV12/I420/IYUV/YV12）
+class ChangeDetector {
+public:
+    static bool IsSupported(VideoSubtype subtype);
+
+    void SetSettings(const ChangeDetectorSettings& settings) { m_settings = settings; }
+    const ChangeDetectorSettings& GetSettings() const { return m_settings; }
+
+    // 第一帧、尺寸变化或 Reset 之后的第一帧总是变化帧
+    HRESULT Analyze(const ImagePlanes& frame, ChangeResult* pResult);
+
+    // 锁定采样缓冲按 format 分析，并在采样上设置 ChangeDetector_RepeatFrame
+    HRESULT AnalyzeSample(IMFSample* pSample, const VideoFormat& format, ChangeResult* pResult);
+
+    // 下一帧强制按变化帧处理（流切换、编码器重建后调用）
+    void Reset();
+
+    const ChangeDetectorStats& GetStats() const { return m_stats; }
+
+private:
+    ChangeDetectorSettings m_settings;
+    ChangeDetectorStats m_stats;
+    UINT32 m_width = 0, m_height = 0;
+    UINT32 m_blocksX = 0, m_blocksY = 0;
+    UINT32 m_repeatRun = 0;
+    std::vector<BYTE> m_reference;      // 上一个送出帧的抽样行，每行 m_blocksX * 16 字节
+    std::vector<BYTE> m_candidate;      // 当前帧的抽样行，判为变化帧时与 m_reference 交换
+    std::vector<UINT32> m_blockSad;
+};
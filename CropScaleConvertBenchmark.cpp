@@ -0,0 +1,474 @@
+/******************************************************************************
+* Filename: CropScaleConvertBenchmark.cpp
+*
+* Description:
+* Compares the fused CropScaleConverter against the three separate passes it
+* replaces: crop copy, VideoScaler (bilinear) and a full-frame YUV to RGBA
+* conversion. Reports time per frame and the bytes each approach streams
+* through memory, from a 3840x2160 NV12 or I420 source.
+*
+* The p010 mode instead times the 10-bit paths against their 8-bit
+* equivalents: P010 -> RGBA and P010 -> RGB10A2 against NV12 -> RGBA, and the
+* dithered P010 -> NV12 narrowing against an I420 -> NV12 repack.
+*
+* The rotate mode times FrameRotator on 4K NV12, I420 and RGB32 frames against
+* a memcpy of the same frame (the memory-bandwidth bound), and a 180-degree
+* preview with the flip fused into the conversion against rotate-then-convert.
+*
+* The dewarp mode builds a LensDewarper remap table for a typical wide-angle
+* calibration and times the correction of 4K NV12 and I420 frames on one to
+* four cores against the 33.3 ms budget of a 30 fps stream.
+*
+* The stats mode times FrameStatistics (luma histogram, exposure and
+* Laplacian sharpness on the subsampled grid) on a 4K NV12 frame against its
+* 0.5 ms budget, next to the preview conversion it runs alongside.
+*
+* Usage: CropScaleConvertBenchmark [nv12|i420|p010|rotate|dewarp|stats] [dstWidth] [dstHeight] [frames]
+*
+* License: Public Domain (no warranty, use at own risk)
+*******************************************************************************/
+
+#include "MFUtility.h"
+#include "CropScaleConverter.h"
+#include "VideoScaler.h"
+#include "BitDepthConverter.h"
+#include "FrameRotator.h"
+#include "LensDewarper.h"
+#include "FrameStatistics.h"
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfuuid.lib")
+
+#define SRC_WIDTH 3840
+#define SRC_HEIGHT 2160
+#define HIGH_BIT_DEPTH_BUDGET 1.5
+#define FRAME_BUDGET_30FPS_MS 33.3
+#define FRAME_STATS_BUDGET_MS 0.5
+
+/**
+* Parses a VideoFormat for an uncompressed frame of the given subtype and size.
+*/
+HRESULT MakeFormat(const GUID& subtype, UINT32 width, UINT32 height, VideoFormat* pFormat)
+{
+  IMFMediaType* pType = NULL;
+  HRESULT hr = S_OK;
+
+  CHECK_HR(MFCreateMediaType(&pType), "Failed to create media type.");
+  CHECK_HR(pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video), "Failed to set major type.");
+  CHECK_HR(pType->SetGUID(MF_MT_SUBTYPE, subtype), "Failed to set subtype.");
+  CHECK_HR(MFSetAttributeSize(pType, MF_MT_FRAME_SIZE, width, height), "Failed to set frame size.");
+  CHECK_HR(pType->SetUINT32(MF_MT_YUV_MATRIX, MFVideoTransferMatrix_BT709), "Failed to set YUV matrix.");
+  CHECK_HR(VideoFormatFromMediaType(pType, pFormat), "Failed to parse media type.");
+
+done:
+  SAFE_RELEASE(pType);
+  return hr;
+}
+
+/**
+* Copies the crop rectangle of every plane into a tightly packed frame of the same subtype.
+*/
+void CropCopy(const ImagePlanes& src, const CropRect& crop, const ImagePlanes& dst)
+{
+  for (UINT32 i = 0; i < src.planeCount; i++) {
+    UINT32 div = (i == 0) ? 1 : 2;
+    UINT32 bytesPerPixel = (src.subtype == VideoSubtype::NV12 && i == 1) ? 2 : 1;
+    UINT32 rowBytes = crop.width / div * bytesPerPixel;
+    for (UINT32 y = 0; y < crop.height / div; y++) {
+      const BYTE* pSrcRow = src.data[i] + static_cast<ptrdiff_t>(crop.y / div + y) * src.stride[i] + crop.x / div * bytesPerPixel;
+      memcpy(dst.data[i] + static_cast<ptrdiff_t>(y) * dst.stride[i], pSrcRow, rowBytes);
+    }
+  }
+}
+
+/**
+* Repacks an I420 frame as NV12: the 8-bit counterpart of the P010 -> NV12 narrowing.
+*/
+void I420ToNV12(const ImagePlanes& src, const ImagePlanes& dst)
+{
+  for (UINT32 y = 0; y < src.height; y++) {
+    memcpy(dst.data[0] + static_cast<ptrdiff_t>(y) * dst.stride[0], src.data[0] + static_cast<ptrdiff_t>(y) * src.stride[0], src.width);
+  }
+  for (UINT32 y = 0; y < (src.height + 1) / 2; y++) {
+    const BYTE* pU = src.data[1] + static_cast<ptrdiff_t>(y) * src.stride[1];
+    const BYTE* pV = src.data[2] + static_cast<ptrdiff_t>(y) * src.stride[2];
+    BYTE* pUV = dst.data[1] + static_cast<ptrdiff_t>(y) * dst.stride[1];
+    for (UINT32 x = 0; x < (src.width + 1) / 2; x++) {
+      pUV[x * 2] = pU[x];
+      pUV[x * 2 + 1] = pV[x];
+    }
+  }
+}
+
+/**
+* Runs work the given number of times and returns the average milliseconds per run.
+*/
+template <typename Work>
+double TimeFrames(int frames, Work work)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    work();
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+void PrintRatio(const char* name, double highMs, double baseMs)
+{
+  double ratio = highMs / baseMs;
+  printf("%-24s %8.3f ms/frame vs %8.3f ms/frame: %5.2fx %s\n", name, highMs, baseMs, ratio,
+    ratio <= HIGH_BIT_DEPTH_BUDGET ? "(within budget)" : "(OVER BUDGET)");
+}
+
+/**
+* Times the 10-bit conversions against the same conversions on 8-bit frames.
+*/
+int RunBitDepthBenchmark(UINT32 dstWidth, UINT32 dstHeight, int frames)
+{
+  VideoFormat nv12Format, i420Format, p010Format;
+  if (FAILED(MakeFormat(MFVideoFormat_NV12, SRC_WIDTH, SRC_HEIGHT, &nv12Format)) ||
+    FAILED(MakeFormat(MFVideoFormat_I420, SRC_WIDTH, SRC_HEIGHT, &i420Format)) ||
+    FAILED(MakeFormat(MFVideoFormat_P010, SRC_WIDTH, SRC_HEIGHT, &p010Format))) {
+    return 1;
+  }
+
+  // Same picture at both depths: 10-bit samples in the high bits of each 16-bit word.
+  std::vector<BYTE> nv12Frame(nv12Format.frameBytes), i420Frame(i420Format.frameBytes), p010Frame(p010Format.frameBytes);
+  std::vector<BYTE> nv12Out(nv12Format.frameBytes);
+  UINT16* pP010 = reinterpret_cast<UINT16*>(p010Frame.data());
+  for (size_t i = 0; i < nv12Frame.size(); i++) {
+    UINT32 sample = static_cast<UINT32>((i * 7) ^ (i >> 11)) & 0x3FF;
+    nv12Frame[i] = static_cast<BYTE>(sample >> 2);
+    pP010[i] = static_cast<UINT16>(sample << 6);
+  }
+  for (size_t i = 0; i < i420Frame.size(); i++) i420Frame[i] = nv12Frame[i];
+
+  ImagePlanes nv12, i420, p010, narrowed;
+  ImagePlanesFromBuffer(nv12Format, nv12Frame.data(), static_cast<DWORD>(nv12Frame.size()), &nv12);
+  ImagePlanesFromBuffer(i420Format, i420Frame.data(), static_cast<DWORD>(i420Frame.size()), &i420);
+  ImagePlanesFromBuffer(p010Format, p010Frame.data(), static_cast<DWORD>(p010Frame.size()), &p010);
+  ImagePlanesFromBuffer(nv12Format, nv12Out.data(), static_cast<DWORD>(nv12Out.size()), &narrowed);
+
+  CropScaleConverter nv12Rgba, p010Rgba, p010Rgb10;
+  HRESULT hr = nv12Rgba.Configure(nv12Format, CropRect(), dstWidth, dstHeight, RgbLayout::RGBA);
+  if (SUCCEEDED(hr)) hr = p010Rgba.Configure(p010Format, CropRect(), dstWidth, dstHeight, RgbLayout::RGBA);
+  if (SUCCEEDED(hr)) hr = p010Rgb10.Configure(p010Format, CropRect(), dstWidth, dstHeight, RgbLayout::RGB10A2);
+  if (FAILED(hr)) {
+    printf("Failed to configure the benchmark stages %.2X.\n", hr);
+    return 1;
+  }
+
+  BitDepthConverter narrow;
+  std::vector<BYTE> rgb(static_cast<size_t>(dstWidth) * dstHeight * 4);
+  LONG rgbStride = static_cast<LONG>(dstWidth * 4);
+
+  double nv12RgbaMs = TimeFrames(frames, [&] { nv12Rgba.Convert(nv12, rgb.data(), rgbStride); });
+  double p010RgbaMs = TimeFrames(frames, [&] { p010Rgba.Convert(p010, rgb.data(), rgbStride); });
+  double p010Rgb10Ms = TimeFrames(frames, [&] { p010Rgb10.Convert(p010, rgb.data(), rgbStride); });
+  double repackMs = TimeFrames(frames, [&] { I420ToNV12(i420, narrowed); });
+  double narrowMs = TimeFrames(frames, [&] { narrow.ConvertToNV12(p010, narrowed); });
+
+  printf("%ux%u source -> %ux%u, %d frames, budget %.1fx of 8-bit.\n", SRC_WIDTH, SRC_HEIGHT, dstWidth, dstHeight,
+    frames, HIGH_BIT_DEPTH_BUDGET);
+  PrintRatio("P010 -> RGBA", p010RgbaMs, nv12RgbaMs);
+  PrintRatio("P010 -> RGB10A2", p010Rgb10Ms, nv12RgbaMs);
+  PrintRatio("P010 -> NV12 (dithered)", narrowMs, repackMs);
+  return 0;
+}
+
+/**
+* Times every orientation change that swaps or mirrors axes against a plain copy of the same frame.
+*/
+int RunRotateBenchmark(UINT32 dstWidth, UINT32 dstHeight, int frames)
+{
+  struct Case {
+    const char* name;
+    const GUID* subtype;
+  } cases[] = { { "NV12", &MFVideoFormat_NV12 }, { "I420", &MFVideoFormat_I420 }, { "RGB32", &MFVideoFormat_RGB32 } };
+  struct Turn {
+    const char* name;
+    FrameOrientation orientation;
+  } turns[] = { { "90", FrameOrientation::Rotate90 }, { "270", FrameOrientation::Rotate270 },
+    { "180", FrameOrientation::Rotate180 }, { "mirror", FrameOrientation::FlipHorizontal } };
+
+  FrameRotator rotator;
+  printf("%ux%u source, %d frames, %u threads. GB/s counts bytes read plus bytes written.\n", SRC_WIDTH, SRC_HEIGHT, frames,
+    ParallelBands::Shared().GetThreadCount());
+
+  for (const Case& c : cases) {
+    VideoFormat srcFormat, rotatedFormat;
+    if (FAILED(MakeFormat(*c.subtype, SRC_WIDTH, SRC_HEIGHT, &srcFormat)) ||
+      FAILED(MakeFormat(*c.subtype, SRC_HEIGHT, SRC_WIDTH, &rotatedFormat))) {
+      return 1;
+    }
+    std::vector<BYTE> srcFrame(srcFormat.frameBytes), dstFrame(srcFormat.frameBytes);
+    for (size_t i = 0; i < srcFrame.size(); i++) srcFrame[i] = static_cast<BYTE>((i * 7) ^ (i >> 11));
+
+    double bytes = 2.0 * srcFormat.frameBytes;
+    double copyMs = TimeFrames(frames, [&] { memcpy(dstFrame.data(), srcFrame.data(), srcFrame.size()); });
+    printf("%-6s memcpy        %8.3f ms/frame, %6.2f GB/s\n", c.name, copyMs, bytes / 1e6 / copyMs);
+
+    ImagePlanes src, dst;
+    ImagePlanesFromBuffer(srcFormat, srcFrame.data(), static_cast<DWORD>(srcFrame.size()), &src);
+    for (const Turn& t : turns) {
+      ImagePlanesFromBuffer(SwapsAxes(t.orientation) ? rotatedFormat : srcFormat, dstFrame.data(),
+        static_cast<DWORD>(dstFrame.size()), &dst);
+      HRESULT hr = S_OK;
+      double ms = TimeFrames(frames, [&] { hr = rotator.Rotate(src, dst, t.orientation); });
+      if (FAILED(hr)) {
+        printf("Rotation failed %.2X.\n", hr);
+        return 1;
+      }
+      printf("%-6s %-13s %8.3f ms/frame, %6.2f GB/s, %5.2fx memcpy\n", c.name, t.name, ms, bytes / 1e6 / ms, ms / copyMs);
+    }
+  }
+
+  // Upside-down camera preview: the flip folded into the conversion tables against a rotated copy converted afterwards.
+  VideoFormat nv12Format;
+  if (FAILED(MakeFormat(MFVideoFormat_NV12, SRC_WIDTH, SRC_HEIGHT, &nv12Format))) return 1;
+  std::vector<BYTE> srcFrame(nv12Format.frameBytes), rotatedFrame(nv12Format.frameBytes);
+  std::vector<BYTE> rgba(static_cast<size_t>(dstWidth) * dstHeight * 4);
+  for (size_t i = 0; i < srcFrame.size(); i++) srcFrame[i] = static_cast<BYTE>((i * 7) ^ (i >> 11));
+  ImagePlanes src, rotated;
+  ImagePlanesFromBuffer(nv12Format, srcFrame.data(), static_cast<DWORD>(srcFrame.size()), &src);
+  ImagePlanesFromBuffer(nv12Format, rotatedFrame.data(), static_cast<DWORD>(rotatedFrame.size()), &rotated);
+
+  CropScaleConverter plain, flipped;
+  HRESULT hr = plain.Configure(nv12Format, CropRect(), dstWidth, dstHeight, RgbLayout::RGBA);
+  if (SUCCEEDED(hr)) hr = flipped.Configure(nv12Format, CropRect(), dstWidth, dstHeight, RgbLayout::RGBA, FrameOrientation::Rotate180);
+  if (FAILED(hr)) {
+    printf("Failed to configure the preview converters %.2X.\n", hr);
+    return 1;
+  }
+  LONG rgbaStride = static_cast<LONG>(dstWidth * 4);
+  double separateMs = TimeFrames(frames, [&] {
+    rotator.Rotate(src, rotated, FrameOrientation::Rotate180);
+    plain.Convert(rotated, rgba.data(), rgbaStride);
+  });
+  double fusedMs = TimeFrames(frames, [&] { flipped.Convert(src, rgba.data(), rgbaStride); });
+  printf("Preview 180 -> RGBA %ux%u: rotate + convert %8.3f ms/frame, fused %8.3f ms/frame (%.2fx)\n", dstWidth, dstHeight,
+    separateMs, fusedMs, separateMs / fusedMs);
+  return 0;
+}
+
+/**
+* Times lens distortion correction of a 4K frame on one to four cores.
+*/
+int RunDewarpBenchmark(int frames)
+{
+  // Strong barrel distortion of a ~120 degree lens, calibrated at 1920x1080 and scaled to the 4K frame.
+  LensCalibration calibration;
+  calibration.width = 1920;
+  calibration.height = 1080;
+  calibration.fx = 1050.0;
+  calibration.fy = 1050.0;
+  calibration.cx = 962.3;
+  calibration.cy = 536.8;
+  calibration.k1 = -0.32;
+  calibration.k2 = 0.11;
+  calibration.k3 = -0.018;
+  calibration.p1 = 0.0004;
+  calibration.p2 = -0.0002;
+  calibration.zoom = 0.85;
+
+  struct Case {
+    const char* name;
+    const GUID* subtype;
+  } cases[] = { { "NV12", &MFVideoFormat_NV12 }, { "I420", &MFVideoFormat_I420 } };
+
+  for (const Case& c : cases) {
+    VideoFormat format;
+    if (FAILED(MakeFormat(*c.subtype, SRC_WIDTH, SRC_HEIGHT, &format))) return 1;
+    std::vector<BYTE> srcFrame(format.frameBytes), dstFrame(format.frameBytes);
+    for (size_t i = 0; i < srcFrame.size(); i++) srcFrame[i] = static_cast<BYTE>((i * 7) ^ (i >> 11));
+    ImagePlanes src, dst;
+    ImagePlanesFromBuffer(format, srcFrame.data(), static_cast<DWORD>(srcFrame.size()), &src);
+    ImagePlanesFromBuffer(format, dstFrame.data(), static_cast<DWORD>(dstFrame.size()), &dst);
+
+    LensDewarper dewarper;
+    dewarper.SetCalibration(calibration);
+    HRESULT hr = S_OK;
+    double buildMs = TimeFrames(1, [&] { hr = dewarper.Configure(format); });
+    if (FAILED(hr)) {
+      printf("Failed to build the remap table %.2X.\n", hr);
+      return 1;
+    }
+    printf("%-6s %ux%u remap table: built in %.1f ms, %.1f MB\n", c.name, SRC_WIDTH, SRC_HEIGHT, buildMs,
+      dewarper.GetTableBytes() / (1024.0 * 1024.0));
+
+    double copyMs = TimeFrames(frames, [&] { memcpy(dstFrame.data(), srcFrame.data(), srcFrame.size()); });
+    printf("%-6s memcpy            %8.3f ms/frame\n", c.name, copyMs);
+    for (UINT32 threads = 1; threads <= 4; threads++) {
+      // The calling thread works one band itself, so N cores need N - 1 workers.
+      ParallelBands bands(threads - 1);
+      dewarper.SetParallelBands(threads > 1 ? &bands : nullptr);
+      double ms = TimeFrames(frames, [&] { hr = dewarper.Remap(src, dst); });
+      if (FAILED(hr)) {
+        printf("Remap failed %.2X.\n", hr);
+        return 1;
+      }
+      printf("%-6s dewarp, %u thread%s %8.3f ms/frame, %6.1f fps (%s 30 fps budget)\n", c.name, threads,
+        threads > 1 ? "s" : " ", ms, 1000.0 / ms, ms <= FRAME_BUDGET_30FPS_MS ? "within" : "OVER");
+    }
+    dewarper.SetParallelBands(nullptr);
+  }
+  return 0;
+}
+
+/**
+* Times the frame statistics pass on a 4K frame, single-threaded and on the shared band pool.
+*/
+int RunStatsBenchmark(UINT32 dstWidth, UINT32 dstHeight, int frames)
+{
+  VideoFormat format;
+  if (FAILED(MakeFormat(MFVideoFormat_NV12, SRC_WIDTH, SRC_HEIGHT, &format))) return 1;
+  std::vector<BYTE> srcFrame(format.frameBytes);
+  std::vector<BYTE> rgba(static_cast<size_t>(dstWidth) * dstHeight * 4);
+  for (size_t i = 0; i < srcFrame.size(); i++) srcFrame[i] = static_cast<BYTE>((i * 7) ^ (i >> 11));
+  ImagePlanes src;
+  ImagePlanesFromBuffer(format, srcFrame.data(), static_cast<DWORD>(srcFrame.size()), &src);
+
+  CropScaleConverter converter;
+  HRESULT hr = converter.Configure(format, CropRect(), dstWidth, dstHeight, RgbLayout::RGBA);
+  if (FAILED(hr)) {
+    printf("Failed to configure the preview converter %.2X.\n", hr);
+    return 1;
+  }
+  double convertMs = TimeFrames(frames, [&] { converter.Convert(src, rgba.data(), static_cast<LONG>(dstWidth * 4)); });
+  printf("Preview NV12 -> RGBA %ux%u        %8.3f ms/frame\n", dstWidth, dstHeight, convertMs);
+
+  FrameStatistics statistics;
+  FrameStats stats;
+  const FrameStatsSettings& settings = statistics.GetSettings();
+  for (int shared = 0; shared < 2; shared++) {
+    statistics.SetParallelBands(shared ? &ParallelBands::Shared() : nullptr);
+    double ms = TimeFrames(frames, [&] { hr = statistics.Analyze(src, format, &stats); });
+    if (FAILED(hr)) {
+      printf("Statistics failed %.2X.\n", hr);
+      return 1;
+    }
+    printf("Statistics, %u thread%s, grid %ux%u %8.3f ms/frame (%s %.1f ms budget)\n",
+      shared ? ParallelBands::Shared().GetThreadCount() : 1, shared ? "s" : " ", settings.columnStep, settings.rowStep, ms,
+      ms <= FRAME_STATS_BUDGET_MS ? "within" : "OVER", FRAME_STATS_BUDGET_MS);
+  }
+  printf("%u samples: mean %.1f, variance %.1f, clipped %.2f%% dark / %.2f%% bright, sharpness %.1f\n", stats.samples,
+    stats.mean, stats.variance, stats.clippedDark * 100.0, stats.clippedBright * 100.0, stats.sharpness);
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  bool i420 = (argc > 1 && strcmp(argv[1], "i420") == 0);
+  bool p010 = (argc > 1 && strcmp(argv[1], "p010") == 0);
+  bool rotate = (argc > 1 && strcmp(argv[1], "rotate") == 0);
+  bool dewarp = (argc > 1 && strcmp(argv[1], "dewarp") == 0);
+  bool stats = (argc > 1 && strcmp(argv[1], "stats") == 0);
+  UINT32 dstWidth = (argc > 2) ? atoi(argv[2]) : 1280;
+  UINT32 dstHeight = (argc > 3) ? atoi(argv[3]) : 720;
+  int frames = (argc > 4) ? atoi(argv[4]) : 100;
+  if (dstWidth == 0 || dstHeight == 0 || frames <= 0) {
+    printf("Usage: CropScaleConvertBenchmark [nv12|i420|p010|rotate|dewarp|stats] [dstWidth] [dstHeight] [frames]\n");
+    return 1;
+  }
+
+  HRESULT hr = MFStartup(MF_VERSION);
+  if (FAILED(hr)) {
+    printf("Media Foundation initialisation failed %.2X.\n", hr);
+    return 1;
+  }
+
+  if (p010) {
+    int result = RunBitDepthBenchmark(dstWidth, dstHeight, frames);
+    MFShutdown();
+    return result;
+  }
+
+  if (rotate) {
+    int result = RunRotateBenchmark(dstWidth, dstHeight, frames);
+    MFShutdown();
+    return result;
+  }
+
+  if (dewarp) {
+    int result = RunDewarpBenchmark(frames);
+    MFShutdown();
+    return result;
+  }
+
+  if (stats) {
+    int result = RunStatsBenchmark(dstWidth, dstHeight, frames);
+    MFShutdown();
+    return result;
+  }
+
+  // Region of interest: the centre 1920x1080 of the 4K frame.
+  CropRect crop;
+  crop.x = 960;
+  crop.y = 540;
+  crop.width = 1920;
+  crop.height = 1080;
+
+  const GUID& subtype = i420 ? MFVideoFormat_I420 : MFVideoFormat_NV12;
+  VideoFormat srcFormat, cropFormat, scaledFormat;
+  if (FAILED(MakeFormat(subtype, SRC_WIDTH, SRC_HEIGHT, &srcFormat)) ||
+    FAILED(MakeFormat(subtype, crop.width, crop.height, &cropFormat)) ||
+    FAILED(MakeFormat(subtype, dstWidth, dstHeight, &scaledFormat))) {
+    MFShutdown();
+    return 1;
+  }
+
+  std::vector<BYTE> srcFrame(srcFormat.frameBytes), cropFrame(cropFormat.frameBytes), scaledFrame(scaledFormat.frameBytes);
+  std::vector<BYTE> rgba(static_cast<size_t>(dstWidth) * dstHeight * 4);
+  for (size_t i = 0; i < srcFrame.size(); i++) srcFrame[i] = static_cast<BYTE>((i * 7) ^ (i >> 11));
+
+  ImagePlanes src, cropped, scaled;
+  ImagePlanesFromBuffer(srcFormat, srcFrame.data(), static_cast<DWORD>(srcFrame.size()), &src);
+  ImagePlanesFromBuffer(cropFormat, cropFrame.data(), static_cast<DWORD>(cropFrame.size()), &cropped);
+  ImagePlanesFromBuffer(scaledFormat, scaledFrame.data(), static_cast<DWORD>(scaledFrame.size()), &scaled);
+
+  // Separate passes: crop copy, scale, then convert the scaled frame with no crop or scaling.
+  VideoScaler scaler;
+  CropScaleConverter convertOnly, fused;
+  hr = scaler.Configure(srcFormat.subtype, crop.width, crop.height, dstWidth, dstHeight, ScaleFilter::Bilinear);
+  if (SUCCEEDED(hr)) hr = convertOnly.Configure(scaledFormat, CropRect(), dstWidth, dstHeight, RgbLayout::RGBA);
+  if (SUCCEEDED(hr)) hr = fused.Configure(srcFormat, crop, dstWidth, dstHeight, RgbLayout::RGBA);
+  if (FAILED(hr)) {
+    printf("Failed to configure the benchmark stages %.2X.\n", hr);
+    MFShutdown();
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    CropCopy(src, crop, cropped);
+    scaler.Scale(cropped, scaled);
+    convertOnly.Convert(scaled, rgba.data(), dstWidth * 4);
+  }
+  double separateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    fused.Convert(src, rgba.data(), dstWidth * 4);
+  }
+  double fusedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+  // Bytes each approach reads and writes per frame (the crop region of the source is read once per pass that touches it).
+  double cropBytes = cropFormat.frameBytes;
+  double separateBytes = (cropBytes * 2) + (cropBytes + scaledFormat.frameBytes) + (scaledFormat.frameBytes + rgba.size());
+  double fusedBytes = cropBytes + rgba.size();
+
+  printf("%s %ux%u crop %ux%u -> RGBA %ux%u, %d frames.\n", i420 ? "I420" : "NV12", SRC_WIDTH, SRC_HEIGHT,
+    crop.width, crop.height, dstWidth, dstHeight, frames);
+  printf("Separate passes: %8.3f ms/frame, %7.2f MB/frame, %6.2f GB/s\n",
+    separateMs, separateBytes / 1e6, separateBytes / 1e6 / separateMs);
+  printf("Fused kernel:    %8.3f ms/frame, %7.2f MB/frame, %6.2f GB/s\n",
+    fusedMs, fusedBytes / 1e6, fusedBytes / 1e6 / fusedMs);
+  printf("Speedup:         %8.2fx\n", separateMs / fusedMs);
+
+  MFShutdown();
+  return 0;
+}
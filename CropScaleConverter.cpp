@@ -0,0 +1,367 @@
+#include "CropScaleConverter.h"
+#include <mferror.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CROP_SCALE_SSE2 1
+#endif
+
+static const int COEF_BITS = 12;
+
+CropScaleConverter::CropScaleConverter() : m_pBands(&ParallelBands::Shared()) {}
+
+// 输出坐标 -> 源坐标的左侧下标和 8 位插值权重；begin/size 为裁剪区间，limit 为平面尺寸
+static void BuildAxis(double begin, double size, UINT32 dstSize, UINT32 limit, std::vector<UINT32>& index,
+    std::vector<UINT16>& weight) {
+    index.resize(dstSize);
+    weight.resize(dstSize);
+    double scale = size / dstSize;
+    for (UINT32 i = 0; i < dstSize; i++) {
+        double s = begin + (i + 0.5) * scale - 0.5;
+        s = (std::min)((std::max)(s, 0.0), static_cast<double>(limit - 1));
+        UINT32 i0 = (limit > 1) ? (std::min)(static_cast<UINT32>(s), limit - 2) : 0;
+        index[i] = i0;
+        weight[i] = (limit > 1) ? static_cast<UINT16>(std::lround((s - i0) * 256.0)) : 0;
+    }
+}
+
+// ---- 输入格式：样点统一读成高位对齐的 16 位值（8 位源左移 8 位），后续插值和转换与位深无关 ----
+
+struct Nv12Source {
+    typedef BYTE Sample;
+    static const bool Interleaved = true;
+    static UINT32 Load(Sample s) { return static_cast<UINT32>(s) << 8; }
+};
+
+struct I420Source {
+    typedef BYTE Sample;
+    static const bool Interleaved = false;
+    static UINT32 Load(Sample s) { return static_cast<UINT32>(s) << 8; }
+};
+
+// P010 的 10 位样点已在高位，低 6 位为 0
+struct P010Source {
+    typedef UINT16 Sample;
+    static const bool Interleaved = true;
+    static UINT32 Load(Sample s) { return s; }
+};
+
+// I010 的样点在低 10 位
+struct I010Source {
+    typedef UINT16 Sample;
+    static const bool Interleaved = false;
+    static UINT32 Load(Sample s) { return static_cast<UINT32>(s & 0x3FF) << 6; }
+};
+
+template <typename Source>
+static const typename Source::Sample* SourceRow(const ImagePlanes& src, UINT32 plane, UINT32 row) {
+    return reinterpret_cast<const typename Source::Sample*>(src.data[plane] + static_cast<ptrdiff_t>(row) * src.stride[plane]);
+}
+
+// 按目标宽度水平插值一行亮度 / 色度，结果为 16 位
+template <typename Source>
+static void ResampleLuma(const ImagePlanes& src, UINT32 row, const CropScaleConverter::Plan& plan, UINT16* pOut) {
+    const typename Source::Sample* p = SourceRow<Source>(src, 0, row);
+    for (UINT32 x = 0; x < plan.dstWidth; x++) {
+        UINT32 sx = plan.lumaX[x], f = plan.lumaFx[x];
+        pOut[x] = static_cast<UINT16>((Source::Load(p[sx]) * (256 - f) + Source::Load(p[sx + 1]) * f + 128) >> 8);
+    }
+}
+
+template <typename Source>
+static void ResampleChroma(const ImagePlanes& src, UINT32 row, const CropScaleConverter::Plan& plan, UINT16* pU, UINT16* pV) {
+    if constexpr (Source::Interleaved) {
+        const typename Source::Sample* p = SourceRow<Source>(src, 1, row);
+        for (UINT32 x = 0; x < plan.dstWidth; x++) {
+            const typename Source::Sample* c = p + plan.chromaX[x] * 2;
+            UINT32 f = plan.chromaFx[x];
+            pU[x] = static_cast<UINT16>((Source::Load(c[0]) * (256 - f) + Source::Load(c[2]) * f + 128) >> 8);
+            pV[x] = static_cast<UINT16>((Source::Load(c[1]) * (256 - f) + Source::Load(c[3]) * f + 128) >> 8);
+        }
+    }
+    else {
+        const typename Source::Sample* u = SourceRow<Source>(src, 1, row);
+        const typename Source::Sample* v = SourceRow<Source>(src, 2, row);
+        for (UINT32 x = 0; x < plan.dstWidth; x++) {
+            UINT32 cx = plan.chromaX[x], f = plan.chromaFx[x];
+            pU[x] = static_cast<UINT16>((Source::Load(u[cx]) * (256 - f) + Source::Load(u[cx + 1]) * f + 128) >> 8);
+            pV[x] = static_cast<UINT16>((Source::Load(v[cx]) * (256 - f) + Source::Load(v[cx + 1]) * f + 128) >> 8);
+        }
+    }
+}
+
+// ---- 输出格式：一个像素写成一个 32 位值，Bits 为每个颜色分量的位数 ----
+
+// Pack8 为 SSE2 版本：r/g/b 为 8 个已截断的 16 位分量，写出 8 个像素
+struct RgbaTarget {
+    static const int Bits = 8;
+    static UINT32 Pack(UINT32 r, UINT32 g, UINT32 b) { return r | (g << 8) | (b << 16) | 0xFF000000u; }
+#ifdef CROP_SCALE_SSE2
+    static void Pack8(__m128i r, __m128i g, __m128i b, UINT32* pOut) {
+        __m128i lo = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        __m128i hi = _mm_or_si128(b, _mm_set1_epi16(static_cast<short>(0xFF00)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm_unpacklo_epi16(lo, hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 4), _mm_unpackhi_epi16(lo, hi));
+    }
+#endif
+};
+
+struct BgraTarget {
+    static const int Bits = 8;
+    static UINT32 Pack(UINT32 r, UINT32 g, UINT32 b) { return b | (g << 8) | (r << 16) | 0xFF000000u; }
+#ifdef CROP_SCALE_SSE2
+    static void Pack8(__m128i r, __m128i g, __m128i b, UINT32* pOut) { RgbaTarget::Pack8(b, g, r, pOut); }
+#endif
+};
+
+// DXGI_FORMAT_R10G10B10A2_UNORM：R 在最低 10 位，Alpha 为 2 位
+struct Rgb10A2Target {
+    static const int Bits = 10;
+    static UINT32 Pack(UINT32 r, UINT32 g, UINT32 b) { return r | (g << 10) | (b << 20) | 0xC0000000u; }
+#ifdef CROP_SCALE_SSE2
+    static void Pack8(__m128i r, __m128i g, __m128i b, UINT32* pOut) {
+        const __m128i zero = _mm_setzero_si128(), alpha = _mm_set1_epi32(static_cast<int>(0xC0000000u));
+        __m128i lo = _mm_or_si128(_mm_or_si128(_mm_unpacklo_epi16(r, zero), _mm_slli_epi32(_mm_unpacklo_epi16(g, zero), 10)),
+            _mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(b, zero), 20), alpha));
+        __m128i hi = _mm_or_si128(_mm_or_si128(_mm_unpackhi_epi16(r, zero), _mm_slli_epi32(_mm_unpackhi_epi16(g, zero), 10)),
+            _mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(b, zero), 20), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 4), hi);
+    }
+#endif
+};
+
+template <int Bits>
+static inline UINT32 ClampBits(INT32 value) {
+    return static_cast<UINT32>((std::min)((std::max)(value, 0), (1 << Bits) - 1));
+}
+
+#ifdef CROP_SCALE_SSE2
+// SSE2 没有 32 位乘法取低位，用两次 32x32->64 拼出；低 32 位与有符号乘法相同
+static inline __m128i MulLo32(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// 8 个 16 位分量的垂直插值 (p0 * w0 + p1 * w1 + 128) >> 8，结果为两组 4 个 32 位值
+static inline void Lerp8(const UINT16* p0, const UINT16* p1, __m128i w0, __m128i w1, __m128i* pLo, __m128i* pHi) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p0));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1));
+    __m128i aLo = _mm_mullo_epi16(a, w0), aHi = _mm_mulhi_epu16(a, w0);
+    __m128i bLo = _mm_mullo_epi16(b, w1), bHi = _mm_mulhi_epu16(b, w1);
+    const __m128i round = _mm_set1_epi32(128);
+    *pLo = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi16(aLo, aHi), _mm_unpacklo_epi16(bLo, bHi)), round), 8);
+    *pHi = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(_mm_unpackhi_epi16(aLo, aHi), _mm_unpackhi_epi16(bLo, bHi)), round), 8);
+}
+
+// 4 个像素的 YUV->RGB（Y 已减黑电平并乘系数、加舍入），与逐像素循环逐位一致
+struct RgbCoefficients {
+    __m128i crv, cgu, cgv, cbu;
+};
+
+static inline void YuvToRgb4(__m128i luma, __m128i U, __m128i V, const RgbCoefficients& k, int shift,
+    __m128i* pR, __m128i* pG, __m128i* pB) {
+    __m128i vShift = _mm_cvtsi32_si128(shift);
+    *pR = _mm_sra_epi32(_mm_add_epi32(luma, MulLo32(k.crv, V)), vShift);
+    *pG = _mm_sra_epi32(_mm_sub_epi32(_mm_sub_epi32(luma, MulLo32(k.cgu, U)), MulLo32(k.cgv, V)), vShift);
+    *pB = _mm_sra_epi32(_mm_add_epi32(luma, MulLo32(k.cbu, U)), vShift);
+}
+
+// 8 个像素的垂直插值、YUV->RGB、截断和打包，P010/I010 与 8 位源共用（行缓存里都是 16 位分量）
+template <typename Target>
+static void ConvertRow8(const UINT16* y0, const UINT16* y1, const UINT16* u0, const UINT16* u1, const UINT16* v0,
+    const UINT16* v1, UINT32 lf, UINT32 cf, const CropScaleConverter::Plan& plan, UINT32* pOut) {
+    const int shift = COEF_BITS + 16 - Target::Bits;
+    const __m128i lw0 = _mm_set1_epi16(static_cast<short>(256 - lf)), lw1 = _mm_set1_epi16(static_cast<short>(lf));
+    const __m128i cw0 = _mm_set1_epi16(static_cast<short>(256 - cf)), cw1 = _mm_set1_epi16(static_cast<short>(cf));
+    const __m128i yOffset = _mm_set1_epi32(plan.yOffset), yScale = _mm_set1_epi32(plan.yScale);
+    const __m128i lumaRound = _mm_set1_epi32(1 << (shift - 1)), chromaBias = _mm_set1_epi32(32768);
+    const __m128i maxValue = _mm_set1_epi16((1 << Target::Bits) - 1), zero = _mm_setzero_si128();
+    const RgbCoefficients k = { _mm_set1_epi32(plan.crv), _mm_set1_epi32(plan.cgu), _mm_set1_epi32(plan.cgv), _mm_set1_epi32(plan.cbu) };
+
+    __m128i Y[2], U[2], V[2];
+    Lerp8(y0, y1, lw0, lw1, &Y[0], &Y[1]);
+    Lerp8(u0, u1, cw0, cw1, &U[0], &U[1]);
+    Lerp8(v0, v1, cw0, cw1, &V[0], &V[1]);
+
+    __m128i r[2], g[2], b[2];
+    for (int i = 0; i < 2; i++) {
+        __m128i luma = _mm_add_epi32(MulLo32(_mm_sub_epi32(Y[i], yOffset), yScale), lumaRound);
+        YuvToRgb4(luma, _mm_sub_epi32(U[i], chromaBias), _mm_sub_epi32(V[i], chromaBias), k, shift, &r[i], &g[i], &b[i]);
+    }
+
+    // 移位后的分量只有十几位，有符号饱和打包到 16 位不改变数值，再截断到 [0, 2^Bits - 1]
+    auto clamp = [&](__m128i lo, __m128i hi) { return _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(lo, hi), zero), maxValue); };
+    Target::Pack8(clamp(r[0], r[1]), clamp(g[0], g[1]), clamp(b[0], b[1]), pOut);
+}
+#endif
+
+// 两行缓存：输出行需要的源行已在缓存中时不再重新读取和水平插值
+struct RowCache {
+    INT32 tag[2] = { -1, -1 };
+    UINT32 next = 0;
+
+    // 返回 row 所在的槽位，needFill 表示需要重新填充
+    UINT32 Slot(UINT32 row, UINT32 keep, bool* needFill) {
+        for (UINT32 i = 0; i < 2; i++) {
+            if (tag[i] == static_cast<INT32>(row)) {
+                *needFill = false;
+                return i;
+            }
+        }
+        // 替换不是 keep（本行要用的另一行）的槽位
+        UINT32 slot = (tag[0] == static_cast<INT32>(keep)) ? 1 : (tag[1] == static_cast<INT32>(keep)) ? 0 : next;
+        next = slot ^ 1;
+        tag[slot] = static_cast<INT32>(row);
+        *needFill = true;
+        return slot;
+    }
+};
+
+template <typename Source, typename Target>
+static void ConvertBand(const CropScaleConverter::Plan& plan, const ImagePlanes& src, BYTE* pDst, LONG dstStride,
+    UINT32 rowBegin, UINT32 rowEnd) {
+    const UINT32 width = plan.dstWidth;
+    thread_local std::vector<UINT16> buffer;
+    buffer.resize(static_cast<size_t>(width) * 6);
+    UINT16* lumaRows[2] = { buffer.data(), buffer.data() + width };
+    UINT16* uRows[2] = { buffer.data() + 2 * width, buffer.data() + 3 * width };
+    UINT16* vRows[2] = { buffer.data() + 4 * width, buffer.data() + 5 * width };
+    RowCache lumaCache, chromaCache;
+
+    for (UINT32 y = rowBegin; y < rowEnd; y++) {
+        // 取得（必要时生成）上下两行已水平插值的亮度和色度
+        UINT32 ly = plan.lumaY[y], cy = plan.chromaY[y];
+        bool fill = false;
+        UINT32 l0 = lumaCache.Slot(ly, ly + 1, &fill);
+        if (fill) ResampleLuma<Source>(src, ly, plan, lumaRows[l0]);
+        UINT32 l1 = lumaCache.Slot(ly + 1, ly, &fill);
+        if (fill) ResampleLuma<Source>(src, ly + 1, plan, lumaRows[l1]);
+        UINT32 c0 = chromaCache.Slot(cy, cy + 1, &fill);
+        if (fill) ResampleChroma<Source>(src, cy, plan, uRows[c0], vRows[c0]);
+        UINT32 c1 = chromaCache.Slot(cy + 1, cy, &fill);
+        if (fill) ResampleChroma<Source>(src, cy + 1, plan, uRows[c1], vRows[c1]);
+
+        const UINT32 lf = plan.lumaFy[y], cf = plan.chromaFy[y];
+        const UINT16* y0 = lumaRows[l0], * y1 = lumaRows[l1];
+        const UINT16* u0 = uRows[c0], * u1 = uRows[c1];
+        const UINT16* v0 = vRows[c0], * v1 = vRows[c1];
+        UINT32* pOut = reinterpret_cast<UINT32*>(pDst + static_cast<ptrdiff_t>(y) * dstStride);
+
+        // 分量为 16 位（8 位整数 + 8 位小数），乘 12 位系数后按目标位数右移
+        const int shift = COEF_BITS + 16 - Target::Bits;
+        UINT32 x = 0;
+#ifdef CROP_SCALE_SSE2
+        for (; x + 8 <= width; x += 8) {
+            ConvertRow8<Target>(y0 + x, y1 + x, u0 + x, u1 + x, v0 + x, v1 + x, lf, cf, plan, pOut + x);
+        }
+#endif
+        for (; x < width; x++) {
+            INT32 Y = static_cast<INT32>((y0[x] * (256 - lf) + y1[x] * lf + 128) >> 8);
+            INT32 U = static_cast<INT32>((u0[x] * (256 - cf) + u1[x] * cf + 128) >> 8) - 32768;
+            INT32 V = static_cast<INT32>((v0[x] * (256 - cf) + v1[x] * cf + 128) >> 8) - 32768;
+
+            INT32 luma = (Y - plan.yOffset) * plan.yScale + (1 << (shift - 1));
+            UINT32 r = ClampBits<Target::Bits>((luma + plan.crv * V) >> shift);
+            UINT32 g = ClampBits<Target::Bits>((luma - plan.cgu * U - plan.cgv * V) >> shift);
+            UINT32 b = ClampBits<Target::Bits>((luma + plan.cbu * U) >> shift);
+            pOut[x] = Target::Pack(r, g, b);
+        }
+    }
+}
+
+template <typename Source>
+static CropScaleConverter::BandFunction SelectBand(RgbLayout layout) {
+    switch (layout) {
+    case RgbLayout::RGBA: return &ConvertBand<Source, RgbaTarget>;
+    case RgbLayout::BGRA: return &ConvertBand<Source, BgraTarget>;
+    case RgbLayout::RGB10A2: return &ConvertBand<Source, Rgb10A2Target>;
+    }
+    return nullptr;
+}
+
+HRESULT CropScaleConverter::Configure(const VideoFormat& srcFormat, const CropRect& crop, UINT32 dstWidth, UINT32 dstHeight,
+    RgbLayout layout, FrameOrientation orientation) {
+    BandFunction band = nullptr;
+    switch (srcFormat.subtype) {
+    case VideoSubtype::NV12: band = SelectBand<Nv12Source>(layout); break;
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12: band = SelectBand<I420Source>(layout); break;
+    case VideoSubtype::P010: band = SelectBand<P010Source>(layout); break;
+    case VideoSubtype::I010: band = SelectBand<I010Source>(layout); break;
+    default: return MF_E_INVALIDMEDIATYPE;
+    }
+    if (band == nullptr || SwapsAxes(orientation)) return E_INVALIDARG;
+    if (dstWidth == 0 || dstHeight == 0 || srcFormat.width < 2 || srcFormat.height < 2) return E_INVALIDARG;
+
+    CropRect area = crop;
+    if (area.width == 0 || area.height == 0) {
+        area.x = area.y = 0;
+        area.width = srcFormat.width;
+        area.height = srcFormat.height;
+    }
+    if (area.x + area.width > srcFormat.width || area.y + area.height > srcFormat.height) return E_INVALIDARG;
+
+    Plan plan;
+    plan.dstWidth = dstWidth;
+    plan.dstHeight = dstHeight;
+    UINT32 chromaWidth = (srcFormat.width + 1) / 2, chromaHeight = (srcFormat.height + 1) / 2;
+    BuildAxis(area.x, area.width, dstWidth, srcFormat.width, plan.lumaX, plan.lumaFx);
+    BuildAxis(area.y, area.height, dstHeight, srcFormat.height, plan.lumaY, plan.lumaFy);
+    // 色度样点位于两个亮度样点中间
+    BuildAxis(area.x / 2.0, area.width / 2.0, dstWidth, chromaWidth, plan.chromaX, plan.chromaFx);
+    BuildAxis(area.y / 2.0, area.height / 2.0, dstHeight, chromaHeight, plan.chromaY, plan.chromaFy);
+
+    // 翻转：第 i 个输出列 / 行取原来第 dstSize - 1 - i 个的坐标和权重，行缓存按行号查找，不依赖访问顺序
+    if (FlipsHorizontally(orientation)) {
+        std::reverse(plan.lumaX.begin(), plan.lumaX.end());
+        std::reverse(plan.lumaFx.begin(), plan.lumaFx.end());
+        std::reverse(plan.chromaX.begin(), plan.chromaX.end());
+        std::reverse(plan.chromaFx.begin(), plan.chromaFx.end());
+    }
+    if (FlipsVertically(orientation)) {
+        std::reverse(plan.lumaY.begin(), plan.lumaY.end());
+        std::reverse(plan.lumaFy.begin(), plan.lumaFy.end());
+        std::reverse(plan.chromaY.begin(), plan.chromaY.end());
+        std::reverse(plan.chromaFy.begin(), plan.chromaFy.end());
+    }
+
+    // 颜色矩阵：未标注时高清用 BT.709、标清用 BT.601；未标注取值范围按 16-235 处理
+    bool bt601 = srcFormat.yuvMatrix == MFVideoTransferMatrix_BT601 ||
+        (srcFormat.yuvMatrix == MFVideoTransferMatrix_Unknown && srcFormat.height < 720);
+    bool fullRange = srcFormat.nominalRange == MFNominalRange_0_255;
+    double kr = bt601 ? 0.299 : 0.2126, kb = bt601 ? 0.114 : 0.0722, kg = 1.0 - kr - kb;
+    double yScale = fullRange ? 1.0 : 255.0 / 219.0;
+    double cScale = fullRange ? 1.0 : 255.0 / 224.0;
+    const double one = 1 << COEF_BITS;
+    plan.yOffset = fullRange ? 0 : (16 << 8);
+    plan.yScale = static_cast<INT32>(std::lround(yScale * one));
+    plan.crv = static_cast<INT32>(std::lround(2.0 * (1.0 - kr) * cScale * one));
+    plan.cbu = static_cast<INT32>(std::lround(2.0 * (1.0 - kb) * cScale * one));
+    plan.cgu = static_cast<INT32>(std::lround(2.0 * (1.0 - kb) * kb / kg * cScale * one));
+    plan.cgv = static_cast<INT32>(std::lround(2.0 * (1.0 - kr) * kr / kg * cScale * one));
+
+    m_band = band;
+    m_plan = std::move(plan);
+    m_srcSubtype = srcFormat.subtype;
+    m_srcWidth = srcFormat.width;
+    m_srcHeight = srcFormat.height;
+    return S_OK;
+}
+
+HRESULT CropScaleConverter::Convert(const ImagePlanes& src, BYTE* pDst, LONG dstStride) {
+    if (m_band == nullptr) return MF_E_NOT_INITIALIZED;
+    if (pDst == nullptr || src.data[0] == nullptr || src.data[1] == nullptr) return E_POINTER;
+    if (src.width != m_srcWidth || src.height != m_srcHeight) return MF_E_INVALIDMEDIATYPE;
+    if (src.planeCount > 2 && src.data[2] == nullptr) return E_POINTER;
+
+    // 每个行带维护自己的行缓存，行带边界处最多多读两行源数据
+    auto band = [&](UINT32 rowBegin, UINT32 rowEnd) { m_band(m_plan, src, pDst, dstStride, rowBegin, rowEnd); };
+    if (m_pBands) m_pBands->Run(m_plan.dstHeight, 16, band);
+    else band(0, m_plan.dstHeight);
+    return S_OK;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+
+// 输出像素的字节顺序
+enum class RgbLayout {
+    RGBA,       // DXGI_FORMAT_R8G8B8A8_UNORM
+    BGRA,       // DXGI_FORMAT_B8G8R8A8_UNORM / MFVideoFormat_RGB32
+    RGB10A2,    // DXGI_FORMAT_R10G10B10A2_UNORM，10 位源不丢精度的预览输出
+};
+
+// 源图像中的裁剪区域（亮度像素），宽或高为 0 表示整帧
+struct CropRect {
+    UINT32 x = 0;
+    UINT32 y = 0;
+    UINT32 width = 0;
+    UINT32 height = 0;
+};
+
+// 裁剪 + 缩放 + YUV→RGB 单趟转换
+// NV12/I420/P010/I010 源只读一次：每个输出行由两行已按目标宽度水平插值的源行（亮度、色度各两行，按行号缓存）
+// 垂直插值后直接转换写出 RGBA/BGRA/RGB10A2，不产生裁剪、缩放后的中间帧；
+// 中间结果统一为 16 位定点，8 位和 10 位源走同一套插值；每种输入/输出组合是一个模板实例，逐像素循环里没有格式分支
+// 垂直插值、YUV→RGB 和打包（RGBA/BGRA/RGB10A2）用 SSE2 每次处理 8 个像素，与标量结果逐位一致；水平插值按坐标表取样，仍为标量
+class CropScaleConverter {
+public:
+    CropScaleConverter();
+
+    // 按源格式（子类型、尺寸、颜色矩阵、取值范围）、裁剪区域和目标尺寸预计算坐标表和转换系数
+    // orientation 只接受翻转（水平、垂直、180 度），直接反转坐标表，不增加任何逐像素开销；
+    // 90/270 度旋转由调用方先用 FrameRotator 转置源帧（裁剪区域同样转置），再把剩下的翻转交给这里
+    HRESULT Configure(const VideoFormat& srcFormat, const CropRect& crop, UINT32 dstWidth, UINT32 dstHeight, RgbLayout layout,
+        FrameOrientation orientation = FrameOrientation::Identity);
+
+    // src 须与 Configure 的源格式一致；pDst 为 dstHeight 行、每行至少 dstWidth * 4 字节
+    HRESULT Convert(const ImagePlanes& src, BYTE* pDst, LONG dstStride);
+
+    UINT32 GetOutputWidth() const { return m_plan.dstWidth; }
+    UINT32 GetOutputHeight() const { return m_plan.dstHeight; }
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+    // 坐标表和转换系数，模板化的行带函数只读这里
+    struct Plan {
+        UINT32 dstWidth = 0, dstHeight = 0;
+        // 水平：每个输出列的左侧源列和 8 位插值权重（亮度和色度各一份）
+        std::vector<UINT32> lumaX, chromaX;
+        std::vector<UINT16> lumaFx, chromaFx;
+        // 垂直：每个输出行的上方源行和 8 位插值权重
+        std::vector<UINT32> lumaY, chromaY;
+        std::vector<UINT16> lumaFy, chromaFy;
+        // 定点（12 位）YUV→RGB 系数，yOffset 为 16 位分量上的黑电平
+        INT32 yOffset = 0, yScale = 0;
+        INT32 crv = 0, cgu = 0, cgv = 0, cbu = 0;
+    };
+
+    using BandFunction = void (*)(const Plan& plan, const ImagePlanes& src, BYTE* pDst, LONG dstStride,
+        UINT32 rowBegin, UINT32 rowEnd);
+
+private:
+    Plan m_plan;
+    BandFunction m_band = nullptr;
+    VideoSubtype m_srcSubtype = VideoSubtype::Unknown;
+    UINT32 m_srcWidth = 0, m_srcHeight = 0;
+    ParallelBands* m_pBands = nullptr;
+};
@@ -0,0 +1,249 @@
+#include "DecodedFrameCache.h"
+#include "H264Demuxer.h"
+#include "TransformDriver.h"
+#include "MFLog.h"
+#include <mferror.h>
+#include <algorithm>
+
+DecodedFrameCache::DecodedFrameCache() {}
+
+DecodedFrameCache::~DecodedFrameCache() { Shutdown(); }
+
+HRESULT DecodedFrameCache::Initialize(size_t byteBudget, DecodeCallback decode, UINT32 prefetchFrames) {
+    if (byteBudget == 0) return E_INVALIDARG;
+    Shutdown();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_byteBudget = byteBudget;
+    m_decode = decode;
+    m_prefetchFrames = prefetchFrames;
+    m_stats = Stats();
+    m_stopPrefetch = false;
+    if (m_decode) {
+        m_prefetchThread = std::thread(&DecodedFrameCache::PrefetchThread, this);
+    }
+    return S_OK;
+}
+
+void DecodedFrameCache::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopPrefetch = true;
+        m_havePrefetchTarget = false;
+    }
+    m_prefetchCV.notify_all();
+    if (m_prefetchThread.joinable()) {
+        m_prefetchThread.join();
+    }
+    Clear();
+}
+
+void DecodedFrameCache::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frames.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+DecodedFrameCache::Stats DecodedFrameCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.frameCount = m_frames.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+DecodedFrameCache::FrameMap::iterator DecodedFrameCache::FindLocked(LONGLONG hnsTime) {
+    auto it = m_frames.upper_bound(hnsTime);
+    if (it == m_frames.begin()) return m_frames.end();
+    --it;
+    LONGLONG duration = (std::max)(it->second.duration, 1LL);
+    return (hnsTime < it->first + duration) ? it : m_frames.end();
+}
+
+void DecodedFrameCache::EvictLocked() {
+    while (m_bytes > m_byteBudget && !m_lru.empty()) {
+        auto it = m_frames.find(m_lru.back());
+        m_lru.pop_back();
+        if (it != m_frames.end()) {
+            m_bytes -= it->second.bytes;
+            m_frames.erase(it);
+            m_stats.evictions++;
+        }
+    }
+}
+
+void DecodedFrameCache::InsertLocked(IMFSample* pSample, const VideoFormat& format, bool prefetched) {
+    LONGLONG sampleTime = 0, duration = 0;
+    DWORD bytes = 0;
+    if (FAILED(pSample->GetSampleTime(&sampleTime))) return;
+    pSample->GetSampleDuration(&duration);
+    pSample->GetTotalLength(&bytes);
+    if (bytes > m_byteBudget) return;
+
+    if (duration > 0) m_frameDuration = duration;
+
+    auto it = m_frames.find(sampleTime);
+    if (it != m_frames.end()) {
+        m_bytes -= it->second.bytes;
+        m_lru.erase(it->second.lru);
+        m_frames.erase(it);
+    }
+
+    // 新插入的帧（包括预取的帧）视为最近使用，避免刚预取就被淘汰
+    Node node;
+    node.sample = pSample;
+    node.format = format;
+    node.duration = duration;
+    node.bytes = bytes;
+    m_lru.push_front(sampleTime);
+    node.lru = m_lru.begin();
+    m_frames.emplace(sampleTime, node);
+    m_bytes += bytes;
+    if (prefetched) m_stats.prefetchedFrames++;
+
+    EvictLocked();
+}
+
+HRESULT DecodedFrameCache::Insert(IMFSample* pSample, const VideoFormat& format) {
+    if (pSample == nullptr) return E_POINTER;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    InsertLocked(pSample, format, false);
+    return S_OK;
+}
+
+void DecodedFrameCache::SchedulePrefetchLocked(LONGLONG hnsTime) {
+    if (!m_decode || m_stopPrefetch) return;
+    // 只保留最新的预取目标，快速拖动时不会堆积过时的解码请求
+    m_prefetchTarget = hnsTime;
+    m_havePrefetchTarget = true;
+    m_prefetchCV.notify_one();
+}
+
+HRESULT DecodedFrameCache::Lookup(LONGLONG hnsTime, IMFSample** ppSample, VideoFormat* pFormat) {
+    if (ppSample == nullptr) return E_POINTER;
+    *ppSample = nullptr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (hnsTime != m_lastLookupTime) {
+        m_direction = (hnsTime > m_lastLookupTime) ? 1 : -1;
+        m_lastLookupTime = hnsTime;
+    }
+
+    auto it = FindLocked(hnsTime);
+    if (it == m_frames.end()) {
+        m_stats.misses++;
+        SchedulePrefetchLocked(hnsTime);
+        return MF_E_NOT_FOUND;
+    }
+
+    m_stats.hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    *ppSample = it->second.sample.Get();
+    (*ppSample)->AddRef();
+    if (pFormat) *pFormat = it->second.format;
+
+    // 沿拖动方向查找预取窗口内第一个缺失的帧
+    if (m_frameDuration > 0) {
+        for (UINT32 k = 1; k <= m_prefetchFrames; k++) {
+            LONGLONG ahead = hnsTime + m_direction * static_cast<LONGLONG>(k) * m_frameDuration;
+            if (ahead < 0) break;
+            if (FindLocked(ahead) == m_frames.end()) {
+                SchedulePrefetchLocked(ahead);
+                break;
+            }
+        }
+    }
+    return S_OK;
+}
+
+HRESULT DecodedFrameCache::GetFrame(LONGLONG hnsTime, IMFSample** ppSample, VideoFormat* pFormat) {
+    HRESULT hr = Lookup(hnsTime, ppSample, pFormat);
+    if (hr != MF_E_NOT_FOUND || !m_decode) return hr;
+
+    std::vector<ComPtr<IMFSample>> frames;
+    VideoFormat format = {};
+    {
+        std::lock_guard<std::mutex> decodeLock(m_decodeMutex);
+        hr = m_decode(hnsTime, frames, &format);
+    }
+    if (FAILED(hr)) return hr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& frame : frames) InsertLocked(frame.Get(), format, false);
+
+    auto it = FindLocked(hnsTime);
+    if (it == m_frames.end()) return MF_E_NOT_FOUND;
+    *ppSample = it->second.sample.Get();
+    (*ppSample)->AddRef();
+    if (pFormat) *pFormat = it->second.format;
+    return S_OK;
+}
+
+void DecodedFrameCache::PrefetchThread() {
+    while (true) {
+        LONGLONG target = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_prefetchCV.wait(lock, [this] { return m_havePrefetchTarget || m_stopPrefetch; });
+            if (m_stopPrefetch) return;
+            target = m_prefetchTarget;
+            m_havePrefetchTarget = false;
+            if (FindLocked(target) != m_frames.end()) continue;
+        }
+
+        std::vector<ComPtr<IMFSample>> frames;
+        VideoFormat format = {};
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<std::mutex> decodeLock(m_decodeMutex);
+            hr = m_decode(target, frames, &format);
+        }
+        if (FAILED(hr)) {
+            MFLOG_WARN("Frame cache prefetch decode failed: 0x%08lx", hr);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& frame : frames) InsertLocked(frame.Get(), format, true);
+    }
+}
+
+DecodedFrameCache::DecodeCallback CreateDemuxerDecodeCallback(H264Demuxer* pDemuxer, IMFTransform* pDecoder) {
+    return [pDemuxer, pDecoder](LONGLONG hnsTime, std::vector<ComPtr<IMFSample>>& frames, VideoFormat* pFormat) -> HRESULT {
+        size_t first = 0;
+        HRESULT hr = pDemuxer->FindKeyframe(hnsTime, &first);
+        if (FAILED(hr)) return hr;
+
+        const std::vector<UINT32>& keyframes = pDemuxer->GetKeyframeIndices();
+        auto next = std::upper_bound(keyframes.begin(), keyframes.end(), static_cast<UINT32>(first));
+        size_t last = (next != keyframes.end()) ? *next : pDemuxer->GetAccessUnitCount();
+
+        // 从关键帧重新开始解码整个 GOP，拖动时整个 GOP 的帧都会进入缓存
+        // 送入、取出和流变化由 TransformDriver 处理，整个 GOP 一次批量送入
+        TransformDriver driver;
+        hr = driver.Attach(pDecoder);
+        if (FAILED(hr)) return hr;
+        hr = driver.Flush();
+        if (FAILED(hr)) return hr;
+
+        std::vector<ComPtr<IMFSample>> samples;
+        std::vector<IMFSample*> inputs;
+        for (size_t i = first; i < last; i++) {
+            ComPtr<IMFSample> pSample;
+            hr = pDemuxer->CreateSample(i, &pSample);
+            if (FAILED(hr)) return hr;
+            inputs.push_back(pSample.Get());
+            samples.push_back(pSample);
+        }
+
+        hr = driver.Process(inputs.data(), inputs.size(), frames);
+        if (SUCCEEDED(hr)) hr = driver.Drain(frames);
+        if (FAILED(hr)) return hr;
+
+        // 驱动在流变化时解析新的输出类型，GOP 内的帧都是这一格式
+        if (pFormat) *pFormat = driver.GetOutputFormat();
+        return hr;
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "VideoFormat.h"
+
+using namespace Microsoft::WRL;
+
+class H264Demuxer;
+
+// 按显示时间索引的解码帧 LRU 缓存，用于拖动进度条时免去从上一个 IDR 重新解码
+// 命中时直接返回解码后的 IMFSample；未命中时由后台线程沿拖动方向预取相邻帧
+class DecodedFrameCache {
+public:
+    // 解码包含 hnsTime 的一段帧（通常是一个 GOP），把解码结果追加到 frames，pFormat 返回这些帧的格式
+    typedef std::function<HRESULT(LONGLONG hnsTime, std::vector<ComPtr<IMFSample>>& frames, VideoFormat* pFormat)> DecodeCallback;
+
+    struct Stats {
+        UINT64 hits = 0;
+        UINT64 misses = 0;
+        UINT64 prefetchedFrames = 0;
+        UINT64 evictions = 0;
+        size_t frameCount = 0;
+        size_t bytes = 0;
+    };
+
+    DecodedFrameCache();
+    ~DecodedFrameCache();
+
+    // byteBudget 为缓存的解码帧总字节上限；decode 为空时不预取（例如实时回看只由 ProcessThread 填充）
+    HRESULT Initialize(size_t byteBudget, DecodeCallback decode = nullptr, UINT32 prefetchFrames = 8);
+
+    // 停止预取线程并清空缓存
+    void Shutdown();
+
+    // 放入一帧解码结果及其格式，可在 ProcessThread 中调用；格式随帧保存，解码器之后换了分辨率也不影响已缓存的帧
+    HRESULT Insert(IMFSample* pSample, const VideoFormat& format);
+
+    // 查找覆盖 hnsTime 的帧，pFormat 不为空时返回该帧插入时的格式；未命中返回 MF_E_NOT_FOUND，并在后台解码该位置
+    HRESULT Lookup(LONGLONG hnsTime, IMFSample** ppSample, VideoFormat* pFormat = nullptr);
+
+    // 查找，未命中时在调用线程同步解码
+    HRESULT GetFrame(LONGLONG hnsTime, IMFSample** ppSample, VideoFormat* pFormat = nullptr);
+
+    void Clear();
+    Stats GetStats() const;
+
+private:
+    struct Node {
+        ComPtr<IMFSample> sample;
+        VideoFormat format = {};
+        LONGLONG duration = 0;
+        size_t bytes = 0;
+        std::list<LONGLONG>::iterator lru;
+    };
+
+    typedef std::map<LONGLONG, Node> FrameMap;
+
+    FrameMap::iterator FindLocked(LONGLONG hnsTime);
+    void InsertLocked(IMFSample* pSample, const VideoFormat& format, bool prefetched);
+    void EvictLocked();
+    void SchedulePrefetchLocked(LONGLONG hnsTime);
+    void PrefetchThread();
+
+    mutable std::mutex m_mutex;
+    std::mutex m_decodeMutex;       // 解码回调不要求线程安全，预取与同步解码互斥
+    std::condition_variable m_prefetchCV;
+    std::thread m_prefetchThread;
+    bool m_stopPrefetch = true;
+
+    FrameMap m_frames;
+    std::list<LONGLONG> m_lru;      // 头部为最近使用
+    size_t m_byteBudget = 0;
+    size_t m_bytes = 0;
+    Stats m_stats;
+
+    DecodeCallback m_decode;
+    UINT32 m_prefetchFrames = 8;
+    LONGLONG m_lastLookupTime = 0;
+    LONGLONG m_frameDuration = 0;
+    int m_direction = 1;            // 拖动方向：1 向后，-1 向前
+    bool m_havePrefetchTarget = false;
+    LONGLONG m_prefetchTarget = 0;
+};
+
+// 创建一个基于 H264Demuxer 的解码回调：从 hnsTime 之前的关键帧解码到下一个关键帧
+// pDecoder 为已设置好输入/输出类型的 H.264 解码器，只在预取线程中使用
+DecodedFrameCache::DecodeCallback CreateDemuxerDecodeCallback(H264Demuxer* pDemuxer, IMFTransform* pDecoder);
@@ -0,0 +1,229 @@
+#include "DeviceRegistry.h"
+#include "MFLog.h"
+#include <mfapi.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#include <initguid.h>
+#include <devpkey.h>
+#include <ks.h>
+#include <ksmedia.h>
+#include <algorithm>
+#include <cwctype>
+
+using namespace Microsoft::WRL;
+
+DeviceRegistry::DeviceRegistry() {}
+
+DeviceRegistry::~DeviceRegistry() {
+    Shutdown();
+}
+
+std::wstring DeviceRegistry::NormalizeKey(const std::wstring& value) {
+    // 通知给出的链接与 MF 枚举的链接大小写可能不同
+    std::wstring key = value;
+    std::transform(key.begin(), key.end(), key.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+    return key;
+}
+
+HRESULT DeviceRegistry::Initialize() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_initialized) return S_OK;
+
+    HRESULT hr = EnumerateLocked();
+    if (FAILED(hr)) return hr;
+
+    // 订阅视频采集设备接口的到达/移除；失败时注册表仍可用，只是需要 Rescan 才能看到变化
+    CM_NOTIFY_FILTER filter = {};
+    filter.cbSize = sizeof(filter);
+    filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+    filter.u.DeviceInterface.ClassGuid = KSCATEGORY_VIDEO_CAMERA;
+    CONFIGRET cr = CM_Register_Notification(&filter, this, &DeviceRegistry::OnDeviceNotification, &m_hNotify);
+    if (cr != CR_SUCCESS) {
+        MFLOG_WARN("Failed to register for camera hotplug notifications: %lu", cr);
+        m_hNotify = nullptr;
+    }
+
+    m_initialized = true;
+    return S_OK;
+}
+
+void DeviceRegistry::Shutdown() {
+    // 注销会等待正在执行的回调结束，不能持锁调用
+    HCMNOTIFICATION hNotify = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        hNotify = m_hNotify;
+        m_hNotify = nullptr;
+    }
+    if (hNotify) CM_Unregister_Notification(hNotify);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_devices.clear();
+    m_byLink.clear();
+    m_initialized = false;
+}
+
+HRESULT DeviceRegistry::EnumerateLocked() {
+    HRESULT hr = S_OK;
+    ComPtr<IMFAttributes> pAttributes;
+    IMFActivate** ppDevices = nullptr;
+    UINT32 count = 0;
+
+    hr = MFCreateAttributes(&pAttributes, 1);
+    if (FAILED(hr)) return hr;
+
+    hr = pAttributes->SetGUID(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE, MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID);
+    if (FAILED(hr)) return hr;
+
+    hr = MFEnumDeviceSources(pAttributes.Get(), &ppDevices, &count);
+    if (FAILED(hr)) return hr;
+
+    m_devices.clear();
+    m_byLink.clear();
+    for (UINT32 i = 0; i < count; i++) {
+        DeviceEntry entry;
+
+        WCHAR* value = nullptr;
+        UINT32 length = 0;
+        if (SUCCEEDED(ppDevices[i]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &value, &length))) {
+            entry.friendlyName = value;
+            CoTaskMemFree(value);
+        }
+        if (SUCCEEDED(ppDevices[i]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_SYMBOLIC_LINK, &value, &length))) {
+            entry.symbolicLink = value;
+            CoTaskMemFree(value);
+        }
+        ppDevices[i]->Release();
+        if (entry.symbolicLink.empty()) continue;
+
+        m_byLink[NormalizeKey(entry.symbolicLink)] = m_devices.size();
+        m_devices.push_back(entry);
+    }
+    CoTaskMemFree(ppDevices);
+
+    m_generation++;
+    return S_OK;
+}
+
+HRESULT DeviceRegistry::Rescan() {
+    HRESULT hr = S_OK;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        hr = EnumerateLocked();
+    }
+    if (SUCCEEDED(hr)) NotifyChanged();
+    return hr;
+}
+
+std::vector<DeviceEntry> DeviceRegistry::GetDevices() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_devices;
+}
+
+bool DeviceRegistry::FindByLink(const std::wstring& symbolicLink, DeviceEntry* pEntry) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_byLink.find(NormalizeKey(symbolicLink));
+    if (it == m_byLink.end()) return false;
+    if (pEntry) *pEntry = m_devices[it->second];
+    return true;
+}
+
+bool DeviceRegistry::FindByName(const std::wstring& friendlyName, DeviceEntry* pEntry) const {
+    std::wstring key = NormalizeKey(friendlyName);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_devices) {
+        if (NormalizeKey(entry.friendlyName) == key) {
+            if (pEntry) *pEntry = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+UINT64 DeviceRegistry::GetGeneration() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+void DeviceRegistry::SetChangeCallback(const ChangeCallback& callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_callback = callback;
+}
+
+DWORD CALLBACK DeviceRegistry::OnDeviceNotification(HCMNOTIFICATION hNotify, PVOID context, CM_NOTIFY_ACTION action,
+    PCM_NOTIFY_EVENT_DATA eventData, DWORD eventDataSize) {
+    DeviceRegistry* registry = static_cast<DeviceRegistry*>(context);
+    if (eventData == nullptr || eventData->FilterType != CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE) return ERROR_SUCCESS;
+
+    std::wstring symbolicLink = eventData->u.DeviceInterface.SymbolicLink;
+    if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL) {
+        registry->OnArrival(symbolicLink);
+    }
+    else if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL) {
+        registry->OnRemoval(symbolicLink);
+    }
+    return ERROR_SUCCESS;
+}
+
+void DeviceRegistry::OnArrival(const std::wstring& symbolicLink) {
+    // 只查询新设备自己的属性，不重新枚举其它设备
+    DeviceEntry entry;
+    entry.symbolicLink = symbolicLink;
+
+    // 友好名称取设备接口属性，与 MF 枚举给出的名称一致
+    WCHAR friendlyName[256] = {};
+    ULONG size = sizeof(friendlyName);
+    DEVPROPTYPE type = DEVPROP_TYPE_EMPTY;
+    CONFIGRET cr = CM_Get_Device_Interface_PropertyW(symbolicLink.c_str(), &DEVPKEY_DeviceInterface_FriendlyName, &type,
+        reinterpret_cast<PBYTE>(friendlyName), &size, 0);
+    if (cr == CR_SUCCESS && type == DEVPROP_TYPE_STRING) {
+        entry.friendlyName = friendlyName;
+    }
+    else {
+        MFLOG_WARN("Camera arrived without a friendly name: %ls", symbolicLink.c_str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::wstring key = NormalizeKey(symbolicLink);
+        auto it = m_byLink.find(key);
+        if (it != m_byLink.end()) {
+            m_devices[it->second] = entry;
+        }
+        else {
+            m_byLink[key] = m_devices.size();
+            m_devices.push_back(entry);
+        }
+        m_generation++;
+    }
+    NotifyChanged();
+}
+
+void DeviceRegistry::OnRemoval(const std::wstring& symbolicLink) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_byLink.find(NormalizeKey(symbolicLink));
+        if (it == m_byLink.end()) return;
+
+        // 删除后重建后面设备的下标
+        size_t index = it->second;
+        m_devices.erase(m_devices.begin() + index);
+        m_byLink.erase(it);
+        for (auto& link : m_byLink) {
+            if (link.second > index) link.second--;
+        }
+        m_generation++;
+    }
+    NotifyChanged();
+}
+
+void DeviceRegistry::NotifyChanged() {
+    ChangeCallback callback;
+    UINT64 generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        callback = m_callback;
+        generation = m_generation;
+    }
+    if (callback) callback(generation);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <windows.h>
+#include <cfgmgr32.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#pragma comment(lib, "cfgmgr32.lib")
+
+// 注册表中的一个视频采集设备
+struct DeviceEntry {
+    std::wstring friendlyName;
+    std::wstring symbolicLink;      // 直接传给 MFCreateDeviceSource，打开设备时无需重新枚举
+};
+
+// 视频采集设备注册表
+// 启动时完整枚举一次，之后只根据设备接口到达/移除通知增量更新；
+// 按符号链接或友好名称查找不再调用 MFEnumDeviceSources
+class DeviceRegistry {
+public:
+    using ChangeCallback = std::function<void(UINT64 generation)>;
+
+    DeviceRegistry();
+    ~DeviceRegistry();
+
+    // 第一次调用时枚举设备并注册热插拔通知，之后直接返回
+    HRESULT Initialize();
+
+    // 注销热插拔通知并清空缓存
+    void Shutdown();
+
+    // 当前设备列表（按枚举顺序，新插入的设备排在最后）
+    std::vector<DeviceEntry> GetDevices() const;
+
+    // 符号链接和友好名称都不区分大小写
+    bool FindByLink(const std::wstring& symbolicLink, DeviceEntry* pEntry) const;
+    bool FindByName(const std::wstring& friendlyName, DeviceEntry* pEntry) const;
+
+    // 每次设备增减时加一，调用方比较后决定是否刷新自己的列表
+    UINT64 GetGeneration() const;
+
+    // 设备增减后在通知线程上调用，回调中不要做耗时操作
+    void SetChangeCallback(const ChangeCallback& callback);
+
+    // 丢弃缓存并重新完整枚举（通知注册失败时的兜底）
+    HRESULT Rescan();
+
+private:
+    static std::wstring NormalizeKey(const std::wstring& value);
+    static DWORD CALLBACK OnDeviceNotification(HCMNOTIFICATION hNotify, PVOID context, CM_NOTIFY_ACTION action,
+        PCM_NOTIFY_EVENT_DATA eventData, DWORD eventDataSize);
+
+    HRESULT EnumerateLocked();
+    void OnArrival(const std::wstring& symbolicLink);
+    void OnRemoval(const std::wstring& symbolicLink);
+    void NotifyChanged();
+
+    mutable std::mutex m_mutex;
+    std::vector<DeviceEntry> m_devices;
+    std::map<std::wstring, size_t> m_byLink;    // 规范化的符号链接 -> m_devices 下标
+    UINT64 m_generation = 0;
+    bool m_initialized = false;
+    HCMNOTIFICATION m_hNotify = nullptr;
+    ChangeCallback m_callback;
+};
@@ -0,0 +1,321 @@
+#include "FormatNegotiator.h"
+#include "MFLog.h"
+#include <mferror.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+
+using namespace Microsoft::WRL;
+
+// 设备模式缓存文件格式（每个设备一个文件）
+#pragma pack(push, 1)
+struct DeviceProfileHeader {
+    char magic[8];          // "MFCPROF1"
+    UINT32 version;
+    UINT32 entrySize;       // sizeof(DeviceProfileEntry)
+    UINT32 modeCount;
+    UINT32 linkLength;      // 其后紧跟的符号链接长度（WCHAR 个数），用于校验文件名哈希冲突
+};
+
+struct DeviceProfileEntry {
+    UINT32 nativeIndex;
+    GUID subtype;
+    UINT32 width;
+    UINT32 height;
+    UINT32 fpsNum;
+    UINT32 fpsDen;
+};
+#pragma pack(pop)
+
+static const char kProfileMagic[8] = { 'M', 'F', 'C', 'P', 'R', 'O', 'F', '1' };
+static const UINT32 DEVICE_PROFILE_VERSION = 1;
+
+// 开销模型中的相对系数（每像素），只用于比较候选模式，不代表绝对耗时
+static const double kDecodeH264Cost = 3.0;
+static const double kDecodeHEVCCost = 4.0;
+static const double kDecodeMJPGCost = 2.0;
+static const double kEncodeH264Cost = 8.0;
+static const double kConvertCost = 0.5;
+static const double kScaleCost = 1.0;
+static const double kCopyCostPerByte = 0.02;
+// 帧率或分辨率达不到目标、或超出链路带宽时的惩罚，远大于任何 CPU 开销
+static const double kShortfallPenalty = 1e12;
+
+static double RawBytesPerPixel(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12: return 1.5;
+    case VideoSubtype::P010:
+    case VideoSubtype::I010: return 3.0;
+    case VideoSubtype::YUY2:
+    case VideoSubtype::UYVY: return 2.0;
+    case VideoSubtype::RGB24: return 3.0;
+    case VideoSubtype::RGB32:
+    case VideoSubtype::ARGB32: return 4.0;
+    default: return 2.0;
+    }
+}
+
+bool FormatNegotiator::IsPipelineSubtype(VideoSubtype subtype) {
+    return subtype == VideoSubtype::H264 || subtype == VideoSubtype::NV12 || IsHighBitDepth(subtype);
+}
+
+static bool IsCompressed(VideoSubtype subtype) {
+    return subtype == VideoSubtype::H264 || subtype == VideoSubtype::HEVC || subtype == VideoSubtype::MJPG;
+}
+
+FormatNegotiator::FormatNegotiator() {}
+
+FormatNegotiator::~FormatNegotiator() {}
+
+HRESULT FormatNegotiator::Initialize(const std::wstring& cacheDirectory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_profiles.clear();
+    m_cacheDirectory = cacheDirectory;
+
+    if (m_cacheDirectory.empty()) {
+        WCHAR localAppData[MAX_PATH] = {};
+        DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", localAppData, MAX_PATH);
+        if (length == 0 || length >= MAX_PATH) return HRESULT_FROM_WIN32(ERROR_ENVVAR_NOT_FOUND);
+        m_cacheDirectory = std::wstring(localAppData) + L"\\MediaFoundationCamera";
+        CreateDirectoryW(m_cacheDirectory.c_str(), nullptr);
+        m_cacheDirectory += L"\\DeviceProfiles";
+    }
+
+    if (!CreateDirectoryW(m_cacheDirectory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        MFLOG_WARN("Failed to create device profile cache %ls", m_cacheDirectory.c_str());
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    return S_OK;
+}
+
+HRESULT FormatNegotiator::EnumerateCandidates(IMFSourceReader* pReader, std::vector<FormatCandidate>& candidates) {
+    if (pReader == nullptr) return E_POINTER;
+    candidates.clear();
+
+    for (DWORD index = 0;; index++) {
+        ComPtr<IMFMediaType> pType;
+        HRESULT hr = pReader->GetNativeMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, index, &pType);
+        if (hr == MF_E_NO_MORE_TYPES) break;
+        if (FAILED(hr)) return hr;
+
+        VideoFormat format;
+        if (FAILED(VideoFormatFromMediaType(pType.Get(), &format))) continue;
+
+        FormatCandidate candidate;
+        candidate.nativeIndex = index;
+        candidate.subtypeGuid = format.subtypeGuid;
+        candidate.subtype = format.subtype;
+        candidate.width = format.width;
+        candidate.height = format.height;
+        candidate.fpsNum = format.fpsNum;
+        candidate.fpsDen = format.fpsDen ? format.fpsDen : 1;
+        candidates.push_back(candidate);
+    }
+    return candidates.empty() ? MF_E_INVALIDMEDIATYPE : S_OK;
+}
+
+double FormatNegotiator::EstimateCost(const FormatCandidate& candidate, const NegotiationTarget& target) {
+    // 不认识的子类型只能交给 MF 的视频处理器，按最差情况计
+    if (candidate.subtype == VideoSubtype::Unknown || candidate.fpsNum == 0) return kShortfallPenalty * 10;
+
+    double srcPixels = static_cast<double>(candidate.width) * candidate.height;
+    double dstPixels = static_cast<double>(target.width) * target.height;
+    double srcFps = static_cast<double>(candidate.fpsNum) / candidate.fpsDen;
+    double dstFps = (target.fpsNum && target.fpsDen) ? static_cast<double>(target.fpsNum) / target.fpsDen : srcFps;
+    double outFps = (std::min)(srcFps, dstFps);
+    bool sameSize = candidate.width == target.width && candidate.height == target.height;
+    double cost = 0.0;
+
+    // 达不到目标帧率或分辨率时按缺口比例惩罚，宁可多花 CPU 也不降低输出质量
+    if (srcFps < dstFps * 0.99) cost += kShortfallPenalty * (1.0 - srcFps / dstFps);
+    if (srcPixels < dstPixels) cost += kShortfallPenalty * (1.0 - srcPixels / dstPixels);
+
+    if (!IsCompressed(candidate.subtype)) {
+        // 未压缩数据受链路带宽限制，超出时相机会丢帧或降帧
+        double bytesPerSecond = srcPixels * RawBytesPerPixel(candidate.subtype) * srcFps;
+        if (target.usbBandwidth && bytesPerSecond > static_cast<double>(target.usbBandwidth)) {
+            cost += kShortfallPenalty * (bytesPerSecond / target.usbBandwidth - 1.0);
+        }
+        cost += bytesPerSecond * kCopyCostPerByte;
+    }
+
+    if (target.output == VideoSubtype::H264) {
+        // 同分辨率的 H.264 直接透传，只有复制开销
+        if (candidate.subtype == VideoSubtype::H264 && sameSize) {
+            return cost + srcPixels * 0.1 * kCopyCostPerByte * outFps;
+        }
+        // 其它情况：解码（压缩源的每一帧都要解码）-> 转 NV12 -> 缩放 -> 编码
+        if (candidate.subtype == VideoSubtype::H264) cost += srcPixels * srcFps * kDecodeH264Cost;
+        else if (candidate.subtype == VideoSubtype::HEVC) cost += srcPixels * srcFps * kDecodeHEVCCost;
+        else if (candidate.subtype == VideoSubtype::MJPG) cost += srcPixels * srcFps * kDecodeMJPGCost;
+        else if (candidate.subtype != VideoSubtype::NV12) cost += srcPixels * outFps * kConvertCost;
+        if (!sameSize) cost += (std::max)(srcPixels, dstPixels) * outFps * kScaleCost;
+        return cost + dstPixels * outFps * kEncodeH264Cost;
+    }
+
+    // 目标为未压缩格式
+    VideoSubtype decoded = candidate.subtype;
+    if (candidate.subtype == VideoSubtype::H264) { cost += srcPixels * srcFps * kDecodeH264Cost; decoded = VideoSubtype::NV12; }
+    else if (candidate.subtype == VideoSubtype::HEVC) { cost += srcPixels * srcFps * kDecodeHEVCCost; decoded = VideoSubtype::NV12; }
+    else if (candidate.subtype == VideoSubtype::MJPG) { cost += srcPixels * srcFps * kDecodeMJPGCost; decoded = VideoSubtype::YUY2; }
+    if (decoded != target.output) cost += srcPixels * outFps * kConvertCost;
+    if (!sameSize) cost += (std::max)(srcPixels, dstPixels) * outFps * kScaleCost;
+    return cost;
+}
+
+std::wstring FormatNegotiator::GetProfilePath(const std::wstring& symbolicLink) const {
+    // 符号链接含有 \ ? # { } 等字符，以哈希作文件名，链接本身存进文件用于校验
+    UINT64 hash = 14695981039346656037ull;
+    for (wchar_t c : symbolicLink) {
+        hash ^= static_cast<UINT64>(std::towlower(c));
+        hash *= 1099511628211ull;
+    }
+    WCHAR name[32] = {};
+    swprintf_s(name, L"%016llx.profile", hash);
+    return m_cacheDirectory + L"\\" + name;
+}
+
+bool FormatNegotiator::LoadProfile(const std::wstring& symbolicLink, std::vector<FormatCandidate>& candidates) {
+    std::ifstream file(GetProfilePath(symbolicLink), std::ios::in | std::ios::binary);
+    if (!file.is_open()) return false;
+
+    DeviceProfileHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || memcmp(header.magic, kProfileMagic, sizeof(kProfileMagic)) != 0 ||
+        header.version != DEVICE_PROFILE_VERSION || header.entrySize != sizeof(DeviceProfileEntry) ||
+        header.linkLength != symbolicLink.size() || header.modeCount == 0 || header.modeCount > 4096) {
+        return false;
+    }
+
+    std::wstring link(header.linkLength, L'\0');
+    file.read(reinterpret_cast<char*>(&link[0]), link.size() * sizeof(wchar_t));
+    if (!file.good() || _wcsicmp(link.c_str(), symbolicLink.c_str()) != 0) return false;
+
+    std::vector<DeviceProfileEntry> entries(header.modeCount);
+    file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(DeviceProfileEntry));
+    if (!file.good()) return false;
+
+    candidates.clear();
+    for (const auto& entry : entries) {
+        FormatCandidate candidate;
+        candidate.nativeIndex = entry.nativeIndex;
+        candidate.subtypeGuid = entry.subtype;
+        candidate.subtype = VideoSubtypeFromGUID(entry.subtype);
+        candidate.width = entry.width;
+        candidate.height = entry.height;
+        candidate.fpsNum = entry.fpsNum;
+        candidate.fpsDen = entry.fpsDen ? entry.fpsDen : 1;
+        candidates.push_back(candidate);
+    }
+    return true;
+}
+
+HRESULT FormatNegotiator::SaveProfile(const std::wstring& symbolicLink, const std::vector<FormatCandidate>& candidates) {
+    std::ofstream file(GetProfilePath(symbolicLink), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return E_FAIL;
+
+    DeviceProfileHeader header = {};
+    memcpy(header.magic, kProfileMagic, sizeof(header.magic));
+    header.version = DEVICE_PROFILE_VERSION;
+    header.entrySize = sizeof(DeviceProfileEntry);
+    header.modeCount = static_cast<UINT32>(candidates.size());
+    header.linkLength = static_cast<UINT32>(symbolicLink.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(symbolicLink.data()), symbolicLink.size() * sizeof(wchar_t));
+
+    for (const auto& candidate : candidates) {
+        DeviceProfileEntry entry = {};
+        entry.nativeIndex = candidate.nativeIndex;
+        entry.subtype = candidate.subtypeGuid;
+        entry.width = candidate.width;
+        entry.height = candidate.height;
+        entry.fpsNum = candidate.fpsNum;
+        entry.fpsDen = candidate.fpsDen;
+        file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    }
+    return file.good() ? S_OK : E_FAIL;
+}
+
+void FormatNegotiator::InvalidateProfile(const std::wstring& symbolicLink) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_profiles.erase(symbolicLink);
+    if (!m_cacheDirectory.empty()) DeleteFileW(GetProfilePath(symbolicLink).c_str());
+}
+
+HRESULT FormatNegotiator::Negotiate(IMFSourceReader* pReader, const std::wstring& symbolicLink,
+    const NegotiationTarget& target, IMFMediaType** ppType, FormatCandidate* pChosen) {
+    if (pReader == nullptr || ppType == nullptr) return E_POINTER;
+    *ppType = nullptr;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::vector<FormatCandidate> candidates;
+        bool fromCache = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_profiles.find(symbolicLink);
+            if (it != m_profiles.end()) {
+                candidates = it->second;
+                fromCache = true;
+            }
+            else if (!m_cacheDirectory.empty() && LoadProfile(symbolicLink, candidates)) {
+                m_profiles[symbolicLink] = candidates;
+                fromCache = true;
+            }
+        }
+
+        if (!fromCache) {
+            HRESULT hr = EnumerateCandidates(pReader, candidates);
+            if (FAILED(hr)) {
+                MFLOG_ERROR("Failed to enumerate native media types: 0x%08lx", hr);
+                return hr;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_profiles[symbolicLink] = candidates;
+            if (!m_cacheDirectory.empty() && FAILED(SaveProfile(symbolicLink, candidates))) {
+                MFLOG_WARN("Failed to save device profile.");
+            }
+        }
+
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+            [&target](const FormatCandidate& candidate) {
+                return !IsPipelineSubtype(candidate.subtype) || (target.requireH264 && candidate.subtype != VideoSubtype::H264);
+            }), candidates.end());
+        if (candidates.empty()) return MF_E_INVALIDMEDIATYPE;
+
+        for (auto& candidate : candidates) candidate.cost = EstimateCost(candidate, target);
+
+        // 开销相同时优先更高帧率，其次更接近目标分辨率
+        auto best = std::min_element(candidates.begin(), candidates.end(),
+            [&target](const FormatCandidate& a, const FormatCandidate& b) {
+                if (a.cost != b.cost) return a.cost < b.cost;
+                double fpsA = static_cast<double>(a.fpsNum) / a.fpsDen, fpsB = static_cast<double>(b.fpsNum) / b.fpsDen;
+                if (fpsA != fpsB) return fpsA > fpsB;
+                return static_cast<UINT64>(a.width) * a.height < static_cast<UINT64>(b.width) * b.height;
+            });
+
+        // 只取选中的那一个原生类型，并确认缓存的索引仍然对应同一模式
+        ComPtr<IMFMediaType> pType;
+        HRESULT hr = pReader->GetNativeMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, best->nativeIndex, &pType);
+        VideoFormat format;
+        bool matches = SUCCEEDED(hr) && SUCCEEDED(VideoFormatFromMediaType(pType.Get(), &format)) &&
+            format.subtypeGuid == best->subtypeGuid && format.width == best->width && format.height == best->height &&
+            format.fpsNum == best->fpsNum && (format.fpsDen ? format.fpsDen : 1) == best->fpsDen;
+
+        if (matches) {
+            if (pChosen) *pChosen = *best;
+            *ppType = pType.Detach();
+            return S_OK;
+        }
+        if (!fromCache) return FAILED(hr) ? hr : MF_E_INVALIDMEDIATYPE;
+
+        // 缓存过期（驱动或固件更新），重新枚举一次
+        MFLOG_INFO("Cached device profile is stale, re-enumerating.");
+        InvalidateProfile(symbolicLink);
+    }
+    return MF_E_INVALIDMEDIATYPE;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "VideoFormat.h"
+
+// 协商目标：管线最终需要的输出
+struct NegotiationTarget {
+    VideoSubtype output = VideoSubtype::H264;   // H264 表示录像/预录直接使用压缩码流，其它值表示需要该未压缩格式
+    UINT32 width = 3840;
+    UINT32 height = 2160;
+    UINT32 fpsNum = 25;
+    UINT32 fpsDen = 1;
+    UINT64 usbBandwidth = 40 * 1000 * 1000;     // 相机链路可持续的字节/秒，默认按 USB 2.0 估计
+    bool requireH264 = false;                   // 只在相机原生的 H264 模式中选择（预录缓冲和直通录像只接受 H264）
+};
+
+// 相机原生支持的一种模式（GetNativeMediaType 的一项）
+struct FormatCandidate {
+    DWORD nativeIndex = 0;
+    GUID subtypeGuid = GUID_NULL;
+    VideoSubtype subtype = VideoSubtype::Unknown;
+    UINT32 width = 0;
+    UINT32 height = 0;
+    UINT32 fpsNum = 0;
+    UINT32 fpsDen = 1;
+    double cost = 0.0;      // 估算的端到端 CPU 开销，越小越好
+};
+
+// 按端到端开销给相机的每种原生模式打分并选出最便宜的一种
+// 枚举结果按符号链接缓存到磁盘，之后启动时只按缓存的索引取一次原生类型
+class FormatNegotiator {
+public:
+    FormatNegotiator();
+    ~FormatNegotiator();
+
+    // cacheDirectory 为空时使用 %LOCALAPPDATA%\MediaFoundationCamera\DeviceProfiles
+    HRESULT Initialize(const std::wstring& cacheDirectory = std::wstring());
+
+    // 为 pReader 的第一个视频流选择模式，返回可直接用于 SetCurrentMediaType 的原生类型。
+    // 只在管线能消费的子类型（IsPipelineSubtype）中选择；没有这样的模式，
+    // 或 target.requireH264 而相机没有 H264 模式时返回 MF_E_INVALIDMEDIATYPE
+    HRESULT Negotiate(IMFSourceReader* pReader, const std::wstring& symbolicLink, const NegotiationTarget& target,
+        IMFMediaType** ppType, FormatCandidate* pChosen = nullptr);
+
+    // 枚举所有原生模式（与 ListModes 相同的遍历方式）
+    static HRESULT EnumerateCandidates(IMFSourceReader* pReader, std::vector<FormatCandidate>& candidates);
+
+    // 采集管线能直接处理的子类型：H264 经解码器进入预览；NV12/P010/I010 直接进入预览，
+    // 预录时编码成 H264。YUY2/MJPG 等没有转换路径，不参与协商
+    static bool IsPipelineSubtype(VideoSubtype subtype);
+
+    // 估算把 candidate 变成 target 需要的开销
+    static double EstimateCost(const FormatCandidate& candidate, const NegotiationTarget& target);
+
+    // 删除某个设备的缓存（例如驱动更新后模式列表变化）
+    void InvalidateProfile(const std::wstring& symbolicLink);
+
+private:
+    std::wstring GetProfilePath(const std::wstring& symbolicLink) const;
+    bool LoadProfile(const std::wstring& symbolicLink, std::vector<FormatCandidate>& candidates);
+    HRESULT SaveProfile(const std::wstring& symbolicLink, const std::vector<FormatCandidate>& candidates);
+
+    std::wstring m_cacheDirectory;
+    std::mutex m_mutex;
+    std::map<std::wstring, std::vector<FormatCandidate>> m_profiles;   // 已加载的设备模式列表
+};
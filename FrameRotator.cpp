@@ -0,0 +1,364 @@
+#include "FrameRotator.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAME_ROTATOR_SSE2 1
+#endif
+
+using Microsoft::WRL::ComPtr;
+
+// 转置时目标块的边长（样点）
+static const UINT32 BLOCK = 128;
+
+// 一个平面：源尺寸以样点计，NV12 的 UV 对、RGB32 的像素各算一个样点
+struct PlaneView {
+    const BYTE* src;
+    LONG srcStride;
+    BYTE* dst;
+    LONG dstStride;
+    UINT32 width;
+    UINT32 height;
+};
+
+// 各子类型的平面数和每个平面的样点字节数
+struct PlaneLayout {
+    UINT32 count;
+    UINT32 sampleBytes[VIDEO_FORMAT_MAX_PLANES];
+};
+
+static bool GetPlaneLayout(VideoSubtype subtype, PlaneLayout* pLayout) {
+    switch (subtype) {
+    case VideoSubtype::NV12: *pLayout = { 2, { 1, 2, 0 } }; return true;
+    case VideoSubtype::P010: *pLayout = { 2, { 2, 4, 0 } }; return true;
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12: *pLayout = { 3, { 1, 1, 1 } }; return true;
+    case VideoSubtype::I010: *pLayout = { 3, { 2, 2, 2 } }; return true;
+    case VideoSubtype::RGB32:
+    case VideoSubtype::ARGB32: *pLayout = { 1, { 4, 0, 0 } }; return true;
+    default: return false;
+    }
+}
+
+// 小块边长：1、2 字节样点 8x8，4 字节样点 4x4
+template <typename T>
+constexpr UINT32 TileSize() { return sizeof(T) == 4 ? 4 : 8; }
+
+#ifdef FRAME_ROTATOR_SSE2
+// 寄存器内样点反序
+static inline __m128i ReverseLanes(__m128i v, UINT32) {
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static inline __m128i ReverseLanes(__m128i v, UINT16) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline __m128i ReverseLanes(__m128i v, UINT8) {
+    v = ReverseLanes(v, UINT16());
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// 小块转置：目标第 i 行第 j 个样点 = 源第 j 行第 i 个样点；行跨度为负即按相反的行序读写
+// 三种样点大小都是 8 个寄存器以内的解包网络，整块留在寄存器里
+static inline void TransposeTile(const BYTE* pSrc, ptrdiff_t srcStride, BYTE* pDst, ptrdiff_t dstStride, UINT8) {
+    __m128i r0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc));
+    __m128i r1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + srcStride));
+    __m128i r2 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + 2 * srcStride));
+    __m128i r3 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + 3 * srcStride));
+    __m128i r4 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + 4 * srcStride));
+    __m128i r5 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + 5 * srcStride));
+    __m128i r6 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + 6 * srcStride));
+    __m128i r7 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + 7 * srcStride));
+    // 相邻两行交织，每 16 位是同一列上的两行
+    __m128i a0 = _mm_unpacklo_epi8(r0, r1), a1 = _mm_unpacklo_epi8(r2, r3);
+    __m128i a2 = _mm_unpacklo_epi8(r4, r5), a3 = _mm_unpacklo_epi8(r6, r7);
+    // 每 32 位是同一列上的四行
+    __m128i b0 = _mm_unpacklo_epi16(a0, a1), b1 = _mm_unpackhi_epi16(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi16(a2, a3), b3 = _mm_unpackhi_epi16(a2, a3);
+    // 每 64 位是一整列
+    __m128i c0 = _mm_unpacklo_epi32(b0, b2), c1 = _mm_unpackhi_epi32(b0, b2);
+    __m128i c2 = _mm_unpacklo_epi32(b1, b3), c3 = _mm_unpackhi_epi32(b1, b3);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), c0);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + dstStride), _mm_unpackhi_epi64(c0, c0));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + 2 * dstStride), c1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + 3 * dstStride), _mm_unpackhi_epi64(c1, c1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + 4 * dstStride), c2);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + 5 * dstStride), _mm_unpackhi_epi64(c2, c2));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + 6 * dstStride), c3);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + 7 * dstStride), _mm_unpackhi_epi64(c3, c3));
+}
+
+static inline void TransposeTile(const BYTE* pSrc, ptrdiff_t srcStride, BYTE* pDst, ptrdiff_t dstStride, UINT16) {
+    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + srcStride));
+    __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * srcStride));
+    __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 3 * srcStride));
+    __m128i a0 = _mm_unpacklo_epi16(r0, r1), a1 = _mm_unpackhi_epi16(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi16(r2, r3), a3 = _mm_unpackhi_epi16(r2, r3);
+    r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * srcStride));
+    r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 5 * srcStride));
+    r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 6 * srcStride));
+    r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 7 * srcStride));
+    __m128i a4 = _mm_unpacklo_epi16(r0, r1), a5 = _mm_unpackhi_epi16(r0, r1);
+    __m128i a6 = _mm_unpacklo_epi16(r2, r3), a7 = _mm_unpackhi_epi16(r2, r3);
+    // 每 64 位是同一列上的四行
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_unpacklo_epi64(b0, b4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + dstStride), _mm_unpackhi_epi64(b0, b4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 2 * dstStride), _mm_unpacklo_epi64(b1, b5));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 3 * dstStride), _mm_unpackhi_epi64(b1, b5));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 4 * dstStride), _mm_unpacklo_epi64(b2, b6));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 5 * dstStride), _mm_unpackhi_epi64(b2, b6));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 6 * dstStride), _mm_unpacklo_epi64(b3, b7));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 7 * dstStride), _mm_unpackhi_epi64(b3, b7));
+}
+
+static inline void TransposeTile(const BYTE* pSrc, ptrdiff_t srcStride, BYTE* pDst, ptrdiff_t dstStride, UINT32) {
+    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + srcStride));
+    __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * srcStride));
+    __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 3 * srcStride));
+    __m128i a0 = _mm_unpacklo_epi32(r0, r1), a1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi32(r2, r3), a3 = _mm_unpackhi_epi32(r2, r3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_unpacklo_epi64(a0, a2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + dstStride), _mm_unpackhi_epi64(a0, a2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 2 * dstStride), _mm_unpacklo_epi64(a1, a3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 3 * dstStride), _mm_unpackhi_epi64(a1, a3));
+}
+#else
+template <typename T>
+static inline void TransposeTile(const BYTE* pSrc, ptrdiff_t srcStride, BYTE* pDst, ptrdiff_t dstStride, T) {
+    const UINT32 N = TileSize<T>();
+    for (UINT32 i = 0; i < N; i++) {
+        T* pRow = reinterpret_cast<T*>(pDst + i * dstStride);
+        for (UINT32 j = 0; j < N; j++) pRow[j] = reinterpret_cast<const T*>(pSrc + j * srcStride)[i];
+    }
+}
+#endif
+
+template <typename T>
+static void ReverseRow(const T* pSrc, T* pDst, UINT32 count) {
+    UINT32 x = 0;
+#ifdef FRAME_ROTATOR_SSE2
+    const UINT32 lanes = 16 / sizeof(T);
+    for (; x + lanes <= count; x += lanes) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + count - x - lanes));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x), ReverseLanes(v, T()));
+    }
+#endif
+    for (; x < count; x++) pDst[x] = pSrc[count - 1 - x];
+}
+
+// 不转置：目标行 y 来自源行 y（垂直翻转时为 height - 1 - y），水平翻转时整行反序
+template <typename T>
+static void CopyRows(const PlaneView& plane, bool flipX, bool flipY, UINT32 rowBegin, UINT32 rowEnd) {
+    for (UINT32 y = rowBegin; y < rowEnd; y++) {
+        UINT32 sy = flipY ? plane.height - 1 - y : y;
+        const T* pSrc = reinterpret_cast<const T*>(plane.src + static_cast<ptrdiff_t>(sy) * plane.srcStride);
+        T* pDst = reinterpret_cast<T*>(plane.dst + static_cast<ptrdiff_t>(y) * plane.dstStride);
+        if (flipX) ReverseRow(pSrc, pDst, plane.width);
+        else memcpy(pDst, pSrc, plane.width * sizeof(T));
+    }
+}
+
+// 转置：目标 (dx, dy) 来自源 (flipY ? width - 1 - dy : dy, flipX ? height - 1 - dx : dx)
+// [rowBegin, rowEnd) 为目标行，目标宽度为源高度
+template <typename T>
+static void TransposeRows(const PlaneView& plane, bool flipX, bool flipY, UINT32 rowBegin, UINT32 rowEnd) {
+    const UINT32 N = TileSize<T>();
+    const UINT32 dstWidth = plane.height;
+    auto srcRow = [&](UINT32 dx) {
+        return plane.src + static_cast<ptrdiff_t>(flipX ? plane.height - 1 - dx : dx) * plane.srcStride;
+    };
+    auto dstRow = [&](UINT32 dy) { return plane.dst + static_cast<ptrdiff_t>(dy) * plane.dstStride; };
+
+    // 翻转只体现在行跨度的符号上：水平翻转时源行倒序读，垂直翻转时小块的目标行倒序写
+    const ptrdiff_t srcStep = flipX ? -static_cast<ptrdiff_t>(plane.srcStride) : plane.srcStride;
+    const ptrdiff_t dstStep = flipY ? -static_cast<ptrdiff_t>(plane.dstStride) : plane.dstStride;
+
+    // 目标按 BLOCK x BLOCK 的块处理：块内的源行段和目标行段都留在缓存里，每条缓存行只从内存读写一次
+    for (UINT32 blockY = rowBegin; blockY < rowEnd; blockY += BLOCK) {
+        UINT32 blockYEnd = (std::min)(blockY + BLOCK, rowEnd);
+        UINT32 tileYEnd = blockY + (blockYEnd - blockY) / N * N;
+        for (UINT32 blockX = 0; blockX < dstWidth; blockX += BLOCK) {
+            UINT32 blockXEnd = (std::min)(blockX + BLOCK, dstWidth);
+            UINT32 tileXEnd = blockX + (blockXEnd - blockX) / N * N;
+            for (UINT32 dy = blockY; dy < tileYEnd; dy += N) {
+                UINT32 sx = flipY ? plane.width - dy - N : dy;
+                BYTE* pDst = dstRow(flipY ? dy + N - 1 : dy);
+                for (UINT32 dx = blockX; dx < tileXEnd; dx += N) {
+                    TransposeTile(srcRow(dx) + sx * sizeof(T), srcStep, pDst + dx * sizeof(T), dstStep, T());
+                }
+            }
+
+            // 块右边缘和下边缘不足一个小块的部分逐样点处理
+            for (UINT32 dy = blockY; dy < blockYEnd; dy++) {
+                T* pDst = reinterpret_cast<T*>(dstRow(dy));
+                UINT32 sx = flipY ? plane.width - 1 - dy : dy;
+                for (UINT32 dx = (dy < tileYEnd) ? tileXEnd : blockX; dx < blockXEnd; dx++) {
+                    pDst[dx] = reinterpret_cast<const T*>(srcRow(dx))[sx];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+static void RotatePlane(ParallelBands* pBands, const PlaneView& plane, FrameOrientation orientation) {
+    bool flipX = FlipsHorizontally(orientation), flipY = FlipsVertically(orientation);
+    if (SwapsAxes(orientation)) {
+        // 行带按整块切分，块不会跨越两个行带
+        UINT32 dstHeight = plane.width;
+        UINT32 blocks = (dstHeight + BLOCK - 1) / BLOCK;
+        auto band = [&](UINT32 blockBegin, UINT32 blockEnd) {
+            TransposeRows<T>(plane, flipX, flipY, blockBegin * BLOCK, (std::min)(blockEnd * BLOCK, dstHeight));
+        };
+        if (pBands) pBands->Run(blocks, 1, band);
+        else band(0, blocks);
+    }
+    else {
+        auto band = [&](UINT32 rowBegin, UINT32 rowEnd) { CopyRows<T>(plane, flipX, flipY, rowBegin, rowEnd); };
+        if (pBands) pBands->Run(plane.height, 32, band);
+        else band(0, plane.height);
+    }
+}
+
+FrameRotator::FrameRotator() : m_pBands(&ParallelBands::Shared()) {}
+
+FrameRotator::~FrameRotator() {
+    if (m_pPool) m_pPool->Shutdown();
+}
+
+bool FrameRotator::IsSupported(VideoSubtype subtype) {
+    PlaneLayout layout;
+    return GetPlaneLayout(subtype, &layout);
+}
+
+void FrameRotator::GetOutputSize(FrameOrientation orientation, UINT32 width, UINT32 height, UINT32* pWidth, UINT32* pHeight) {
+    bool swap = SwapsAxes(orientation);
+    *pWidth = swap ? height : width;
+    *pHeight = swap ? width : height;
+}
+
+HRESULT FrameRotator::Rotate(const ImagePlanes& src, const ImagePlanes& dst, FrameOrientation orientation) {
+    PlaneLayout layout;
+    if (!GetPlaneLayout(src.subtype, &layout)) return MF_E_INVALIDMEDIATYPE;
+    UINT32 dstWidth = 0, dstHeight = 0;
+    GetOutputSize(orientation, src.width, src.height, &dstWidth, &dstHeight);
+    if (dst.width != dstWidth || dst.height != dstHeight) return MF_E_INVALIDMEDIATYPE;
+
+    for (UINT32 i = 0; i < layout.count; i++) {
+        if (src.data[i] == nullptr || dst.data[i] == nullptr) return E_POINTER;
+
+        // 4:2:0 色度平面按向上取整的半尺寸处理，转置后正好是目标的色度尺寸
+        PlaneView plane;
+        plane.src = src.data[i];
+        plane.srcStride = src.stride[i];
+        plane.dst = dst.data[i];
+        plane.dstStride = dst.stride[i];
+        plane.width = (i == 0) ? src.width : (src.width + 1) / 2;
+        plane.height = (i == 0) ? src.height : (src.height + 1) / 2;
+
+        switch (layout.sampleBytes[i]) {
+        case 1: RotatePlane<UINT8>(m_pBands, plane, orientation); break;
+        case 2: RotatePlane<UINT16>(m_pBands, plane, orientation); break;
+        case 4: RotatePlane<UINT32>(m_pBands, plane, orientation); break;
+        }
+    }
+    return S_OK;
+}
+
+// 输出格式只改变尺寸，颜色信息沿用输入
+HRESULT FrameRotator::UpdateOutputFormat(const VideoFormat& format, FrameOrientation orientation) {
+    if (m_pPool && format.hash == m_inputHash && orientation == m_orientation) return S_OK;
+
+    UINT32 width = 0, height = 0;
+    GetOutputSize(orientation, format.width, format.height, &width, &height);
+
+    ComPtr<IMFMediaType> pType;
+    HRESULT hr = MFCreateMediaType(&pType);
+    if (SUCCEEDED(hr)) hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (SUCCEEDED(hr)) hr = pType->SetGUID(MF_MT_SUBTYPE, format.subtypeGuid);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeSize(pType.Get(), MF_MT_FRAME_SIZE, width, height);
+    if (SUCCEEDED(hr) && format.fpsNum != 0) hr = MFSetAttributeRatio(pType.Get(), MF_MT_FRAME_RATE, format.fpsNum, format.fpsDen);
+    if (SUCCEEDED(hr) && format.yuvMatrix != 0) hr = pType->SetUINT32(MF_MT_YUV_MATRIX, format.yuvMatrix);
+    if (SUCCEEDED(hr) && format.nominalRange != 0) hr = pType->SetUINT32(MF_MT_VIDEO_NOMINAL_RANGE, format.nominalRange);
+    if (SUCCEEDED(hr) && format.primaries != 0) hr = pType->SetUINT32(MF_MT_VIDEO_PRIMARIES, format.primaries);
+    if (SUCCEEDED(hr) && format.transferFunction != 0) hr = pType->SetUINT32(MF_MT_TRANSFER_FUNCTION, format.transferFunction);
+    if (SUCCEEDED(hr)) hr = VideoFormatFromMediaType(pType.Get(), &m_outputFormat);
+    if (FAILED(hr)) return hr;
+
+    if (m_pPool) m_pPool->Reconfigure(m_outputFormat.frameBytes, 16);
+    else hr = SamplePool::Create(m_outputFormat.frameBytes, 16, 2, &m_pPool);
+    if (FAILED(hr)) return hr;
+
+    m_inputHash = format.hash;
+    m_orientation = orientation;
+    return S_OK;
+}
+
+HRESULT FrameRotator::RotateSample(IMFSample* pInput, const VideoFormat& format, FrameOrientation orientation,
+    IMFSample** ppOutput) {
+    if (pInput == nullptr || ppOutput == nullptr) return E_POINTER;
+    *ppOutput = nullptr;
+    if (!IsSupported(format.subtype)) return MF_E_INVALIDMEDIATYPE;
+
+    // 不需要改变方向时原样返回
+    if (orientation == FrameOrientation::Identity) {
+        m_outputFormat = format;
+        m_inputHash = 0;
+        *ppOutput = pInput;
+        pInput->AddRef();
+        return S_OK;
+    }
+
+    HRESULT hr = UpdateOutputFormat(format, orientation);
+    if (FAILED(hr)) return hr;
+
+    ComPtr<IMFMediaBuffer> pInBuffer, pOutBuffer;
+    ComPtr<IMFSample> pOutput;
+    hr = pInput->ConvertToContiguousBuffer(&pInBuffer);
+    if (FAILED(hr)) return hr;
+    hr = m_pPool->AcquireSample(&pOutput);
+    if (FAILED(hr)) return hr;
+    hr = pOutput->GetBufferByIndex(0, &pOutBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pIn = nullptr;
+    BYTE* pOut = nullptr;
+    DWORD cbIn = 0, cbOutMax = 0;
+    hr = pInBuffer->Lock(&pIn, nullptr, &cbIn);
+    if (FAILED(hr)) return hr;
+    hr = pOutBuffer->Lock(&pOut, &cbOutMax, nullptr);
+    if (SUCCEEDED(hr)) {
+        ImagePlanes src, dst;
+        hr = ImagePlanesFromBuffer(format, pIn, cbIn, &src);
+        if (SUCCEEDED(hr)) hr = ImagePlanesFromBuffer(m_outputFormat, pOut, cbOutMax, &dst);
+        if (SUCCEEDED(hr)) hr = Rotate(src, dst, orientation);
+        pOutBuffer->Unlock();
+    }
+    pInBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    hr = pOutBuffer->SetCurrentLength(m_outputFormat.frameBytes);
+    if (FAILED(hr)) return hr;
+
+    hr = pInput->CopyAllItems(pOutput.Get());
+    if (FAILED(hr)) return hr;
+    LONGLONG value = 0;
+    if (SUCCEEDED(pInput->GetSampleTime(&value))) pOutput->SetSampleTime(value);
+    if (SUCCEEDED(pInput->GetSampleDuration(&value))) pOutput->SetSampleDuration(value);
+
+    *ppOutput = pOutput.Detach();
+    return S_OK;
+}
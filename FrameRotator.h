@@ -0,0 +1,42 @@
+#pragma once
+#include <windows.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+#include "SamplePool.h"
+
+// 旋转 / 翻转 / 转置（NV12 / P010 / I420 / IYUV / YV12 / I010 / RGB32 / ARGB32），用于倒装或竖装的相机
+// 每个平面按样点大小（1、2、4 字节，NV12 的 UV 对按 2 字节整体移动）实例化同一套模板：
+// 不转置时逐行拷贝（水平翻转用 SSE2 反序）；转置时按 128x128 样点的目标块处理，块内的源行段和目标行段
+// 都留在缓存里，块内用 SSE2 解包做 8x8（4 字节样点为 4x4）小块转置；翻转只改变小块读写的行跨度符号，
+// 不需要额外的反序步骤。按目标块行带并行
+class FrameRotator {
+public:
+    FrameRotator();
+    ~FrameRotator();
+
+    static bool IsSupported(VideoSubtype subtype);
+
+    // 按方向得到输出尺寸（转置时宽高互换）
+    static void GetOutputSize(FrameOrientation orientation, UINT32 width, UINT32 height, UINT32* pWidth, UINT32* pHeight);
+
+    // src 按 orientation 写入 dst；dst 尺寸须为 GetOutputSize 的结果、子类型与 src 相同，不能与 src 重叠
+    HRESULT Rotate(const ImagePlanes& src, const ImagePlanes& dst, FrameOrientation orientation);
+
+    // 采样接口：输出从池中取，时间戳和采样属性随帧复制；输出格式由 GetOutputFormat 返回
+    HRESULT RotateSample(IMFSample* pInput, const VideoFormat& format, FrameOrientation orientation, IMFSample** ppOutput);
+    const VideoFormat& GetOutputFormat() const { return m_outputFormat; }
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+private:
+    HRESULT UpdateOutputFormat(const VideoFormat& format, FrameOrientation orientation);
+
+    ParallelBands* m_pBands = nullptr;
+    Microsoft::WRL::ComPtr<SamplePool> m_pPool;
+    VideoFormat m_outputFormat = {};
+    UINT64 m_inputHash = 0;                     // 输出格式对应的输入格式和方向
+    FrameOrientation m_orientation = FrameOrientation::Identity;
+};
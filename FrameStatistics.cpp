@@ -0,0 +1,203 @@
+#include "FrameStatistics.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAME_STATISTICS_SSE2 1
+#endif
+
+// {8E3F6B21-47C9-4A5D-B1E8-2D6C9A0F5E34}
+const GUID FrameStatistics_Stats = { 0x8e3f6b21, 0x47c9, 0x4a5d, { 0xb1, 0xe8, 0x2d, 0x6c, 0x9a, 0x0f, 0x5e, 0x34 } };
+
+static_assert(std::is_trivially_copyable<FrameStats>::value, "FrameStats is copied as raw words");
+
+// ---- 快照 ----
+
+void FrameStatsSnapshot::Publish(const FrameStats& stats) {
+    UINT64 words[WORDS] = {};
+    memcpy(words, &stats, sizeof(stats));
+
+    UINT64 sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) m_words[i].store(words[i], std::memory_order_relaxed);
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool FrameStatsSnapshot::Read(FrameStats* pStats) const {
+    if (pStats == nullptr) return false;
+    UINT64 words[WORDS];
+    for (;;) {
+        UINT64 before = m_sequence.load(std::memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < WORDS; i++) words[i] = m_words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) == before) break;
+    }
+    memcpy(pStats, words, sizeof(*pStats));
+    return true;
+}
+
+// ---- 统计 ----
+
+FrameStatistics::FrameStatistics() : m_pBands(&ParallelBands::Shared()) {}
+
+bool FrameStatistics::IsSupported(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 一个抽样行的直方图：四张子表轮流累加，相邻样点值相同时不会互相等待同一个计数器
+static void HistogramRow(const BYTE* pRow, UINT32 width, UINT32 step, UINT32 (*pHistogram)[256]) {
+    UINT32 x = 0;
+    for (; x + 3 * step < width; x += 4 * step) {
+        pHistogram[0][pRow[x]]++;
+        pHistogram[1][pRow[x + step]]++;
+        pHistogram[2][pRow[x + 2 * step]]++;
+        pHistogram[3][pRow[x + 3 * step]]++;
+    }
+    for (; x < width; x += step) pHistogram[0][pRow[x]]++;
+}
+
+// 一行内部样点（x = 1 .. width - 2）的 4 邻域拉普拉斯平方和
+static UINT64 LaplacianRow(const BYTE* pUp, const BYTE* pRow, const BYTE* pDown, UINT32 width) {
+    UINT64 sum = 0;
+    UINT32 x = 1;
+#ifdef FRAME_STATISTICS_SSE2
+    // |L| <= 1020，每次迭代每个 32 位通道加 4 个平方（最多约 416 万），每 256 次迭代转到 64 位累加
+    const __m128i zero = _mm_setzero_si128();
+    while (x + 16 <= width - 1) {
+        __m128i acc = _mm_setzero_si128();
+        for (UINT32 n = 0; n < 256 && x + 16 <= width - 1; n++, x += 16) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x));
+            __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x - 1));
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x + 1));
+            __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pUp + x));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pDown + x));
+            __m128i lo = _mm_slli_epi16(_mm_unpacklo_epi8(c, zero), 2);
+            __m128i hi = _mm_slli_epi16(_mm_unpackhi_epi8(c, zero), 2);
+            lo = _mm_sub_epi16(lo, _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(l, zero), _mm_unpacklo_epi8(r, zero)),
+                _mm_add_epi16(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(d, zero))));
+            hi = _mm_sub_epi16(hi, _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(l, zero), _mm_unpackhi_epi8(r, zero)),
+                _mm_add_epi16(_mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(d, zero))));
+            acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+        alignas(16) UINT32 lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        sum += static_cast<UINT64>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; x + 1 < width; x++) {
+        INT32 l = 4 * pRow[x] - pRow[x - 1] - pRow[x + 1] - pUp[x] - pDown[x];
+        sum += static_cast<UINT64>(l * l);
+    }
+    return sum;
+}
+
+HRESULT FrameStatistics::Analyze(const ImagePlanes& frame, const VideoFormat& format, FrameStats* pStats) {
+    if (pStats == nullptr || frame.data[0] == nullptr) return E_POINTER;
+    if (!IsSupported(frame.subtype)) return MF_E_INVALIDMEDIATYPE;
+    if (frame.width < 3 || frame.height < 3) return MF_E_INVALIDMEDIATYPE;
+
+    auto start = std::chrono::steady_clock::now();
+    const UINT32 rowStep = (std::max)(m_settings.rowStep, 1u);
+    const UINT32 columnStep = (std::max)(m_settings.columnStep, 1u);
+    // 第一行和最后一行没有上下邻行，抽样行从第 1 行开始
+    const UINT32 rows = (frame.height - 2 + rowStep - 1) / rowStep;
+
+    // 每个行带先累加到自己的表里，结束时合并一次
+    UINT32 histogram[256] = {};
+    UINT64 laplacianSum = 0;
+    std::mutex mergeMutex;
+    auto band = [&](UINT32 rowBegin, UINT32 rowEnd) {
+        UINT32 local[4][256] = {};
+        UINT64 localSum = 0;
+        for (UINT32 i = rowBegin; i < rowEnd; i++) {
+            UINT32 y = 1 + i * rowStep;
+            const BYTE* pRow = frame.data[0] + static_cast<ptrdiff_t>(y) * frame.stride[0];
+            HistogramRow(pRow, frame.width, columnStep, local);
+            localSum += LaplacianRow(pRow - frame.stride[0], pRow, pRow + frame.stride[0], frame.width);
+        }
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (UINT32 v = 0; v < 256; v++) histogram[v] += local[0][v] + local[1][v] + local[2][v] + local[3][v];
+        laplacianSum += localSum;
+    };
+    if (m_pBands) m_pBands->Run(rows, 16, band);
+    else band(0, rows);
+
+    FrameStats stats;
+    stats.width = frame.width;
+    stats.height = frame.height;
+    memcpy(stats.histogram, histogram, sizeof(histogram));
+
+    // 均值、方差和截断比例都由直方图得出
+    bool fullRange = format.nominalRange == MFNominalRange_0_255;
+    UINT32 black = fullRange ? 0 : 16, white = fullRange ? 255 : 235;
+    UINT64 count = 0, sum = 0, sumSquares = 0, dark = 0, bright = 0;
+    for (UINT32 v = 0; v < 256; v++) {
+        UINT64 n = histogram[v];
+        count += n;
+        sum += n * v;
+        sumSquares += n * v * v;
+        if (v <= black) dark += n;
+        if (v >= white) bright += n;
+    }
+    stats.samples = static_cast<UINT32>(count);
+    if (count > 0) {
+        stats.mean = static_cast<double>(sum) / count;
+        stats.variance = static_cast<double>(sumSquares) / count - stats.mean * stats.mean;
+        stats.clippedDark = static_cast<double>(dark) / count;
+        stats.clippedBright = static_cast<double>(bright) / count;
+    }
+    stats.sharpness = static_cast<double>(laplacianSum) / (static_cast<double>(rows) * (frame.width - 2));
+    stats.analyzeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    *pStats = stats;
+    return S_OK;
+}
+
+HRESULT FrameStatistics::Publish(IMFSample* pSample, FrameStats& stats) {
+    LONGLONG time = 0;
+    if (SUCCEEDED(pSample->GetSampleTime(&time))) stats.sampleTime = time;
+    m_last = stats;
+    m_snapshot.Publish(stats);
+    return pSample->SetBlob(FrameStatistics_Stats, reinterpret_cast<const UINT8*>(&stats), sizeof(stats));
+}
+
+HRESULT FrameStatistics::AnalyzeSample(IMFSample* pSample, const ImagePlanes& frame, const VideoFormat& format) {
+    if (pSample == nullptr) return E_POINTER;
+
+    FrameStats stats;
+    HRESULT hr = Analyze(frame, format, &stats);
+    if (FAILED(hr)) return hr;
+    stats.frameNumber = ++m_frameNumber;
+    return Publish(pSample, stats);
+}
+
+HRESULT FrameStatistics::RepeatSample(IMFSample* pSample) {
+    if (pSample == nullptr) return E_POINTER;
+    if (m_frameNumber == 0) return MF_E_NOT_INITIALIZED;
+
+    FrameStats stats = m_last;
+    stats.frameNumber = ++m_frameNumber;
+    stats.repeated = true;
+    stats.analyzeMs = 0.0;
+    return Publish(pSample, stats);
+}
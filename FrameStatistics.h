@@ -0,0 +1,84 @@
+#pragma once
+#include <windows.h>
+#include <mfidl.h>
+#include <atomic>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+
+// 采样属性（blob）：该帧的 FrameStats
+extern const GUID FrameStatistics_Stats;
+
+struct FrameStatsSettings {
+    UINT32 rowStep = 8;             // 抽样网格：每隔 rowStep 行取一行（拉普拉斯还要读上下邻行）
+    UINT32 columnStep = 4;          // 抽样行内直方图每隔 columnStep 个样点取一个；锐度按抽样行的每个样点计算
+};
+
+// 一帧的亮度统计（8 位亮度值）
+struct FrameStats {
+    LONGLONG sampleTime = 0;
+    UINT64 frameNumber = 0;         // 从 1 开始计数，0 表示还没有统计过任何帧
+    UINT32 width = 0;
+    UINT32 height = 0;
+    UINT32 samples = 0;             // 直方图的样点数
+    UINT32 histogram[256] = {};
+    double mean = 0.0;
+    double variance = 0.0;
+    double clippedDark = 0.0;       // 黑电平及以下的样点比例（视频范围 16，全范围 0）
+    double clippedBright = 0.0;     // 白电平及以上的样点比例（视频范围 235，全范围 255）
+    double sharpness = 0.0;         // 4 邻域拉普拉斯响应的均方，越大越清晰；只适合同一画面前后比较
+    bool repeated = false;          // 静止画面沿用上一帧的统计
+    double analyzeMs = 0.0;
+};
+
+// 单写多读的无锁快照（序列锁）：写方每帧发布一次不会被读方阻塞，读方读到写了一半的数据时重试
+class FrameStatsSnapshot {
+public:
+    void Publish(const FrameStats& stats);
+
+    // 还没有发布过时返回 false
+    bool Read(FrameStats* pStats) const;
+
+private:
+    static const size_t WORDS = (sizeof(FrameStats) + sizeof(UINT64) - 1) / sizeof(UINT64);
+    std::atomic<UINT64> m_sequence{ 0 };    // 奇数表示正在写
+    std::atomic<UINT64> m_words[WORDS];
+};
+
+// 帧统计：曝光（直方图、均值、方差）、过暗 / 过亮截断比例和对焦锐度，用于相机健康监控
+// 只读亮度平面的抽样行（默认每 8 行一行）：直方图每 4 个样点取一个，均值和方差由直方图得出；
+// 锐度在抽样行的每个样点上算拉普拉斯（SSE2 每次 16 个样点，madd 累加平方），对焦变化不会被抽样漏掉。
+// 抽样行按行带并行。只看 8 位亮度（NV12/I420/IYUV/YV12）
+class FrameStatistics {
+public:
+    FrameStatistics();
+
+    static bool IsSupported(VideoSubtype subtype);
+
+    void SetSettings(const FrameStatsSettings& settings) { m_settings = settings; }
+    const FrameStatsSettings& GetSettings() const { return m_settings; }
+
+    // 只计算，不发布
+    HRESULT Analyze(const ImagePlanes& frame, const VideoFormat& format, FrameStats* pStats);
+
+    // frame 为 pSample 已锁定缓冲的平面视图（在转换等已经读取帧数据的地方调用，避免单独再锁一次）；
+    // 统计结果写入采样的 FrameStatistics_Stats 并发布到快照
+    HRESULT AnalyzeSample(IMFSample* pSample, const ImagePlanes& frame, const VideoFormat& format);
+
+    // 静止画面的重复帧：沿用上一帧的统计，只更新时间戳
+    HRESULT RepeatSample(IMFSample* pSample);
+
+    // 任意线程调用，不加锁；还没有统计过任何帧时返回 false
+    bool GetLatest(FrameStats* pStats) const { return m_snapshot.Read(pStats); }
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+private:
+    HRESULT Publish(IMFSample* pSample, FrameStats& stats);
+
+    FrameStatsSettings m_settings;
+    ParallelBands* m_pBands = nullptr;
+    UINT64 m_frameNumber = 0;
+    FrameStats m_last;                  // 写方自己的副本，RepeatSample 沿用
+    FrameStatsSnapshot m_snapshot;
+};
@@ -0,0 +1,230 @@
+#include "H264Bitstream.h"
+#include <cstring>
+
+uint32_t H264BitReader::ReadBit() {
+    if (m_byte >= m_size) {
+        m_error = true;
+        return 0;
+    }
+
+    // 跳过 00 00 03 中的防竞争字节
+    if (m_bit == 0 && m_zeroRun >= 2 && m_data[m_byte] == 0x03) {
+        m_zeroRun = 0;
+        if (++m_byte >= m_size) {
+            m_error = true;
+            return 0;
+        }
+    }
+
+    uint32_t value = (m_data[m_byte] >> (7 - m_bit)) & 1;
+    if (++m_bit == 8) {
+        m_zeroRun = m_data[m_byte] == 0 ? m_zeroRun + 1 : 0;
+        m_bit = 0;
+        m_byte++;
+    }
+    return value;
+}
+
+uint32_t H264BitReader::ReadBits(uint32_t count) {
+    uint32_t value = 0;
+    while (count--) {
+        value = (value << 1) | ReadBit();
+    }
+    return value;
+}
+
+uint32_t H264BitReader::ReadUE() {
+    uint32_t leadingZeros = 0;
+    while (ReadBit() == 0) {
+        if (m_error || ++leadingZeros > 31) {
+            m_error = true;
+            return 0;
+        }
+    }
+    if (leadingZeros == 0) return 0;
+    return ((1u << leadingZeros) - 1) + ReadBits(leadingZeros);
+}
+
+int32_t H264BitReader::ReadSE() {
+    uint32_t codeNum = ReadUE();
+    int32_t magnitude = static_cast<int32_t>((codeNum + 1) >> 1);
+    return (codeNum & 1) ? magnitude : -magnitude;
+}
+
+const uint8_t* H264FindStartCode(const uint8_t* p, const uint8_t* end, size_t* pStartCodeLength) {
+    // 以 memchr 定位 0x01，再回看前导的 0，比逐字节状态机快得多
+    const uint8_t* search = p + 2;
+    while (search < end) {
+        const uint8_t* one = static_cast<const uint8_t*>(memchr(search, 0x01, end - search));
+        if (one == nullptr) break;
+        if (one[-1] == 0 && one[-2] == 0) {
+            const uint8_t* start = one - 2;
+            size_t length = 3;
+            if (start > p && start[-1] == 0) {
+                start--;
+                length = 4;
+            }
+            if (pStartCodeLength) *pStartCodeLength = length;
+            return start;
+        }
+        search = one + 1;
+    }
+    if (pStartCodeLength) *pStartCodeLength = 0;
+    return end;
+}
+
+size_t H264SplitAnnexB(const uint8_t* data, size_t size, std::vector<H264NalUnit>& nals) {
+    const uint8_t* end = data + size;
+    size_t startCodeLength = 0;
+    const uint8_t* start = H264FindStartCode(data, end, &startCodeLength);
+    size_t count = 0;
+
+    while (start < end) {
+        const uint8_t* nalStart = start + startCodeLength;
+        size_t nextLength = 0;
+        const uint8_t* next = H264FindStartCode(nalStart, end, &nextLength);
+
+        // 去掉 NAL 尾部的 trailing_zero_8bits
+        const uint8_t* nalEnd = next;
+        while (nalEnd > nalStart && nalEnd[-1] == 0 && next != end) nalEnd--;
+
+        if (nalEnd > nalStart) {
+            H264NalUnit nal;
+            nal.data = nalStart;
+            nal.size = static_cast<size_t>(nalEnd - nalStart);
+            nal.type = H264NalTypeOf(nalStart[0]);
+            nals.push_back(nal);
+            count++;
+        }
+
+        start = next;
+        startCodeLength = nextLength;
+    }
+    return count;
+}
+
+bool H264IsFirstSliceOfPicture(const H264NalUnit& nal) {
+    if (!H264IsVclNal(nal.type) || nal.size < 2) return false;
+    // first_mb_in_slice 为 ue(v)，值为 0 时编码为单个 '1' 比特
+    return (nal.data[1] & 0x80) != 0;
+}
+
+bool H264ContainsIdr(const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    size_t startCodeLength = 0;
+    const uint8_t* p = H264FindStartCode(data, end, &startCodeLength);
+    while (p < end) {
+        const uint8_t* header = p + startCodeLength;
+        if (header < end && H264NalTypeOf(*header) == H264_NAL_SLICE_IDR) return true;
+        p = H264FindStartCode(header, end, &startCodeLength);
+    }
+    return false;
+}
+
+static void SkipScalingList(H264BitReader& reader, int size) {
+    int lastScale = 8, nextScale = 8;
+    for (int j = 0; j < size; j++) {
+        if (nextScale != 0) {
+            int delta = reader.ReadSE();
+            nextScale = (lastScale + delta + 256) % 256;
+        }
+        lastScale = (nextScale == 0) ? lastScale : nextScale;
+    }
+}
+
+bool H264ParseSps(const uint8_t* nal, size_t size, H264SpsInfo* pInfo) {
+    if (size < 4 || H264NalTypeOf(nal[0]) != H264_NAL_SPS) return false;
+
+    H264SpsInfo info;
+    info.profileIdc = nal[1];
+    info.constraintFlags = nal[2];
+    info.levelIdc = nal[3];
+
+    H264BitReader reader(nal + 4, size - 4);
+    info.spsId = reader.ReadUE();
+
+    uint32_t separateColourPlane = 0;
+    switch (info.profileIdc) {
+    case 100: case 110: case 122: case 244: case 44:
+    case 83: case 86: case 118: case 128: case 138:
+    case 139: case 134: case 135:
+        info.chromaFormatIdc = reader.ReadUE();
+        if (info.chromaFormatIdc == 3) separateColourPlane = reader.ReadBits(1);
+        info.bitDepthLuma = reader.ReadUE() + 8;
+        info.bitDepthChroma = reader.ReadUE() + 8;
+        reader.SkipBits(1); // qpprime_y_zero_transform_bypass_flag
+        if (reader.ReadBits(1)) {
+            int listCount = (info.chromaFormatIdc != 3) ? 8 : 12;
+            for (int i = 0; i < listCount; i++) {
+                if (reader.ReadBits(1)) SkipScalingList(reader, i < 6 ? 16 : 64);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    info.log2MaxFrameNum = reader.ReadUE() + 4;
+    info.pocType = reader.ReadUE();
+    if (info.pocType == 0) {
+        reader.ReadUE(); // log2_max_pic_order_cnt_lsb_minus4
+    }
+    else if (info.pocType == 1) {
+        reader.SkipBits(1);
+        reader.ReadSE();
+        reader.ReadSE();
+        uint32_t cycle = reader.ReadUE();
+        for (uint32_t i = 0; i < cycle && !reader.HasError(); i++) reader.ReadSE();
+    }
+
+    reader.ReadUE(); // max_num_ref_frames
+    reader.SkipBits(1); // gaps_in_frame_num_value_allowed_flag
+    uint32_t widthInMbs = reader.ReadUE() + 1;
+    uint32_t heightInMapUnits = reader.ReadUE() + 1;
+    uint32_t frameMbsOnly = reader.ReadBits(1);
+    if (!frameMbsOnly) reader.SkipBits(1);
+    reader.SkipBits(1); // direct_8x8_inference_flag
+
+    uint32_t cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+    if (reader.ReadBits(1)) {
+        cropLeft = reader.ReadUE();
+        cropRight = reader.ReadUE();
+        cropTop = reader.ReadUE();
+        cropBottom = reader.ReadUE();
+    }
+    if (reader.HasError()) return false;
+
+    uint32_t cropUnitX = 1, cropUnitY = 2 - frameMbsOnly;
+    if (info.chromaFormatIdc != 0 && !separateColourPlane) {
+        cropUnitX = (info.chromaFormatIdc == 3) ? 1 : 2;
+        cropUnitY *= (info.chromaFormatIdc == 1) ? 2 : 1;
+    }
+
+    info.width = widthInMbs * 16 - cropUnitX * (cropLeft + cropRight);
+    info.height = (2 - frameMbsOnly) * heightInMapUnits * 16 - cropUnitY * (cropTop + cropBottom);
+
+    *pInfo = info;
+    return true;
+}
+
+bool H264ParsePps(const uint8_t* nal, size_t size, uint32_t* pPpsId, uint32_t* pSpsId) {
+    if (size < 2 || H264NalTypeOf(nal[0]) != H264_NAL_PPS) return false;
+    H264BitReader reader(nal + 1, size - 1);
+    uint32_t ppsId = reader.ReadUE();
+    uint32_t spsId = reader.ReadUE();
+    if (reader.HasError()) return false;
+    *pPpsId = ppsId;
+    *pSpsId = spsId;
+    return true;
+}
+
+bool H264ParseSlicePpsId(const uint8_t* nal, size_t size, uint32_t* pPpsId) {
+    if (size < 2 || !H264IsVclNal(H264NalTypeOf(nal[0]))) return false;
+    H264BitReader reader(nal + 1, size - 1);
+    reader.ReadUE(); // first_mb_in_slice
+    reader.ReadUE(); // slice_type
+    uint32_t ppsId = reader.ReadUE();
+    if (reader.HasError()) return false;
+    *pPpsId = ppsId;
+    return true;
+}
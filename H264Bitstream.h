@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// H.264 NAL 单元类型（ITU-T H.264 表 7-1）
+enum H264NalType : uint8_t {
+    H264_NAL_SLICE = 1,
+    H264_NAL_SLICE_IDR = 5,
+    H264_NAL_SEI = 6,
+    H264_NAL_SPS = 7,
+    H264_NAL_PPS = 8,
+    H264_NAL_AUD = 9,
+    H264_NAL_END_OF_SEQUENCE = 10,
+    H264_NAL_END_OF_STREAM = 11,
+    H264_NAL_FILLER = 12,
+};
+
+// 指向原始码流内部的 NAL 单元（data 指向 NAL 头字节，不含起始码）
+struct H264NalUnit {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    uint8_t type = 0;
+};
+
+// 从 SPS 中解析出的关键参数
+struct H264SpsInfo {
+    uint8_t profileIdc = 0;
+    uint8_t constraintFlags = 0;
+    uint8_t levelIdc = 0;
+    uint32_t spsId = 0;
+    uint32_t chromaFormatIdc = 1;
+    uint32_t bitDepthLuma = 8;
+    uint32_t bitDepthChroma = 8;
+    uint32_t log2MaxFrameNum = 4;
+    uint32_t pocType = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+inline uint8_t H264NalTypeOf(uint8_t header) { return header & 0x1F; }
+inline bool H264IsVclNal(uint8_t type) { return type >= H264_NAL_SLICE && type <= H264_NAL_SLICE_IDR; }
+
+// 查找下一个 00 00 01 起始码，返回起始码首字节位置（包含 4 字节形式的前导 0），找不到时返回 end
+const uint8_t* H264FindStartCode(const uint8_t* p, const uint8_t* end, size_t* pStartCodeLength);
+
+// 将 Annex-B 码流拆分为 NAL 单元，返回 NAL 个数
+size_t H264SplitAnnexB(const uint8_t* data, size_t size, std::vector<H264NalUnit>& nals);
+
+// 判断 VCL NAL 是否为一帧的第一个 slice（first_mb_in_slice == 0）
+bool H264IsFirstSliceOfPicture(const H264NalUnit& nal);
+
+// 判断一段 Annex-B 数据中是否包含 IDR slice
+bool H264ContainsIdr(const uint8_t* data, size_t size);
+
+// 解析 SPS（nal 指向 NAL 头）
+bool H264ParseSps(const uint8_t* nal, size_t size, H264SpsInfo* pInfo);
+
+// 解析 PPS 的 pps_id 与其引用的 sps_id
+bool H264ParsePps(const uint8_t* nal, size_t size, uint32_t* pPpsId, uint32_t* pSpsId);
+
+// 解析 slice 头引用的 pps_id
+bool H264ParseSlicePpsId(const uint8_t* nal, size_t size, uint32_t* pPpsId);
+
+// 带防竞争字节（emulation prevention）处理的指数哥伦布位读取器
+class H264BitReader {
+public:
+    H264BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    uint32_t ReadBits(uint32_t count);
+    uint32_t ReadUE();
+    int32_t ReadSE();
+    void SkipBits(uint32_t count) { while (count--) ReadBit(); }
+    bool HasError() const { return m_error; }
+
+private:
+    uint32_t ReadBit();
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_byte = 0;
+    uint32_t m_bit = 0;
+    uint32_t m_zeroRun = 0;
+    bool m_error = false;
+};
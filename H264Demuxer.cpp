@@ -0,0 +1,722 @@
+#include "H264Demuxer.h"
+#include "H264Bitstream.h"
+#include "MFLog.h"
+#include <mferror.h>
+#include <algorithm>
+#include <map>
+
+namespace {
+
+constexpr UINT32 Mp4Type(const char (&name)[5]) {
+    return (UINT32(BYTE(name[0])) << 24) | (UINT32(BYTE(name[1])) << 16) | (UINT32(BYTE(name[2])) << 8) | UINT32(BYTE(name[3]));
+}
+
+inline UINT16 ReadBE16(const BYTE* p) { return UINT16((p[0] << 8) | p[1]); }
+inline UINT32 ReadBE32(const BYTE* p) { return (UINT32(p[0]) << 24) | (UINT32(p[1]) << 16) | (UINT32(p[2]) << 8) | p[3]; }
+inline UINT64 ReadBE64(const BYTE* p) { return (UINT64(ReadBE32(p)) << 32) | ReadBE32(p + 4); }
+
+struct Mp4Box {
+    UINT32 type = 0;
+    const BYTE* data = nullptr; // 盒子负载（不含头）
+    UINT64 size = 0;            // 负载字节数
+    UINT32 headerSize = 0;      // 头字节数：8，largesize（64 位大小）时为 16
+};
+
+// 读取下一个盒子，p 前进到盒子末尾
+bool NextBox(const BYTE*& p, const BYTE* end, Mp4Box* pBox) {
+    if (end - p < 8) return false;
+    UINT64 boxSize = ReadBE32(p);
+    UINT32 type = ReadBE32(p + 4);
+    UINT64 headerSize = 8;
+    if (boxSize == 1) {
+        if (end - p < 16) return false;
+        boxSize = ReadBE64(p + 8);
+        headerSize = 16;
+    }
+    else if (boxSize == 0) {
+        boxSize = static_cast<UINT64>(end - p);
+    }
+    if (boxSize < headerSize || boxSize > static_cast<UINT64>(end - p)) return false;
+
+    pBox->type = type;
+    pBox->data = p + headerSize;
+    pBox->size = boxSize - headerSize;
+    pBox->headerSize = static_cast<UINT32>(headerSize);
+    p += boxSize;
+    return true;
+}
+
+// 在直接子盒子中查找指定类型
+bool FindChildBox(const BYTE* pData, UINT64 size, UINT32 type, Mp4Box* pBox) {
+    const BYTE* p = pData;
+    const BYTE* end = pData + size;
+    Mp4Box box;
+    while (NextBox(p, end, &box)) {
+        if (box.type == type) {
+            *pBox = box;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline LONGLONG TicksToHns(LONGLONG ticks, UINT32 timescale) {
+    return MFllMulDiv(ticks, 10000000, timescale, 0);
+}
+
+const UINT32 kSampleIsNonSync = 0x00010000;
+
+} // namespace
+
+H264Demuxer::H264Demuxer() {}
+
+H264Demuxer::~H264Demuxer() { Close(); }
+
+HRESULT H264Demuxer::Open(const std::wstring& filePath, UINT32 fpsNum, UINT32 fpsDen) {
+    Close();
+
+    // MP4 中的 AVCC 长度前缀需要原地改写为起始码，因此使用写时复制映射
+    auto file = std::make_shared<MappedFile>();
+    HRESULT hr = file->Open(filePath, true);
+    if (FAILED(hr)) return hr;
+    m_file = file;
+
+    const BYTE* pData = m_file->Data();
+    UINT64 size = m_file->Size();
+
+    if (size >= 8 && (ReadBE32(pData + 4) == Mp4Type("ftyp") || ReadBE32(pData + 4) == Mp4Type("moov") ||
+        ReadBE32(pData + 4) == Mp4Type("styp"))) {
+        m_containerType = ContainerType::MP4;
+        hr = ParseMP4();
+    }
+    else {
+        m_containerType = ContainerType::AnnexB;
+        hr = ParseAnnexB(fpsNum, fpsDen);
+    }
+
+    if (SUCCEEDED(hr) && m_accessUnits.empty()) {
+        MFLOG_ERROR("No H264 access units found.");
+        hr = MF_E_INVALID_FILE_FORMAT;
+    }
+    if (FAILED(hr)) {
+        Close();
+        return hr;
+    }
+
+    BuildKeyframeIndex();
+    m_converted.assign(m_accessUnits.size(), m_containerType == ContainerType::AnnexB ? 1 : 0);
+    return hr;
+}
+
+void H264Demuxer::Close() {
+    // 仍被 IMFSample 引用的映射会在最后一个缓冲区释放时解除
+    m_file.reset();
+    m_containerType = ContainerType::Unknown;
+    m_accessUnits.clear();
+    m_keyframes.clear();
+    m_sequenceHeader.clear();
+    m_converted.clear();
+    m_width = m_height = 0;
+    m_trackId = m_timescale = 0;
+    m_nalLengthSize = 4;
+    m_trexDefaultDuration = m_trexDefaultSize = m_trexDefaultFlags = 0;
+    m_nextFragmentDts = 0;
+}
+
+LONGLONG H264Demuxer::GetDuration() const {
+    if (m_accessUnits.empty()) return 0;
+    LONGLONG end = 0;
+    for (size_t i = m_keyframes.empty() ? 0 : m_keyframes.back(); i < m_accessUnits.size(); i++) {
+        end = (std::max)(end, m_accessUnits[i].sampleTime + m_accessUnits[i].duration);
+    }
+    return end;
+}
+
+HRESULT H264Demuxer::ParseAnnexB(UINT32 fpsNum, UINT32 fpsDen) {
+    if (fpsNum == 0 || fpsDen == 0) return E_INVALIDARG;
+
+    const BYTE* pData = m_file->Data();
+    const BYTE* end = pData + m_file->Size();
+    LONGLONG frameDuration = MFllMulDiv(fpsDen, 10000000, fpsNum, 0);
+
+    H264AccessUnit current;
+    bool haveAu = false, haveVcl = false;
+    bool haveSps = false, havePps = false;
+
+    auto finishAu = [&](const BYTE* auEnd) {
+        if (haveAu && haveVcl) {
+            current.size = static_cast<UINT32>(auEnd - (pData + current.offset));
+            current.sampleTime = static_cast<LONGLONG>(m_accessUnits.size()) * frameDuration;
+            current.duration = frameDuration;
+            m_accessUnits.push_back(current);
+        }
+        current = H264AccessUnit();
+        haveAu = haveVcl = false;
+    };
+
+    size_t startCodeLength = 0;
+    const BYTE* p = H264FindStartCode(pData, end, &startCodeLength);
+    while (p < end) {
+        const BYTE* nal = p + startCodeLength;
+        size_t nextLength = 0;
+        const BYTE* next = H264FindStartCode(nal, end, &nextLength);
+        if (nal >= end) break;
+
+        H264NalUnit unit;
+        unit.data = nal;
+        unit.size = static_cast<size_t>(next - nal);
+        unit.type = H264NalTypeOf(nal[0]);
+
+        // 访问单元边界：AUD/SPS/PPS/SEI 或新一帧的第一个 slice 出现在已有 VCL 之后
+        bool startsNewAu = false;
+        if (haveVcl) {
+            if (unit.type == H264_NAL_AUD || unit.type == H264_NAL_SPS || unit.type == H264_NAL_PPS ||
+                unit.type == H264_NAL_SEI || (unit.type >= 14 && unit.type <= 18)) {
+                startsNewAu = true;
+            }
+            else if (H264IsVclNal(unit.type) && H264IsFirstSliceOfPicture(unit)) {
+                startsNewAu = true;
+            }
+        }
+        if (startsNewAu) finishAu(p);
+
+        if (!haveAu) {
+            current.offset = static_cast<UINT64>(p - pData);
+            haveAu = true;
+        }
+
+        if (H264IsVclNal(unit.type)) {
+            haveVcl = true;
+            if (unit.type == H264_NAL_SLICE_IDR) current.keyframe = true;
+        }
+        else if (unit.type == H264_NAL_SPS && !haveSps) {
+            H264SpsInfo info;
+            if (H264ParseSps(unit.data, unit.size, &info)) {
+                m_width = info.width;
+                m_height = info.height;
+            }
+            m_sequenceHeader.insert(m_sequenceHeader.end(), { 0, 0, 0, 1 });
+            m_sequenceHeader.insert(m_sequenceHeader.end(), unit.data, unit.data + unit.size);
+            haveSps = true;
+        }
+        else if (unit.type == H264_NAL_PPS && !havePps) {
+            m_sequenceHeader.insert(m_sequenceHeader.end(), { 0, 0, 0, 1 });
+            m_sequenceHeader.insert(m_sequenceHeader.end(), unit.data, unit.data + unit.size);
+            havePps = true;
+        }
+
+        p = next;
+        startCodeLength = nextLength;
+    }
+    finishAu(end);
+
+    return S_OK;
+}
+
+HRESULT H264Demuxer::ParseMP4() {
+    const BYTE* pData = m_file->Data();
+    const BYTE* end = pData + m_file->Size();
+
+    // 先解析 moov 以确定视频轨道，再按顺序处理所有 moof 分片
+    Mp4Box box;
+    const BYTE* p = pData;
+    bool haveMoov = false;
+    while (NextBox(p, end, &box)) {
+        if (box.type == Mp4Type("moov")) {
+            HRESULT hr = ParseMoov(box.data, box.size);
+            if (FAILED(hr)) return hr;
+            haveMoov = true;
+            break;
+        }
+    }
+    if (!haveMoov || m_trackId == 0) {
+        MFLOG_ERROR("No H264 video track found in MP4 file.");
+        return MF_E_INVALID_FILE_FORMAT;
+    }
+
+    p = pData;
+    while (NextBox(p, end, &box)) {
+        if (box.type == Mp4Type("moof")) {
+            UINT64 moofOffset = static_cast<UINT64>(box.data - pData) - box.headerSize;
+            HRESULT hr = ParseMoof(box.data, box.size, moofOffset);
+            if (FAILED(hr)) return hr;
+        }
+    }
+
+    // 丢弃越界的采样，防止截断文件导致越界访问
+    UINT64 fileSize = m_file->Size();
+    m_accessUnits.erase(std::remove_if(m_accessUnits.begin(), m_accessUnits.end(),
+        [fileSize](const H264AccessUnit& au) { return au.size == 0 || au.offset + au.size > fileSize; }),
+        m_accessUnits.end());
+
+    return S_OK;
+}
+
+HRESULT H264Demuxer::ParseMoov(const BYTE* pData, UINT64 size) {
+    const BYTE* p = pData;
+    const BYTE* end = pData + size;
+    std::map<UINT32, const BYTE*> trexById;
+    Mp4Box box;
+
+    while (NextBox(p, end, &box)) {
+        if (box.type == Mp4Type("trak")) {
+            HRESULT hr = ParseTrak(box.data, box.size);
+            if (FAILED(hr)) return hr;
+        }
+        else if (box.type == Mp4Type("mvex")) {
+            const BYTE* q = box.data;
+            const BYTE* mvexEnd = box.data + box.size;
+            Mp4Box child;
+            while (NextBox(q, mvexEnd, &child)) {
+                if (child.type == Mp4Type("trex") && child.size >= 24) {
+                    trexById[ReadBE32(child.data + 4)] = child.data;
+                }
+            }
+        }
+    }
+
+    auto it = trexById.find(m_trackId);
+    if (it != trexById.end()) {
+        m_trexDefaultDuration = ReadBE32(it->second + 12);
+        m_trexDefaultSize = ReadBE32(it->second + 16);
+        m_trexDefaultFlags = ReadBE32(it->second + 20);
+    }
+    return S_OK;
+}
+
+HRESULT H264Demuxer::ParseTrak(const BYTE* pData, UINT64 size) {
+    if (m_trackId != 0) return S_OK; // 只处理第一条视频轨道
+
+    Mp4Box tkhd, mdia;
+    if (!FindChildBox(pData, size, Mp4Type("tkhd"), &tkhd) || !FindChildBox(pData, size, Mp4Type("mdia"), &mdia)) {
+        return S_OK;
+    }
+    if (tkhd.size < 24) return MF_E_INVALID_FILE_FORMAT;
+    UINT32 trackId = (tkhd.data[0] == 1) ? ReadBE32(tkhd.data + 20) : ReadBE32(tkhd.data + 12);
+
+    Mp4Box mdhd, hdlr, minf, stbl;
+    if (!FindChildBox(mdia.data, mdia.size, Mp4Type("mdhd"), &mdhd) ||
+        !FindChildBox(mdia.data, mdia.size, Mp4Type("hdlr"), &hdlr) ||
+        !FindChildBox(mdia.data, mdia.size, Mp4Type("minf"), &minf) ||
+        !FindChildBox(minf.data, minf.size, Mp4Type("stbl"), &stbl)) {
+        return S_OK;
+    }
+    if (hdlr.size < 12 || ReadBE32(hdlr.data + 8) != Mp4Type("vide")) return S_OK;
+    if (mdhd.size < 24) return MF_E_INVALID_FILE_FORMAT;
+
+    UINT32 timescale = (mdhd.data[0] == 1) ? ReadBE32(mdhd.data + 20) : ReadBE32(mdhd.data + 12);
+    if (timescale == 0) return MF_E_INVALID_FILE_FORMAT;
+
+    m_trackId = trackId;
+    m_timescale = timescale;
+    return ParseStbl(stbl.data, stbl.size);
+}
+
+HRESULT H264Demuxer::ParseAvcC(const BYTE* pData, UINT64 size) {
+    if (size < 7) return MF_E_INVALID_FILE_FORMAT;
+
+    m_nalLengthSize = (pData[4] & 0x03) + 1;
+    m_sequenceHeader.clear();
+
+    const BYTE* p = pData + 5;
+    const BYTE* end = pData + size;
+    for (int pass = 0; pass < 2; pass++) {
+        if (p >= end) break;
+        UINT32 count = (pass == 0) ? (*p & 0x1F) : *p;
+        p++;
+        for (UINT32 i = 0; i < count; i++) {
+            if (end - p < 2) return MF_E_INVALID_FILE_FORMAT;
+            UINT16 length = ReadBE16(p);
+            p += 2;
+            if (end - p < length) return MF_E_INVALID_FILE_FORMAT;
+
+            if (pass == 0 && i == 0) {
+                H264SpsInfo info;
+                if (H264ParseSps(p, length, &info)) {
+                    m_width = info.width;
+                    m_height = info.height;
+                }
+            }
+            m_sequenceHeader.insert(m_sequenceHeader.end(), { 0, 0, 0, 1 });
+            m_sequenceHeader.insert(m_sequenceHeader.end(), p, p + length);
+            p += length;
+        }
+    }
+    return S_OK;
+}
+
+HRESULT H264Demuxer::ParseStbl(const BYTE* pData, UINT64 size) {
+    Mp4Box stsd, stts, ctts, stss, stsz, stsc, stco;
+    bool haveCtts = FindChildBox(pData, size, Mp4Type("ctts"), &ctts);
+    bool haveStss = FindChildBox(pData, size, Mp4Type("stss"), &stss);
+    bool co64 = false;
+    if (!FindChildBox(pData, size, Mp4Type("stco"), &stco)) {
+        if (!FindChildBox(pData, size, Mp4Type("co64"), &stco)) stco.size = 0;
+        co64 = true;
+    }
+    if (!FindChildBox(pData, size, Mp4Type("stsd"), &stsd) || stsd.size < 8) return MF_E_INVALID_FILE_FORMAT;
+
+    // 采样描述：avc1/avc3 + avcC
+    Mp4Box entry;
+    const BYTE* p = stsd.data + 8;
+    if (!NextBox(p, stsd.data + stsd.size, &entry)) return MF_E_INVALID_FILE_FORMAT;
+    if (entry.type != Mp4Type("avc1") && entry.type != Mp4Type("avc3")) {
+        MFLOG_ERROR("MP4 video track is not H264.");
+        return MF_E_UNSUPPORTED_FORMAT;
+    }
+    const UINT64 visualEntryHeader = 78;
+    if (entry.size < visualEntryHeader) return MF_E_INVALID_FILE_FORMAT;
+    m_width = ReadBE16(entry.data + 24);
+    m_height = ReadBE16(entry.data + 26);
+
+    Mp4Box avcC;
+    if (FindChildBox(entry.data + visualEntryHeader, entry.size - visualEntryHeader, Mp4Type("avcC"), &avcC)) {
+        HRESULT hr = ParseAvcC(avcC.data, avcC.size);
+        if (FAILED(hr)) return hr;
+    }
+
+    // 分片 MP4 的 moov 中采样表为空，采样来自 moof
+    if (!FindChildBox(pData, size, Mp4Type("stsz"), &stsz) || stsz.size < 12) return S_OK;
+    UINT32 defaultSize = ReadBE32(stsz.data + 4);
+    UINT32 sampleCount = ReadBE32(stsz.data + 8);
+    if (sampleCount == 0) return S_OK;
+    if (defaultSize == 0 && stsz.size < 12 + UINT64(sampleCount) * 4) return MF_E_INVALID_FILE_FORMAT;
+    if (!FindChildBox(pData, size, Mp4Type("stts"), &stts) || stts.size < 8) return MF_E_INVALID_FILE_FORMAT;
+    if (!FindChildBox(pData, size, Mp4Type("stsc"), &stsc) || stsc.size < 8) return MF_E_INVALID_FILE_FORMAT;
+    if (stco.size < 8) return MF_E_INVALID_FILE_FORMAT;
+
+    m_accessUnits.resize(sampleCount);
+    for (UINT32 i = 0; i < sampleCount; i++) {
+        m_accessUnits[i].size = defaultSize ? defaultSize : ReadBE32(stsz.data + 12 + i * 4);
+        m_accessUnits[i].keyframe = !haveStss;
+    }
+
+    // 块偏移 + 每块采样数 -> 每个采样的文件偏移
+    UINT32 chunkCount = ReadBE32(stco.data + 4);
+    UINT32 entrySize = co64 ? 8 : 4;
+    if (stco.size < 8 + UINT64(chunkCount) * entrySize) return MF_E_INVALID_FILE_FORMAT;
+    UINT32 stscCount = ReadBE32(stsc.data + 4);
+    if (stsc.size < 8 + UINT64(stscCount) * 12) return MF_E_INVALID_FILE_FORMAT;
+
+    UINT32 sample = 0;
+    for (UINT32 i = 0; i < stscCount && sample < sampleCount; i++) {
+        const BYTE* e = stsc.data + 8 + i * 12;
+        UINT32 firstChunk = ReadBE32(e);
+        UINT32 samplesPerChunk = ReadBE32(e + 4);
+        UINT32 lastChunk = (i + 1 < stscCount) ? ReadBE32(e + 12) : chunkCount + 1;
+        for (UINT32 chunk = firstChunk; chunk < lastChunk && chunk <= chunkCount && sample < sampleCount; chunk++) {
+            const BYTE* c = stco.data + 8 + UINT64(chunk - 1) * entrySize;
+            UINT64 offset = co64 ? ReadBE64(c) : ReadBE32(c);
+            for (UINT32 s = 0; s < samplesPerChunk && sample < sampleCount; s++) {
+                m_accessUnits[sample].offset = offset;
+                offset += m_accessUnits[sample].size;
+                sample++;
+            }
+        }
+    }
+
+    // 解码时间 (stts) + 合成偏移 (ctts) -> 显示时间
+    std::vector<LONGLONG> dts(sampleCount, 0);
+    UINT32 sttsCount = ReadBE32(stts.data + 4);
+    if (stts.size < 8 + UINT64(sttsCount) * 8) return MF_E_INVALID_FILE_FORMAT;
+    LONGLONG t = 0;
+    sample = 0;
+    for (UINT32 i = 0; i < sttsCount && sample < sampleCount; i++) {
+        UINT32 count = ReadBE32(stts.data + 8 + i * 8);
+        UINT32 delta = ReadBE32(stts.data + 12 + i * 8);
+        for (UINT32 s = 0; s < count && sample < sampleCount; s++) {
+            dts[sample] = t;
+            m_accessUnits[sample].duration = TicksToHns(delta, m_timescale);
+            t += delta;
+            sample++;
+        }
+    }
+
+    std::vector<LONGLONG> cts(sampleCount, 0);
+    if (haveCtts && ctts.size >= 8) {
+        UINT32 cttsCount = ReadBE32(ctts.data + 4);
+        if (ctts.size < 8 + UINT64(cttsCount) * 8) return MF_E_INVALID_FILE_FORMAT;
+        sample = 0;
+        for (UINT32 i = 0; i < cttsCount && sample < sampleCount; i++) {
+            UINT32 count = ReadBE32(ctts.data + 8 + i * 8);
+            INT32 offset = static_cast<INT32>(ReadBE32(ctts.data + 12 + i * 8));
+            for (UINT32 s = 0; s < count && sample < sampleCount; s++) cts[sample++] = offset;
+        }
+    }
+
+    for (UINT32 i = 0; i < sampleCount; i++) {
+        m_accessUnits[i].sampleTime = TicksToHns(dts[i] + cts[i], m_timescale);
+    }
+    m_nextFragmentDts = t;
+
+    if (haveStss && stss.size >= 8) {
+        UINT32 syncCount = ReadBE32(stss.data + 4);
+        if (stss.size < 8 + UINT64(syncCount) * 4) return MF_E_INVALID_FILE_FORMAT;
+        for (UINT32 i = 0; i < syncCount; i++) {
+            UINT32 number = ReadBE32(stss.data + 8 + i * 4);
+            if (number >= 1 && number <= sampleCount) m_accessUnits[number - 1].keyframe = true;
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT H264Demuxer::ParseMoof(const BYTE* pData, UINT64 size, UINT64 moofOffset) {
+    const BYTE* p = pData;
+    const BYTE* end = pData + size;
+    Mp4Box traf;
+
+    while (NextBox(p, end, &traf)) {
+        if (traf.type != Mp4Type("traf")) continue;
+
+        Mp4Box tfhd;
+        if (!FindChildBox(traf.data, traf.size, Mp4Type("tfhd"), &tfhd) || tfhd.size < 8) continue;
+        UINT32 tfhdFlags = ReadBE32(tfhd.data) & 0xFFFFFF;
+        if (ReadBE32(tfhd.data + 4) != m_trackId) continue;
+
+        // tfhd 可选字段，缺省时回退到 trex
+        const BYTE* f = tfhd.data + 8;
+        const BYTE* tfhdEnd = tfhd.data + tfhd.size;
+        UINT64 baseDataOffset = moofOffset;
+        UINT32 defaultDuration = m_trexDefaultDuration;
+        UINT32 defaultSize = m_trexDefaultSize;
+        UINT32 defaultFlags = m_trexDefaultFlags;
+        if ((tfhdFlags & 0x01) && tfhdEnd - f >= 8) { baseDataOffset = ReadBE64(f); f += 8; }
+        if ((tfhdFlags & 0x02) && tfhdEnd - f >= 4) { f += 4; }
+        if ((tfhdFlags & 0x08) && tfhdEnd - f >= 4) { defaultDuration = ReadBE32(f); f += 4; }
+        if ((tfhdFlags & 0x10) && tfhdEnd - f >= 4) { defaultSize = ReadBE32(f); f += 4; }
+        if ((tfhdFlags & 0x20) && tfhdEnd - f >= 4) { defaultFlags = ReadBE32(f); f += 4; }
+
+        Mp4Box tfdt;
+        LONGLONG dts = m_nextFragmentDts;
+        if (FindChildBox(traf.data, traf.size, Mp4Type("tfdt"), &tfdt) && tfdt.size >= 8) {
+            dts = (tfdt.data[0] == 1 && tfdt.size >= 12) ? static_cast<LONGLONG>(ReadBE64(tfdt.data + 4))
+                                                         : static_cast<LONGLONG>(ReadBE32(tfdt.data + 4));
+        }
+
+        // 同一 traf 中没有 data_offset 的 trun 紧接上一个 trun 的数据
+        UINT64 dataCursor = baseDataOffset;
+        const BYTE* q = traf.data;
+        const BYTE* trafEnd = traf.data + traf.size;
+        Mp4Box trun;
+        while (NextBox(q, trafEnd, &trun)) {
+            if (trun.type != Mp4Type("trun") || trun.size < 8) continue;
+
+            BYTE version = trun.data[0];
+            UINT32 flags = ReadBE32(trun.data) & 0xFFFFFF;
+            UINT32 sampleCount = ReadBE32(trun.data + 4);
+            const BYTE* r = trun.data + 8;
+            const BYTE* trunEnd = trun.data + trun.size;
+
+            if (flags & 0x01) {
+                if (trunEnd - r < 4) return MF_E_INVALID_FILE_FORMAT;
+                dataCursor = baseDataOffset + static_cast<INT32>(ReadBE32(r));
+                r += 4;
+            }
+            UINT32 firstSampleFlags = defaultFlags;
+            bool haveFirstFlags = false;
+            if (flags & 0x04) {
+                if (trunEnd - r < 4) return MF_E_INVALID_FILE_FORMAT;
+                firstSampleFlags = ReadBE32(r);
+                haveFirstFlags = true;
+                r += 4;
+            }
+
+            UINT32 fieldSize = 4 * (((flags & 0x100) ? 1 : 0) + ((flags & 0x200) ? 1 : 0) +
+                                    ((flags & 0x400) ? 1 : 0) + ((flags & 0x800) ? 1 : 0));
+            if (static_cast<UINT64>(trunEnd - r) < UINT64(sampleCount) * fieldSize) return MF_E_INVALID_FILE_FORMAT;
+
+            m_accessUnits.reserve(m_accessUnits.size() + sampleCount);
+            for (UINT32 i = 0; i < sampleCount; i++) {
+                UINT32 duration = defaultDuration, sampleSize = defaultSize;
+                UINT32 sampleFlags = (i == 0 && haveFirstFlags) ? firstSampleFlags : defaultFlags;
+                INT32 ctsOffset = 0;
+                if (flags & 0x100) { duration = ReadBE32(r); r += 4; }
+                if (flags & 0x200) { sampleSize = ReadBE32(r); r += 4; }
+                if (flags & 0x400) {
+                    UINT32 value = ReadBE32(r);
+                    if (!(i == 0 && haveFirstFlags)) sampleFlags = value;
+                    r += 4;
+                }
+                if (flags & 0x800) {
+                    UINT32 value = ReadBE32(r);
+                    ctsOffset = (version == 0) ? static_cast<INT32>(value & 0x7FFFFFFF) : static_cast<INT32>(value);
+                    r += 4;
+                }
+
+                H264AccessUnit au;
+                au.offset = dataCursor;
+                au.size = sampleSize;
+                au.sampleTime = TicksToHns(dts + ctsOffset, m_timescale);
+                au.duration = TicksToHns(duration, m_timescale);
+                au.keyframe = (sampleFlags & kSampleIsNonSync) == 0;
+                m_accessUnits.push_back(au);
+
+                dataCursor += sampleSize;
+                dts += duration;
+            }
+        }
+        m_nextFragmentDts = dts;
+    }
+    return S_OK;
+}
+
+void H264Demuxer::BuildKeyframeIndex() {
+    m_keyframes.clear();
+    for (size_t i = 0; i < m_accessUnits.size(); i++) {
+        if (!m_accessUnits[i].keyframe) continue;
+        // 保证索引按显示时间单调递增，二分查找才成立
+        if (!m_keyframes.empty() && m_accessUnits[m_keyframes.back()].sampleTime > m_accessUnits[i].sampleTime) continue;
+        m_keyframes.push_back(static_cast<UINT32>(i));
+    }
+}
+
+HRESULT H264Demuxer::FindKeyframe(LONGLONG hnsTime, size_t* pIndex) const {
+    if (pIndex == nullptr) return E_POINTER;
+    if (m_keyframes.empty()) return MF_E_NOT_FOUND;
+
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), hnsTime,
+        [this](LONGLONG time, UINT32 index) { return time < m_accessUnits[index].sampleTime; });
+    if (it != m_keyframes.begin()) --it;
+
+    *pIndex = *it;
+    return S_OK;
+}
+
+HRESULT H264Demuxer::ConvertToAnnexB(size_t index) {
+    std::lock_guard<std::mutex> lock(m_convertMutex);
+    if (m_converted[index]) return S_OK;
+
+    // 4 字节长度前缀与 00 00 00 01 等长，可在写时复制页上原地替换
+    // 先校验全部长度前缀，确认不越界后再改写，避免出错时留下一半已转换、无法再解析的访问单元
+    BYTE* begin = m_file->Data() + m_accessUnits[index].offset;
+    BYTE* end = begin + m_accessUnits[index].size;
+    for (const BYTE* p = begin; p < end;) {
+        if (end - p < 4) return MF_E_INVALID_FILE_FORMAT;
+        UINT32 length = ReadBE32(p);
+        if (length > static_cast<UINT64>(end - p - 4)) return MF_E_INVALID_FILE_FORMAT;
+        p += 4 + length;
+    }
+    for (BYTE* p = begin; p < end;) {
+        UINT32 length = ReadBE32(p);
+        p[0] = 0; p[1] = 0; p[2] = 0; p[3] = 1;
+        p += 4 + length;
+    }
+
+    m_converted[index] = 1;
+    return S_OK;
+}
+
+HRESULT H264Demuxer::GetAccessUnitData(size_t index, const BYTE** ppData, DWORD* pcbData) {
+    if (ppData == nullptr || pcbData == nullptr) return E_POINTER;
+    if (!m_file || index >= m_accessUnits.size()) return E_INVALIDARG;
+
+    if (m_containerType == ContainerType::MP4) {
+        if (m_nalLengthSize != 4) return MF_E_UNSUPPORTED_FORMAT;
+        HRESULT hr = ConvertToAnnexB(index);
+        if (FAILED(hr)) return hr;
+    }
+
+    *ppData = m_file->Data() + m_accessUnits[index].offset;
+    *pcbData = m_accessUnits[index].size;
+    return S_OK;
+}
+
+HRESULT H264Demuxer::CreateSample(size_t index, IMFSample** ppSample) {
+    if (ppSample == nullptr) return E_POINTER;
+    if (!m_file || index >= m_accessUnits.size()) return E_INVALIDARG;
+
+    const H264AccessUnit& au = m_accessUnits[index];
+    ComPtr<IMFSample> pSample;
+    ComPtr<IMFMediaBuffer> pBuffer;
+
+    HRESULT hr = MFCreateSample(&pSample);
+    if (FAILED(hr)) return hr;
+
+    const BYTE* pData = nullptr;
+    DWORD cbData = 0;
+    hr = GetAccessUnitData(index, &pData, &cbData);
+    if (SUCCEEDED(hr)) {
+        hr = CreateMappedMediaBuffer(m_file, const_cast<BYTE*>(pData), cbData, &pBuffer);
+        if (FAILED(hr)) return hr;
+    }
+    else if (hr == MF_E_UNSUPPORTED_FORMAT) {
+        // 1/2 字节长度前缀无法原地改写，退回到复制转换
+        std::vector<BYTE> annexB;
+        const BYTE* p = m_file->Data() + au.offset;
+        const BYTE* end = p + au.size;
+        while (p < end) {
+            if (static_cast<UINT32>(end - p) < m_nalLengthSize) return MF_E_INVALID_FILE_FORMAT;
+            UINT32 length = 0;
+            for (UINT32 i = 0; i < m_nalLengthSize; i++) length = (length << 8) | p[i];
+            p += m_nalLengthSize;
+            if (length > static_cast<UINT64>(end - p)) return MF_E_INVALID_FILE_FORMAT;
+            annexB.insert(annexB.end(), { 0, 0, 0, 1 });
+            annexB.insert(annexB.end(), p, p + length);
+            p += length;
+        }
+
+        hr = MFCreateMemoryBuffer(static_cast<DWORD>(annexB.size()), &pBuffer);
+        if (FAILED(hr)) return hr;
+        BYTE* pDst = nullptr;
+        hr = pBuffer->Lock(&pDst, nullptr, nullptr);
+        if (FAILED(hr)) return hr;
+        memcpy(pDst, annexB.data(), annexB.size());
+        pBuffer->Unlock();
+        hr = pBuffer->SetCurrentLength(static_cast<DWORD>(annexB.size()));
+        if (FAILED(hr)) return hr;
+    }
+    else {
+        return hr;
+    }
+
+    hr = pSample->AddBuffer(pBuffer.Get());
+    if (FAILED(hr)) return hr;
+    hr = pSample->SetSampleTime(au.sampleTime);
+    if (FAILED(hr)) return hr;
+    hr = pSample->SetSampleDuration(au.duration);
+    if (FAILED(hr)) return hr;
+    hr = pSample->SetUINT32(MFSampleExtension_CleanPoint, au.keyframe ? TRUE : FALSE);
+    if (FAILED(hr)) return hr;
+
+    *ppSample = pSample.Detach();
+    return S_OK;
+}
+
+HRESULT H264Demuxer::CreateMediaType(IMFMediaType** ppType) const {
+    if (ppType == nullptr) return E_POINTER;
+
+    ComPtr<IMFMediaType> pType;
+    HRESULT hr = MFCreateMediaType(&pType);
+    if (FAILED(hr)) return hr;
+
+    hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (FAILED(hr)) return hr;
+    hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
+    if (FAILED(hr)) return hr;
+    hr = pType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    if (FAILED(hr)) return hr;
+
+    if (m_width && m_height) {
+        hr = MFSetAttributeSize(pType.Get(), MF_MT_FRAME_SIZE, m_width, m_height);
+        if (FAILED(hr)) return hr;
+    }
+
+    // 以首个采样的持续时间推导帧率
+    if (!m_accessUnits.empty() && m_accessUnits[0].duration > 0) {
+        UINT32 fpsNum = 0, fpsDen = 0;
+        hr = MFAverageTimePerFrameToFrameRate(static_cast<UINT64>(m_accessUnits[0].duration), &fpsNum, &fpsDen);
+        if (SUCCEEDED(hr)) {
+            hr = MFSetAttributeRatio(pType.Get(), MF_MT_FRAME_RATE, fpsNum, fpsDen);
+            if (FAILED(hr)) return hr;
+        }
+    }
+
+    if (!m_sequenceHeader.empty()) {
+        hr = pType->SetBlob(MF_MT_MPEG_SEQUENCE_HEADER, m_sequenceHeader.data(), static_cast<UINT32>(m_sequenceHeader.size()));
+        if (FAILED(hr)) return hr;
+    }
+
+    *ppType = pType.Detach();
+    return S_OK;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+using namespace Microsoft::WRL;
+
+// 一个压缩访问单元（一帧）在文件中的位置与时间戳
+struct H264AccessUnit {
+    UINT64 offset = 0;          // 在映射文件中的字节偏移
+    UINT32 size = 0;            // 字节数
+    LONGLONG sampleTime = 0;    // 显示时间戳，单位 100ns
+    LONGLONG duration = 0;      // 持续时间，单位 100ns
+    bool keyframe = false;      // 是否为 IDR/同步帧
+};
+
+// 内存映射的 MP4（含分片 MP4）/ Annex-B 裸 H.264 解复用器
+// 打开时一次性建立采样表，之后按索引零拷贝地输出 IMFSample，由 MFTCodecHelper::DecodeAccessUnitToTexture 送入解码器
+class H264Demuxer {
+public:
+    enum class ContainerType { Unknown, AnnexB, MP4 };
+
+    H264Demuxer();
+    ~H264Demuxer();
+
+    // 打开文件并建立采样表。裸 .h264 没有时间戳，按 fpsNum/fpsDen 生成
+    HRESULT Open(const std::wstring& filePath, UINT32 fpsNum = 25, UINT32 fpsDen = 1);
+
+    // 关闭文件，已输出的采样仍持有映射直到被释放
+    void Close();
+
+    ContainerType GetContainerType() const { return m_containerType; }
+    size_t GetAccessUnitCount() const { return m_accessUnits.size(); }
+    const H264AccessUnit& GetAccessUnit(size_t index) const { return m_accessUnits[index]; }
+    const std::vector<UINT32>& GetKeyframeIndices() const { return m_keyframes; }
+    UINT32 GetWidth() const { return m_width; }
+    UINT32 GetHeight() const { return m_height; }
+    LONGLONG GetDuration() const;
+
+    // Annex-B 格式的 SPS/PPS（带起始码）
+    const std::vector<BYTE>& GetSequenceHeader() const { return m_sequenceHeader; }
+
+    // 查找显示时间不晚于 hnsTime 的最近关键帧，O(log n)
+    HRESULT FindKeyframe(LONGLONG hnsTime, size_t* pIndex) const;
+
+    // 返回访问单元的 Annex-B 数据指针（必要时原地把 AVCC 长度前缀改写为起始码）
+    HRESULT GetAccessUnitData(size_t index, const BYTE** ppData, DWORD* pcbData);
+
+    // 创建引用映射内存的 IMFSample，不复制压缩数据
+    HRESULT CreateSample(size_t index, IMFSample** ppSample);
+
+    // 创建解码器输入类型（H264 + 分辨率 + 帧率 + MF_MT_MPEG_SEQUENCE_HEADER）
+    HRESULT CreateMediaType(IMFMediaType** ppType) const;
+
+private:
+    HRESULT ParseAnnexB(UINT32 fpsNum, UINT32 fpsDen);
+    HRESULT ParseMP4();
+    HRESULT ParseMoov(const BYTE* pData, UINT64 size);
+    HRESULT ParseTrak(const BYTE* pData, UINT64 size);
+    HRESULT ParseStbl(const BYTE* pData, UINT64 size);
+    HRESULT ParseAvcC(const BYTE* pData, UINT64 size);
+    HRESULT ParseMoof(const BYTE* pData, UINT64 size, UINT64 moofOffset);
+    HRESULT ConvertToAnnexB(size_t index);
+    void BuildKeyframeIndex();
+
+    std::shared_ptr<MappedFile> m_file;
+    ContainerType m_containerType = ContainerType::Unknown;
+    std::vector<H264AccessUnit> m_accessUnits;
+    std::vector<UINT32> m_keyframes;
+    std::vector<BYTE> m_sequenceHeader;
+    UINT32 m_width = 0;
+    UINT32 m_height = 0;
+
+    // MP4 视频轨道信息
+    UINT32 m_trackId = 0;
+    UINT32 m_timescale = 0;
+    UINT32 m_nalLengthSize = 4;
+    UINT32 m_trexDefaultDuration = 0;
+    UINT32 m_trexDefaultSize = 0;
+    UINT32 m_trexDefaultFlags = 0;
+    LONGLONG m_nextFragmentDts = 0;
+
+    // AVCC -> Annex-B 原地转换状态
+    std::vector<BYTE> m_converted;
+    std::mutex m_convertMutex;
+};
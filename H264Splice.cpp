@@ -0,0 +1,346 @@
+#include "H264Splice.h"
+#include "H264Bitstream.h"
+#include "H264Demuxer.h"
+#include "KeyframeIndex.h"
+#include "MappedFile.h"
+#include "MFLog.h"
+#include "PreRollBuffer.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <mfreadwrite.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <cwctype>
+#include <fstream>
+#include <memory>
+
+using namespace Microsoft::WRL;
+
+static bool IsMP4Path(const std::wstring& path) {
+    size_t dot = path.find_last_of(L'.');
+    if (dot == std::wstring::npos) return false;
+    std::wstring ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+    return ext == L".mp4" || ext == L".m4v";
+}
+
+static bool FindSpsInfo(const BYTE* pData, size_t cbData, H264SpsInfo* pInfo) {
+    std::vector<H264NalUnit> nals;
+    H264SplitAnnexB(pData, cbData, nals);
+    for (const auto& nal : nals) {
+        if (nal.type == H264_NAL_SPS) return H264ParseSps(nal.data, nal.size, pInfo);
+    }
+    return false;
+}
+
+HRESULT H264CheckSpliceCompatibility(const std::vector<BYTE>& sequenceHeaderA, const std::vector<BYTE>& sequenceHeaderB) {
+    if (sequenceHeaderA == sequenceHeaderB) return S_OK;
+
+    H264SpsInfo a, b;
+    if (!FindSpsInfo(sequenceHeaderA.data(), sequenceHeaderA.size(), &a) ||
+        !FindSpsInfo(sequenceHeaderB.data(), sequenceHeaderB.size(), &b)) {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+
+    // 级别、帧号位宽等差异由解码器在收到新 SPS 后处理；分辨率、档次、色度和位深变化则需要重建解码器
+    if (a.width != b.width || a.height != b.height || a.profileIdc != b.profileIdc ||
+        a.chromaFormatIdc != b.chromaFormatIdc || a.bitDepthLuma != b.bitDepthLuma ||
+        a.bitDepthChroma != b.bitDepthChroma) {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+    return S_FALSE;
+}
+
+// 剪辑/拼接的输出端：.mp4 走直通复用器，其它扩展名写 Annex-B 裸流并同时生成关键帧索引
+class SpliceOutput {
+public:
+    ~SpliceOutput() { Close(); }
+
+    HRESULT Open(const std::wstring& path, H264Demuxer& firstInput) {
+        m_mp4 = IsMP4Path(path);
+        if (m_mp4) {
+            ComPtr<IMFMediaType> pType;
+            HRESULT hr = firstInput.CreateMediaType(&pType);
+            if (FAILED(hr)) return hr;
+            return CreateH264PassthroughWriter(path, pType.Get(), &m_pWriter, &m_streamIndex);
+        }
+
+        m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open()) {
+            MFLOG_ERROR("Failed to create %ls", path.c_str());
+            return E_FAIL;
+        }
+        return m_index.Open(path + L".idx");
+    }
+
+    bool IsMP4() const { return m_mp4; }
+
+    // 写出 demuxer 的第 index 个访问单元，时间戳改写为 sampleTime。
+    // sequenceHeader 非空且该访问单元没有自带 SPS 时，在其前面补发参数集（仅裸流输出需要）
+    HRESULT Write(H264Demuxer& demuxer, size_t index, LONGLONG sampleTime,
+        const std::vector<BYTE>* sequenceHeader, H264SpliceStats& stats) {
+        const H264AccessUnit& au = demuxer.GetAccessUnit(index);
+
+        // 采样直接引用映射内存，压缩数据只在写出时读取一次
+        ComPtr<IMFSample> pSample;
+        HRESULT hr = demuxer.CreateSample(index, &pSample);
+        if (FAILED(hr)) return hr;
+        stats.bytesRead += au.size;
+
+        if (m_mp4) {
+            hr = pSample->SetSampleTime(sampleTime);
+            if (FAILED(hr)) return hr;
+            hr = m_pWriter->WriteSample(m_streamIndex, pSample.Get());
+            if (FAILED(hr)) {
+                MFLOG_ERROR("Failed to write spliced sample: 0x%08lx", hr);
+                return hr;
+            }
+            stats.bytesWritten += au.size;
+        }
+        else {
+            ComPtr<IMFMediaBuffer> pBuffer;
+            hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+            if (FAILED(hr)) return hr;
+
+            BYTE* pData = nullptr;
+            DWORD cbData = 0;
+            hr = pBuffer->Lock(&pData, nullptr, &cbData);
+            if (FAILED(hr)) return hr;
+
+            H264SpsInfo info;
+            if (sequenceHeader && !sequenceHeader->empty() && !FindSpsInfo(pData, cbData, &info)) {
+                // 参数集与 IDR 作为同一个访问单元交给索引，索引记录的 SPS/PPS 偏移才正确
+                m_scratch.assign(sequenceHeader->begin(), sequenceHeader->end());
+                m_scratch.insert(m_scratch.end(), pData, pData + cbData);
+                hr = WriteAnnexB(m_scratch.data(), static_cast<DWORD>(m_scratch.size()), sampleTime, au.duration, stats);
+            }
+            else {
+                hr = WriteAnnexB(pData, cbData, sampleTime, au.duration, stats);
+            }
+            pBuffer->Unlock();
+            if (FAILED(hr)) return hr;
+        }
+
+        stats.accessUnits++;
+        stats.duration = (std::max)(stats.duration, sampleTime + au.duration);
+        return S_OK;
+    }
+
+    HRESULT Close() {
+        HRESULT hr = S_OK;
+        if (m_pWriter) {
+            hr = m_pWriter->Finalize();
+            m_pWriter.Reset();
+        }
+        if (m_file.is_open()) {
+            bool good = m_file.good();
+            m_file.close();
+            HRESULT hrIndex = m_index.Close();
+            if (SUCCEEDED(hr)) hr = good ? hrIndex : E_FAIL;
+        }
+        return hr;
+    }
+
+private:
+    HRESULT WriteAnnexB(const BYTE* pData, DWORD cbData, LONGLONG sampleTime, LONGLONG duration, H264SpliceStats& stats) {
+        m_file.write(reinterpret_cast<const char*>(pData), cbData);
+        if (!m_file.good()) return E_FAIL;
+        stats.bytesWritten += cbData;
+        return m_index.OnAccessUnit(pData, cbData, sampleTime, duration);
+    }
+
+    bool m_mp4 = false;
+    ComPtr<IMFSinkWriter> m_pWriter;
+    DWORD m_streamIndex = 0;
+    std::ofstream m_file;
+    KeyframeIndexWriter m_index;
+    std::vector<BYTE> m_scratch;
+};
+
+// 带索引的 Annex-B 输入剪成 Annex-B 输出：按索引定位字节范围，只读写剪辑内的数据
+static HRESULT TrimWithIndex(const std::wstring& inputPath, const std::wstring& outputPath,
+    LONGLONG startTime, LONGLONG endTime, H264SpliceStats& stats) {
+    KeyframeIndexReader reader;
+    HRESULT hr = reader.Open(inputPath + L".idx");
+    if (FAILED(hr)) return hr;
+
+    size_t first = 0;
+    hr = reader.FindByTime(startTime, &first);
+    if (FAILED(hr)) return hr;
+
+    // 终点向后对齐到第一个不早于 endTime 的关键帧（不含该关键帧）
+    size_t last = first + 1;
+    while (last < reader.GetEntryCount() && reader.GetEntry(last).sampleTime < endTime) last++;
+
+    MappedFile input;
+    hr = input.Open(inputPath);
+    if (FAILED(hr)) return hr;
+
+    const KeyframeIndexEntry& start = reader.GetEntry(first);
+    UINT64 rangeBegin = start.byteOffset;
+    UINT64 rangeEnd = (last < reader.GetEntryCount()) ? reader.GetEntry(last).byteOffset : input.Size();
+    if (rangeBegin >= rangeEnd || rangeEnd > input.Size()) return MF_E_INVALID_FILE_FORMAT;
+
+    // 未正常结束的录像没有总帧数/时长，此时最后一个 GOP 的长度未知
+    const KeyframeIndexHeader& header = reader.GetHeader();
+    UINT64 endFrame = (last < reader.GetEntryCount()) ? reader.GetEntry(last).frameNumber : header.totalFrames;
+    LONGLONG endSampleTime = (last < reader.GetEntryCount()) ? reader.GetEntry(last).sampleTime : header.duration;
+
+    std::ofstream output(outputPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        MFLOG_ERROR("Failed to create %ls", outputPath.c_str());
+        return E_FAIL;
+    }
+
+    KeyframeIndexWriter index;
+    hr = index.Open(outputPath + L".idx");
+    if (FAILED(hr)) return hr;
+
+    // 编码器只在码流开头发送参数集时，起始 GOP 引用的 SPS/PPS 位于剪辑范围之前，需要补写到输出开头
+    bool spsBefore = start.spsSize && start.spsOffset < rangeBegin;
+    bool ppsBefore = start.ppsSize && start.ppsOffset < rangeBegin;
+    if (spsBefore) output.write(reinterpret_cast<const char*>(input.Data() + start.spsOffset), start.spsSize);
+    if (ppsBefore) output.write(reinterpret_cast<const char*>(input.Data() + start.ppsOffset), start.ppsSize);
+    UINT64 prefix = (spsBefore ? start.spsSize : 0) + (ppsBefore ? start.ppsSize : 0);
+    UINT64 prefixPpsOffset = spsBefore ? start.spsSize : 0;
+
+    output.write(reinterpret_cast<const char*>(input.Data() + rangeBegin), static_cast<std::streamsize>(rangeEnd - rangeBegin));
+    if (!output.good()) return E_FAIL;
+
+    stats.bytesRead += rangeEnd - rangeBegin + prefix;
+    stats.bytesWritten += rangeEnd - rangeBegin + prefix;
+    stats.startTime = start.sampleTime;
+    stats.accessUnits = (endFrame > start.frameNumber) ? endFrame - start.frameNumber : 0;
+    stats.duration = (endSampleTime > start.sampleTime) ? endSampleTime - start.sampleTime : 0;
+
+    // 平移原索引：偏移减去范围起点再加上补写的参数集，时间与帧号以剪辑起点为 0
+    for (size_t i = first; i < last; i++) {
+        KeyframeIndexEntry entry = reader.GetEntry(i);
+        entry.byteOffset = entry.byteOffset - rangeBegin + prefix;
+        entry.sampleTime -= start.sampleTime;
+        entry.frameNumber -= start.frameNumber;
+
+        if (entry.spsOffset >= rangeBegin) entry.spsOffset = entry.spsOffset - rangeBegin + prefix;
+        else if (spsBefore && entry.spsOffset == start.spsOffset) entry.spsOffset = 0;
+        else entry.spsSize = 0;
+
+        if (entry.ppsOffset >= rangeBegin) entry.ppsOffset = entry.ppsOffset - rangeBegin + prefix;
+        else if (ppsBefore && entry.ppsOffset == start.ppsOffset) entry.ppsOffset = prefixPpsOffset;
+        else entry.ppsSize = 0;
+
+        hr = index.AppendEntry(entry, stats.accessUnits, stats.duration);
+        if (FAILED(hr)) return hr;
+    }
+
+    output.close();
+    return index.Close();
+}
+
+HRESULT H264TrimRecording(const std::wstring& inputPath, const std::wstring& outputPath,
+    LONGLONG startTime, LONGLONG endTime, H264SpliceStats* pStats) {
+    if (endTime <= startTime) return E_INVALIDARG;
+
+    H264SpliceStats stats;
+    HRESULT hr = E_FAIL;
+
+    if (!IsMP4Path(inputPath) && !IsMP4Path(outputPath) &&
+        GetFileAttributesW((inputPath + L".idx").c_str()) != INVALID_FILE_ATTRIBUTES) {
+        hr = TrimWithIndex(inputPath, outputPath, startTime, endTime, stats);
+        if (SUCCEEDED(hr)) {
+            if (pStats) *pStats = stats;
+            return hr;
+        }
+        MFLOG_WARN("Keyframe index unusable, falling back to full scan: 0x%08lx", hr);
+        stats = H264SpliceStats();
+    }
+
+    H264Demuxer demuxer;
+    hr = demuxer.Open(inputPath);
+    if (FAILED(hr)) return hr;
+
+    size_t first = 0;
+    hr = demuxer.FindKeyframe(startTime, &first);
+    if (FAILED(hr)) return hr;
+
+    const std::vector<UINT32>& keyframes = demuxer.GetKeyframeIndices();
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), static_cast<UINT32>(first));
+    while (next != keyframes.end() && demuxer.GetAccessUnit(*next).sampleTime < endTime) ++next;
+    size_t last = (next != keyframes.end()) ? *next : demuxer.GetAccessUnitCount();
+
+    SpliceOutput output;
+    hr = output.Open(outputPath, demuxer);
+    if (FAILED(hr)) return hr;
+
+    LONGLONG base = demuxer.GetAccessUnit(first).sampleTime;
+    stats.startTime = base;
+    const std::vector<BYTE>& sequenceHeader = demuxer.GetSequenceHeader();
+    for (size_t i = first; i < last; i++) {
+        hr = output.Write(demuxer, i, demuxer.GetAccessUnit(i).sampleTime - base,
+            (i == first) ? &sequenceHeader : nullptr, stats);
+        if (FAILED(hr)) return hr;
+    }
+
+    hr = output.Close();
+    if (SUCCEEDED(hr) && pStats) *pStats = stats;
+    return hr;
+}
+
+HRESULT H264ConcatenateRecordings(const std::vector<std::wstring>& inputPaths, const std::wstring& outputPath,
+    H264SpliceStats* pStats) {
+    if (inputPaths.empty()) return E_INVALIDARG;
+
+    // 先打开所有输入并校验参数集，避免写出一半才发现无法拼接
+    std::vector<std::unique_ptr<H264Demuxer>> demuxers;
+    bool identical = true;
+    for (const auto& path : inputPaths) {
+        auto demuxer = std::make_unique<H264Demuxer>();
+        HRESULT hr = demuxer->Open(path);
+        if (FAILED(hr)) {
+            MFLOG_ERROR("Failed to open %ls", path.c_str());
+            return hr;
+        }
+        if (demuxer->GetKeyframeIndices().empty()) {
+            MFLOG_ERROR("%ls contains no keyframe.", path.c_str());
+            return MF_E_INVALID_FILE_FORMAT;
+        }
+        if (!demuxers.empty()) {
+            hr = H264CheckSpliceCompatibility(demuxers.front()->GetSequenceHeader(), demuxer->GetSequenceHeader());
+            if (FAILED(hr)) {
+                MFLOG_ERROR("%ls has incompatible SPS/PPS and cannot be joined without re-encoding.", path.c_str());
+                return hr;
+            }
+            if (hr == S_FALSE) identical = false;
+        }
+        demuxers.push_back(std::move(demuxer));
+    }
+
+    // MP4 只有一个 avcC，参数集不同的片段只能拼成裸流，由带内 SPS/PPS 切换；在创建输出文件之前拒绝
+    if (IsMP4Path(outputPath) && !identical) {
+        MFLOG_ERROR("Segments use different SPS/PPS; concatenate to an .h264 output instead.");
+        return MF_E_INVALIDMEDIATYPE;
+    }
+
+    SpliceOutput output;
+    HRESULT hr = output.Open(outputPath, *demuxers.front());
+    if (FAILED(hr)) return hr;
+
+    H264SpliceStats stats;
+    LONGLONG timeOffset = 0;
+    for (auto& demuxer : demuxers) {
+        // 每个片段从第一个关键帧开始，时间戳接在上一个片段之后
+        size_t first = demuxer->GetKeyframeIndices().front();
+        LONGLONG base = demuxer->GetAccessUnit(first).sampleTime;
+        const std::vector<BYTE>& sequenceHeader = demuxer->GetSequenceHeader();
+
+        for (size_t i = first; i < demuxer->GetAccessUnitCount(); i++) {
+            hr = output.Write(*demuxer, i, demuxer->GetAccessUnit(i).sampleTime - base + timeOffset,
+                (i == first) ? &sequenceHeader : nullptr, stats);
+            if (FAILED(hr)) return hr;
+        }
+        timeOffset = stats.duration;
+    }
+
+    hr = output.Close();
+    if (SUCCEEDED(hr) && pStats) *pStats = stats;
+    return hr;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+
+// 剪辑/拼接统计
+struct H264SpliceStats {
+    UINT64 bytesRead = 0;       // 从输入读取的压缩数据字节数
+    UINT64 bytesWritten = 0;    // 写入输出的压缩数据字节数
+    UINT64 accessUnits = 0;     // 输出的访问单元数
+    LONGLONG startTime = 0;     // 剪辑实际起点（对齐到 IDR 后），单位 100ns
+    LONGLONG duration = 0;      // 输出总时长，单位 100ns
+};
+
+// 比较两段 Annex-B 序列头（SPS+PPS）能否拼接：
+// S_OK 参数集完全相同；S_FALSE 参数集不同但分辨率/档次/色度/位深一致，需在拼接处重新发送参数集；
+// MF_E_INVALIDMEDIATYPE 不兼容
+HRESULT H264CheckSpliceCompatibility(const std::vector<BYTE>& sequenceHeaderA, const std::vector<BYTE>& sequenceHeaderB);
+
+// 在 IDR 边界上剪出 [startTime, endTime) 区间：起点向前对齐到关键帧，终点向后对齐到下一个关键帧。
+// 只复制压缩数据并改写时间戳，不经过编码器。输出格式由扩展名决定（.mp4 或 .h264）。
+// 输入为带 .idx 边车的裸 .h264 时只读取剪辑范围内的字节
+HRESULT H264TrimRecording(const std::wstring& inputPath, const std::wstring& outputPath,
+    LONGLONG startTime, LONGLONG endTime, H264SpliceStats* pStats = nullptr);
+
+// 按顺序拼接多个录像，拼接前校验参数集兼容性
+HRESULT H264ConcatenateRecordings(const std::vector<std::wstring>& inputPaths, const std::wstring& outputPath,
+    H264SpliceStats* pStats = nullptr);
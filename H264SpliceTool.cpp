@@ -0,0 +1,67 @@
+#include <windows.h>
+#include <mfapi.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "H264Splice.h"
+
+// 命令行：
+//   H264Splice trim <输入> <输出> <起始秒> <结束秒>
+//   H264Splice concat <输出> <输入1> <输入2> ...
+// 输出扩展名为 .mp4 时封装为 MP4，否则写 Annex-B 裸流和 .idx 索引
+
+static void PrintUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  H264Splice trim <input> <output> <startSeconds> <endSeconds>" << std::endl;
+    std::cout << "  H264Splice concat <output> <input1> <input2> [...]" << std::endl;
+}
+
+static void PrintStats(const H264SpliceStats& stats) {
+    std::cout << "Access units: " << stats.accessUnits
+        << ", read " << stats.bytesRead << " bytes, wrote " << stats.bytesWritten << " bytes"
+        << ", start " << stats.startTime / 10000000.0 << "s"
+        << ", duration " << stats.duration / 10000000.0 << "s" << std::endl;
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::wstring command = argv[1];
+    if (!((command == L"trim" && argc == 6) || (command == L"concat" && argc >= 5))) {
+        PrintUsage();
+        return 1;
+    }
+
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hr)) return hr;
+    hr = MFStartup(MF_VERSION);
+    if (FAILED(hr)) {
+        CoUninitialize();
+        return hr;
+    }
+
+    H264SpliceStats stats;
+    if (command == L"trim") {
+        LONGLONG startTime = static_cast<LONGLONG>(_wtof(argv[4]) * 10000000.0);
+        LONGLONG endTime = static_cast<LONGLONG>(_wtof(argv[5]) * 10000000.0);
+        hr = H264TrimRecording(argv[2], argv[3], startTime, endTime, &stats);
+    }
+    else {
+        std::vector<std::wstring> inputs(argv + 3, argv + argc);
+        hr = H264ConcatenateRecordings(inputs, argv[2], &stats);
+    }
+
+    if (SUCCEEDED(hr)) {
+        PrintStats(stats);
+    }
+    else {
+        std::cerr << "H264Splice failed: " << std::hex << hr << std::endl;
+    }
+
+    MFShutdown();
+    CoUninitialize();
+    return SUCCEEDED(hr) ? 0 : 1;
+}
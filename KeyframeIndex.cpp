@@ -0,0 +1,214 @@
+#include "KeyframeIndex.h"
+#include "H264Bitstream.h"
+#include "MFLog.h"
+#include <mferror.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+static const char kIndexMagic[8] = { 'H', '2', '6', '4', 'I', 'D', 'X', '1' };
+
+KeyframeIndexWriter::KeyframeIndexWriter() {}
+
+KeyframeIndexWriter::~KeyframeIndexWriter() { Close(); }
+
+HRESULT KeyframeIndexWriter::Open(const std::wstring& indexFilePath, UINT64 streamOffset) {
+    Close();
+
+    m_file.open(indexFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        MFLOG_ERROR("Failed to create keyframe index %ls", indexFilePath.c_str());
+        return E_FAIL;
+    }
+
+    KeyframeIndexHeader header = {};
+    memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+    header.version = KEYFRAME_INDEX_VERSION;
+    header.entrySize = sizeof(KeyframeIndexEntry);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_streamOffset = streamOffset;
+    m_frameCount = 0;
+    m_entryCount = 0;
+    m_endTime = 0;
+    for (auto& sps : m_sps) sps = ParameterSetRef();
+    for (auto& pps : m_pps) pps = ParameterSetRef();
+    memset(m_ppsToSps, 0, sizeof(m_ppsToSps));
+
+    return m_file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT KeyframeIndexWriter::OnAccessUnit(const BYTE* pData, DWORD cbData, LONGLONG sampleTime, LONGLONG duration) {
+    if (!m_file.is_open()) return MF_E_NOT_INITIALIZED;
+
+    const BYTE* end = pData + cbData;
+    bool idr = false;
+    UINT32 idrPpsId = 0;
+
+    size_t startCodeLength = 0;
+    const BYTE* p = H264FindStartCode(pData, end, &startCodeLength);
+    while (p < end) {
+        const BYTE* nal = p + startCodeLength;
+        size_t nextLength = 0;
+        const BYTE* next = H264FindStartCode(nal, end, &nextLength);
+        if (nal >= end) break;
+
+        size_t nalSize = static_cast<size_t>(next - nal);
+        UINT64 nalOffset = m_streamOffset + static_cast<UINT64>(p - pData);
+        UINT32 nalSizeWithStartCode = static_cast<UINT32>(next - p);
+
+        switch (H264NalTypeOf(nal[0])) {
+        case H264_NAL_SPS: {
+            H264SpsInfo info;
+            if (H264ParseSps(nal, nalSize, &info) && info.spsId < 32) {
+                m_sps[info.spsId].offset = nalOffset;
+                m_sps[info.spsId].size = nalSizeWithStartCode;
+                m_sps[info.spsId].valid = true;
+            }
+            break;
+        }
+        case H264_NAL_PPS: {
+            UINT32 ppsId = 0, spsId = 0;
+            if (H264ParsePps(nal, nalSize, &ppsId, &spsId) && ppsId < 256 && spsId < 32) {
+                m_pps[ppsId].offset = nalOffset;
+                m_pps[ppsId].size = nalSizeWithStartCode;
+                m_pps[ppsId].valid = true;
+                m_ppsToSps[ppsId] = static_cast<BYTE>(spsId);
+            }
+            break;
+        }
+        case H264_NAL_SLICE_IDR:
+            if (!idr) {
+                idr = true;
+                H264ParseSlicePpsId(nal, nalSize, &idrPpsId);
+            }
+            break;
+        default:
+            break;
+        }
+
+        p = next;
+        startCodeLength = nextLength;
+    }
+
+    if (idr && idrPpsId < 256) {
+        KeyframeIndexEntry entry = {};
+        entry.byteOffset = m_streamOffset;
+        entry.sampleTime = sampleTime;
+        entry.frameNumber = m_frameCount;
+        entry.ppsId = static_cast<BYTE>(idrPpsId);
+        entry.spsId = m_ppsToSps[idrPpsId];
+        if (m_pps[idrPpsId].valid) {
+            entry.ppsOffset = m_pps[idrPpsId].offset;
+            entry.ppsSize = m_pps[idrPpsId].size;
+        }
+        if (m_sps[entry.spsId].valid) {
+            entry.spsOffset = m_sps[entry.spsId].offset;
+            entry.spsSize = m_sps[entry.spsId].size;
+        }
+
+        // 每个 GOP 只写一条记录，立即落盘，录像中断时已写入的索引仍然可用
+        m_file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        m_file.flush();
+        m_entryCount++;
+    }
+
+    m_streamOffset += cbData;
+    m_frameCount++;
+    m_endTime = (std::max)(m_endTime, sampleTime + duration);
+
+    return m_file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT KeyframeIndexWriter::AppendEntry(const KeyframeIndexEntry& entry, UINT64 frameCount, LONGLONG endTime) {
+    if (!m_file.is_open()) return MF_E_NOT_INITIALIZED;
+
+    m_file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    m_file.flush();
+    m_entryCount++;
+    m_frameCount = (std::max)(m_frameCount, frameCount);
+    m_endTime = (std::max)(m_endTime, endTime);
+
+    return m_file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT KeyframeIndexWriter::Close() {
+    if (!m_file.is_open()) return S_OK;
+
+    // 回填头部，读取端据此得到最后一个 GOP 的帧数
+    m_file.seekp(offsetof(KeyframeIndexHeader, totalFrames));
+    m_file.write(reinterpret_cast<const char*>(&m_frameCount), sizeof(m_frameCount));
+    m_file.write(reinterpret_cast<const char*>(&m_endTime), sizeof(m_endTime));
+    bool good = m_file.good();
+    m_file.close();
+
+    return good ? S_OK : E_FAIL;
+}
+
+KeyframeIndexReader::KeyframeIndexReader() {}
+
+KeyframeIndexReader::~KeyframeIndexReader() { Close(); }
+
+HRESULT KeyframeIndexReader::Open(const std::wstring& indexFilePath) {
+    Close();
+
+    auto file = std::make_unique<MappedFile>();
+    HRESULT hr = file->Open(indexFilePath);
+    if (FAILED(hr)) return hr;
+
+    if (file->Size() < sizeof(KeyframeIndexHeader)) return MF_E_INVALID_FILE_FORMAT;
+    auto pHeader = reinterpret_cast<const KeyframeIndexHeader*>(file->Data());
+    if (memcmp(pHeader->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+        pHeader->version != KEYFRAME_INDEX_VERSION || pHeader->entrySize != sizeof(KeyframeIndexEntry)) {
+        MFLOG_WARN("Keyframe index has an unsupported format.");
+        return MF_E_INVALID_FILE_FORMAT;
+    }
+
+    // 条目数由文件大小决定，因此未正常关闭的索引同样可读
+    m_pHeader = pHeader;
+    m_pEntries = reinterpret_cast<const KeyframeIndexEntry*>(file->Data() + sizeof(KeyframeIndexHeader));
+    m_entryCount = static_cast<size_t>((file->Size() - sizeof(KeyframeIndexHeader)) / sizeof(KeyframeIndexEntry));
+    m_file = std::move(file);
+    return S_OK;
+}
+
+void KeyframeIndexReader::Close() {
+    m_file.reset();
+    m_pHeader = nullptr;
+    m_pEntries = nullptr;
+    m_entryCount = 0;
+}
+
+UINT64 KeyframeIndexReader::GetGopFrameCount(size_t index) const {
+    if (index + 1 < m_entryCount) return m_pEntries[index + 1].frameNumber - m_pEntries[index].frameNumber;
+    if (index < m_entryCount && m_pHeader->totalFrames > m_pEntries[index].frameNumber) {
+        return m_pHeader->totalFrames - m_pEntries[index].frameNumber;
+    }
+    return 0;
+}
+
+HRESULT KeyframeIndexReader::FindByTime(LONGLONG hnsTime, size_t* pIndex) const {
+    if (pIndex == nullptr) return E_POINTER;
+    if (m_entryCount == 0) return MF_E_NOT_FOUND;
+
+    const KeyframeIndexEntry* end = m_pEntries + m_entryCount;
+    const KeyframeIndexEntry* it = std::upper_bound(m_pEntries, end, hnsTime,
+        [](LONGLONG time, const KeyframeIndexEntry& entry) { return time < entry.sampleTime; });
+    if (it != m_pEntries) --it;
+
+    *pIndex = static_cast<size_t>(it - m_pEntries);
+    return S_OK;
+}
+
+HRESULT KeyframeIndexReader::FindByFrame(UINT64 frameNumber, size_t* pIndex) const {
+    if (pIndex == nullptr) return E_POINTER;
+    if (m_entryCount == 0) return MF_E_NOT_FOUND;
+
+    const KeyframeIndexEntry* end = m_pEntries + m_entryCount;
+    const KeyframeIndexEntry* it = std::upper_bound(m_pEntries, end, frameNumber,
+        [](UINT64 frame, const KeyframeIndexEntry& entry) { return frame < entry.frameNumber; });
+    if (it != m_pEntries) --it;
+
+    *pIndex = static_cast<size_t>(it - m_pEntries);
+    return S_OK;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <windows.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "MappedFile.h"
+
+// 关键帧索引边车文件（<录像文件>.idx）的磁盘格式，全部为小端
+#pragma pack(push, 1)
+struct KeyframeIndexHeader {
+    char magic[8];          // "H264IDX1"
+    UINT32 version;
+    UINT32 entrySize;       // sizeof(KeyframeIndexEntry)，便于以后扩展
+    UINT64 totalFrames;     // 录像结束时写入；异常中断时为 0
+    LONGLONG duration;      // 录像总时长，单位 100ns；异常中断时为 0
+};
+
+struct KeyframeIndexEntry {
+    UINT64 byteOffset;      // IDR 访问单元在录像文件中的字节偏移
+    LONGLONG sampleTime;    // 显示时间戳，单位 100ns
+    UINT64 frameNumber;     // 该 IDR 在码流中的帧序号
+    UINT64 spsOffset;       // 该 IDR 引用的 SPS NAL 在录像文件中的偏移（含起始码）
+    UINT64 ppsOffset;       // 该 IDR 引用的 PPS NAL 在录像文件中的偏移（含起始码）
+    UINT32 spsSize;
+    UINT32 ppsSize;
+    BYTE spsId;
+    BYTE ppsId;
+    UINT16 reserved;
+};
+#pragma pack(pop)
+
+const UINT32 KEYFRAME_INDEX_VERSION = 1;
+
+// 录像时边写边生成索引：每写入一个 Annex-B 访问单元调用一次 OnAccessUnit
+class KeyframeIndexWriter {
+public:
+    KeyframeIndexWriter();
+    ~KeyframeIndexWriter();
+
+    // 创建边车文件，streamOffset 为录像文件当前已写入的字节数（续录时非 0）
+    HRESULT Open(const std::wstring& indexFilePath, UINT64 streamOffset = 0);
+
+    // 记录一个已写入录像文件的访问单元
+    HRESULT OnAccessUnit(const BYTE* pData, DWORD cbData, LONGLONG sampleTime, LONGLONG duration);
+
+    // 直接追加一条已知的索引记录（剪辑/拼接时由已有索引平移得到），frameCount 帧之后视为结束于 endTime
+    HRESULT AppendEntry(const KeyframeIndexEntry& entry, UINT64 frameCount, LONGLONG endTime);
+
+    // 回填头部的总帧数和时长并关闭
+    HRESULT Close();
+
+    bool IsOpen() const { return m_file.is_open(); }
+    UINT64 GetEntryCount() const { return m_entryCount; }
+
+private:
+    std::ofstream m_file;
+    UINT64 m_streamOffset = 0;
+    UINT64 m_frameCount = 0;
+    UINT64 m_entryCount = 0;
+    LONGLONG m_endTime = 0;
+
+    // 最近一次出现的参数集位置（按 id 记录，IDR 引用时查表）
+    struct ParameterSetRef { UINT64 offset = 0; UINT32 size = 0; bool valid = false; };
+    ParameterSetRef m_sps[32];
+    ParameterSetRef m_pps[256];
+    BYTE m_ppsToSps[256] = {};
+};
+
+// 内存映射读取边车文件，按时间或帧号二分查找
+class KeyframeIndexReader {
+public:
+    KeyframeIndexReader();
+    ~KeyframeIndexReader();
+
+    HRESULT Open(const std::wstring& indexFilePath);
+    void Close();
+
+    size_t GetEntryCount() const { return m_entryCount; }
+    const KeyframeIndexEntry& GetEntry(size_t index) const { return m_pEntries[index]; }
+    const KeyframeIndexHeader& GetHeader() const { return *m_pHeader; }
+
+    // 该关键帧开始的 GOP 帧数，最后一个 GOP 在录像未正常结束时返回 0
+    UINT64 GetGopFrameCount(size_t index) const;
+
+    // 查找显示时间不晚于 hnsTime 的最近关键帧
+    HRESULT FindByTime(LONGLONG hnsTime, size_t* pIndex) const;
+
+    // 查找帧号不大于 frameNumber 的最近关键帧
+    HRESULT FindByFrame(UINT64 frameNumber, size_t* pIndex) const;
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    const KeyframeIndexHeader* m_pHeader = nullptr;
+    const KeyframeIndexEntry* m_pEntries = nullptr;
+    size_t m_entryCount = 0;
+};
@@ -0,0 +1,395 @@
+#include "LensDewarper.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LENS_DEWARP_SSE2 1
+#endif
+
+using Microsoft::WRL::ComPtr;
+
+static const int FRACTION_BITS = 5;                 // 坐标小数位，双线性权重 0..32
+static const INT32 FRACTION_ONE = 1 << FRACTION_BITS;
+static const UINT32 TILE_WIDTH = 64;
+static const UINT32 TILE_HEIGHT = 16;
+
+LensDewarper::LensDewarper() : m_pBands(&ParallelBands::Shared()) {}
+
+LensDewarper::~LensDewarper() {
+    if (m_pPool) m_pPool->Shutdown();
+}
+
+bool LensDewarper::IsSupported(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void LensDewarper::SetCalibration(const LensCalibration& calibration) {
+    m_calibration = calibration;
+    m_dirty = true;
+}
+
+size_t LensDewarper::GetTableBytes() const {
+    return (m_luma.offsets.size() + m_chroma.offsets.size()) * sizeof(INT16) +
+        (m_luma.base.size() + m_chroma.base.size()) * sizeof(INT32);
+}
+
+// ---- 建表 ----
+
+// 帧分辨率下的内参
+struct CameraModel {
+    double fx, fy, cx, cy;
+    double k1, k2, k3, p1, p2;
+    double zoom;
+
+    // 输出（校正后）亮度像素 -> 源（畸变）亮度像素，坐标为像素下标
+    void Distort(double u, double v, double* pX, double* pY) const {
+        double x = (u - cx) / (fx * zoom), y = (v - cy) / (fy * zoom);
+        double r2 = x * x + y * y;
+        double radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+        double xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+        double yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+        *pX = fx * xd + cx;
+        *pY = fy * yd + cy;
+    }
+};
+
+// 对平面内每个输出样点调用 map 求源坐标，按块写入基准和偏移
+// 源坐标钳制在 [0, size - 1] 内，落在平面内的坐标保持精确；右、下邻点的边界由逐帧处理钳制
+template <typename Map>
+static HRESULT BuildPlane(UINT32 width, UINT32 height, const Map& map, LensDewarper::RemapPlane* pPlane) {
+    pPlane->width = width;
+    pPlane->height = height;
+    pPlane->tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    pPlane->tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    pPlane->base.assign(static_cast<size_t>(pPlane->tilesX) * pPlane->tilesY * 2, 0);
+    pPlane->offsets.assign(static_cast<size_t>(pPlane->tilesX) * pPlane->tilesY * TILE_WIDTH * TILE_HEIGHT * 2, 0);
+
+    const INT32 maxX = static_cast<INT32>(width - 1) * FRACTION_ONE;
+    const INT32 maxY = static_cast<INT32>(height - 1) * FRACTION_ONE;
+    std::vector<INT32> fixedX(TILE_WIDTH * TILE_HEIGHT), fixedY(TILE_WIDTH * TILE_HEIGHT);
+
+    for (UINT32 ty = 0; ty < pPlane->tilesY; ty++) {
+        for (UINT32 tx = 0; tx < pPlane->tilesX; tx++) {
+            // 块外（右、下边缘的不完整块）的样点复制块内最后一个有效样点，保证偏移范围不被它们撑大
+            INT32 minX = INT32_MAX, minY = INT32_MAX, maxOffsetX = 0, maxOffsetY = 0;
+            for (UINT32 r = 0; r < TILE_HEIGHT; r++) {
+                UINT32 v = (std::min)(ty * TILE_HEIGHT + r, height - 1);
+                for (UINT32 c = 0; c < TILE_WIDTH; c++) {
+                    UINT32 u = (std::min)(tx * TILE_WIDTH + c, width - 1);
+                    double sx = 0.0, sy = 0.0;
+                    map(u, v, &sx, &sy);
+                    INT32 fx = static_cast<INT32>(std::lround(sx * FRACTION_ONE));
+                    INT32 fy = static_cast<INT32>(std::lround(sy * FRACTION_ONE));
+                    fx = (std::min)((std::max)(fx, 0), maxX);
+                    fy = (std::min)((std::max)(fy, 0), maxY);
+                    fixedX[r * TILE_WIDTH + c] = fx;
+                    fixedY[r * TILE_WIDTH + c] = fy;
+                    minX = (std::min)(minX, fx >> FRACTION_BITS);
+                    minY = (std::min)(minY, fy >> FRACTION_BITS);
+                }
+            }
+
+            size_t tile = static_cast<size_t>(ty) * pPlane->tilesX + tx;
+            pPlane->base[tile * 2] = minX;
+            pPlane->base[tile * 2 + 1] = minY;
+            INT16* pOffsets = pPlane->offsets.data() + tile * TILE_WIDTH * TILE_HEIGHT * 2;
+            for (UINT32 r = 0; r < TILE_HEIGHT; r++) {
+                for (UINT32 c = 0; c < TILE_WIDTH; c++) {
+                    INT32 ox = fixedX[r * TILE_WIDTH + c] - minX * FRACTION_ONE;
+                    INT32 oy = fixedY[r * TILE_WIDTH + c] - minY * FRACTION_ONE;
+                    maxOffsetX = (std::max)(maxOffsetX, ox);
+                    maxOffsetY = (std::max)(maxOffsetY, oy);
+                    pOffsets[r * TILE_WIDTH * 2 + c] = static_cast<INT16>(ox);
+                    pOffsets[r * TILE_WIDTH * 2 + TILE_WIDTH + c] = static_cast<INT16>(oy);
+                }
+            }
+            // 一个块内源坐标跨度超过 1023 像素说明畸变系数或 zoom 不合理
+            if (maxOffsetX > INT16_MAX || maxOffsetY > INT16_MAX) return E_INVALIDARG;
+        }
+    }
+    return S_OK;
+}
+
+HRESULT LensDewarper::Configure(const VideoFormat& format) {
+    if (!IsSupported(format.subtype)) return MF_E_INVALIDMEDIATYPE;
+    if (format.width < 2 || format.height < 4) return E_INVALIDARG;
+    const LensCalibration& cal = m_calibration;
+    if (cal.width == 0 || cal.height == 0 || cal.fx <= 0.0 || cal.fy <= 0.0 || cal.zoom <= 0.0) return MF_E_NOT_INITIALIZED;
+
+    // I420 / IYUV / YV12 的平面布局相同，可以共用一张表
+    bool interleaved = format.subtype == VideoSubtype::NV12;
+    bool sameLayout = (m_subtype == VideoSubtype::NV12) == interleaved;
+    if (!m_dirty && sameLayout && format.width == m_width && format.height == m_height) return S_OK;
+
+    // 内参按帧分辨率缩放（按像素中心对齐）
+    double scaleX = static_cast<double>(format.width) / cal.width;
+    double scaleY = static_cast<double>(format.height) / cal.height;
+    CameraModel model = { cal.fx * scaleX, cal.fy * scaleY, (cal.cx + 0.5) * scaleX - 0.5, (cal.cy + 0.5) * scaleY - 0.5,
+        cal.k1, cal.k2, cal.k3, cal.p1, cal.p2, cal.zoom };
+
+    HRESULT hr = BuildPlane(format.width, format.height,
+        [&](UINT32 u, UINT32 v, double* pX, double* pY) { model.Distort(u, v, pX, pY); }, &m_luma);
+    if (FAILED(hr)) return hr;
+
+    // 色度样点位于 2x2 亮度样点中心：先换算到亮度坐标求源位置，再换回色度坐标
+    UINT32 chromaWidth = (format.width + 1) / 2, chromaHeight = (format.height + 1) / 2;
+    hr = BuildPlane(chromaWidth, chromaHeight, [&](UINT32 u, UINT32 v, double* pX, double* pY) {
+        double sx = 0.0, sy = 0.0;
+        model.Distort(u * 2.0 + 0.5, v * 2.0 + 0.5, &sx, &sy);
+        *pX = (sx - 0.5) / 2.0;
+        *pY = (sy - 0.5) / 2.0;
+    }, &m_chroma);
+    if (FAILED(hr)) return hr;
+
+    m_subtype = format.subtype;
+    m_width = format.width;
+    m_height = format.height;
+    m_dirty = false;
+    return S_OK;
+}
+
+// ---- 逐帧重映射 ----
+
+// 单分量平面（Y、I420 的 U/V）一行：count 个输出样点
+// limitX、limitY 是平面最后一列、一行相对块基准的坐标，右、下邻点钳制在这里（落在边缘上的样点权重为 0，只是不越界读取）
+static void RemapRow(const BYTE* pSrc, LONG srcStride, BYTE* pDst, const INT16* pX, const INT16* pY, UINT32 count,
+    INT32 limitX, INT32 limitY) {
+    UINT32 i = 0;
+#ifdef LENS_DEWARP_SSE2
+    const __m128i fractionMask = _mm_set1_epi16(FRACTION_ONE - 1);
+    const __m128i one = _mm_set1_epi16(FRACTION_ONE);
+    const __m128i round = _mm_set1_epi32(1 << (2 * FRACTION_BITS - 1));
+    const __m128i zero = _mm_setzero_si128();
+    alignas(16) UINT16 xs[8], ys[8], top[8], bottom[8];
+    for (; i + 8 <= count; i += 8) {
+        __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pX + i));
+        __m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(xs), _mm_srli_epi16(vx, FRACTION_BITS));
+        _mm_store_si128(reinterpret_cast<__m128i*>(ys), _mm_srli_epi16(vy, FRACTION_BITS));
+
+        // SSE2 没有 gather：每个样点逐个取出四个邻点
+        for (int k = 0; k < 8; k++) {
+            const BYTE* p = pSrc + static_cast<ptrdiff_t>(ys[k]) * srcStride + xs[k];
+            ptrdiff_t right = xs[k] < limitX ? 1 : 0;
+            ptrdiff_t down = ys[k] < limitY ? srcStride : 0;
+            top[k] = static_cast<UINT16>(p[0] | (p[right] << 8));
+            bottom[k] = static_cast<UINT16>(p[down] | (p[down + right] << 8));
+        }
+
+        // 水平：(左, 右) 与 (32 - fx, fx) 做 madd
+        __m128i fx = _mm_and_si128(vx, fractionMask), fy = _mm_and_si128(vy, fractionMask);
+        __m128i wxLo = _mm_unpacklo_epi16(_mm_sub_epi16(one, fx), fx), wxHi = _mm_unpackhi_epi16(_mm_sub_epi16(one, fx), fx);
+        __m128i t = _mm_load_si128(reinterpret_cast<const __m128i*>(top));
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(bottom));
+        __m128i topRow = _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(t, zero), wxLo),
+            _mm_madd_epi16(_mm_unpackhi_epi8(t, zero), wxHi));
+        __m128i bottomRow = _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(b, zero), wxLo),
+            _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), wxHi));
+
+        // 垂直：(上, 下) 与 (32 - fy, fy) 做 madd
+        __m128i wyLo = _mm_unpacklo_epi16(_mm_sub_epi16(one, fy), fy), wyHi = _mm_unpackhi_epi16(_mm_sub_epi16(one, fy), fy);
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(topRow, bottomRow), wyLo);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(topRow, bottomRow), wyHi);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 2 * FRACTION_BITS);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 2 * FRACTION_BITS);
+        __m128i out = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i), _mm_packus_epi16(out, out));
+    }
+#endif
+    for (; i < count; i++) {
+        INT32 x = pX[i] >> FRACTION_BITS, y = pY[i] >> FRACTION_BITS;
+        INT32 fx = pX[i] & (FRACTION_ONE - 1), fy = pY[i] & (FRACTION_ONE - 1);
+        const BYTE* p = pSrc + static_cast<ptrdiff_t>(y) * srcStride + x;
+        ptrdiff_t right = x < limitX ? 1 : 0;
+        ptrdiff_t down = y < limitY ? srcStride : 0;
+        INT32 t = p[0] * (FRACTION_ONE - fx) + p[right] * fx;
+        INT32 b = p[down] * (FRACTION_ONE - fx) + p[down + right] * fx;
+        pDst[i] = static_cast<BYTE>((t * (FRACTION_ONE - fy) + b * fy + (1 << (2 * FRACTION_BITS - 1))) >> (2 * FRACTION_BITS));
+    }
+}
+
+// NV12 的 UV 平面一行：count 个输出 UV 对；limitX、limitY 同 RemapRow（以 UV 对为单位）
+static void RemapRowUV(const BYTE* pSrc, LONG srcStride, BYTE* pDst, const INT16* pX, const INT16* pY, UINT32 count,
+    INT32 limitX, INT32 limitY) {
+    UINT32 i = 0;
+#ifdef LENS_DEWARP_SSE2
+    const __m128i fractionMask = _mm_set1_epi16(FRACTION_ONE - 1);
+    const __m128i one = _mm_set1_epi16(FRACTION_ONE);
+    const __m128i round = _mm_set1_epi32(1 << (2 * FRACTION_BITS - 1));
+    const __m128i zero = _mm_setzero_si128();
+    alignas(16) UINT16 xs[8], ys[8];
+    alignas(16) UINT32 top[4], bottom[4];
+    for (; i + 4 <= count; i += 4) {
+        __m128i vx = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pX + i));
+        __m128i vy = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pY + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(xs), _mm_srli_epi16(vx, FRACTION_BITS));
+        _mm_store_si128(reinterpret_cast<__m128i*>(ys), _mm_srli_epi16(vy, FRACTION_BITS));
+
+        // 每个样点取左右两个 UV 对（各一次 16 位读取），拼成一个 32 位值
+        for (int k = 0; k < 4; k++) {
+            const BYTE* p = pSrc + static_cast<ptrdiff_t>(ys[k]) * srcStride + xs[k] * 2;
+            ptrdiff_t right = xs[k] < limitX ? 2 : 0;
+            ptrdiff_t down = ys[k] < limitY ? srcStride : 0;
+            UINT16 pairs[4];
+            memcpy(&pairs[0], p, 2);
+            memcpy(&pairs[1], p + right, 2);
+            memcpy(&pairs[2], p + down, 2);
+            memcpy(&pairs[3], p + down + right, 2);
+            top[k] = pairs[0] | (static_cast<UINT32>(pairs[1]) << 16);
+            bottom[k] = pairs[2] | (static_cast<UINT32>(pairs[3]) << 16);
+        }
+
+        // U0 V0 U1 V1 重排成 U0 U1 V0 V1，每个样点的权重对重复两次，一次 madd 得到 U 和 V
+        __m128i fx = _mm_and_si128(vx, fractionMask), fy = _mm_and_si128(vy, fractionMask);
+        __m128i wx = _mm_unpacklo_epi16(_mm_sub_epi16(one, fx), fx);
+        __m128i wy = _mm_unpacklo_epi16(_mm_sub_epi16(one, fy), fy);
+        __m128i wx01 = _mm_unpacklo_epi32(wx, wx), wx23 = _mm_unpackhi_epi32(wx, wx);
+        __m128i wy01 = _mm_unpacklo_epi32(wy, wy), wy23 = _mm_unpackhi_epi32(wy, wy);
+        auto horizontal = [&](__m128i pairs) {
+            __m128i lo = _mm_unpacklo_epi8(pairs, zero), hi = _mm_unpackhi_epi8(pairs, zero);
+            lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+            hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+            return _mm_packs_epi32(_mm_madd_epi16(lo, wx01), _mm_madd_epi16(hi, wx23));
+        };
+        __m128i topRow = horizontal(_mm_load_si128(reinterpret_cast<const __m128i*>(top)));
+        __m128i bottomRow = horizontal(_mm_load_si128(reinterpret_cast<const __m128i*>(bottom)));
+
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(topRow, bottomRow), wy01);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(topRow, bottomRow), wy23);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 2 * FRACTION_BITS);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 2 * FRACTION_BITS);
+        __m128i out = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i * 2), _mm_packus_epi16(out, out));
+    }
+#endif
+    for (; i < count; i++) {
+        INT32 x = pX[i] >> FRACTION_BITS, y = pY[i] >> FRACTION_BITS;
+        INT32 fx = pX[i] & (FRACTION_ONE - 1), fy = pY[i] & (FRACTION_ONE - 1);
+        const BYTE* p = pSrc + static_cast<ptrdiff_t>(y) * srcStride + x * 2;
+        ptrdiff_t right = x < limitX ? 2 : 0;
+        ptrdiff_t down = y < limitY ? srcStride : 0;
+        for (int c = 0; c < 2; c++) {
+            INT32 t = p[c] * (FRACTION_ONE - fx) + p[c + right] * fx;
+            INT32 b = p[down + c] * (FRACTION_ONE - fx) + p[down + c + right] * fx;
+            pDst[i * 2 + c] = static_cast<BYTE>((t * (FRACTION_ONE - fy) + b * fy + (1 << (2 * FRACTION_BITS - 1))) >> (2 * FRACTION_BITS));
+        }
+    }
+}
+
+// 一个平面的 [tileRowBegin, tileRowEnd) 块行；行函数拿到的源指针已移到块的基准坐标
+template <bool Interleaved>
+static void RemapTiles(const LensDewarper::RemapPlane& plane, const BYTE* pSrc, LONG srcStride, BYTE* pDst, LONG dstStride,
+    UINT32 tileRowBegin, UINT32 tileRowEnd) {
+    const UINT32 sampleBytes = Interleaved ? 2 : 1;
+    for (UINT32 ty = tileRowBegin; ty < tileRowEnd; ty++) {
+        UINT32 rows = (std::min)(TILE_HEIGHT, plane.height - ty * TILE_HEIGHT);
+        for (UINT32 tx = 0; tx < plane.tilesX; tx++) {
+            size_t tile = static_cast<size_t>(ty) * plane.tilesX + tx;
+            UINT32 columns = (std::min)(TILE_WIDTH, plane.width - tx * TILE_WIDTH);
+            const BYTE* pBase = pSrc + static_cast<ptrdiff_t>(plane.base[tile * 2 + 1]) * srcStride +
+                static_cast<ptrdiff_t>(plane.base[tile * 2]) * sampleBytes;
+            const INT16* pOffsets = plane.offsets.data() + tile * TILE_WIDTH * TILE_HEIGHT * 2;
+            INT32 limitX = static_cast<INT32>(plane.width - 1) - plane.base[tile * 2];
+            INT32 limitY = static_cast<INT32>(plane.height - 1) - plane.base[tile * 2 + 1];
+            for (UINT32 r = 0; r < rows; r++) {
+                BYTE* pRow = pDst + static_cast<ptrdiff_t>(ty * TILE_HEIGHT + r) * dstStride + tx * TILE_WIDTH * sampleBytes;
+                const INT16* pX = pOffsets + r * TILE_WIDTH * 2;
+                if (Interleaved) RemapRowUV(pBase, srcStride, pRow, pX, pX + TILE_WIDTH, columns, limitX, limitY);
+                else RemapRow(pBase, srcStride, pRow, pX, pX + TILE_WIDTH, columns, limitX, limitY);
+            }
+        }
+    }
+}
+
+HRESULT LensDewarper::Remap(const ImagePlanes& src, const ImagePlanes& dst) {
+    if (m_dirty || m_luma.width == 0) return MF_E_NOT_INITIALIZED;
+    if (src.width != m_width || src.height != m_height || dst.width != m_width || dst.height != m_height) {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+    bool interleaved = m_subtype == VideoSubtype::NV12;
+    if ((src.subtype == VideoSubtype::NV12) != interleaved || (dst.subtype == VideoSubtype::NV12) != interleaved) {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+    UINT32 planeCount = interleaved ? 2 : 3;
+    for (UINT32 i = 0; i < planeCount; i++) {
+        if (src.data[i] == nullptr || dst.data[i] == nullptr) return E_POINTER;
+    }
+
+    for (UINT32 i = 0; i < planeCount; i++) {
+        const RemapPlane& plane = (i == 0) ? m_luma : m_chroma;
+        auto band = [&](UINT32 tileRowBegin, UINT32 tileRowEnd) {
+            if (i > 0 && interleaved) {
+                RemapTiles<true>(plane, src.data[i], src.stride[i], dst.data[i], dst.stride[i], tileRowBegin, tileRowEnd);
+            }
+            else {
+                RemapTiles<false>(plane, src.data[i], src.stride[i], dst.data[i], dst.stride[i], tileRowBegin, tileRowEnd);
+            }
+        };
+        if (m_pBands) m_pBands->Run(plane.tilesY, 1, band);
+        else band(0, plane.tilesY);
+    }
+    return S_OK;
+}
+
+HRESULT LensDewarper::ProcessSample(IMFSample* pInput, const VideoFormat& format, IMFSample** ppOutput) {
+    if (pInput == nullptr || ppOutput == nullptr) return E_POINTER;
+    *ppOutput = nullptr;
+
+    HRESULT hr = Configure(format);
+    if (FAILED(hr)) return hr;
+    if (!m_pPool || format.hash != m_formatHash) {
+        if (m_pPool) m_pPool->Reconfigure(format.frameBytes, 16);
+        else hr = SamplePool::Create(format.frameBytes, 16, 2, &m_pPool);
+        if (FAILED(hr)) return hr;
+        m_formatHash = format.hash;
+    }
+
+    ComPtr<IMFMediaBuffer> pInBuffer, pOutBuffer;
+    ComPtr<IMFSample> pOutput;
+    hr = pInput->ConvertToContiguousBuffer(&pInBuffer);
+    if (FAILED(hr)) return hr;
+    hr = m_pPool->AcquireSample(&pOutput);
+    if (FAILED(hr)) return hr;
+    hr = pOutput->GetBufferByIndex(0, &pOutBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pIn = nullptr;
+    BYTE* pOut = nullptr;
+    DWORD cbIn = 0, cbOutMax = 0;
+    hr = pInBuffer->Lock(&pIn, nullptr, &cbIn);
+    if (FAILED(hr)) return hr;
+    hr = pOutBuffer->Lock(&pOut, &cbOutMax, nullptr);
+    if (SUCCEEDED(hr)) {
+        ImagePlanes src, dst;
+        hr = ImagePlanesFromBuffer(format, pIn, cbIn, &src);
+        if (SUCCEEDED(hr)) hr = ImagePlanesFromBuffer(format, pOut, cbOutMax, &dst);
+        if (SUCCEEDED(hr)) hr = Remap(src, dst);
+        pOutBuffer->Unlock();
+    }
+    pInBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    hr = pOutBuffer->SetCurrentLength(format.frameBytes);
+    if (FAILED(hr)) return hr;
+
+    hr = pInput->CopyAllItems(pOutput.Get());
+    if (FAILED(hr)) return hr;
+    LONGLONG value = 0;
+    if (SUCCEEDED(pInput->GetSampleTime(&value))) pOutput->SetSampleTime(value);
+    if (SUCCEEDED(pInput->GetSampleDuration(&value))) pOutput->SetSampleDuration(value);
+
+    *ppOutput = pOutput.Detach();
+    return S_OK;
+}
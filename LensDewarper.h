@@ -0,0 +1,71 @@
+#pragma once
+#include <windows.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#include <vector>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+#include "SamplePool.h"
+
+// 镜头标定：标定分辨率下的针孔内参（像素）和 Brown-Conrady 畸变系数，定义与 OpenCV 相同
+// 帧分辨率与标定分辨率不同时按比例缩放内参；width 或 height 为 0 表示没有标定
+struct LensCalibration {
+    UINT32 width = 0;
+    UINT32 height = 0;
+    double fx = 0.0, fy = 0.0;          // 焦距
+    double cx = 0.0, cy = 0.0;          // 主点
+    double k1 = 0.0, k2 = 0.0, k3 = 0.0;    // 径向畸变（桶形畸变时 k1 < 0）
+    double p1 = 0.0, p2 = 0.0;          // 切向畸变
+    double zoom = 1.0;                  // 输出焦距相对标定焦距的比例，小于 1 保留更多边缘视野（落到源画面外的部分按边缘像素延伸）
+};
+
+// 镜头畸变校正（NV12 / I420 / IYUV / YV12）
+// 每个标定和分辨率只建一次定点重映射表：输出按 64x16 的块划分，每块记录一个整数基准源坐标，
+// 块内每个样点只存相对基准的 16 位 x、y 偏移（低 5 位为小数），4 字节 / 样点；色度平面单独一张半分辨率的表。
+// 逐帧按块处理（块对应的源区域留在缓存里），SSE2 计算坐标和双线性权重，四个邻点按样点取出后用 madd 插值；
+// 块行按行带并行
+class LensDewarper {
+public:
+    LensDewarper();
+    ~LensDewarper();
+
+    static bool IsSupported(VideoSubtype subtype);
+
+    // 标定变化时下一次 Configure（或 ProcessSample）重新建表
+    void SetCalibration(const LensCalibration& calibration);
+    const LensCalibration& GetCalibration() const { return m_calibration; }
+
+    // 按帧尺寸建表；尺寸、平面布局和标定都没变时直接返回
+    HRESULT Configure(const VideoFormat& format);
+
+    // src 须与 Configure 的格式一致；dst 格式相同，不能与 src 重叠
+    HRESULT Remap(const ImagePlanes& src, const ImagePlanes& dst);
+
+    // 采样接口：输出从池中取，时间戳和采样属性随帧复制
+    HRESULT ProcessSample(IMFSample* pInput, const VideoFormat& format, IMFSample** ppOutput);
+
+    // 当前重映射表占用的字节数
+    size_t GetTableBytes() const;
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+    // 一个平面的重映射表
+    struct RemapPlane {
+        UINT32 width = 0, height = 0;       // 平面尺寸（样点），源和输出相同
+        UINT32 tilesX = 0, tilesY = 0;
+        std::vector<INT32> base;            // 每块两个值：块内源坐标的整数最小值 (x, y)
+        std::vector<INT16> offsets;         // 每块 TILE_HEIGHT 行，每行先 TILE_WIDTH 个 x 偏移再 TILE_WIDTH 个 y 偏移
+    };
+
+private:
+    LensCalibration m_calibration;
+    bool m_dirty = true;
+    VideoSubtype m_subtype = VideoSubtype::Unknown;
+    UINT32 m_width = 0, m_height = 0;
+    RemapPlane m_luma;
+    RemapPlane m_chroma;
+    ParallelBands* m_pBands = nullptr;
+    Microsoft::WRL::ComPtr<SamplePool> m_pPool;
+    UINT64 m_formatHash = 0;
+};
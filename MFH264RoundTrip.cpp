@@ -11,6 +11,16 @@
 * ffmpeg -vcodec rawvideo -s 640x480 -pix_fmt yuv420p -i rawframes.yuv -vframes 1 output.jpeg
 * ffmpeg -vcodec rawvideo -s 640x480 -pix_fmt yuv420p -i rawframes.yuv out.avi
 *
+* Usage: MFH264RoundTrip [bitrateKbps] [input.y4m|-] [denoiseStrength]
+* With a Y4M input file (8 bit 4:2:0, even width and height) the clip is encoded
+* instead of the webcam, so runs at different bit rates see identical frames.
+* "-" keeps the webcam as input. A denoise strength of 1-127 runs the temporal
+* denoiser on each frame before the encoder; source.y4m keeps the unfiltered
+* frames, so the quality report measures the filter against the original.
+* The source and decoded frames are also written to source.y4m and decoded.y4m
+* with their timestamps, for the PSNR/SSIM tool:
+* VideoQuality source.y4m 240k=decoded.y4m,capture.h264
+*
 * Author:
 * Aaron Clauson (aaron@sipsorcery.com)
 *
@@ -21,6 +31,12 @@
 /******************************************************************************/
 
 #include "MFUtility.h"
+#include "KeyframeIndex.h"
+#include "TransformChain.h"
+#include "ChangeDetector.h"
+#include "SceneCutDetector.h"
+#include "TemporalDenoiser.h"
+#include "Y4MFile.h"
 
 #include <stdio.h>
 #include <tchar.h>
@@ -31,6 +47,7 @@
 #include <wmcodecdsp.h>
 #include <codecapi.h>
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
 
@@ -46,11 +63,228 @@
 #define OUTPUT_FRAME_WIDTH 640		// Adjust if the webcam does not support this frame width.
 #define OUTPUT_FRAME_HEIGHT 480		// Adjust if the webcam does not support this frame height.
 #define OUTPUT_FRAME_RATE 30      // Adjust if the webcam does not support this frame rate.
+#define MAX_GOP_FRAMES 300        // Longest key frame interval, extra IDRs are only inserted at scene cuts.
 #define CAPTURE_FILENAME "rawframes.yuv"
+#define H264_CAPTURE_FILENAME "capture.h264"
+#define H264_INDEX_FILENAME L"capture.h264.idx"
+#define SOURCE_Y4M_FILENAME "source.y4m"
+#define DECODED_Y4M_FILENAME "decoded.y4m"
+#define DEFAULT_BITRATE_KBPS 240
+
+/**
+* Appends an encoded H264 sample to the elementary stream recording and records
+* it in the keyframe index sidecar.
+* @param[in] pSample: pointer to the Annex-B encoded sample from the H264 encoder MFT.
+* @param[in] pFileStream: pointer to the H264 recording file stream.
+* @param[in] pIndexWriter: pointer to the keyframe index writer for the recording.
+* @@Returns S_OK if successful or an error code if not.
+*/
+HRESULT WriteH264SampleToRecording(IMFSample* pSample, std::ofstream* pFileStream, KeyframeIndexWriter* pIndexWriter)
+{
+  IMFMediaBuffer* buf = NULL;
+  BYTE* byteBuffer = NULL;
+  DWORD bufLength = 0;
+  LONGLONG sampleTime = 0, sampleDuration = 0;
+
+  HRESULT hr = S_OK;
+
+  hr = pSample->ConvertToContiguousBuffer(&buf);
+  CHECK_HR(hr, "ConvertToContiguousBuffer failed.");
+
+  pSample->GetSampleTime(&sampleTime);
+  pSample->GetSampleDuration(&sampleDuration);
+
+  hr = buf->Lock(&byteBuffer, NULL, &bufLength);
+  CHECK_HR(hr, "Failed to lock encoded sample buffer.");
+
+  pFileStream->write((char*)byteBuffer, bufLength);
+  hr = pIndexWriter->OnAccessUnit(byteBuffer, bufLength, sampleTime, sampleDuration);
+
+  buf->Unlock();
+  CHECK_HR(hr, "Failed to update keyframe index.");
+
+done:
+
+  SAFE_RELEASE(buf);
+
+  return hr;
+}
+
+/**
+* Asks the encoder to code the next input frame as an IDR.
+* @param[in] pEncoder: pointer to the H264 encoder MFT.
+* @@Returns S_OK if successful or an error code if not.
+*/
+HRESULT ForceKeyFrame(IMFTransform* pEncoder)
+{
+  ICodecAPI* pCodecApi = NULL;
+  VARIANT value;
+  HRESULT hr = S_OK;
+
+  VariantInit(&value);
+  value.vt = VT_UI4;
+  value.ulVal = 1;
+
+  CHECK_HR(pEncoder->QueryInterface(IID_PPV_ARGS(&pCodecApi)), "Failed to get ICodecAPI from H264 encoder MFT.");
+  CHECK_HR(pCodecApi->SetValue(&CODECAPI_AVEncVideoForceKeyFrame, &value), "Failed to request a key frame.");
+
+done:
+
+  SAFE_RELEASE(pCodecApi);
+
+  return hr;
+}
+
+/**
+* Reads the next frame of a Y4M clip into a new sample laid out as IYUV.
+* @param[in] pReader: pointer to the open Y4M reader.
+* @param[in] frameDuration: duration to set on the sample, in 100ns units.
+* @param[out] ppSample: receives the sample, NULL at the end of the clip.
+* @@Returns S_OK if successful or an error code if not.
+*/
+HRESULT ReadY4MSample(Y4MReader* pReader, LONGLONG frameDuration, IMFSample** ppSample)
+{
+  IMFSample* pSample = NULL;
+  IMFMediaBuffer* buf = NULL;
+  BYTE* byteBuffer = NULL;
+  Y4MFrame frame;
+
+  HRESULT hr = S_OK;
+
+  *ppSample = NULL;
+  if (!pReader->ReadFrame(&frame)) {
+    if (pReader->HasError()) {
+      printf("Error reading Y4M input: %s.\n", pReader->GetError().c_str());
+      return E_FAIL;
+    }
+    return S_OK;
+  }
+
+  hr = CreateSingleBufferIMFSample((DWORD)frame.data.size(), &pSample);
+  CHECK_HR(hr, "Failed to create sample for Y4M frame.");
+
+  hr = pSample->GetBufferByIndex(0, &buf);
+  CHECK_HR(hr, "Failed to get Y4M sample buffer.");
+
+  hr = buf->Lock(&byteBuffer, NULL, NULL);
+  CHECK_HR(hr, "Failed to lock Y4M sample buffer.");
+  memcpy(byteBuffer, frame.data.data(), frame.data.size());
+  buf->Unlock();
+
+  CHECK_HR(buf->SetCurrentLength((DWORD)frame.data.size()), "Failed to set Y4M sample length.");
+  CHECK_HR(pSample->SetSampleTime(frame.pts), "Failed to set Y4M sample time.");
+  CHECK_HR(pSample->SetSampleDuration(frameDuration), "Failed to set Y4M sample duration.");
+
+  *ppSample = pSample;
+  pSample = NULL;
+
+done:
+
+  SAFE_RELEASE(buf);
+  SAFE_RELEASE(pSample);
+
+  return hr;
+}
+
+/**
+* Appends an uncompressed 4:2:0 sample to a Y4M file for the PSNR/SSIM tool. Only the
+* picture area of the writer's frame size is written, so decoder padding is cropped off.
+* @param[in] pSample: pointer to the uncompressed sample.
+* @param[in] format: layout of the sample's buffer.
+* @param[in] pts: timestamp written to the frame header, in 100ns units.
+* @param[in] pWriter: pointer to the open Y4M writer.
+* @@Returns S_OK if successful or an error code if not.
+*/
+HRESULT WriteSampleToY4M(IMFSample* pSample, const VideoFormat& format, LONGLONG pts, Y4MWriter* pWriter)
+{
+  IMFMediaBuffer* buf = NULL;
+  BYTE* byteBuffer = NULL;
+  DWORD bufLength = 0;
+  ImagePlanes planes = {};
+  const uint8_t* planeData[3] = {};
+  ptrdiff_t planeStrides[3] = {};
+
+  HRESULT hr = S_OK;
+
+  if (format.planeCount != 3 || format.width < pWriter->GetInfo().width || format.height < pWriter->GetInfo().height) {
+    printf("Sample format %s %ux%u cannot be written to the Y4M file.\n", VideoSubtypeName(format.subtype), format.width, format.height);
+    return MF_E_INVALIDMEDIATYPE;
+  }
+
+  hr = pSample->ConvertToContiguousBuffer(&buf);
+  CHECK_HR(hr, "ConvertToContiguousBuffer failed.");
+
+  hr = buf->Lock(&byteBuffer, NULL, &bufLength);
+  CHECK_HR(hr, "Failed to lock sample buffer.");
+
+  hr = ImagePlanesFromBuffer(format, byteBuffer, bufLength, &planes);
+  if (SUCCEEDED(hr)) {
+    for (int i = 0; i < 3; i++) {
+      planeData[i] = planes.data[i];
+      planeStrides[i] = planes.stride[i];
+    }
+    if (!pWriter->WriteFrame(planeData, planeStrides, pts)) {
+      hr = E_FAIL;
+    }
+  }
+
+  buf->Unlock();
+  CHECK_HR(hr, "Failed to write Y4M frame.");
+
+done:
+
+  SAFE_RELEASE(buf);
+
+  return hr;
+}
+
+/**
+* Writes a decoded sample to the raw dump and the decoded Y4M file.
+* @param[in] pSample: pointer to the decoded sample.
+* @param[in] pts: timestamp of the source frame it stands for, in 100ns units.
+* @param[in] decodedFormat: output format of the H264 decoder.
+* @param[in] pRawStream: pointer to the raw yuv dump file stream.
+* @param[in] pY4MWriter: pointer to the decoded Y4M writer.
+* @@Returns S_OK if successful or an error code if not.
+*/
+HRESULT WriteDecodedSample(IMFSample* pSample, LONGLONG pts, const VideoFormat& decodedFormat, std::ofstream* pRawStream, Y4MWriter* pY4MWriter)
+{
+  HRESULT hr = S_OK;
+
+  CHECK_HR(WriteSampleToFile(pSample, pRawStream), "Failed to write sample to file.");
+  CHECK_HR(WriteSampleToY4M(pSample, decodedFormat, pts, pY4MWriter), "Failed to write decoded sample to Y4M file.");
+
+done:
+
+  return hr;
+}
 
 int _tmain(int argc, _TCHAR* argv[])
 {
   std::ofstream outputBuffer(CAPTURE_FILENAME, std::ios::out | std::ios::binary);
+  std::ofstream h264Buffer(H264_CAPTURE_FILENAME, std::ios::out | std::ios::binary);
+  KeyframeIndexWriter keyframeIndex;
+  TransformChain roundTripChain;
+  std::vector<ComPtr<IMFSample>> decodedSamples;
+  ComPtr<IMFSample> pLastDecoded;
+  ChangeDetector changeDetector;
+  SceneCutDetector sceneCutDetector;
+  SceneCutSettings sceneCutSettings;
+  TemporalDenoiser denoiser;
+  TemporalDenoiseSettings denoiseSettings;
+  UINT32 denoiseStrength = 0;
+  double denoiseMs = 0;
+  int denoiseFrames = 0;
+  VideoFormat inputFormat = {};
+  double roundTripMs = 0;
+  int roundTripFrames = 0;
+  UINT32 bitrateKbps = DEFAULT_BITRATE_KBPS;
+  UINT32 frameWidth = OUTPUT_FRAME_WIDTH, frameHeight = OUTPUT_FRAME_HEIGHT;
+  UINT32 fpsNum = OUTPUT_FRAME_RATE, fpsDen = 1;
+  LONGLONG frameDuration = 0;
+  bool useY4MInput = false;
+  Y4MReader y4mInput;
+  Y4MWriter sourceY4M, decodedY4M;
 
   IMFMediaSource* pVideoSource = NULL;
   IMFSourceReader* pVideoReader = NULL;
@@ -71,20 +305,60 @@ int _tmain(int argc, _TCHAR* argv[])
   CHECK_HR(MFStartup(MF_VERSION),
     "Media Foundation initialisation failed.");
 
-  // Get video capture device.
-  CHECK_HR(GetVideoSourceFromDevice(WEBCAM_DEVICE_INDEX, &pVideoSource, &pVideoReader),
-    "Failed to get webcam video source.");
+  CHECK_HR(keyframeIndex.Open(H264_INDEX_FILENAME),
+    "Failed to create keyframe index.");
+
+  if (argc > 1 && _ttoi(argv[1]) > 0) {
+    bitrateKbps = _ttoi(argv[1]);
+  }
+
+  if (argc > 3 && _ttoi(argv[3]) > 0) {
+    denoiseStrength = (_ttoi(argv[3]) < 127) ? _ttoi(argv[3]) : 127;
+  }
+
+  if (argc > 2 && _tcscmp(argv[2], _T("-")) != 0) {
+    // Encode a Y4M clip instead of the webcam.
+#ifdef _UNICODE
+    char y4mPath[MAX_PATH] = {};
+    WideCharToMultiByte(CP_ACP, 0, argv[2], -1, y4mPath, MAX_PATH, NULL, NULL);
+#else
+    const char* y4mPath = argv[2];
+#endif
+    if (!y4mInput.Open(y4mPath)) {
+      printf("Failed to open Y4M input: %s.\n", y4mInput.GetError().c_str());
+      goto done;
+    }
+    const Y4MInfo& info = y4mInput.GetInfo();
+    if (info.monochrome || (info.width & 1) || (info.height & 1)) {
+      printf("Y4M input must be 4:2:0 with an even frame size.\n");
+      goto done;
+    }
+    useY4MInput = true;
+    frameWidth = info.width;
+    frameHeight = info.height;
+    if (info.fpsNum != 0) {
+      fpsNum = info.fpsNum;
+      fpsDen = info.fpsDen;
+    }
+  }
+  frameDuration = 10000000LL * fpsDen / fpsNum;
 
-  // Note the webcam needs to support this media type. 
+  // Note the webcam needs to support this media type.
   // The list of media types supported can be obtained using the ListTypes function in MFUtility.h.
   MFCreateMediaType(&pSrcOutMediaType);
   CHECK_HR(pSrcOutMediaType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video), "Failed to set major video type.");
   CHECK_HR(pSrcOutMediaType->SetGUID(MF_MT_SUBTYPE, WMMEDIASUBTYPE_I420), "Failed to set video sub type to I420.");
-  CHECK_HR(MFSetAttributeRatio(pSrcOutMediaType, MF_MT_FRAME_RATE, OUTPUT_FRAME_RATE, 1), "Failed to set frame rate on source reader out type.");
-  CHECK_HR(MFSetAttributeSize(pSrcOutMediaType, MF_MT_FRAME_SIZE, OUTPUT_FRAME_WIDTH, OUTPUT_FRAME_HEIGHT), "Failed to set frame size.");
+  CHECK_HR(MFSetAttributeRatio(pSrcOutMediaType, MF_MT_FRAME_RATE, fpsNum, fpsDen), "Failed to set frame rate on source reader out type.");
+  CHECK_HR(MFSetAttributeSize(pSrcOutMediaType, MF_MT_FRAME_SIZE, frameWidth, frameHeight), "Failed to set frame size.");
+
+  if (!useY4MInput) {
+    // Get video capture device.
+    CHECK_HR(GetVideoSourceFromDevice(WEBCAM_DEVICE_INDEX, &pVideoSource, &pVideoReader),
+      "Failed to get webcam video source.");
 
-  CHECK_HR(pVideoReader->SetCurrentMediaType(0, NULL, pSrcOutMediaType),
-    "Failed to set media type on source reader.");
+    CHECK_HR(pVideoReader->SetCurrentMediaType(0, NULL, pSrcOutMediaType),
+      "Failed to set media type on source reader.");
+  }
 
   printf("%s\n", GetMediaTypeDescription(pSrcOutMediaType).c_str());
 
@@ -114,11 +388,11 @@ int _tmain(int argc, _TCHAR* argv[])
   MFCreateMediaType(&pMFTOutputMediaType);
   CHECK_HR(pMFTInputMediaType->CopyAllItems(pMFTOutputMediaType), "Error copying media type attributes tfrom mft input type to mft output type.");
   CHECK_HR(pMFTOutputMediaType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264), "Error setting video sub type.");
-  CHECK_HR(pMFTOutputMediaType->SetUINT32(MF_MT_AVG_BITRATE, 240000), "Error setting average bit rate.");
+  CHECK_HR(pMFTOutputMediaType->SetUINT32(MF_MT_AVG_BITRATE, bitrateKbps * 1000), "Error setting average bit rate.");
   CHECK_HR(pMFTOutputMediaType->SetUINT32(MF_MT_INTERLACE_MODE, 2), "Error setting interlace mode.");
   CHECK_HR(MFSetAttributeRatio(pMFTOutputMediaType, MF_MT_MPEG2_PROFILE, eAVEncH264VProfile_Base, 1), "Failed to set profile on H264 MFT out type.");
   //CHECK_HR(pMFTOutputMediaType->SetDouble(MF_MT_MPEG2_LEVEL, 3.1), "Failed to set level on H264 MFT out type.\n");
-  //CHECK_HR(pMFTOutputMediaType->SetUINT32(MF_MT_MAX_KEYFRAME_SPACING, 10), "Failed to set key frame interval on H264 MFT out type.\n");
+  CHECK_HR(pMFTOutputMediaType->SetUINT32(MF_MT_MAX_KEYFRAME_SPACING, MAX_GOP_FRAMES), "Failed to set key frame interval on H264 MFT out type.\n");
   //CHECK_HR(pMFTOutputMediaType->SetUINT32(CODECAPI_AVEncCommonQuality, 100), "Failed to set H264 codec qulaity.\n");
 
   std::cout << "H264 encoder output type: " << GetMediaTypeDescription(pMFTOutputMediaType) << std::endl;
@@ -131,6 +405,16 @@ int _tmain(int argc, _TCHAR* argv[])
   CHECK_HR(pEncoderTransfrom->SetInputType(0, pMFTInputMediaType, 0),
     "Failed to set input media type on H.264 encoder MFT.");
 
+  CHECK_HR(VideoFormatFromMediaType(pMFTInputMediaType, &inputFormat),
+    "Failed to parse H.264 encoder input media type.");
+
+  // Both files are cropped to the source frame size, decoded frames are matched to source frames by timestamp.
+  if (!sourceY4M.Open(SOURCE_Y4M_FILENAME, frameWidth, frameHeight, fpsNum, fpsDen) ||
+    !decodedY4M.Open(DECODED_Y4M_FILENAME, frameWidth, frameHeight, fpsNum, fpsDen)) {
+    printf("Failed to create Y4M output files.\n");
+    goto done;
+  }
+
   CHECK_HR(pEncoderTransfrom->GetInputStatus(0, &mftStatus), "Failed to get input status from H.264 MFT.");
   if (MFT_INPUT_STATUS_ACCEPT_DATA != mftStatus) {
     printf("E: ApplyTransform() pEncoderTransfrom->GetInputStatus() not accept data.\n");
@@ -170,27 +454,56 @@ int _tmain(int argc, _TCHAR* argv[])
   CHECK_HR(pDecoderTransform->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, NULL), "Failed to process BEGIN_STREAMING command on H.264 decoder MFT.");
   CHECK_HR(pDecoderTransform->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, NULL), "Failed to process START_OF_STREAM command on H.264 decoder MFT.");
 
+  // Chain the encoder straight into the decoder. Both MFTs stay owned by this function.
+  CHECK_HR(roundTripChain.AddLink(pEncoderTransfrom, ChainLinkOwnership::Borrowed, MFVideoFormat_H264),
+    "Failed to add H.264 encoder MFT to the round trip chain.");
+  CHECK_HR(roundTripChain.AddLink(pDecoderTransform, ChainLinkOwnership::Borrowed, MFVideoFormat_IYUV),
+    "Failed to add H.264 decoder MFT to the round trip chain.");
+
+  // Record the encoded stream on its way to the decoder, the keyframe index lets players seek without scanning it.
+  // Key frames the encoder inserts on its own restart the scene cut detector's GOP count.
+  roundTripChain.SetTap(0, [&h264Buffer, &keyframeIndex, &sceneCutDetector](IMFSample* pEncoded) {
+    if (MFGetAttributeUINT32(pEncoded, MFSampleExtension_CleanPoint, FALSE)) {
+      sceneCutDetector.OnKeyframeEncoded();
+    }
+    return WriteH264SampleToRecording(pEncoded, &h264Buffer, &keyframeIndex);
+  });
+
+  sceneCutSettings.maxGop = MAX_GOP_FRAMES;
+  sceneCutDetector.SetSettings(sceneCutSettings);
+
+  denoiseSettings.strength = denoiseStrength;
+  denoiser.SetSettings(denoiseSettings);
+
   // Ready to go.
 
-  printf("Reading video samples from webcam.\n");
+  printf(useY4MInput ? "Reading video samples from Y4M input.\n" : "Reading video samples from webcam.\n");
 
-  IMFSample* pVideoSample = NULL, * pH264EncodeOutSample = NULL, * pH264DecodeOutSample = NULL;
+  IMFSample* pVideoSample = NULL;
   DWORD streamIndex = 0, flags = 0, sampleFlags = 0;
   LONGLONG llVideoTimeStamp, llSampleDuration;
   int sampleCount = 0;
-  BOOL h264EncodeTransformFlushed = FALSE;
-  BOOL h264DecodeTransformFlushed = FALSE;
 
-  while (sampleCount <= SAMPLE_COUNT)
+  while (useY4MInput || sampleCount <= SAMPLE_COUNT)
   {
-    CHECK_HR(pVideoReader->ReadSample(
-      MF_SOURCE_READER_FIRST_VIDEO_STREAM,
-      0,                              // Flags.
-      &streamIndex,                   // Receives the actual stream index. 
-      &flags,                         // Receives status flags.
-      &llVideoTimeStamp,              // Receives the time stamp.
-      &pVideoSample                    // Receives the sample or NULL.
-    ), "Error reading video sample.");
+    if (useY4MInput) {
+      // The whole clip is encoded, its timestamps come from the frame rate or the XPTS tags.
+      CHECK_HR(ReadY4MSample(&y4mInput, frameDuration, &pVideoSample), "Error reading Y4M sample.");
+      flags = pVideoSample ? 0 : MF_SOURCE_READERF_ENDOFSTREAM;
+      if (pVideoSample) {
+        pVideoSample->GetSampleTime(&llVideoTimeStamp);
+      }
+    }
+    else {
+      CHECK_HR(pVideoReader->ReadSample(
+        MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+        0,                              // Flags.
+        &streamIndex,                   // Receives the actual stream index.
+        &flags,                         // Receives status flags.
+        &llVideoTimeStamp,              // Receives the time stamp.
+        &pVideoSample                    // Receives the sample or NULL.
+      ), "Error reading video sample.");
+    }
 
     if (flags & MF_SOURCE_READERF_STREAMTICK)
     {
@@ -227,81 +540,141 @@ int _tmain(int argc, _TCHAR* argv[])
 
       printf("Sample count %d, Sample flags %d, sample duration %I64d, sample time %I64d\n", sampleCount, sampleFlags, llSampleDuration, llVideoTimeStamp);
 
-      // Apply the H264 encoder transform
-      CHECK_HR(pEncoderTransfrom->ProcessInput(0, pVideoSample, 0),
-        "The H264 encoder ProcessInput call failed.");
-
-      // ***** H264 ENcoder transform processing loop. *****
-
-      HRESULT getEncoderResult = S_OK;
-      while (getEncoderResult == S_OK) {
+      CHECK_HR(WriteSampleToY4M(pVideoSample, inputFormat, llVideoTimeStamp, &sourceY4M), "Failed to write source sample to Y4M file.");
+
+      // A static scene skips the encoder and decoder entirely. The MS H.264 encoder has no explicit skip
+      // frame, so the previous frame simply lasts longer in the stream and the decoded dumps repeat it.
+      ChangeResult change;
+      CHECK_HR(changeDetector.AnalyzeSample(pVideoSample, inputFormat, &change),
+        "Failed to run static scene detection.");
+      if (change.repeat) {
+        if (pLastDecoded) {
+          CHECK_HR(WriteDecodedSample(pLastDecoded.Get(), llVideoTimeStamp, roundTripChain.GetLink(1).GetOutputFormat(),
+            &outputBuffer, &decodedY4M), "Failed to write repeated sample.");
+        }
+        sampleCount++;
+        SAFE_RELEASE(pVideoSample);
+        continue;
+      }
 
-        getEncoderResult = GetTransformOutput(pEncoderTransfrom, &pH264EncodeOutSample, &h264EncodeTransformFlushed);
+      // Only real scene cuts get an extra IDR. The first frame is an IDR anyway and the encoder
+      // inserts its own at MAX_GOP_FRAMES.
+      SceneCutResult sceneCut;
+      CHECK_HR(sceneCutDetector.AnalyzeSample(pVideoSample, inputFormat, &sceneCut),
+        "Failed to run scene cut detection.");
+      if (sceneCut.sceneCut) {
+        printf("Scene cut (histogram distance %.2f, mean SAD %.1f), requesting a key frame.\n",
+          sceneCut.histogramDistance, sceneCut.meanSad);
+        CHECK_HR(ForceKeyFrame(pEncoderTransfrom), "Failed to force a key frame at a scene cut.");
+      }
 
-        if (getEncoderResult != S_OK && getEncoderResult != MF_E_TRANSFORM_NEED_MORE_INPUT) {
-          printf("Error getting H264 encoder transform output, error code %.2X.\n", getEncoderResult);
-          goto done;
+      // The denoised frame replaces the capture as the encoder input, the new scene after a cut is not
+      // blended with the old one.
+      if (denoiseStrength > 0) {
+        if (sceneCut.sceneCut) {
+          denoiser.Reset();
         }
+        IMFSample* pDenoised = NULL;
+        auto denoiseStart = std::chrono::steady_clock::now();
+        CHECK_HR(denoiser.ProcessSample(pVideoSample, inputFormat, &pDenoised), "Failed to denoise video sample.");
+        denoiseMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - denoiseStart).count();
+        denoiseFrames++;
+        SAFE_RELEASE(pVideoSample);
+        pVideoSample = pDenoised;
+      }
 
-        if (h264EncodeTransformFlushed == TRUE) {
-          // H264 encoder format changed. Clear the capture file and start again.
-          printf("H264 encoder transform flushed stream.\n");
-        }
-        else if (pH264EncodeOutSample != NULL) {
-          printf("Applying decoder transform.\n");
-
-          // Apply the H264 decoder transform
-          CHECK_HR(pDecoderTransform->ProcessInput(0, pH264EncodeOutSample, 0),
-            "The H264 decoder ProcessInput call failed.");
-
-          // ----- H264 DEcoder transform processing loop. -----
-
-          HRESULT getDecoderResult = S_OK;
-          while (getDecoderResult == S_OK) {
-
-            // Apply the H264 decoder transform
-            getDecoderResult = GetTransformOutput(pDecoderTransform, &pH264DecodeOutSample, &h264DecodeTransformFlushed);
-
-            if (getDecoderResult != S_OK && getDecoderResult != MF_E_TRANSFORM_NEED_MORE_INPUT) {
-              printf("Error getting H264 decoder transform output, error code %.2X.\n", getDecoderResult);
-              goto done;
-            }
-
-            if (h264DecodeTransformFlushed == TRUE) {
-              // H264 decoder format changed. Clear the capture file and start again.
-              printf("H264 decoder transform flushed stream.\n");
-              outputBuffer.close();
-              outputBuffer.open(CAPTURE_FILENAME, std::ios::out | std::ios::binary);
-            }
-            else if (pH264DecodeOutSample != NULL) {
-              // Write decoded sample to capture file.
-              CHECK_HR(WriteSampleToFile(pH264DecodeOutSample, &outputBuffer),
-                "Failed to write sample to file.");
-            }
-
-            SAFE_RELEASE(pH264DecodeOutSample);
-          }
-          // -----
+      // Encode and decode in one pass. Each encoded sample is handed to the decoder by reference
+      // and returns to the encoder's sample pool once the decoder has consumed it.
+      decodedSamples.clear();
+      auto roundTripStart = std::chrono::steady_clock::now();
+      HRESULT chainResult = roundTripChain.Process(pVideoSample, decodedSamples);
+      if (FAILED(chainResult)) {
+        printf("Error getting H264 round trip transform output, error code %.2X.\n", chainResult);
+        goto done;
+      }
+      roundTripMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - roundTripStart).count();
+      roundTripFrames++;
 
-        }
+      if (roundTripChain.GetLink(0).OutputFormatChanged()) {
+        printf("H264 encoder transform output format changed.\n");
+      }
 
-        SAFE_RELEASE(pH264EncodeOutSample);
+      if (roundTripChain.GetLink(1).OutputFormatChanged()) {
+        // H264 decoder format changed. Clear the capture file and start again.
+        printf("H264 decoder transform output format changed.\n");
+        outputBuffer.close();
+        outputBuffer.open(CAPTURE_FILENAME, std::ios::out | std::ios::binary);
+      }
+
+      for (auto& decoded : decodedSamples) {
+        // Write decoded sample to capture files, it keeps the timestamp of the source frame it was encoded from.
+        LONGLONG decodedTime = 0;
+        decoded->GetSampleTime(&decodedTime);
+        CHECK_HR(WriteDecodedSample(decoded.Get(), decodedTime, roundTripChain.GetLink(1).GetOutputFormat(), &outputBuffer, &decodedY4M),
+          "Failed to write decoded sample.");
+      }
+      if (!decodedSamples.empty()) {
+        pLastDecoded = decodedSamples.back();
       }
-      // *****
 
       sampleCount++;
 
       // Note: Apart from memory leak issues if the media samples are not released the videoReader->ReadSample
       // blocks when it is unable to allocate a new sample.
       SAFE_RELEASE(pVideoSample);
-      SAFE_RELEASE(pH264EncodeOutSample);
-      SAFE_RELEASE(pH264DecodeOutSample);
     }
   }
 
+  // Frames still held in the encoder's lookahead and the decoder's reorder buffer would otherwise be missing
+  // from the decoded files and show up as unmatched source frames in the quality report.
+  decodedSamples.clear();
+  CHECK_HR(roundTripChain.Drain(decodedSamples), "Failed to drain the H264 round trip chain.");
+  for (auto& decoded : decodedSamples) {
+    LONGLONG decodedTime = 0;
+    decoded->GetSampleTime(&decodedTime);
+    CHECK_HR(WriteDecodedSample(decoded.Get(), decodedTime, roundTripChain.GetLink(1).GetOutputFormat(), &outputBuffer, &decodedY4M),
+      "Failed to write drained sample.");
+  }
+  if (denoiseStrength > 0) {
+    printf("Quality report: VideoQuality %s %ukbps-dn%u=%s,%s\n", SOURCE_Y4M_FILENAME, bitrateKbps, denoiseStrength,
+      DECODED_Y4M_FILENAME, H264_CAPTURE_FILENAME);
+  }
+  else {
+    printf("Quality report: VideoQuality %s %ukbps=%s,%s\n", SOURCE_Y4M_FILENAME, bitrateKbps, DECODED_Y4M_FILENAME, H264_CAPTURE_FILENAME);
+  }
+
 done:
 
+  if (changeDetector.GetStats().frames > 0) {
+    const ChangeDetectorStats& stats = changeDetector.GetStats();
+    double perFrameMs = (roundTripFrames > 0) ? roundTripMs / roundTripFrames : 0;
+    printf("Static scene: %llu of %llu frames repeated, skipped encode/decode saved ~%.1f ms CPU, detection %.3f ms/frame.\n",
+      stats.repeats, stats.frames, perFrameMs * stats.repeats, stats.analyzeMs / stats.frames);
+  }
+
+  if (sceneCutDetector.GetStats().frames > 0) {
+    const SceneCutStats& stats = sceneCutDetector.GetStats();
+    double seconds = static_cast<double>(sampleCount) * fpsDen / fpsNum;
+    double bytes = static_cast<double>(h264Buffer.tellp());
+    printf("Scene cuts: %llu, key frames: %llu (+%llu unrequested), average bit rate %.1f kbps, detection %.3f ms/frame.\n",
+      stats.sceneCuts, stats.keyframes, stats.encoderKeyframes, seconds > 0 ? bytes * 8 / seconds / 1000 : 0, stats.analyzeMs / stats.frames);
+  }
+
+  if (denoiseFrames > 0) {
+    printf("Temporal denoise: strength %u, %.3f ms/frame.\n", denoiseStrength, denoiseMs / denoiseFrames);
+  }
+
+  decodedSamples.clear();
+  pLastDecoded.Reset();
+  roundTripChain.Reset();
+  denoiser.Reset();
+
   outputBuffer.close();
+  h264Buffer.close();
+  keyframeIndex.Close();
+  sourceY4M.Close();
+  decodedY4M.Close();
+  y4mInput.Close();
 
   printf("finished.\n");
   auto c = getchar();
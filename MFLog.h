@@ -0,0 +1,94 @@
+/******************************************************************************
+* Filename: MFLog.h
+*
+* Description:
+* Levelled logging for the Media Foundation helpers. Messages below
+* MFLOG_LEVEL are removed by the preprocessor together with their arguments,
+* so a disabled MFLOG_TRACE in a per-frame path costs nothing. Enabled
+* messages are additionally filtered at run time by MFLogSetLevel before any
+* formatting happens.
+*
+* Define MFLOG_LEVEL (0-5) on the compiler command line to change the
+* compile-time threshold. The default keeps everything up to INFO in release
+* builds and up to DEBUG in debug builds.
+*
+* License: Public Domain (no warranty, use at own risk)
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+
+#define MFLOG_LEVEL_NONE  0
+#define MFLOG_LEVEL_ERROR 1
+#define MFLOG_LEVEL_WARN  2
+#define MFLOG_LEVEL_INFO  3
+#define MFLOG_LEVEL_DEBUG 4
+#define MFLOG_LEVEL_TRACE 5
+
+#ifndef MFLOG_LEVEL
+#ifdef NDEBUG
+#define MFLOG_LEVEL MFLOG_LEVEL_INFO
+#else
+#define MFLOG_LEVEL MFLOG_LEVEL_DEBUG
+#endif
+#endif
+
+/**
+* Sets the run-time threshold. Messages above it are skipped before formatting.
+* Levels compiled out by MFLOG_LEVEL cannot be re-enabled at run time.
+*/
+void MFLogSetLevel(int level);
+int MFLogGetLevel();
+
+extern std::atomic<int> g_MFLogLevel;
+
+/**
+* Returns true if a message at the level would be written. Use it to guard
+* work done only to build a log message.
+*/
+inline bool MFLogEnabled(int level)
+{
+  return level <= g_MFLogLevel.load(std::memory_order_relaxed);
+}
+
+/**
+* Formats and writes a message. Called through the MFLOG_* macros; errors and
+* warnings go to stderr, everything else to stdout.
+*/
+void MFLogWrite(int level, const char* format, ...);
+
+#define MFLOG_AT(level, ...) \
+  do { if (MFLogEnabled(level)) { MFLogWrite(level, __VA_ARGS__); } } while (0)
+
+#define MFLOG_DISABLED(...) do { } while (0)
+
+#if MFLOG_LEVEL >= MFLOG_LEVEL_ERROR
+#define MFLOG_ERROR(...) MFLOG_AT(MFLOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define MFLOG_ERROR(...) MFLOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MFLOG_LEVEL >= MFLOG_LEVEL_WARN
+#define MFLOG_WARN(...) MFLOG_AT(MFLOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define MFLOG_WARN(...) MFLOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MFLOG_LEVEL >= MFLOG_LEVEL_INFO
+#define MFLOG_INFO(...) MFLOG_AT(MFLOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define MFLOG_INFO(...) MFLOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MFLOG_LEVEL >= MFLOG_LEVEL_DEBUG
+#define MFLOG_DEBUG(...) MFLOG_AT(MFLOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define MFLOG_DEBUG(...) MFLOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MFLOG_LEVEL >= MFLOG_LEVEL_TRACE
+#define MFLOG_TRACE(...) MFLOG_AT(MFLOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define MFLOG_TRACE(...) MFLOG_DISABLED(__VA_ARGS__)
+#endif
@@ -1,24 +1,21 @@
 #include "MFTCodecHelper.h"
 #include <mfapi.h>
 #include <mferror.h>
-#include <iostream>
+#include <codecapi.h>
 
 // 构造函数
 MFTCodecHelper::MFTCodecHelper() {
     // 初始化成员变量
     m_pD3D11Device = nullptr;
     m_pD3D11Context = nullptr;
-    m_pH264DecoderMFT = nullptr;
-    m_pH264EncoderMFT = nullptr;
 }
 
 // 析构函数
 MFTCodecHelper::~MFTCodecHelper() {
-    // 释放资源
+    // 编解码器归还共享池，其余资源随之释放
+    ReleaseCodecs();
     m_pD3D11Device = nullptr;
     m_pD3D11Context = nullptr;
-    m_pH264DecoderMFT = nullptr;
-    m_pH264EncoderMFT = nullptr;
 }
 
 // 初始化 MFT 编解码器
@@ -29,39 +26,123 @@ HRESULT MFTCodecHelper::Initialize(ID3D11Device* pD3D11Device) {
     m_pD3D11Device = pD3D11Device;
     m_pD3D11Device->GetImmediateContext(&m_pD3D11Context);
 
-    // 初始化 H264 解码器
-    hr = InitializeH264Decoder();
-    if (FAILED(hr)) {
-        std::cerr << "Failed to initialize H264 decoder." << std::endl;
-        return hr;
-    }
+    // 解码器要等知道码流的分辨率和帧率才能设置类型，由 DecodeH264ToSamples 借出；编码器由 EncodeFrame 借出
+    return hr;
+}
 
-    // 初始化 H264 编码器
-    hr = InitializeH264Encoder();
-    if (FAILED(hr)) {
-        std::cerr << "Failed to initialize H264 encoder." << std::endl;
-        return hr;
+// 归还编解码器
+void MFTCodecHelper::ReleaseCodecs() {
+    m_decoderDriver.Detach();
+    m_decoder.Reset();
+    m_decoderInputFormat = {};
+    m_encoderDriver.Detach();
+    m_encoder.Reset();
+    m_encoderFormat = {};
+    if (m_pEncoderInputPool) {
+        m_pEncoderInputPool->Shutdown();
+        m_pEncoderInputPool.Reset();
     }
+}
 
-    return hr;
+void MFTCodecHelper::ResetDecoder() {
+    if (!m_decoder) return;
+    m_decoderDriver.Flush();
+    m_decoderDriver.Detach();
+    m_decoder.Reset();
+    m_decoderInputFormat = {};
+    m_decoderOutputFormat = {};
 }
 
 // 解码 H264 视频流并生成 GPU 纹理
-HRESULT MFTCodecHelper::DecodeH264ToTexture( ComPtr<IMFSample> pSample, DWORD cbData, ID3D11Texture2D** ppOutputTexture) {
-    HRESULT hr = S_OK;
+HRESULT MFTCodecHelper::DecodeH264ToTexture(ComPtr<IMFSample> pSample, const VideoFormat& format, ID3D11Texture2D** ppOutputTexture) {
+    if (ppOutputTexture == nullptr) return E_POINTER;
+    *ppOutputTexture = nullptr;
+
+    std::vector<ComPtr<IMFSample>> decodedSamples;
+    HRESULT hr = DecodeH264ToSamples(pSample, format, decodedSamples);
+    if (FAILED(hr)) return hr;
+    if (decodedSamples.empty()) return MF_E_TRANSFORM_NEED_MORE_INPUT;
 
-    // TODO: 实现解码逻辑
-    // 1. 将输入数据封装为 IMFSample
-    // 2. 使用 H264 解码器 MFT 处理解码
-    // 3. 将解码后的数据转换为 D3D11 纹理
+    // 一次送入可能产出多帧，只有最新的一帧需要显示
+    return UploadToTexture(decodedSamples.back().Get(), m_decoderOutputFormat, ppOutputTexture);
+}
 
-    return hr;
+// 解码解复用器中的一个访问单元
+HRESULT MFTCodecHelper::DecodeAccessUnitToTexture(H264Demuxer* pDemuxer, size_t index, ID3D11Texture2D** ppOutputTexture) {
+    if (pDemuxer == nullptr || ppOutputTexture == nullptr) return E_POINTER;
+    *ppOutputTexture = nullptr;
+    if (index >= pDemuxer->GetAccessUnitCount()) return E_INVALIDARG;
+
+    ComPtr<IMFMediaType> pType;
+    VideoFormat format = {};
+    HRESULT hr = pDemuxer->CreateMediaType(&pType);
+    if (SUCCEEDED(hr)) hr = VideoFormatFromMediaType(pType.Get(), &format);
+    if (FAILED(hr)) return hr;
+
+    const H264AccessUnit& au = pDemuxer->GetAccessUnit(index);
+    const std::vector<BYTE>& header = pDemuxer->GetSequenceHeader();
+    if (au.keyframe && !header.empty()) {
+        // 参数集单独成一个采样送入，访问单元本身仍直接引用映射内存
+        ComPtr<IMFSample> pHeader;
+        ComPtr<IMFMediaBuffer> pBuffer;
+        BYTE* pData = nullptr;
+        hr = CreateSingleBufferIMFSample(static_cast<DWORD>(header.size()), &pHeader);
+        if (SUCCEEDED(hr)) hr = pHeader->GetBufferByIndex(0, &pBuffer);
+        if (SUCCEEDED(hr)) hr = pBuffer->Lock(&pData, nullptr, nullptr);
+        if (SUCCEEDED(hr)) {
+            memcpy(pData, header.data(), header.size());
+            pBuffer->Unlock();
+            hr = pBuffer->SetCurrentLength(static_cast<DWORD>(header.size()));
+        }
+        if (SUCCEEDED(hr)) hr = pHeader->SetSampleTime(au.sampleTime);
+        if (FAILED(hr)) return hr;
+
+        std::vector<ComPtr<IMFSample>> decodedSamples;
+        hr = DecodeH264ToSamples(pHeader, format, decodedSamples);
+        if (FAILED(hr)) return hr;
+    }
+
+    ComPtr<IMFSample> pSample;
+    hr = pDemuxer->CreateSample(index, &pSample);
+    if (FAILED(hr)) return hr;
+    return DecodeH264ToTexture(pSample, format, ppOutputTexture);
+}
+
+// 解码 H264 采样，输出未压缩帧
+HRESULT MFTCodecHelper::DecodeH264ToSamples(ComPtr<IMFSample> pSample, const VideoFormat& format,
+    std::vector<ComPtr<IMFSample>>& outputSamples) {
+    HRESULT hr = S_OK;
+    // 码流分辨率变了（切换相机或采集模式）：归还旧解码器，按新类型借出
+    if (m_decoder && (m_decoderInputFormat.width != format.width || m_decoderInputFormat.height != format.height)) {
+        ResetDecoder();
+    }
+    if (!m_decoder) {
+        hr = InitializeH264Decoder(format);
+        if (FAILED(hr)) return hr;
+    }
+
+    // 驱动取出这个采样能产出的全部帧；流变化时在驱动内完成输出类型重设
+    hr = m_decoderDriver.Process(pSample.Get(), outputSamples);
+    if (m_decoderDriver.OutputFormatChanged()) {
+        m_decoderOutputFormat = m_decoderDriver.GetOutputFormat();
+    }
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to decode H264 sample: 0x%08lx", hr);
+        return hr;
+    }
+    return S_OK;
 }
 
 // 编码 GPU 纹理为 MP4 文件
 HRESULT MFTCodecHelper::EncodeTextureToMP4(ID3D11Texture2D* pInputTexture, const std::wstring& outputFilePath) {
     HRESULT hr = S_OK;
 
+    // 编码器在第一次录像时才从共享池借出
+    if (!m_encoder) {
+        hr = InitializeH264Encoder(m_decoderOutputFormat);
+        if (FAILED(hr)) return hr;
+    }
+
     // TODO: 实现编码逻辑
     // 1. 将输入纹理转换为 IMFSample
     // 2. 使用 H264 编码器 MFT 处理编码
@@ -70,79 +151,396 @@ HRESULT MFTCodecHelper::EncodeTextureToMP4(ID3D11Texture2D* pInputTexture, const
     return hr;
 }
 
-// 初始化 H264 解码器
-HRESULT MFTCodecHelper::InitializeH264Decoder() {
+// 编码一帧：准备编码器输入，必要时借出编码器，再由驱动送入并取出已就绪的输出
+HRESULT MFTCodecHelper::EncodeFrame(IMFSample* pFrame, const VideoFormat& format, std::vector<ComPtr<IMFSample>>& outputSamples) {
+    ComPtr<IMFSample> pInput;
+    VideoFormat inputFormat = {};
+    HRESULT hr = PrepareEncoderInput(pFrame, format, &pInput, &inputFormat);
+    if (FAILED(hr)) return hr;
+
+    if (!m_encoder || !IsSameVideoFormat(inputFormat, m_encoderFormat)) {
+        // 输入格式变了：旧编码器中的帧先取出，再按新格式借出
+        if (m_encoder) {
+            hr = DrainEncoder(outputSamples);
+            if (FAILED(hr)) return hr;
+            m_encoderDriver.Detach();
+            m_encoder.Reset();
+        }
+
+        hr = InitializeH264Encoder(inputFormat);
+        if (SUCCEEDED(hr)) hr = m_encoder->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+        if (SUCCEEDED(hr)) hr = m_encoder->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+        if (SUCCEEDED(hr)) hr = m_encoderDriver.Attach(m_encoder.Get(), MFVideoFormat_H264);
+        // 池中复用的编码器不一定从 IDR 开始
+        if (SUCCEEDED(hr)) hr = RequestEncoderKeyframe();
+        if (FAILED(hr)) {
+            MFLOG_ERROR("Failed to start H264 encoder: 0x%08lx", hr);
+            m_encoderDriver.Detach();
+            m_encoder.Reset();
+            return hr;
+        }
+        m_encoderFormat = inputFormat;
+    }
+
+    hr = m_encoderDriver.Process(pInput.Get(), outputSamples);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to encode frame: 0x%08lx", hr);
+        return hr;
+    }
+    return S_OK;
+}
+
+HRESULT MFTCodecHelper::DrainEncoder(std::vector<ComPtr<IMFSample>>& outputSamples) {
+    if (!m_encoder) return S_OK;
+    return m_encoderDriver.Drain(outputSamples);
+}
+
+HRESULT MFTCodecHelper::GetEncoderOutputType(IMFMediaType** ppType) {
+    if (ppType == nullptr) return E_POINTER;
+    *ppType = nullptr;
+    if (!m_encoder) return MF_E_NOT_INITIALIZED;
+    return m_encoder->GetOutputCurrentType(0, ppType);
+}
+
+// 旋转后的画面与旋转前的参考帧无关：降噪不能再与旧参考混合，场景切换检测把下一帧当作首帧，由它请求关键帧
+void MFTCodecHelper::SetEncoderOrientation(FrameOrientation orientation) {
+    if (orientation == m_encoderOrientation) return;
+    m_encoderOrientation = orientation;
+    m_denoiser.Reset();
+    m_sceneCutDetector.Reset();
+}
+
+// 编码器输入：转换位深、场景切换检测、时域降噪
+HRESULT MFTCodecHelper::PrepareEncoderInput(IMFSample* pFrame, const VideoFormat& format, IMFSample** ppEncoderInput,
+    VideoFormat* pInputFormat) {
+    if (pFrame == nullptr || ppEncoderInput == nullptr) return E_POINTER;
+    *ppEncoderInput = nullptr;
+
     HRESULT hr = S_OK;
-    IUnknown* spDecTransformUnk = NULL;
-    CHECK_HR(CoCreateInstance(CLSID_CMSH264DecoderMFT, NULL, CLSCTX_INPROC_SERVER,IID_IUnknown, (void**)&spDecTransformUnk), 
-    "Failed to create H264 decoder MFT.");
-    
-    CHECK_HR(spDecTransformUnk->QueryInterface(IID_PPV_ARGS(&pDecoderTransform)),
-        "Failed to get IMFTransform interface from H264 decoder MFT object.");
-    
-      MFCreateMediaType(&pDecInputMediaType);
-      CHECK_HR(pMFTOutputMediaType->CopyAllItems(pDecInputMediaType), "Error copying media type attributes to decoder input media type.");
-      CHECK_HR(pDecoderTransform->SetInputType(0, pDecInputMediaType, 0), "Failed to set input media type on H.264 decoder MFT.");
-    
-      MFCreateMediaType(&pDecOutputMediaType);
-      CHECK_HR(pMFTInputMediaType->CopyAllItems(pDecOutputMediaType), "Error copying media type attributes to decoder output media type.");
-      CHECK_HR(pDecoderTransform->SetOutputType(0, pDecOutputMediaType, 0), "Failed to set output media type on H.264 decoder MFT.");
-    
-      CHECK_HR(pDecoderTransform->GetInputStatus(0, &mftStatus), "Failed to get input status from H.264 decoder MFT.");
-      if (MFT_INPUT_STATUS_ACCEPT_DATA != mftStatus) {
-        printf("H.264 decoder MFT is not accepting data.\n");
-        return E_FAIL;
-      }
-      CHECK_HR(pDecoderTransform->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, NULL), "Failed to process FLUSH command on H.264 decoder MFT.");
-      CHECK_HR(pDecoderTransform->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, NULL), "Failed to process BEGIN_STREAMING command on H.264 decoder MFT.");
-      CHECK_HR(pDecoderTransform->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, NULL), "Failed to process START_OF_STREAM command on H.264 decoder MFT.");
-   
-    return hr;
+    ComPtr<IMFSample> pInput;
+    VideoFormat inputFormat = format;
+    if (format.subtype == VideoSubtype::NV12) {
+        pInput = pFrame;
+    }
+    else {
+        hr = ConvertToNV12(pFrame, format, &pInput);
+        if (FAILED(hr)) return hr;
+        inputFormat = m_encoderInputFormat;
+    }
+
+    if (m_encoderOrientation != FrameOrientation::Identity) {
+        ComPtr<IMFSample> pRotated;
+        hr = m_encoderRotator.RotateSample(pInput.Get(), inputFormat, m_encoderOrientation, &pRotated);
+        if (FAILED(hr)) return hr;
+        pInput = pRotated;
+        inputFormat = m_encoderRotator.GetOutputFormat();
+    }
+
+    // 先在原始帧上检测场景切换，切换处丢弃降噪参考，新场景的第一帧不与旧画面混合
+    bool sceneCut = false;
+    hr = DetectSceneCut(pInput.Get(), inputFormat, &sceneCut);
+    if (FAILED(hr)) return hr;
+
+    if (m_denoiseEncoderInput) {
+        if (sceneCut) m_denoiser.Reset();
+        ComPtr<IMFSample> pDenoised;
+        hr = m_denoiser.ProcessSample(pInput.Get(), inputFormat, &pDenoised);
+        if (FAILED(hr)) return hr;
+        pInput = pDenoised;
+    }
+
+    if (pInputFormat) *pInputFormat = inputFormat;
+    *ppEncoderInput = pInput.Detach();
+    return S_OK;
 }
 
-// 初始化 H264 编码器
-HRESULT MFTCodecHelper::InitializeH264Encoder() {
+// 10 位帧转成编码器输入的 NV12
+HRESULT MFTCodecHelper::ConvertToNV12(IMFSample* pFrame, const VideoFormat& format, IMFSample** ppOutput) {
+    if (!BitDepthConverter::IsSupported(format.subtype)) return MF_E_INVALIDMEDIATYPE;
+
     HRESULT hr = S_OK;
 
-    // 创建 H264 编码器 MFT
-    hr = CoCreateInstance(CLSID_CMSH264EncoderMFT, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&m_pH264EncoderMFT));
-    if (FAILED(hr)) {
-        std::cerr << "Failed to create H264 encoder MFT." << std::endl;
-        return hr;
+    // 源尺寸变化时重建 NV12 描述，池中缓冲大小随之调整
+    if (!m_pEncoderInputPool || m_encoderInputFormat.width != format.width || m_encoderInputFormat.height != format.height) {
+        ComPtr<IMFMediaType> pType;
+        hr = MFCreateMediaType(&pType);
+        if (FAILED(hr)) return hr;
+        hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+        if (FAILED(hr)) return hr;
+        hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+        if (FAILED(hr)) return hr;
+        hr = MFSetAttributeSize(pType.Get(), MF_MT_FRAME_SIZE, format.width, format.height);
+        if (FAILED(hr)) return hr;
+        hr = VideoFormatFromMediaType(pType.Get(), &m_encoderInputFormat);
+        if (FAILED(hr)) return hr;
+
+        if (m_pEncoderInputPool) m_pEncoderInputPool->Reconfigure(m_encoderInputFormat.frameBytes, 16);
+        else hr = SamplePool::Create(m_encoderInputFormat.frameBytes, 16, 4, &m_pEncoderInputPool);
+        if (FAILED(hr)) return hr;
     }
 
-    // 设置编码器输入类型
-    hr = MFCreateMediaType(&m_pEncoderInputType);
+    ComPtr<IMFMediaBuffer> pSrcBuffer;
+    ComPtr<IMFSample> pOutput;
+    ComPtr<IMFMediaBuffer> pDstBuffer;
+    hr = pFrame->ConvertToContiguousBuffer(&pSrcBuffer);
+    if (FAILED(hr)) return hr;
+    hr = m_pEncoderInputPool->AcquireSample(&pOutput);
+    if (FAILED(hr)) return hr;
+    hr = pOutput->GetBufferByIndex(0, &pDstBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pSrc = nullptr;
+    BYTE* pDst = nullptr;
+    DWORD cbSrc = 0, cbDstMax = 0;
+    hr = pSrcBuffer->Lock(&pSrc, nullptr, &cbSrc);
+    if (FAILED(hr)) return hr;
+    hr = pDstBuffer->Lock(&pDst, &cbDstMax, nullptr);
+    if (SUCCEEDED(hr)) {
+        ImagePlanes src, dst;
+        hr = ImagePlanesFromBuffer(format, pSrc, cbSrc, &src);
+        if (SUCCEEDED(hr)) hr = ImagePlanesFromBuffer(m_encoderInputFormat, pDst, cbDstMax, &dst);
+        if (SUCCEEDED(hr)) hr = m_bitDepthConverter.ConvertToNV12(src, dst);
+        pDstBuffer->Unlock();
+    }
+    pSrcBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    hr = pDstBuffer->SetCurrentLength(m_encoderInputFormat.frameBytes);
+    if (FAILED(hr)) return hr;
+
+    LONGLONG value = 0;
+    if (SUCCEEDED(pFrame->GetSampleTime(&value))) pOutput->SetSampleTime(value);
+    if (SUCCEEDED(pFrame->GetSampleDuration(&value))) pOutput->SetSampleDuration(value);
+
+    *ppOutput = pOutput.Detach();
+    return S_OK;
+}
+
+// 场景切换检测，需要关键帧时通知编码器
+HRESULT MFTCodecHelper::DetectSceneCut(IMFSample* pFrame, const VideoFormat& format, bool* pSceneCut) {
+    SceneCutResult result;
+    HRESULT hr = m_sceneCutDetector.AnalyzeSample(pFrame, format, &result);
+    if (FAILED(hr)) return hr;
+    *pSceneCut = result.sceneCut;
+
+    // 检测器的首帧、场景切换或到达 maxGop；编码器还没借出时由 EncodeFrame 在借出后请求
+    if (result.keyframe && m_encoder) {
+        hr = RequestEncoderKeyframe();
+    }
+    return hr;
+}
+
+HRESULT MFTCodecHelper::ConfigureEncoderGop() {
+    ComPtr<ICodecAPI> pCodecApi;
+    HRESULT hr = m_encoder->QueryInterface(IID_PPV_ARGS(&pCodecApi));
+    if (FAILED(hr)) return hr;
+
+    VARIANT value;
+    VariantInit(&value);
+    value.vt = VT_UI4;
+    value.ulVal = m_sceneCutDetector.GetSettings().maxGop;
+    return pCodecApi->SetValue(&CODECAPI_AVEncMPVGOPSize, &value);
+}
+
+HRESULT MFTCodecHelper::RequestEncoderKeyframe() {
+    ComPtr<ICodecAPI> pCodecApi;
+    HRESULT hr = m_encoder->QueryInterface(IID_PPV_ARGS(&pCodecApi));
     if (FAILED(hr)) return hr;
 
-    hr = m_pEncoderInputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    VARIANT value;
+    VariantInit(&value);
+    value.vt = VT_UI4;
+    value.ulVal = 1;
+    return pCodecApi->SetValue(&CODECAPI_AVEncVideoForceKeyFrame, &value);
+}
+
+// 初始化 H264 解码器：按采集格式设置输入/输出类型，从共享池借出类型相同的实例
+HRESULT MFTCodecHelper::InitializeH264Decoder(const VideoFormat& format) {
+    HRESULT hr = CreateDecoderMediaTypes(format);
     if (FAILED(hr)) return hr;
 
-    hr = m_pEncoderInputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+    // 键由输入（H264）和输出（NV12）类型的分辨率、帧率组成，不同码流的相机不会借到彼此的实例
+    MFTPoolKey key = MFTPoolKey::FromMediaTypes(CLSID_CMSH264DecoderMFT, m_pDecoderInputType.Get(), m_pDecoderOutputType.Get());
+    hr = MFTPool::Shared().Acquire(key, [this](IMFTransform** ppDecoder) { return CreateH264Decoder(ppDecoder); },
+        MFTPool::EstimateDecoderBytes(format.width, format.height), &m_decoder);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to acquire H264 decoder MFT: 0x%08lx", hr);
+        return hr;
+    }
+
+    // 新建和复用的实例媒体类型都已设置好，从当前输出类型取格式
+    ComPtr<IMFMediaType> pCurrentOutputType;
+    hr = m_decoder->GetOutputCurrentType(0, &pCurrentOutputType);
+    if (SUCCEEDED(hr)) hr = VideoFormatFromMediaType(pCurrentOutputType.Get(), &m_decoderOutputFormat);
+    if (SUCCEEDED(hr)) hr = m_decoder->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, 0);
+    if (SUCCEEDED(hr)) hr = m_decoder->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+    if (SUCCEEDED(hr)) hr = m_decoder->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+    // 解码输出从池中分配，调用方释放后回收，不再每帧新建缓冲
+    if (SUCCEEDED(hr)) {
+        m_decoderDriver.SetOutputPoolSize(4);
+        hr = m_decoderDriver.Attach(m_decoder.Get(), m_decoderOutputFormat.subtypeGuid);
+    }
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to start H264 decoder MFT: 0x%08lx", hr);
+        m_decoderDriver.Detach();
+        m_decoder.Reset();
+        m_decoderOutputFormat = {};
+        return hr;
+    }
+    m_decoderInputFormat = format;
+    return S_OK;
+}
+
+// 解码器输入为 H264，输出 NV12，分辨率和帧率取自采集格式；流中的实际尺寸变化由 TransformDriver 重设输出类型
+HRESULT MFTCodecHelper::CreateDecoderMediaTypes(const VideoFormat& format) {
+    UINT32 fpsNum = format.fpsNum ? format.fpsNum : 25;
+    UINT32 fpsDen = format.fpsDen ? format.fpsDen : 1;
+
+    m_pDecoderInputType.Reset();
+    HRESULT hr = MFCreateMediaType(&m_pDecoderInputType);
+    if (SUCCEEDED(hr)) hr = m_pDecoderInputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (SUCCEEDED(hr)) hr = m_pDecoderInputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeSize(m_pDecoderInputType.Get(), MF_MT_FRAME_SIZE, format.width, format.height);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeRatio(m_pDecoderInputType.Get(), MF_MT_FRAME_RATE, fpsNum, fpsDen);
+    if (SUCCEEDED(hr)) hr = m_pDecoderInputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create H264 decoder input type: 0x%08lx", hr);
+        return hr;
+    }
+
+    m_pDecoderOutputType.Reset();
+    hr = MFCreateMediaType(&m_pDecoderOutputType);
+    if (SUCCEEDED(hr)) hr = m_pDecoderOutputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (SUCCEEDED(hr)) hr = m_pDecoderOutputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeSize(m_pDecoderOutputType.Get(), MF_MT_FRAME_SIZE, format.width, format.height);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeRatio(m_pDecoderOutputType.Get(), MF_MT_FRAME_RATE, fpsNum, fpsDen);
+    if (SUCCEEDED(hr)) hr = m_pDecoderOutputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create H264 decoder output type: 0x%08lx", hr);
+        return hr;
+    }
+    return hr;
+}
+
+// 新建 H264 解码器实例并设置 InitializeH264Decoder 准备好的媒体类型（池中没有可复用实例时调用）
+HRESULT MFTCodecHelper::CreateH264Decoder(IMFTransform** ppDecoder) {
+    ComPtr<IMFTransform> pDecoder;
+    HRESULT hr = CoCreateInstance(CLSID_CMSH264DecoderMFT, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pDecoder));
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create H264 decoder MFT: 0x%08lx", hr);
+        return hr;
+    }
+
+    // 解码器要求先设置输入类型
+    hr = pDecoder->SetInputType(0, m_pDecoderInputType.Get(), 0);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to set input type for H264 decoder MFT: 0x%08lx", hr);
+        return hr;
+    }
+
+    hr = pDecoder->SetOutputType(0, m_pDecoderOutputType.Get(), 0);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to set output type for H264 decoder MFT: 0x%08lx", hr);
+        return hr;
+    }
+
+    *ppDecoder = pDecoder.Detach();
+    return S_OK;
+}
+
+// 初始化 H264 编码器
+HRESULT MFTCodecHelper::InitializeH264Encoder(const VideoFormat& format) {
+    HRESULT hr = CreateEncoderMediaTypes(format);
     if (FAILED(hr)) return hr;
 
-    hr = m_pH264EncoderMFT->SetInputType(0, m_pEncoderInputType.Get(), 0);
+    // 键由输入/输出类型（NV12 / H264 的分辨率、帧率）加码率和 GOP 组成，不同配置的相机不会借到彼此的实例
+    UINT32 config[2] = { m_encoderBitrate, m_sceneCutDetector.GetSettings().maxGop };
+    UINT32 configHash = 2166136261u;
+    for (size_t i = 0; i < sizeof(config); i++) {
+        configHash ^= reinterpret_cast<const BYTE*>(config)[i];
+        configHash *= 16777619u;
+    }
+    MFTPoolKey key = MFTPoolKey::FromMediaTypes(CLSID_CMSH264EncoderMFT, m_pEncoderInputType.Get(),
+        m_pEncoderOutputType.Get(), configHash);
+
+    hr = MFTPool::Shared().Acquire(key, [this](IMFTransform** ppEncoder) { return CreateH264Encoder(ppEncoder); },
+        MFTPool::EstimateEncoderBytes(format.width, format.height), &m_encoder);
     if (FAILED(hr)) {
-        std::cerr << "Failed to set input type for H264 encoder MFT." << std::endl;
+        MFLOG_ERROR("Failed to acquire H264 encoder MFT.");
+        return hr;
+    }
+
+    // 借到的实例 GOP 与键一致，新建实例在这里设置
+    hr = ConfigureEncoderGop();
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to set H264 encoder GOP size.");
+        return hr;
+    }
+    return hr;
+}
+
+// 编码器输入为 NV12（10 位帧先经 PrepareEncoderInput 转换），输出 H264，分辨率和帧率取自 format
+HRESULT MFTCodecHelper::CreateEncoderMediaTypes(const VideoFormat& format) {
+    UINT32 fpsNum = format.fpsNum ? format.fpsNum : 25;
+    UINT32 fpsDen = format.fpsDen ? format.fpsDen : 1;
+
+    // 设置编码器输入类型
+    m_pEncoderInputType.Reset();
+    HRESULT hr = MFCreateMediaType(&m_pEncoderInputType);
+    if (SUCCEEDED(hr)) hr = m_pEncoderInputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (SUCCEEDED(hr)) hr = m_pEncoderInputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeSize(m_pEncoderInputType.Get(), MF_MT_FRAME_SIZE, format.width, format.height);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeRatio(m_pEncoderInputType.Get(), MF_MT_FRAME_RATE, fpsNum, fpsDen);
+    if (SUCCEEDED(hr)) hr = m_pEncoderInputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    // 解码输出和池化采样的行跨度可能大于宽度
+    if (SUCCEEDED(hr) && format.stride[0] > 0) hr = m_pEncoderInputType->SetUINT32(MF_MT_DEFAULT_STRIDE, format.stride[0]);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create H264 encoder input type: 0x%08lx", hr);
         return hr;
     }
 
     // 设置编码器输出类型
+    m_pEncoderOutputType.Reset();
     hr = MFCreateMediaType(&m_pEncoderOutputType);
-    if (FAILED(hr)) return hr;
+    if (SUCCEEDED(hr)) hr = m_pEncoderOutputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    if (SUCCEEDED(hr)) hr = m_pEncoderOutputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeSize(m_pEncoderOutputType.Get(), MF_MT_FRAME_SIZE, format.width, format.height);
+    if (SUCCEEDED(hr)) hr = MFSetAttributeRatio(m_pEncoderOutputType.Get(), MF_MT_FRAME_RATE, fpsNum, fpsDen);
+    if (SUCCEEDED(hr)) hr = m_pEncoderOutputType->SetUINT32(MF_MT_AVG_BITRATE, m_encoderBitrate);
+    if (SUCCEEDED(hr)) hr = m_pEncoderOutputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create H264 encoder output type: 0x%08lx", hr);
+        return hr;
+    }
+    return hr;
+}
 
-    hr = m_pEncoderOutputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
-    if (FAILED(hr)) return hr;
+// 新建 H264 编码器实例并设置 InitializeH264Encoder 准备好的媒体类型（池中没有可复用实例时调用）
+HRESULT MFTCodecHelper::CreateH264Encoder(IMFTransform** ppEncoder) {
+    HRESULT hr = S_OK;
+    ComPtr<IMFTransform> pEncoder;
 
-    hr = m_pEncoderOutputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
-    if (FAILED(hr)) return hr;
+    // 创建 H264 编码器 MFT
+    hr = CoCreateInstance(CLSID_CMSH264EncoderMFT, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pEncoder));
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create H264 encoder MFT.");
+        return hr;
+    }
 
-    hr = m_pH264EncoderMFT->SetOutputType(0, m_pEncoderOutputType.Get(), 0);
+    // H264 编码器要求先设置输出类型
+    hr = pEncoder->SetOutputType(0, m_pEncoderOutputType.Get(), 0);
     if (FAILED(hr)) {
-        std::cerr << "Failed to set output type for H264 encoder MFT." << std::endl;
+        MFLOG_ERROR("Failed to set output type for H264 encoder MFT.");
         return hr;
     }
 
+    hr = pEncoder->SetInputType(0, m_pEncoderInputType.Get(), 0);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to set input type for H264 encoder MFT.");
+        return hr;
+    }
+
+    *ppEncoder = pEncoder.Detach();
     return hr;
 }
 
@@ -162,13 +560,74 @@ HRESULT MFTCodecHelper::CreateD3D11Texture(UINT width, UINT height, DXGI_FORMAT
 
     hr = m_pD3D11Device->CreateTexture2D(&desc, nullptr, ppTexture);
     if (FAILED(hr)) {
-        std::cerr << "Failed to create D3D11 texture." << std::endl;
+        MFLOG_ERROR("Failed to create D3D11 texture.");
         return hr;
     }
 
     return hr;
 }
 
+// 把一帧 NV12 / P010 解码输出上传为同格式的纹理；UpdateSubresource 要求色度平面紧接在亮度平面之后
+HRESULT MFTCodecHelper::UploadToTexture(IMFSample* pFrame, const VideoFormat& format, ID3D11Texture2D** ppTexture) {
+    DXGI_FORMAT textureFormat = DXGI_FORMAT_UNKNOWN;
+    if (format.subtype == VideoSubtype::NV12) textureFormat = DXGI_FORMAT_NV12;
+    else if (format.subtype == VideoSubtype::P010) textureFormat = DXGI_FORMAT_P010;
+    else return MF_E_INVALIDMEDIATYPE;
+    if (!m_pD3D11Device || !m_pD3D11Context) return MF_E_NOT_INITIALIZED;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = format.width;
+    desc.Height = format.height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = textureFormat;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    ComPtr<ID3D11Texture2D> pTexture;
+    HRESULT hr = m_pD3D11Device->CreateTexture2D(&desc, nullptr, &pTexture);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create decoded frame texture: 0x%08lx", hr);
+        return hr;
+    }
+
+    ComPtr<IMFMediaBuffer> pBuffer;
+    BYTE* pData = nullptr;
+    DWORD cbData = 0;
+    hr = pFrame->ConvertToContiguousBuffer(&pBuffer);
+    if (SUCCEEDED(hr)) hr = pBuffer->Lock(&pData, nullptr, &cbData);
+    if (FAILED(hr)) return hr;
+
+    ImagePlanes planes = {};
+    hr = ImagePlanesFromBuffer(format, pData, cbData, &planes);
+    if (SUCCEEDED(hr)) {
+        const BYTE* pSource = planes.data[0];
+        UINT pitch = static_cast<UINT>(planes.stride[0]);
+        if (planes.data[1] != planes.data[0] + static_cast<size_t>(pitch) * format.height || planes.stride[1] != planes.stride[0]) {
+            // 解码器按对齐后的高度排列平面，逐行拼成紧凑布局
+            size_t rowBytes = static_cast<size_t>(format.width) * format.bytesPerSample;
+            UINT32 chromaRows = (format.height + 1) / 2;
+            m_uploadBuffer.resize(rowBytes * (format.height + chromaRows));
+            BYTE* pDst = m_uploadBuffer.data();
+            for (UINT32 y = 0; y < format.height; y++, pDst += rowBytes) {
+                memcpy(pDst, planes.data[0] + static_cast<ptrdiff_t>(y) * planes.stride[0], rowBytes);
+            }
+            for (UINT32 y = 0; y < chromaRows; y++, pDst += rowBytes) {
+                memcpy(pDst, planes.data[1] + static_cast<ptrdiff_t>(y) * planes.stride[1], rowBytes);
+            }
+            pSource = m_uploadBuffer.data();
+            pitch = static_cast<UINT>(rowBytes);
+        }
+        m_pD3D11Context->UpdateSubresource(pTexture.Get(), 0, nullptr, pSource, pitch, 0);
+    }
+    pBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    *ppTexture = pTexture.Detach();
+    return S_OK;
+}
+
 // 处理 MFT 输出
 HRESULT MFTCodecHelper::ProcessMFTOutput(IMFTransform* pMFT, IMFSample** ppOutputSample) {
     HRESULT hr = S_OK;
@@ -203,7 +662,7 @@ HRESULT MFTCodecHelper::ProcessMFTOutput(IMFTransform* pMFT, IMFSample** ppOutpu
     }
 
     if (FAILED(hr)) {
-        std::cerr << "Failed to process MFT output." << std::endl;
+        MFLOG_ERROR("Failed to process MFT output.");
         SAFE_RELEASE(*ppOutputSample);
         return hr;
     }
@@ -5,11 +5,19 @@
 #include <wrl.h>
 #include <d3d11.h>
 #include <string>
+#include <vector>
 #include <initguid.h>
 #include <wmcodecdsp.h>
 #include <mfreadwrite.h>
 #include <mfobjects.h>
 #include "MFUtility.h"
+#include "MFTPool.h"
+#include "TransformDriver.h"
+#include "BitDepthConverter.h"
+#include "SceneCutDetector.h"
+#include "TemporalDenoiser.h"
+#include "FrameRotator.h"
+#include "H264Demuxer.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -22,24 +30,91 @@ public:
     MFTCodecHelper();
     ~MFTCodecHelper();
 
-    // 初始化MFT编解码器
+    // 初始化MFT编解码器：解码器在第一次解码时按码流格式从共享池借出，编码器在第一次编码时借出
     HRESULT Initialize(ID3D11Device* pD3D11Device);
 
-    // 解码H264视频流并生成GPU纹理
-    HRESULT DecodeH264ToTexture( ComPtr<IMFSample> pSample, DWORD cbData, ID3D11Texture2D** ppOutputTexture);
+    // 把编解码器冲刷后归还共享池，供其它相机复用
+    void ReleaseCodecs();
+
+    // 解码H264采样并把最新的一帧上传为 GPU 纹理（NV12 / P010，仅作着色器资源）；
+    // 解码器还没有输出时返回 MF_E_TRANSFORM_NEED_MORE_INPUT。format 含义同 DecodeH264ToSamples
+    HRESULT DecodeH264ToTexture(ComPtr<IMFSample> pSample, const VideoFormat& format, ID3D11Texture2D** ppOutputTexture);
+
+    // 解码录像中的第 index 个访问单元：采样零拷贝地引用映射文件，关键帧之前先送入 SPS/PPS
+    // （MP4 的参数集只在 avcC 中）。按显示顺序依次调用，或从 FindKeyframe 找到的关键帧开始
+    HRESULT DecodeAccessUnitToTexture(H264Demuxer* pDemuxer, size_t index, ID3D11Texture2D** ppOutputTexture);
+
+    // 解码H264采样，输出解码器当前能产出的全部未压缩帧。format 为码流的分辨率和帧率（采集格式），
+    // 第一次调用或分辨率改变时按它借出解码器
+    HRESULT DecodeH264ToSamples(ComPtr<IMFSample> pSample, const VideoFormat& format,
+        std::vector<ComPtr<IMFSample>>& outputSamples);
+
+    // 解码器当前输出格式，流变化时更新，逐帧代码从这里读取分辨率和行跨度
+    const VideoFormat& GetDecoderOutputFormat() const { return m_decoderOutputFormat; }
+
+    // 输入码流格式改变（切换到分辨率不同的相机）时归还解码器，下一次解码重新借出并设置
+    void ResetDecoder();
+
+    // 编码器只接受 8 位 NV12：10 位帧（P010/I010）抖动转换成 NV12 写入池化采样，NV12 帧原样返回（增加引用）；
+    // 设置了安装方向时旋转到池化采样（90/270 度时宽高互换）；
+    // 同时做场景切换检测，检测到切换（或到达最大 GOP）时向编码器请求 IDR；启用降噪时返回降噪后的帧。
+    // pInputFormat 不为空时返回编码器输入帧的格式
+    HRESULT PrepareEncoderInput(IMFSample* pFrame, const VideoFormat& format, IMFSample** ppEncoderInput,
+        VideoFormat* pInputFormat = nullptr);
+
+    // 编码一帧未压缩帧（NV12/P010/I010）：经 PrepareEncoderInput 处理后送入 H264 编码器，输出编码器已产出的全部采样。
+    // 编码器在第一帧按准备好的输入格式从共享池借出，输入格式变化（分辨率、旋转）时重新借出，借出后的首帧编码为 IDR
+    HRESULT EncodeFrame(IMFSample* pFrame, const VideoFormat& format, std::vector<ComPtr<IMFSample>>& outputSamples);
+
+    // 流结束：取出编码器中剩余的采样
+    HRESULT DrainEncoder(std::vector<ComPtr<IMFSample>>& outputSamples);
+
+    // 编码器当前输出类型（H264，含序列头），供直通写入器使用；还没有编码过任何帧时返回 MF_E_NOT_INITIALIZED
+    HRESULT GetEncoderOutputType(IMFMediaType** ppType);
+
+    // 编码前的时域降噪，默认关闭；低照度下压低噪声占用的码率
+    void SetEncoderDenoise(bool enable, const TemporalDenoiseSettings& settings = TemporalDenoiseSettings()) {
+        m_denoiseEncoderInput = enable;
+        m_denoiser.SetSettings(settings);
+        if (!enable) m_denoiser.Reset();
+    }
+
+    // 编码器输入的旋转 / 翻转，默认不旋转。方向改变时丢弃降噪参考并让下一帧编码为 IDR；
+    // 90/270 度交换宽高时 EncodeFrame 还会按新尺寸重新借出编码器
+    void SetEncoderOrientation(FrameOrientation orientation);
+
+    // 编码码率（bit/s），在下一次借出编码器时生效
+    void SetEncoderBitrate(UINT32 bitrate) { m_encoderBitrate = bitrate; }
+
+    // 场景切换阈值和最大 GOP；最大 GOP 在下一次借出编码器时生效
+    void SetSceneCutSettings(const SceneCutSettings& settings) { m_sceneCutDetector.SetSettings(settings); }
+    const SceneCutStats& GetSceneCutStats() const { return m_sceneCutDetector.GetStats(); }
 
     // 编码GPU纹理为MP4文件
     HRESULT EncodeTextureToMP4(ID3D11Texture2D* pInputTexture, const std::wstring& outputFilePath);
 
 private:
-    // 初始化H264解码器
-    HRESULT InitializeH264Decoder();
+    // 按 format 的分辨率和帧率设置解码器类型（H264 输入、NV12 输出），从共享池借出类型匹配的H264解码器，
+    // 池中没有匹配实例时调用 CreateH264Decoder
+    HRESULT InitializeH264Decoder(const VideoFormat& format);
+    HRESULT CreateDecoderMediaTypes(const VideoFormat& format);
+    HRESULT CreateH264Decoder(IMFTransform** ppDecoder);
+
+    // 按 format 的分辨率和帧率设置编码器类型，从共享池借出类型、码率和 GOP 都匹配的H264编码器，
+    // 池中没有匹配实例时调用 CreateH264Encoder
+    HRESULT InitializeH264Encoder(const VideoFormat& format);
+    HRESULT CreateEncoderMediaTypes(const VideoFormat& format);
+    HRESULT CreateH264Encoder(IMFTransform** ppEncoder);
 
-    // 初始化H264编码器
-    HRESULT InitializeH264Encoder();
+    // 通过 ICodecAPI 设置编码器 GOP / 请求下一帧编码为关键帧
+    HRESULT ConfigureEncoderGop();
+    HRESULT RequestEncoderKeyframe();
+    HRESULT DetectSceneCut(IMFSample* pFrame, const VideoFormat& format, bool* pSceneCut);
+    HRESULT ConvertToNV12(IMFSample* pFrame, const VideoFormat& format, IMFSample** ppOutput);
 
     // 创建D3D11纹理
     HRESULT CreateD3D11Texture(UINT width, UINT height, DXGI_FORMAT format, ID3D11Texture2D** ppTexture);
+    HRESULT UploadToTexture(IMFSample* pFrame, const VideoFormat& format, ID3D11Texture2D** ppTexture);
 
     // 处理MFT输出
     HRESULT ProcessMFTOutput(IMFTransform* pMFT, IMFSample** ppOutputSample);
@@ -48,16 +123,29 @@ private:
     ComPtr<ID3D11DeviceContext> m_pD3D11Context;
 
     // 解码相关
-    ComPtr<IMFMediaType> pMFTOutputMediaType;
-    ComPtr<IMFTransform> pDecoderTransform=NULL;
-    ComPtr<IMFMediaType> pDecInputMediaType=NULL;
-    ComPtr<IMFMediaType> pDecOutputMediaType=NULL;
-    DWORD mftStatus = 0;
+    MFTLease m_decoder;
+    TransformDriver m_decoderDriver;    // 缓存输出流信息，批量送入/取出
+    ComPtr<IMFMediaType> m_pDecoderInputType;
+    ComPtr<IMFMediaType> m_pDecoderOutputType;
+    VideoFormat m_decoderInputFormat = {};          // 解码器当前按此码流格式设置
+    VideoFormat m_decoderOutputFormat = {};
+    std::vector<BYTE> m_uploadBuffer;               // 解码帧平面不连续时拼成纹理要求的布局
 
     // 编码相关
-    ComPtr<IMFTransform> m_pH264EncoderMFT;
-    ComPtr<IMFMediaType> pMFTOutputMediaType;
+    MFTLease m_encoder;
+    TransformDriver m_encoderDriver;
+    VideoFormat m_encoderFormat = {};               // 编码器当前按此输入格式设置
+    ComPtr<IMFMediaType> m_pEncoderInputType;
     ComPtr<IMFMediaType> m_pEncoderOutputType;
+    UINT32 m_encoderBitrate = 8000000;
+    BitDepthConverter m_bitDepthConverter;          // 10 位帧转编码器输入
+    ComPtr<SamplePool> m_pEncoderInputPool;
+    VideoFormat m_encoderInputFormat = {};
+    SceneCutDetector m_sceneCutDetector;            // 只在真正的场景切换处插入 IDR
+    FrameRotator m_encoderRotator;
+    FrameOrientation m_encoderOrientation = FrameOrientation::Identity;
+    TemporalDenoiser m_denoiser;
+    bool m_denoiseEncoderInput = false;
     ComPtr<IMFSinkWriter> m_pSinkWriter;
     DWORD m_videoStreamIndex;
 };
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "MFTPool.h"
+#include "VideoFormat.h"
+#include "MFLog.h"
+#include <iterator>
+
+MFTPoolKey MFTPoolKey::FromMediaTypes(REFCLSID clsid, IMFMediaType* pInputType, IMFMediaType* pOutputType, UINT32 config) {
+    MFTPoolKey key;
+    key.clsid = clsid;
+    key.config = config;
+
+    VideoFormat format = {};
+    if (pInputType && SUCCEEDED(VideoFormatFromMediaType(pInputType, &format))) key.inputFormat = format.hash;
+    if (pOutputType && SUCCEEDED(VideoFormatFromMediaType(pOutputType, &format))) key.outputFormat = format.hash;
+    return key;
+}
+
+MFTLease& MFTLease::operator=(MFTLease&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        m_pPool = other.m_pPool;
+        m_key = other.m_key;
+        m_pTransform = std::move(other.m_pTransform);
+        m_bytes = other.m_bytes;
+        m_fresh = other.m_fresh;
+        other.m_pPool = nullptr;
+        other.m_bytes = 0;
+        other.m_fresh = false;
+    }
+    return *this;
+}
+
+void MFTLease::Reset() {
+    if (m_pPool && m_pTransform) {
+        m_pPool->Release(m_key, m_pTransform, m_bytes);
+    }
+    m_pTransform.Reset();
+    m_pPool = nullptr;
+    m_bytes = 0;
+    m_fresh = false;
+}
+
+MFTPool::MFTPool() {}
+
+MFTPool::~MFTPool() {
+    Trim();
+}
+
+MFTPool& MFTPool::Shared() {
+    static MFTPool pool;
+    return pool;
+}
+
+void MFTPool::SetMemoryBudget(size_t bytes) {
+    std::list<IdleEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_memoryBudget = bytes;
+        EvictLocked(evicted);
+    }
+}
+
+size_t MFTPool::GetMemoryBudget() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryBudget;
+}
+
+HRESULT MFTPool::Acquire(const MFTPoolKey& key, const Factory& factory, size_t estimatedBytes, MFTLease* pLease) {
+    if (pLease == nullptr || !factory) return E_POINTER;
+    pLease->Reset();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+            if (it->key == key) {
+                pLease->m_pTransform = std::move(it->pTransform);
+                pLease->m_bytes = it->bytes;
+                m_idleBytes -= it->bytes;
+                m_idle.erase(it);
+
+                m_activeBytes += pLease->m_bytes;
+                m_activeCount++;
+                m_stats.hits++;
+                pLease->m_pPool = this;
+                pLease->m_key = key;
+                pLease->m_fresh = false;
+                return S_OK;
+            }
+        }
+        m_stats.misses++;
+    }
+
+    // 创建实例较慢（加载 DLL、枚举硬件），不持锁
+    auto start = std::chrono::steady_clock::now();
+    ComPtr<IMFTransform> pTransform;
+    HRESULT hr = factory(&pTransform);
+    double createMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::list<IdleEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (FAILED(hr) || !pTransform) {
+            m_stats.creationFailures++;
+            return FAILED(hr) ? hr : E_UNEXPECTED;
+        }
+        m_stats.totalCreateMs += createMs;
+        if (createMs > m_stats.maxCreateMs) m_stats.maxCreateMs = createMs;
+        m_activeBytes += estimatedBytes;
+        m_activeCount++;
+
+        // 新实例计入预算后，必要时释放最久未用的空闲实例
+        EvictLocked(evicted);
+    }
+
+    pLease->m_pPool = this;
+    pLease->m_key = key;
+    pLease->m_pTransform = pTransform;
+    pLease->m_bytes = estimatedBytes;
+    pLease->m_fresh = true;
+    return S_OK;
+}
+
+void MFTPool::Release(const MFTPoolKey& key, ComPtr<IMFTransform>& pTransform, size_t bytes) {
+    // 冲刷掉上一个流残留的数据，下一个使用者从干净状态开始
+    HRESULT hr = pTransform->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, 0);
+    if (SUCCEEDED(hr)) hr = pTransform->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+
+    std::list<IdleEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_activeBytes -= bytes;
+        m_activeCount--;
+
+        // 冲刷失败的实例状态不可信，不再复用
+        if (FAILED(hr)) {
+            MFLOG_WARN("Discarding pooled MFT that failed to flush: 0x%08lx.", hr);
+            return;
+        }
+
+        IdleEntry entry;
+        entry.key = key;
+        entry.pTransform = std::move(pTransform);
+        entry.bytes = bytes;
+        entry.lastUsed = std::chrono::steady_clock::now();
+        m_idle.push_front(std::move(entry));
+        m_idleBytes += bytes;
+
+        EvictLocked(evicted);
+    }
+    pTransform.Reset();
+}
+
+void MFTPool::EvictLocked(std::list<IdleEntry>& evicted) {
+    // 从链表尾部（最久未用）开始释放，直到总量回到预算内；实例在调用方出锁后析构
+    while (!m_idle.empty() && m_idleBytes + m_activeBytes > m_memoryBudget) {
+        MFLOG_DEBUG("Evicting idle MFT of %zu bytes, pool over its memory budget.", m_idle.back().bytes);
+        m_idleBytes -= m_idle.back().bytes;
+        evicted.splice(evicted.end(), m_idle, std::prev(m_idle.end()));
+        m_stats.evictions++;
+    }
+}
+
+void MFTPool::Trim() {
+    std::list<IdleEntry> evicted;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    evicted.swap(m_idle);
+    m_idleBytes = 0;
+}
+
+MFTPoolStats MFTPool::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MFTPoolStats stats = m_stats;
+    stats.idleInstances = m_idle.size();
+    stats.activeInstances = m_activeCount;
+    stats.estimatedBytes = m_idleBytes + m_activeBytes;
+    return stats;
+}
+
+size_t MFTPool::EstimateDecoderBytes(UINT32 width, UINT32 height) {
+    // NV12 帧，H.264 最多 16 个参考帧加输出队列
+    size_t frameBytes = static_cast<size_t>(width) * height * 3 / 2;
+    return frameBytes * 18;
+}
+
+size_t MFTPool::EstimateEncoderBytes(UINT32 width, UINT32 height) {
+    // 输入帧、重建帧、参考帧及码流缓冲
+    size_t frameBytes = static_cast<size_t>(width) * height * 3 / 2;
+    return frameBytes * 6;
+}
+
+size_t MFTPool::DefaultMemoryBudget() {
+    return 2 * (EstimateDecoderBytes(3840, 2160) + EstimateEncoderBytes(3840, 2160));
+}
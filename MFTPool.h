@@ -0,0 +1,129 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <utility>
+
+using namespace Microsoft::WRL;
+
+// 池中实例的身份：同一 CLSID、相同输入/输出格式和配置的 MFT 可以互相替代
+struct MFTPoolKey {
+    CLSID clsid = GUID_NULL;
+    UINT64 inputFormat = 0;     // 输入类型的 VideoFormat::hash，未设置类型时为 0
+    UINT64 outputFormat = 0;    // 输出类型的 VideoFormat::hash
+    UINT32 config = 0;          // 调用方定义的额外配置（码率、低延迟等）的哈希
+
+    // 按 MFT 的输入/输出媒体类型生成键，类型可以为空
+    static MFTPoolKey FromMediaTypes(REFCLSID clsid, IMFMediaType* pInputType, IMFMediaType* pOutputType, UINT32 config = 0);
+
+    bool operator==(const MFTPoolKey& other) const {
+        return IsEqualGUID(clsid, other.clsid) && inputFormat == other.inputFormat &&
+            outputFormat == other.outputFormat && config == other.config;
+    }
+};
+
+struct MFTPoolStats {
+    UINT64 hits = 0;            // 复用空闲实例
+    UINT64 misses = 0;          // 需要新建实例
+    UINT64 creationFailures = 0;
+    UINT64 evictions = 0;       // 因内存预算被释放的空闲实例
+    double totalCreateMs = 0.0; // 新建实例（含设置媒体类型）累计耗时
+    double maxCreateMs = 0.0;
+    size_t idleInstances = 0;
+    size_t activeInstances = 0;
+    size_t estimatedBytes = 0;  // 全部实例（空闲 + 使用中）的估算内存
+};
+
+class MFTPool;
+
+// 从池中借出的 MFT，析构时自动冲刷并归还
+class MFTLease {
+public:
+    MFTLease() = default;
+    ~MFTLease() { Reset(); }
+    MFTLease(const MFTLease&) = delete;
+    MFTLease& operator=(const MFTLease&) = delete;
+    MFTLease(MFTLease&& other) noexcept { *this = std::move(other); }
+    MFTLease& operator=(MFTLease&& other) noexcept;
+
+    IMFTransform* Get() const { return m_pTransform.Get(); }
+    IMFTransform* operator->() const { return m_pTransform.Get(); }
+    explicit operator bool() const { return m_pTransform != nullptr; }
+
+    // 是否为新建实例（新建实例需要调用方完成一次性配置）
+    bool IsFresh() const { return m_fresh; }
+
+    // 归还给池
+    void Reset();
+
+private:
+    friend class MFTPool;
+    MFTPool* m_pPool = nullptr;
+    MFTPoolKey m_key;
+    ComPtr<IMFTransform> m_pTransform;
+    size_t m_bytes = 0;
+    bool m_fresh = false;
+};
+
+// 进程内共享的编解码 MFT 池
+// 实例在第一次需要时才创建，归还时冲刷后进入空闲列表，供其它 CameraCapture 复用；
+// 空闲实例按最久未用顺序在超出内存预算时释放，使用中的实例不受影响
+class MFTPool {
+public:
+    using Factory = std::function<HRESULT(IMFTransform** ppTransform)>;
+
+    MFTPool();
+    ~MFTPool();
+
+    // 所有 CameraCapture 共享的池
+    static MFTPool& Shared();
+
+    // 内存预算（字节），默认 DefaultMemoryBudget()。预算包括借出中的实例，
+    // 小于一对编解码器的估计值时归还的实例会立即被逐出，池就不再复用任何实例
+    void SetMemoryBudget(size_t bytes);
+    size_t GetMemoryBudget() const;
+
+    // 借出一个与 key 匹配的实例：有空闲实例则直接复用，否则调用 factory 新建
+    // estimatedBytes 为该实例占用内存的估计值，用于预算统计
+    HRESULT Acquire(const MFTPoolKey& key, const Factory& factory, size_t estimatedBytes, MFTLease* pLease);
+
+    // 释放全部空闲实例
+    void Trim();
+
+    MFTPoolStats GetStats() const;
+
+    // 按分辨率估算编解码实例的内存：解码器含参考帧队列，编码器含输入/重建帧
+    static size_t EstimateDecoderBytes(UINT32 width, UINT32 height);
+    static size_t EstimateEncoderBytes(UINT32 width, UINT32 height);
+
+    // 默认预算：两对 4K（3840x2160）解码器 + 编码器的估计值（约 600MB），
+    // 一台 4K 相机在用的同时，切换相机或模式时归还的另一对实例也能留在池中
+    static size_t DefaultMemoryBudget();
+
+private:
+    friend class MFTLease;
+
+    struct IdleEntry {
+        MFTPoolKey key;
+        ComPtr<IMFTransform> pTransform;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
+    void Release(const MFTPoolKey& key, ComPtr<IMFTransform>& pTransform, size_t bytes);
+    void EvictLocked(std::list<IdleEntry>& evicted);
+
+    mutable std::mutex m_mutex;
+    std::list<IdleEntry> m_idle;    // 最近归还的在前
+    size_t m_memoryBudget = DefaultMemoryBudget();
+    size_t m_idleBytes = 0;
+    size_t m_activeBytes = 0;
+    size_t m_activeCount = 0;
+    MFTPoolStats m_stats;
+};
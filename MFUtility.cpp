@@ -0,0 +1,1081 @@
+/******************************************************************************
+* Filename: MFUtility.cpp
+*
+* Description:
+* Definitions of the helper functions declared in MFUtility.h. Compiled once
+* into the MFUtility library so every source can include the header.
+*
+* License: Public Domain (no warranty, use at own risk)
+*******************************************************************************/
+
+#include "MFUtility.h"
+
+#include <cstdarg>
+
+std::atomic<int> g_MFLogLevel(MFLOG_LEVEL);
+
+void MFLogSetLevel(int level)
+{
+  g_MFLogLevel.store(level, std::memory_order_relaxed);
+}
+
+int MFLogGetLevel()
+{
+  return g_MFLogLevel.load(std::memory_order_relaxed);
+}
+
+void MFLogWrite(int level, const char* format, ...)
+{
+  static const char* const levelNames[] = { "", "ERROR", "WARN", "INFO", "DEBUG", "TRACE" };
+  FILE* stream = (level <= MFLOG_LEVEL_WARN) ? stderr : stdout;
+
+  // Format into one buffer so lines from different threads don't interleave.
+  char message[1024];
+  int prefix = snprintf(message, sizeof(message), "[%s] ", levelNames[level >= 0 && level <= MFLOG_LEVEL_TRACE ? level : 0]);
+
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message + prefix, sizeof(message) - prefix, format, args);
+  va_end(args);
+
+  fprintf(stream, "%s\n", message);
+}
+
+// Address-constant table, initialised statically without running any code.
+extern const GUIDNameEntry g_GUIDNameTable[] =
+{
+#define MF_GUID_NAME_ENTRY(g) { &g, #g },
+  MF_GUID_NAME_LIST(MF_GUID_NAME_ENTRY)
+#undef MF_GUID_NAME_ENTRY
+};
+
+extern const UINT32 GUID_NAME_TABLE_SIZE = sizeof(g_GUIDNameTable) / sizeof(g_GUIDNameTable[0]);
+
+// Open addressing hash slots, a power of two at least twice the table size so probes stay short.
+static const UINT32 GUID_NAME_HASH_SLOTS = 512;
+static_assert(GUID_NAME_HASH_SLOTS >= 2 * GUID_NAME_TABLE_SIZE, "Increase GUID_NAME_HASH_SLOTS.");
+
+static UINT32 HashGUID(const GUID& guid)
+{
+  // The MFVideoFormat/MFAudioFormat GUIDs share Data2..Data4 and differ only in Data1,
+  // while attribute GUIDs are random, so fold all 128 bits together.
+  const UINT32* p = reinterpret_cast<const UINT32*>(&guid);
+  UINT32 h = p[0] * 0x9E3779B1u;
+  h ^= (p[1] + 0x7F4A7C15u) * 0x85EBCA77u;
+  h ^= (p[2] + 0x165667B1u) * 0xC2B2AE3Du;
+  h ^= (p[3] + 0x27D4EB2Fu) * 0x27D4EB2Du;
+  return h ^ (h >> 15);
+}
+
+std::string WStrToStr(LPCWSTR lpwstr) {
+    int size = WideCharToMultiByte(CP_ACP, 0, lpwstr, -1, NULL, 0, NULL, NULL);
+    std::string str(size, 0);
+    WideCharToMultiByte(CP_ACP, 0, lpwstr, -1, &str[0], size, NULL, NULL);
+    return str;
+}
+
+LPCSTR GetGUIDNameConst(const GUID& guid)
+{
+  struct HashIndex
+  {
+    UINT16 slots[GUID_NAME_HASH_SLOTS]; // index + 1 into g_GUIDNameTable, 0 for empty.
+
+    HashIndex() : slots()
+    {
+      for (UINT32 i = 0; i < GUID_NAME_TABLE_SIZE; i++)
+      {
+        UINT32 slot = HashGUID(*g_GUIDNameTable[i].pGuid) & (GUID_NAME_HASH_SLOTS - 1);
+        bool duplicate = false;
+        while (slots[slot] != 0)
+        {
+          // Keep the first name for aliased GUIDs, matching the order of MF_GUID_NAME_LIST.
+          if (*g_GUIDNameTable[slots[slot] - 1].pGuid == *g_GUIDNameTable[i].pGuid)
+          {
+            duplicate = true;
+            break;
+          }
+          slot = (slot + 1) & (GUID_NAME_HASH_SLOTS - 1);
+        }
+        if (!duplicate)
+        {
+          slots[slot] = static_cast<UINT16>(i + 1);
+        }
+      }
+    }
+  };
+  static const HashIndex index;
+
+  UINT32 slot = HashGUID(guid) & (GUID_NAME_HASH_SLOTS - 1);
+  while (index.slots[slot] != 0)
+  {
+    const GUIDNameEntry& entry = g_GUIDNameTable[index.slots[slot] - 1];
+    if (*entry.pGuid == guid)
+    {
+      return entry.name;
+    }
+    slot = (slot + 1) & (GUID_NAME_HASH_SLOTS - 1);
+  }
+  return NULL;
+}
+
+std::string GetMediaTypeDescription(IMFMediaType* pMediaType)
+{
+  HRESULT hr = S_OK;
+  GUID MajorType;
+  UINT32 cAttrCount;
+  LPCSTR pszGuidStr;
+  std::string description;
+  WCHAR TempBuf[200];
+
+  if (pMediaType == NULL)
+  {
+    description = "<NULL>";
+    goto done;
+  }
+
+  hr = pMediaType->GetMajorType(&MajorType);
+  CHECKHR_GOTO(hr, done);
+
+  //pszGuidStr = STRING_FROM_GUID(MajorType);
+  pszGuidStr = GetGUIDNameConst(MajorType);
+  if (pszGuidStr != NULL)
+  {
+    description += pszGuidStr;
+    description += ": ";
+  }
+  else
+  {
+    description += "Other: ";
+  }
+
+  hr = pMediaType->GetCount(&cAttrCount);
+  CHECKHR_GOTO(hr, done);
+
+  for (UINT32 i = 0; i < cAttrCount; i++)
+  {
+    GUID guidId;
+    MF_ATTRIBUTE_TYPE attrType;
+
+    hr = pMediaType->GetItemByIndex(i, &guidId, NULL);
+    CHECKHR_GOTO(hr, done);
+
+    hr = pMediaType->GetItemType(guidId, &attrType);
+    CHECKHR_GOTO(hr, done);
+
+    //pszGuidStr = STRING_FROM_GUID(guidId);
+    pszGuidStr = GetGUIDNameConst(guidId);
+    if (pszGuidStr != NULL)
+    {
+      description += pszGuidStr;
+    }
+    else
+    {
+      LPOLESTR guidStr = NULL;
+
+      CHECKHR_GOTO(StringFromCLSID(guidId, &guidStr), done);
+      auto wGuidStr = std::wstring(guidStr);
+      description += std::string(wGuidStr.begin(), wGuidStr.end()); // GUID's won't have wide chars.
+
+      CoTaskMemFree(guidStr);
+    }
+
+    description += "=";
+
+    switch (attrType)
+    {
+    case MF_ATTRIBUTE_UINT32:
+    {
+      UINT32 Val;
+      hr = pMediaType->GetUINT32(guidId, &Val);
+      CHECKHR_GOTO(hr, done);
+
+      description += std::to_string(Val);
+      break;
+    }
+    case MF_ATTRIBUTE_UINT64:
+    {
+      UINT64 Val;
+      hr = pMediaType->GetUINT64(guidId, &Val);
+      CHECKHR_GOTO(hr, done);
+
+      if (guidId == MF_MT_FRAME_SIZE)
+      {
+        description += "W:" + std::to_string(HI32(Val)) + " H: " + std::to_string(LO32(Val));
+      }
+      else if (guidId == MF_MT_FRAME_RATE)
+      {
+        // Frame rate is numerator/denominator.
+        description += std::to_string(HI32(Val)) + "/" + std::to_string(LO32(Val));
+      }
+      else if (guidId == MF_MT_PIXEL_ASPECT_RATIO)
+      {
+        description += std::to_string(HI32(Val)) + ":" + std::to_string(LO32(Val));
+      }
+      else
+      {
+        //tempStr.Format("%ld", Val);
+        description += std::to_string(Val);
+      }
+
+      //description += tempStr;
+
+      break;
+    }
+    case MF_ATTRIBUTE_DOUBLE:
+    {
+      DOUBLE Val;
+      hr = pMediaType->GetDouble(guidId, &Val);
+      CHECKHR_GOTO(hr, done);
+
+      //tempStr.Format("%f", Val);
+      description += std::to_string(Val);
+      break;
+    }
+    case MF_ATTRIBUTE_GUID:
+    {
+      GUID Val;
+      const char* pValStr;
+
+      hr = pMediaType->GetGUID(guidId, &Val);
+      CHECKHR_GOTO(hr, done);
+
+      //pValStr = STRING_FROM_GUID(Val);
+      pValStr = GetGUIDNameConst(Val);
+      if (pValStr != NULL)
+      {
+        description += pValStr;
+      }
+      else
+      {
+        LPOLESTR guidStr = NULL;
+        CHECKHR_GOTO(StringFromCLSID(Val, &guidStr), done);
+        auto wGuidStr = std::wstring(guidStr);
+        description += std::string(wGuidStr.begin(), wGuidStr.end()); // GUID's won't have wide chars.
+
+        CoTaskMemFree(guidStr);
+      }
+
+      break;
+    }
+    case MF_ATTRIBUTE_STRING:
+    {
+      hr = pMediaType->GetString(guidId, TempBuf, sizeof(TempBuf) / sizeof(TempBuf[0]), NULL);
+      if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER))
+      {
+        description += "<Too Long>";
+        break;
+      }
+      CHECKHR_GOTO(hr, done);
+      auto wstr = std::wstring(TempBuf);
+      description += std::string(wstr.begin(), wstr.end()); // It's unlikely the attribute descriptions will contain multi byte chars.
+
+      break;
+    }
+    case MF_ATTRIBUTE_BLOB:
+    {
+      description += "<BLOB>";
+      break;
+    }
+    case MF_ATTRIBUTE_IUNKNOWN:
+    {
+      description += "<UNK>";
+      break;
+    }
+    }
+
+    description += ", ";
+  }
+
+done:
+
+  return description;
+}
+
+std::string GetVideoTypeDescriptionBrief(IMFMediaType* pMediaType)
+{
+  std::string description = " ";
+  GUID subType;
+  UINT32 width = 0, height = 0, fpsNum = 0, fpsDen = 0;
+
+  if (pMediaType == NULL) {
+    description = " <NULL>";
+  }
+  else {
+    CHECK_HR(pMediaType->GetGUID(MF_MT_SUBTYPE, &subType), "Failed to get video sub type.");
+    CHECK_HR(MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &width, &height), "Failed to get MF_MT_FRAME_SIZE attribute.");
+    CHECK_HR(MFGetAttributeRatio(pMediaType, MF_MT_FRAME_RATE, &fpsNum, &fpsDen), "Failed to get MF_MT_FRAME_RATE attribute.");
+
+    description += GetGUIDNameConst(subType);
+    description += ", " + std::to_string(width) + "x" + std::to_string(height) + ", " + std::to_string(fpsNum) + "/" + std::to_string(fpsDen) + "fps";
+  }
+
+done:
+
+  return description;
+}
+
+HRESULT FindMatchingVideoType(IMFMediaTypeHandler* pMediaTypeHandler, const GUID& pixelFormat, uint32_t width, uint32_t height, uint32_t fps, IMFMediaType* pOutMediaType)
+{
+  HRESULT hr = S_FALSE;
+  DWORD mediaTypeCount = 0;
+  GUID subType;
+  UINT32 w = 0, h = 0, fpsNum = 0, fpsDen = 0;
+
+  CHECK_HR(pMediaTypeHandler->GetMediaTypeCount(&mediaTypeCount),
+    "Failed to get sink media type count.");
+
+  for (int i = 0; i < mediaTypeCount; i++) {
+    IMFMediaType* pMediaType = NULL;
+    CHECK_HR(pMediaTypeHandler->GetMediaTypeByIndex(i, &pMediaType), "Failed to get media type.");
+
+    CHECK_HR(pMediaType->GetGUID(MF_MT_SUBTYPE, &subType), "Failed to get video sub type.");
+    CHECK_HR(MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &w, &h), "Failed to get MF_MT_FRAME_SIZE attribute.");
+    CHECK_HR(MFGetAttributeRatio(pMediaType, MF_MT_FRAME_RATE, &fpsNum, &fpsDen), "Failed to get MF_MT_FRAME_RATE attribute.");
+
+    if(IsEqualGUID(pixelFormat, subType) && w == width && h == height && fps == fpsNum && fpsDen == 1) {
+      CHECK_HR(pMediaType->CopyAllItems(pOutMediaType), "Error copying media type attributes.");
+      SAFE_RELEASE(pMediaType);
+      hr = S_OK;
+      break;
+    }
+    else {
+      SAFE_RELEASE(pMediaType);
+    }
+  }
+
+done:
+  return hr;
+}
+
+HRESULT ListMediaTypes(IMFMediaTypeHandler* pMediaTypeHandler)
+{
+  HRESULT hr = S_OK;
+  DWORD mediaTypeCount = 0;
+
+  hr = pMediaTypeHandler->GetMediaTypeCount(&mediaTypeCount);
+  CHECK_HR(hr, "Failed to get sink media type count.");
+
+  std::cout << "Sink media type count: " << mediaTypeCount << "." << std::endl;
+
+  for (int i = 0; i < mediaTypeCount; i++) {
+    IMFMediaType* pMediaType = NULL;
+    hr = pMediaTypeHandler->GetMediaTypeByIndex(i, &pMediaType);
+    CHECK_HR(hr, "Failed to get media type.");
+
+    std::cout << "Media type " << i << ": " << std::endl;
+    std::cout << GetMediaTypeDescription(pMediaType) << std::endl;
+
+    SAFE_RELEASE(pMediaType);
+  }
+
+done:
+  return hr;
+}
+
+void ListModes(IMFSourceReader* pReader, bool brief)
+{
+  HRESULT hr = NULL;
+  DWORD dwMediaTypeIndex = 0;
+
+  while (SUCCEEDED(hr))
+  {
+    IMFMediaType* pType = NULL;
+    hr = pReader->GetNativeMediaType(0, dwMediaTypeIndex, &pType);
+    if (hr == MF_E_NO_MORE_TYPES)
+    {
+      hr = S_OK;
+      break;
+    }
+    else if (SUCCEEDED(hr))
+    {
+      if (!brief) {
+        std::cout << GetMediaTypeDescription(pType) << std::endl;
+      }
+      else {
+        std::cout << GetVideoTypeDescriptionBrief(pType) << std::endl;
+      }
+
+      pType->Release();
+    }
+    ++dwMediaTypeIndex;
+  }
+}
+
+HRESULT ListCaptureDevices(DeviceType deviceType)
+{
+  IMFAttributes* pDeviceAttributes = NULL;
+  IMFActivate** ppDevices = NULL;
+  UINT32 deviceCount = 0;
+
+  HRESULT hr = S_OK;
+
+  hr = MFCreateAttributes(&pDeviceAttributes, 1);
+  CHECK_HR(hr, "Error creating device attributes.");
+
+  if (deviceType == DeviceType::Audio) {
+    // Request audio capture devices.
+    hr = pDeviceAttributes->SetGUID(
+      MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE,
+      MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_AUDCAP_GUID);
+    CHECK_HR(hr, "Error initialising audio configuration object.");
+  }
+  else {
+    // Request video capture devices.
+    hr = pDeviceAttributes->SetGUID(
+      MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE,
+      MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID);
+    CHECK_HR(hr, "Error initialising video configuration object.");
+  }
+
+  hr = MFEnumDeviceSources(pDeviceAttributes, &ppDevices, &deviceCount);
+  CHECK_HR(hr, "Error enumerating devices.");
+
+  wprintf(L"Device count %d.\n", deviceCount);
+
+  for (UINT i = 0; i < deviceCount; i++) {
+
+    LPWSTR friendlyName = NULL;
+    UINT32 friendlyNameLength = 0;
+    IMFMediaSource* pMediaSource = NULL;
+    IMFSourceReader* pSourceReader = NULL;
+
+    hr = ppDevices[i]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &friendlyName, &friendlyNameLength);
+    CHECK_HR(hr, "Error retrieving device friendly name.");
+
+    wprintf(L"Device name: %s\n", friendlyName);
+
+    hr = ppDevices[i]->ActivateObject(IID_PPV_ARGS(&pMediaSource));
+    CHECK_HR(hr, "Error activating device media source.");
+
+    hr = MFCreateSourceReaderFromMediaSource(
+      pMediaSource,
+      NULL,
+      &pSourceReader);
+    CHECK_HR(hr, "Error creating device source reader.");
+
+    ListModes(pSourceReader);
+
+    CoTaskMemFree(friendlyName);
+    SAFE_RELEASE(pMediaSource);
+    SAFE_RELEASE(pSourceReader);
+  }
+
+done:
+
+  SAFE_RELEASE(pDeviceAttributes);
+  CoTaskMemFree(ppDevices);
+
+  return hr;
+}
+
+HRESULT ListVideoDevicesWithBriefFormat()
+{
+  IMFAttributes* pDeviceAttributes = NULL;
+  IMFActivate** ppDevices = NULL;
+  UINT32 deviceCount = 0;
+
+  HRESULT hr = S_OK;
+
+  hr = MFCreateAttributes(&pDeviceAttributes, 1);
+  CHECK_HR(hr, "Error creating device attributes.");
+
+    // Request video capture devices.
+    hr = pDeviceAttributes->SetGUID(
+      MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE,
+      MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID);
+    CHECK_HR(hr, "Error initialising video configuration object.");
+
+  hr = MFEnumDeviceSources(pDeviceAttributes, &ppDevices, &deviceCount);
+  CHECK_HR(hr, "Error enumerating devices.");
+
+  wprintf(L"Device count %d.\n", deviceCount);
+
+  for (UINT i = 0; i < deviceCount; i++) {
+
+    LPWSTR friendlyName = NULL;
+    UINT32 friendlyNameLength = 0;
+    IMFMediaSource* pMediaSource = NULL;
+    IMFSourceReader* pSourceReader = NULL;
+
+    hr = ppDevices[i]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &friendlyName, &friendlyNameLength);
+    CHECK_HR(hr, "Error retrieving device friendly name.");
+
+    wprintf(L"Device name: %s\n", friendlyName);
+
+    hr = ppDevices[i]->ActivateObject(IID_PPV_ARGS(&pMediaSource));
+    CHECK_HR(hr, "Error activating device media source.");
+
+    hr = MFCreateSourceReaderFromMediaSource(
+      pMediaSource,
+      NULL,
+      &pSourceReader);
+    CHECK_HR(hr, "Error creating device source reader.");
+
+    ListModes(pSourceReader, true);
+
+    CoTaskMemFree(friendlyName);
+    SAFE_RELEASE(pMediaSource);
+    SAFE_RELEASE(pSourceReader);
+  }
+
+done:
+
+  SAFE_RELEASE(pDeviceAttributes);
+  CoTaskMemFree(ppDevices);
+
+  return hr;
+}
+
+HRESULT ListAudioOutputDevices()
+{
+  HRESULT hr = S_OK;
+
+  IMMDeviceEnumerator* pEnum = NULL;      // Audio device enumerator.
+  IMMDeviceCollection* pDevices = NULL;   // Audio device collection.
+  IMMDevice* pDevice = NULL;              // An audio device.
+  UINT deviceCount = 0;
+
+  // Create the device enumerator.
+  hr = CoCreateInstance(
+    __uuidof(MMDeviceEnumerator),
+    NULL,
+    CLSCTX_ALL,
+    __uuidof(IMMDeviceEnumerator),
+    (void**)&pEnum
+  );
+
+  // Enumerate the rendering devices.
+  hr = pEnum->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &pDevices);
+  CHECK_HR(hr, "Failed to enumerate audio end points.");
+
+  hr = pDevices->GetCount(&deviceCount);
+  CHECK_HR(hr, "Failed to get audio end points count.");
+
+  std::cout << "Audio output device count " << deviceCount << "." << std::endl;
+
+  for (int i = 0; i < deviceCount; i++) {
+    LPWSTR wstrID = NULL;                   // Device ID.
+
+    hr = pDevices->Item(i, &pDevice);
+    CHECK_HR(hr, "Failed to get device for ID.");
+
+    hr = pDevice->GetId(&wstrID);
+    CHECK_HR(hr, "Failed to get name for device.");
+
+    std::wcout << "Audio output device " << i << ": " << wstrID << "." << std::endl;
+
+    CoTaskMemFree(wstrID);
+  }
+
+done:
+
+  SAFE_RELEASE(pEnum);
+  SAFE_RELEASE(pDevices);
+  SAFE_RELEASE(pDevice);
+
+  return hr;
+}
+
+HRESULT GetAudioOutputDevice(UINT deviceIndex, IMFMediaSink** ppAudioSink)
+{
+  HRESULT hr = S_OK;
+
+  IMMDeviceEnumerator* pEnum = NULL;      // Audio device enumerator.
+  IMMDeviceCollection* pDevices = NULL;   // Audio device collection.
+  IMMDevice* pDevice = NULL;              // An audio device.
+  IMFAttributes* pAttributes = NULL;      // Attribute store.
+  LPWSTR wstrID = NULL;                   // Device ID.
+  UINT deviceCount = 0;
+
+  // Create the device enumerator.
+  hr = CoCreateInstance(
+    __uuidof(MMDeviceEnumerator),
+    NULL,
+    CLSCTX_ALL,
+    __uuidof(IMMDeviceEnumerator),
+    (void**)&pEnum
+  );
+
+  // Enumerate the rendering devices.
+  hr = pEnum->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &pDevices);
+  CHECK_HR(hr, "Failed to enumerate audio end points.");
+
+  hr = pDevices->GetCount(&deviceCount);
+  CHECK_HR(hr, "Failed to get audio end points count.");
+
+  if (deviceIndex >= deviceCount) {
+    MFLOG_ERROR("The audio output device index was invalid.");
+    hr = E_INVALIDARG;
+  }
+  else {
+    hr = pDevices->Item(deviceIndex, &pDevice);
+    CHECK_HR(hr, "Failed to get device for ID.");
+
+    hr = pDevice->GetId(&wstrID);
+    CHECK_HR(hr, "Failed to get name for device.");
+
+    std::wcout << "Audio output device for index " << deviceIndex << ": " << wstrID << "." << std::endl;
+
+    // Create an attribute store and set the device ID attribute.
+    hr = MFCreateAttributes(&pAttributes, 1);
+    CHECK_HR(hr, "Failed to create attribute store.");
+
+    hr = pAttributes->SetString(MF_AUDIO_RENDERER_ATTRIBUTE_ENDPOINT_ID, wstrID);
+    CHECK_HR(hr, "Failed to set endpoint ID attribute.");
+
+    // Create the audio renderer.
+    hr = MFCreateAudioRenderer(pAttributes, ppAudioSink);
+    CHECK_HR(hr, "Failed to create the audio output sink.");
+  }
+
+done:
+
+  CoTaskMemFree(wstrID);
+  SAFE_RELEASE(pEnum);
+  SAFE_RELEASE(pDevices);
+  SAFE_RELEASE(pDevice);
+  SAFE_RELEASE(pAttributes);
+
+  return hr;
+}
+
+HRESULT GetVideoSourceFromDevice(UINT nDevice, IMFMediaSource** ppVideoSource, IMFSourceReader** ppVideoReader)
+{
+  UINT32 videoDeviceCount = 0;
+  IMFAttributes* videoConfig = NULL;
+  IMFActivate** videoDevices = NULL;
+  WCHAR* webcamFriendlyName;
+  UINT nameLength = 0;
+  IMFAttributes* pAttributes = NULL;
+
+  HRESULT hr = S_OK;
+
+  // Get the first available webcam.
+  hr = MFCreateAttributes(&videoConfig, 1);
+  CHECK_HR(hr, "Error creating video configuration.");
+
+  // Request video capture devices.
+  hr = videoConfig->SetGUID(
+    MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE,
+    MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID);
+  CHECK_HR(hr, "Error initialising video configuration object.");
+
+  hr = MFEnumDeviceSources(videoConfig, &videoDevices, &videoDeviceCount);
+  CHECK_HR(hr, "Error enumerating video devices.");
+
+  if (nDevice >= videoDeviceCount) {
+    MFLOG_ERROR("The device index of %u was invalid for available device count of %u.", nDevice, videoDeviceCount);
+    hr = E_INVALIDARG;
+  }
+  else {
+    hr = videoDevices[nDevice]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &webcamFriendlyName, &nameLength);
+    CHECK_HR(hr, "Error retrieving video device friendly name.\n");
+
+    wprintf(L"Using webcam: %s\n", webcamFriendlyName);
+
+    hr = videoDevices[nDevice]->ActivateObject(IID_PPV_ARGS(ppVideoSource));
+    CHECK_HR(hr, "Error activating video device.");
+
+    CHECK_HR(MFCreateAttributes(&pAttributes, 1),
+      "Failed to create attributes.");
+
+    if (ppVideoReader != nullptr) {
+      // Adding this attribute creates a video source reader that will handle
+      // colour conversion and avoid the need to manually convert between RGB24 and RGB32 etc.
+      CHECK_HR(pAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, 1),
+        "Failed to set enable video processing attribute.");
+
+      // Create a source reader.
+      hr = MFCreateSourceReaderFromMediaSource(
+        *ppVideoSource,
+        pAttributes,
+        ppVideoReader);
+      CHECK_HR(hr, "Error creating video source reader.");
+    }
+  }
+
+done:
+
+  SAFE_RELEASE(videoConfig);
+  SAFE_RELEASE(videoDevices);
+  SAFE_RELEASE(pAttributes);
+
+  return hr;
+}
+
+HRESULT GetSourceFromCaptureDevice(DeviceType deviceType, UINT nDevice, IMFMediaSource** ppMediaSource, IMFSourceReader** ppMediaReader)
+{
+  UINT32 captureDeviceCount = 0;
+  IMFAttributes* pDeviceConfig = NULL;
+  IMFActivate** ppCaptureDevices = NULL;
+  WCHAR* deviceFriendlyName;
+  UINT nameLength = 0;
+  IMFAttributes* pAttributes = NULL;
+
+  HRESULT hr = S_OK;
+
+  hr = MFCreateAttributes(&pDeviceConfig, 1);
+  CHECK_HR(hr, "Error creating capture device configuration.");
+
+  GUID captureType = (deviceType == DeviceType::Audio) ?
+    MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_AUDCAP_GUID :
+    MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID;
+
+  // Request video capture devices.
+  hr = pDeviceConfig->SetGUID(
+    MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE,
+    captureType);
+  CHECK_HR(hr, "Error initialising capture device configuration object.");
+
+  hr = MFEnumDeviceSources(pDeviceConfig, &ppCaptureDevices, &captureDeviceCount);
+  CHECK_HR(hr, "Error enumerating capture devices.");
+
+  if (nDevice >= captureDeviceCount) {
+    MFLOG_ERROR("The device index of %u was invalid for available device count of %u.", nDevice, captureDeviceCount);
+    hr = E_INVALIDARG;
+  }
+  else {
+    hr = ppCaptureDevices[nDevice]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &deviceFriendlyName, &nameLength);
+    CHECK_HR(hr, "Error retrieving video device friendly name.\n");
+
+    wprintf(L"Capture device friendly name: %s\n", deviceFriendlyName);
+
+    hr = ppCaptureDevices[nDevice]->ActivateObject(IID_PPV_ARGS(ppMediaSource));
+    CHECK_HR(hr, "Error activating capture device.");
+
+    // Is a reader required or does the caller only want the source?
+    if (ppMediaReader != nullptr) {
+      CHECK_HR(MFCreateAttributes(&pAttributes, 1),
+        "Failed to create attributes.");
+
+      if (deviceType == DeviceType::Video) {
+        // Adding this attribute creates a video source reader that will handle
+        // colour conversion and avoid the need to manually convert between RGB24 and RGB32 etc.
+        CHECK_HR(pAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, 1),
+          "Failed to set enable video processing attribute.");
+      }
+
+      // Create a source reader.
+      hr = MFCreateSourceReaderFromMediaSource(
+        *ppMediaSource,
+        pAttributes,
+        ppMediaReader);
+      CHECK_HR(hr, "Error creating media source reader.");
+    }
+  }
+
+done:
+
+  SAFE_RELEASE(pDeviceConfig);
+  SAFE_RELEASE(ppCaptureDevices);
+  SAFE_RELEASE(pAttributes);
+
+  return hr;
+}
+
+HRESULT CopyAttribute(IMFAttributes* pSrc, IMFAttributes* pDest, const GUID& key)
+{
+  PROPVARIANT var;
+  PropVariantInit(&var);
+
+  HRESULT hr = S_OK;
+
+  hr = pSrc->GetItem(key, &var);
+  if (SUCCEEDED(hr))
+  {
+    hr = pDest->SetItem(key, var);
+  }
+
+  PropVariantClear(&var);
+  return hr;
+}
+
+void CreateBitmapFile(LPCWSTR fileName, long width, long height, WORD bitsPerPixel, BYTE* bitmapData, DWORD bitmapDataLength)
+{
+  HANDLE file;
+  BITMAPFILEHEADER fileHeader;
+  BITMAPINFOHEADER fileInfo;
+  DWORD writePosn = 0;
+
+  file = CreateFile(WStrToStr(fileName).c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);  //Sets up the new bmp to be written to
+
+  fileHeader.bfType = 19778;                                                                    //Sets our type to BM or bmp
+  fileHeader.bfSize = sizeof(fileHeader.bfOffBits) + sizeof(RGBTRIPLE);                         //Sets the size equal to the size of the header struct
+  fileHeader.bfReserved1 = 0;                                                                   //sets the reserves to 0
+  fileHeader.bfReserved2 = 0;
+  fileHeader.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);											//Sets offbits equal to the size of file and info header
+  fileInfo.biSize = sizeof(BITMAPINFOHEADER);
+  fileInfo.biWidth = width;
+  fileInfo.biHeight = height;
+  fileInfo.biPlanes = 1;
+  fileInfo.biBitCount = bitsPerPixel;
+  fileInfo.biCompression = BI_RGB;
+  fileInfo.biSizeImage = width * height * (bitsPerPixel / 8);
+  fileInfo.biXPelsPerMeter = 2400;
+  fileInfo.biYPelsPerMeter = 2400;
+  fileInfo.biClrImportant = 0;
+  fileInfo.biClrUsed = 0;
+
+  WriteFile(file, &fileHeader, sizeof(fileHeader), &writePosn, NULL);
+
+  WriteFile(file, &fileInfo, sizeof(fileInfo), &writePosn, NULL);
+
+  WriteFile(file, bitmapData, bitmapDataLength, &writePosn, NULL);
+
+  CloseHandle(file);
+}
+
+void CreateBitmapFromSample(LPCWSTR fileName, long width, long height, WORD bitsPerPixel, IMFSample* pSample)
+{
+  IMFMediaBuffer* pMediaBuffer = NULL;
+  DWORD bmpLength = 0;
+  BYTE* bmpBuffer = NULL;
+
+  CHECK_HR(pSample->ConvertToContiguousBuffer(&pMediaBuffer), "CreateBitmapFromSample convert to contiguous buffer failed.");
+  CHECK_HR(pMediaBuffer->Lock(&bmpBuffer, NULL, &bmpLength), "CreateBitmapFromSamplep failed to lock converted buffer IMFSample.");
+
+  CreateBitmapFile(fileName, width, height, bitsPerPixel, bmpBuffer, bmpLength);
+
+  CHECK_HR(pMediaBuffer->Unlock(), "CreateBitmapFromSample unlock buffer failed.");
+
+done:
+  return;
+}
+
+HRESULT GetDefaultStride(IMFMediaType* pType, LONG* plStride)
+{
+  LONG lStride = 0;
+
+  // Try to get the default stride from the media type.
+  HRESULT hr = pType->GetUINT32(MF_MT_DEFAULT_STRIDE, (UINT32*)&lStride);
+  if (FAILED(hr))
+  {
+    // Attribute not set. Try to calculate the default stride.
+
+    GUID subtype = GUID_NULL;
+
+    UINT32 width = 0;
+    UINT32 height = 0;
+
+    // Get the subtype and the image size.
+    hr = pType->GetGUID(MF_MT_SUBTYPE, &subtype);
+    if (FAILED(hr))
+    {
+      goto done;
+    }
+
+    hr = MFGetAttributeSize(pType, MF_MT_FRAME_SIZE, &width, &height);
+    if (FAILED(hr))
+    {
+      goto done;
+    }
+
+    hr = MFGetStrideForBitmapInfoHeader(subtype.Data1, width, &lStride);
+    if (FAILED(hr))
+    {
+      goto done;
+    }
+
+    // Set the attribute for later reference.
+    (void)pType->SetUINT32(MF_MT_DEFAULT_STRIDE, UINT32(lStride));
+  }
+
+  if (SUCCEEDED(hr))
+  {
+    *plStride = lStride;
+  }
+
+done:
+  return hr;
+}
+
+HRESULT WriteSampleToFile(IMFSample* pSample, std::ofstream* pFileStream)
+{
+  IMFMediaBuffer* buf = NULL;
+  DWORD bufLength;
+
+  HRESULT hr = S_OK;
+
+  hr = pSample->ConvertToContiguousBuffer(&buf);
+  CHECK_HR(hr, "ConvertToContiguousBuffer failed.");
+
+  hr = buf->GetCurrentLength(&bufLength);
+  CHECK_HR(hr, "Get buffer length failed.");
+
+  MFLOG_TRACE("Writing sample to capture file sample size %u.", bufLength);
+
+  byte* byteBuffer = NULL;
+  DWORD buffMaxLen = 0, buffCurrLen = 0;
+  buf->Lock(&byteBuffer, &buffMaxLen, &buffCurrLen);
+
+  pFileStream->write((char*)byteBuffer, bufLength);
+  pFileStream->flush();
+
+done:
+
+  SAFE_RELEASE(buf);
+
+  return hr;
+}
+
+HRESULT CreateSingleBufferIMFSample(DWORD bufferSize, IMFSample** pSample)
+{
+  IMFMediaBuffer* pBuffer = NULL;
+
+  HRESULT hr = S_OK;
+
+  hr = MFCreateSample(pSample);
+  CHECK_HR(hr, "Failed to create MF sample.");
+
+  // Adds a ref count to the pBuffer object.
+  hr = MFCreateMemoryBuffer(bufferSize, &pBuffer);
+  CHECK_HR(hr, "Failed to create memory buffer.");
+
+  // Adds another ref count to the pBuffer object.
+  hr = (*pSample)->AddBuffer(pBuffer);
+  CHECK_HR(hr, "Failed to add sample to buffer.");
+
+done:
+  // Leave the single ref count that will be removed when the pSample is released.
+  SAFE_RELEASE(pBuffer);
+  return hr;
+}
+
+HRESULT CreateAndCopySingleBufferIMFSample(IMFSample* pSrcSample, IMFSample** pDstSample)
+{
+  IMFMediaBuffer* pDstBuffer = NULL;
+  DWORD srcBufLength;
+
+  HRESULT hr = S_OK;
+
+  // Gets total length of ALL media buffer samples. We can use here because it's only a
+  // single buffer sample copy.
+  hr = pSrcSample->GetTotalLength(&srcBufLength);
+  CHECK_HR(hr, "Failed to get total length from source buffer.");
+
+  hr = CreateSingleBufferIMFSample(srcBufLength, pDstSample);
+  CHECK_HR(hr, "Failed to create new single buffer IMF sample.");
+
+  hr = pSrcSample->CopyAllItems(*pDstSample);
+  CHECK_HR(hr, "Failed to copy IMFSample items from src to dst.");
+
+  hr = (*pDstSample)->GetBufferByIndex(0, &pDstBuffer);
+  CHECK_HR(hr, "Failed to get buffer from sample.");
+
+  hr = pSrcSample->CopyToBuffer(pDstBuffer);
+  CHECK_HR(hr, "Failed to copy IMF media buffer.");
+
+done:
+  SAFE_RELEASE(pDstBuffer);
+  return hr;
+}
+
+HRESULT GetTransformOutput(IMFTransform* pTransform, IMFSample** pOutSample, BOOL* transformFlushed, VideoFormat* pOutputFormat)
+{
+  MFT_OUTPUT_STREAM_INFO StreamInfo = { 0 };
+  MFT_OUTPUT_DATA_BUFFER outputDataBuffer = { 0 };
+  DWORD processOutputStatus = 0;
+  IMFMediaType* pChangedOutMediaType = NULL;
+
+  HRESULT hr = S_OK;
+  *transformFlushed = FALSE;
+
+  hr = pTransform->GetOutputStreamInfo(0, &StreamInfo);
+  CHECK_HR(hr, "Failed to get output stream info from MFT.");
+
+  outputDataBuffer.dwStreamID = 0;
+  outputDataBuffer.dwStatus = 0;
+  outputDataBuffer.pEvents = NULL;
+
+  if ((StreamInfo.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES) == 0) {
+    hr = CreateSingleBufferIMFSample(StreamInfo.cbSize, pOutSample);
+    CHECK_HR(hr, "Failed to create new single buffer IMF sample.");
+    outputDataBuffer.pSample = *pOutSample;
+  }
+
+  auto mftProcessOutput = pTransform->ProcessOutput(0, 1, &outputDataBuffer, &processOutputStatus);
+
+  MFLOG_TRACE("Process output result %.2X, MFT status %.2X.", mftProcessOutput, processOutputStatus);
+
+  if (mftProcessOutput == S_OK) {
+    // Sample is ready and allocated on the transform output buffer.
+    *pOutSample = outputDataBuffer.pSample;
+  }
+  else if (mftProcessOutput == MF_E_TRANSFORM_STREAM_CHANGE) {
+    // Format of the input stream has changed. https://docs.microsoft.com/en-us/windows/win32/medfound/handling-stream-changes
+    if (outputDataBuffer.dwStatus == MFT_OUTPUT_DATA_BUFFER_FORMAT_CHANGE) {
+      MFLOG_INFO("MFT stream changed.");
+
+      hr = pTransform->GetOutputAvailableType(0, 0, &pChangedOutMediaType);
+      CHECK_HR(hr, "Failed to get the MFT output media type after a stream change.");
+
+      MFLOG_DEBUG("MFT output media type: %s", GetMediaTypeDescription(pChangedOutMediaType).c_str());
+
+      // Keep 10-bit output as P010 rather than forcing an 8-bit planar subtype the decoder can't produce.
+      GUID changedSubType = GUID_NULL;
+      pChangedOutMediaType->GetGUID(MF_MT_SUBTYPE, &changedSubType);
+      if (changedSubType != MFVideoFormat_P010) {
+        hr = pChangedOutMediaType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_IYUV);
+        CHECK_HR(hr, "Failed to set media sub type.");
+      }
+
+      hr = pTransform->SetOutputType(0, pChangedOutMediaType, 0);
+      CHECK_HR(hr, "Failed to set new output media type on MFT.");
+
+      if (pOutputFormat != NULL) {
+        hr = VideoFormatFromMediaType(pChangedOutMediaType, pOutputFormat);
+        CHECK_HR(hr, "Failed to parse the new MFT output media type.");
+      }
+
+      hr = pTransform->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, NULL);
+      CHECK_HR(hr, "Failed to process FLUSH command on MFT.");
+
+      *transformFlushed = TRUE;
+    }
+    else {
+      MFLOG_WARN("MFT stream changed but didn't have the data format change flag set. Don't know what to do.");
+      hr = E_NOTIMPL;
+    }
+
+    SAFE_RELEASE(pOutSample);
+    *pOutSample = NULL;
+  }
+  else if (mftProcessOutput == MF_E_TRANSFORM_NEED_MORE_INPUT) {
+    // More input is not an error condition but it means the allocated output sample is empty.
+    SAFE_RELEASE(pOutSample);
+    *pOutSample = NULL;
+    hr = MF_E_TRANSFORM_NEED_MORE_INPUT;
+  }
+  else {
+    MFLOG_ERROR("MFT ProcessOutput error result %.2X, MFT status %.2X.", mftProcessOutput, processOutputStatus);
+    hr = mftProcessOutput;
+    SAFE_RELEASE(pOutSample);
+    *pOutSample = NULL;
+  }
+
+done:
+
+  SAFE_RELEASE(pChangedOutMediaType);
+
+  return hr;
+}
+
+unsigned char* HexStr(const uint8_t* start, size_t length)
+{
+  // Each byte requires 2 characters. Add one additional byte to hold the null termination char.
+  unsigned char* hexStr = (unsigned char*)calloc((size_t)(length * 2 + 1), 1);
+
+  static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+  int posn = 0;
+  for (int i = 0; i < length; i++)
+  {
+    unsigned char val = (unsigned char)(*(start + i));
+    hexStr[posn] = (hexmap[val >> 4]);
+    hexStr[posn + 1] = (hexmap[val & 15]);
+    posn += 2;
+  }
+
+  return hexStr;
+}
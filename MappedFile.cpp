@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+#include "MFLog.h"
+#include <mferror.h>
+#include <new>
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() { Close(); }
+
+HRESULT MappedFile::Open(const std::wstring& filePath, bool copyOnWrite) {
+    Close();
+
+    m_hFile = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_hFile == INVALID_HANDLE_VALUE) {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        MFLOG_ERROR("Failed to open file %ls", filePath.c_str());
+        return hr;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(m_hFile, &fileSize)) {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        Close();
+        return hr;
+    }
+    if (fileSize.QuadPart == 0) {
+        Close();
+        return MF_E_INVALID_FILE_FORMAT;
+    }
+
+    // 写时复制映射允许调用者原地改写数据（例如把 AVCC 长度前缀改写成起始码）而不影响磁盘文件
+    m_hMapping = CreateFileMappingW(m_hFile, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (m_hMapping == nullptr) {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        MFLOG_ERROR("Failed to create file mapping.");
+        Close();
+        return hr;
+    }
+
+    m_pView = static_cast<BYTE*>(MapViewOfFile(m_hMapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (m_pView == nullptr) {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        MFLOG_ERROR("Failed to map view of file.");
+        Close();
+        return hr;
+    }
+
+    m_size = static_cast<UINT64>(fileSize.QuadPart);
+    return S_OK;
+}
+
+void MappedFile::Close() {
+    if (m_pView) {
+        UnmapViewOfFile(m_pView);
+        m_pView = nullptr;
+    }
+    if (m_hMapping) {
+        CloseHandle(m_hMapping);
+        m_hMapping = nullptr;
+    }
+    if (m_hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+    m_size = 0;
+}
+
+// 零拷贝媒体缓冲区：Lock 直接返回映射地址
+class MappedMediaBuffer : public IMFMediaBuffer {
+public:
+    MappedMediaBuffer(const std::shared_ptr<MappedFile>& file, BYTE* pData, DWORD cbData)
+        : m_file(file), m_pData(pData), m_cbData(cbData), m_cbCurrent(cbData) {}
+
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override {
+        if (ppv == nullptr) return E_POINTER;
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IMFMediaBuffer)) {
+            *ppv = static_cast<IMFMediaBuffer*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    STDMETHODIMP_(ULONG) AddRef() override { return InterlockedIncrement(&m_refCount); }
+
+    STDMETHODIMP_(ULONG) Release() override {
+        ULONG count = InterlockedDecrement(&m_refCount);
+        if (count == 0) delete this;
+        return count;
+    }
+
+    STDMETHODIMP Lock(BYTE** ppbBuffer, DWORD* pcbMaxLength, DWORD* pcbCurrentLength) override {
+        if (ppbBuffer == nullptr) return E_POINTER;
+        *ppbBuffer = m_pData;
+        if (pcbMaxLength) *pcbMaxLength = m_cbData;
+        if (pcbCurrentLength) *pcbCurrentLength = m_cbCurrent;
+        return S_OK;
+    }
+
+    STDMETHODIMP Unlock() override { return S_OK; }
+
+    STDMETHODIMP GetCurrentLength(DWORD* pcbCurrentLength) override {
+        if (pcbCurrentLength == nullptr) return E_POINTER;
+        *pcbCurrentLength = m_cbCurrent;
+        return S_OK;
+    }
+
+    STDMETHODIMP SetCurrentLength(DWORD cbCurrentLength) override {
+        if (cbCurrentLength > m_cbData) return E_INVALIDARG;
+        m_cbCurrent = cbCurrentLength;
+        return S_OK;
+    }
+
+    STDMETHODIMP GetMaxLength(DWORD* pcbMaxLength) override {
+        if (pcbMaxLength == nullptr) return E_POINTER;
+        *pcbMaxLength = m_cbData;
+        return S_OK;
+    }
+
+private:
+    ~MappedMediaBuffer() {}
+
+    volatile ULONG m_refCount = 1;
+    std::shared_ptr<MappedFile> m_file;
+    BYTE* m_pData;
+    DWORD m_cbData;
+    DWORD m_cbCurrent;
+};
+
+HRESULT CreateMappedMediaBuffer(const std::shared_ptr<MappedFile>& file, BYTE* pData, DWORD cbData, IMFMediaBuffer** ppBuffer) {
+    if (ppBuffer == nullptr || pData == nullptr) return E_POINTER;
+    *ppBuffer = new (std::nothrow) MappedMediaBuffer(file, pData, cbData);
+    return *ppBuffer ? S_OK : E_OUTOFMEMORY;
+}
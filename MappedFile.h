@@ -0,0 +1,34 @@
+#pragma once
+#include <windows.h>
+#include <mfobjects.h>
+#include <memory>
+#include <string>
+
+// 只读/写时复制的文件内存映射
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开并映射整个文件，copyOnWrite 为 true 时映射为进程私有的写时复制页
+    HRESULT Open(const std::wstring& filePath, bool copyOnWrite = false);
+
+    // 解除映射并关闭文件
+    void Close();
+
+    BYTE* Data() const { return m_pView; }
+    UINT64 Size() const { return m_size; }
+    bool IsOpen() const { return m_pView != nullptr; }
+
+private:
+    HANDLE m_hFile = INVALID_HANDLE_VALUE;
+    HANDLE m_hMapping = nullptr;
+    BYTE* m_pView = nullptr;
+    UINT64 m_size = 0;
+};
+
+// 创建直接引用映射内存的 IMFMediaBuffer，缓冲区持有 file 的引用，释放前映射不会被解除
+HRESULT CreateMappedMediaBuffer(const std::shared_ptr<MappedFile>& file, BYTE* pData, DWORD cbData, IMFMediaBuffer** ppBuffer);
@@ -0,0 +1,96 @@
+#include "ParallelBands.h"
+#include <algorithm>
+
+ParallelBands::ParallelBands(UINT32 threadCount) {
+    if (threadCount == 0) {
+        UINT32 hardware = std::thread::hardware_concurrency();
+        threadCount = (hardware > 1) ? hardware - 1 : 0;
+    }
+    for (UINT32 i = 0; i < threadCount; i++) {
+        m_workers.emplace_back(&ParallelBands::WorkerLoop, this);
+    }
+}
+
+ParallelBands::~ParallelBands() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_taskCV.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+ParallelBands& ParallelBands::Shared() {
+    static ParallelBands pool;
+    return pool;
+}
+
+void ParallelBands::Execute(const Task& task) {
+    (*task.batch->work)(task.rowBegin, task.rowEnd);
+
+    std::lock_guard<std::mutex> lock(task.batch->mutex);
+    if (--task.batch->remaining == 0) task.batch->done.notify_all();
+}
+
+void ParallelBands::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskCV.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()) return;
+            task = m_tasks.front();
+            m_tasks.pop_front();
+        }
+        Execute(task);
+    }
+}
+
+void ParallelBands::Run(UINT32 rows, UINT32 minRowsPerBand, const BandFunction& work) {
+    if (rows == 0) return;
+    minRowsPerBand = (std::max)(minRowsPerBand, 1u);
+    UINT32 bands = (std::min)(GetThreadCount(), (rows + minRowsPerBand - 1) / minRowsPerBand);
+    if (bands <= 1) {
+        work(0, rows);
+        return;
+    }
+
+    Batch batch;
+    batch.work = &work;
+    batch.remaining = bands;
+
+    // 行数尽量均分，前 rows % bands 个行带多一行
+    UINT32 base = rows / bands, extra = rows % bands;
+    Task first;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        UINT32 row = 0;
+        for (UINT32 i = 0; i < bands; i++) {
+            Task task;
+            task.batch = &batch;
+            task.rowBegin = row;
+            task.rowEnd = row + base + (i < extra ? 1 : 0);
+            row = task.rowEnd;
+            if (i == 0) first = task;
+            else m_tasks.push_back(task);
+        }
+    }
+    m_taskCV.notify_all();
+
+    // 调用线程处理第一个行带，再帮忙取队列中的行带（在工作线程内嵌套调用时也不会等死），最后等待其余行带
+    Execute(first);
+    while (true) {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_tasks.empty()) break;
+            task = m_tasks.front();
+            m_tasks.pop_front();
+        }
+        Execute(task);
+    }
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+}
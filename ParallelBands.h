@@ -0,0 +1,51 @@
+#pragma once
+#include <windows.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 按行带并行执行图像处理
+// 常驻工作线程，避免每帧创建线程；调用线程自己也处理一个行带，全部行带完成后 Run 才返回
+class ParallelBands {
+public:
+    using BandFunction = std::function<void(UINT32 rowBegin, UINT32 rowEnd)>;
+
+    // threadCount 为 0 时取硬件线程数减一（调用线程算一个）
+    explicit ParallelBands(UINT32 threadCount = 0);
+    ~ParallelBands();
+    ParallelBands(const ParallelBands&) = delete;
+    ParallelBands& operator=(const ParallelBands&) = delete;
+
+    // 进程内共享的实例
+    static ParallelBands& Shared();
+
+    // 把 [0, rows) 切成若干行带并行执行；每个行带至少 minRowsPerBand 行，行数少时直接在调用线程执行
+    void Run(UINT32 rows, UINT32 minRowsPerBand, const BandFunction& work);
+
+    UINT32 GetThreadCount() const { return static_cast<UINT32>(m_workers.size()) + 1; }
+
+private:
+    struct Batch {
+        const BandFunction* work = nullptr;
+        std::mutex mutex;
+        std::condition_variable done;
+        UINT32 remaining = 0;
+    };
+    struct Task {
+        Batch* batch = nullptr;
+        UINT32 rowBegin = 0;
+        UINT32 rowEnd = 0;
+    };
+
+    void WorkerLoop();
+    static void Execute(const Task& task);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_taskCV;
+    std::deque<Task> m_tasks;
+    bool m_stop = false;
+};
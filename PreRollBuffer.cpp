@@ -0,0 +1,243 @@
+#include "PreRollBuffer.h"
+#include "H264Bitstream.h"
+#include "MFLog.h"
+#include <mferror.h>
+#include <cstring>
+
+PreRollBuffer::PreRollBuffer() {}
+
+PreRollBuffer::~PreRollBuffer() { Stop(); }
+
+HRESULT PreRollBuffer::Initialize(size_t byteBudget) {
+    if (byteBudget == 0) return E_INVALIDARG;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try {
+        m_storage.assign(byteBudget, 0);
+    }
+    catch (const std::bad_alloc&) {
+        return E_OUTOFMEMORY;
+    }
+    m_entries.clear();
+    m_head = m_tail = m_usedBytes = 0;
+    return S_OK;
+}
+
+void PreRollBuffer::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_head = m_tail = m_usedBytes = 0;
+}
+
+bool PreRollBuffer::IsRecording() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pWriter != nullptr;
+}
+
+size_t PreRollBuffer::GetBufferedBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usedBytes;
+}
+
+LONGLONG PreRollBuffer::GetBufferedDuration() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.empty()) return 0;
+    return m_entries.back().sampleTime + m_entries.back().duration - m_entries.front().sampleTime;
+}
+
+void PreRollBuffer::PopFront() {
+    m_usedBytes -= m_entries.front().size;
+    m_entries.pop_front();
+    if (m_entries.empty()) {
+        m_head = m_tail = 0;
+    }
+    else {
+        m_head = m_entries.front().offset;
+    }
+}
+
+void PreRollBuffer::TrimToKeyframe() {
+    // 头部被淘汰后剩余的非关键帧无法独立解码，一并丢弃直到下一个 IDR
+    while (!m_entries.empty() && !m_entries.front().keyframe) {
+        PopFront();
+    }
+}
+
+bool PreRollBuffer::Reserve(DWORD size, size_t* pOffset) {
+    const size_t capacity = m_storage.size();
+    if (size == 0 || size > capacity) return false;
+
+    // 每个访问单元在存储区中连续存放，尾部放不下时绕回到 0，必要时淘汰最早的数据
+    while (true) {
+        if (m_entries.empty()) {
+            m_head = m_tail = 0;
+            *pOffset = 0;
+            return true;
+        }
+
+        bool wrapped = m_tail <= m_head;
+        if (!wrapped) {
+            if (capacity - m_tail >= size) {
+                *pOffset = m_tail;
+                return true;
+            }
+            if (m_head >= size) {
+                *pOffset = 0;
+                return true;
+            }
+        }
+        else if (m_head - m_tail >= size) {
+            *pOffset = m_tail;
+            return true;
+        }
+
+        PopFront();
+    }
+}
+
+HRESULT PreRollBuffer::WriteToSink(const BYTE* pData, DWORD cbData, LONGLONG sampleTime, LONGLONG duration, bool keyframe) {
+    ComPtr<IMFSample> pSample;
+    ComPtr<IMFMediaBuffer> pBuffer;
+    BYTE* pDst = nullptr;
+
+    HRESULT hr = MFCreateMemoryBuffer(cbData, &pBuffer);
+    if (FAILED(hr)) return hr;
+    hr = pBuffer->Lock(&pDst, nullptr, nullptr);
+    if (FAILED(hr)) return hr;
+    memcpy(pDst, pData, cbData);
+    pBuffer->Unlock();
+    hr = pBuffer->SetCurrentLength(cbData);
+    if (FAILED(hr)) return hr;
+
+    hr = MFCreateSample(&pSample);
+    if (FAILED(hr)) return hr;
+    hr = pSample->AddBuffer(pBuffer.Get());
+    if (FAILED(hr)) return hr;
+    hr = pSample->SetSampleTime(sampleTime - m_timeBase);
+    if (FAILED(hr)) return hr;
+    hr = pSample->SetSampleDuration(duration);
+    if (FAILED(hr)) return hr;
+    hr = pSample->SetUINT32(MFSampleExtension_CleanPoint, keyframe ? TRUE : FALSE);
+    if (FAILED(hr)) return hr;
+
+    return m_pWriter->WriteSample(m_streamIndex, pSample.Get());
+}
+
+HRESULT PreRollBuffer::Push(IMFSample* pSample) {
+    if (pSample == nullptr) return E_POINTER;
+
+    ComPtr<IMFMediaBuffer> pBuffer;
+    HRESULT hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pData = nullptr;
+    DWORD cbData = 0;
+    hr = pBuffer->Lock(&pData, nullptr, &cbData);
+    if (FAILED(hr)) return hr;
+
+    LONGLONG sampleTime = 0, duration = 0;
+    pSample->GetSampleTime(&sampleTime);
+    pSample->GetSampleDuration(&duration);
+
+    // 相机通常会设置 CleanPoint，没有时扫描码流中的 IDR
+    UINT32 cleanPoint = 0;
+    bool keyframe = SUCCEEDED(pSample->GetUINT32(MFSampleExtension_CleanPoint, &cleanPoint))
+        ? cleanPoint != 0 : H264ContainsIdr(pData, cbData);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 触发时预录为空则等待第一个 IDR 再开始写入
+    if (m_pWriter && m_waitForKeyframe && keyframe) {
+        m_timeBase = sampleTime;
+        m_waitForKeyframe = false;
+    }
+    if (m_pWriter && !m_waitForKeyframe) {
+        hr = WriteToSink(pData, cbData, sampleTime, duration, keyframe);
+        if (FAILED(hr)) MFLOG_ERROR("Failed to write live sample to muxer: 0x%08lx", hr);
+    }
+
+    size_t offset = 0;
+    if (!m_storage.empty() && (keyframe || !m_entries.empty()) && Reserve(cbData, &offset)) {
+        memcpy(m_storage.data() + offset, pData, cbData);
+
+        Entry entry;
+        entry.offset = offset;
+        entry.size = cbData;
+        entry.sampleTime = sampleTime;
+        entry.duration = duration;
+        entry.keyframe = keyframe;
+        m_entries.push_back(entry);
+        m_head = m_entries.front().offset;
+        m_tail = offset + cbData;
+        m_usedBytes += cbData;
+
+        TrimToKeyframe();
+    }
+
+    pBuffer->Unlock();
+    return hr;
+}
+
+HRESULT PreRollBuffer::Trigger(IMFSinkWriter* pWriter, DWORD streamIndex) {
+    if (pWriter == nullptr) return E_POINTER;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pWriter) return MF_E_INVALIDREQUEST;
+
+    m_pWriter = pWriter;
+    m_streamIndex = streamIndex;
+    m_timeBase = m_entries.empty() ? 0 : m_entries.front().sampleTime;
+    m_waitForKeyframe = m_entries.empty();
+
+    // 预录内容已从 IDR 开始，按原样写出
+    for (const Entry& entry : m_entries) {
+        HRESULT hr = WriteToSink(m_storage.data() + entry.offset, entry.size, entry.sampleTime, entry.duration, entry.keyframe);
+        if (FAILED(hr)) {
+            MFLOG_ERROR("Failed to write pre-roll sample to muxer: 0x%08lx", hr);
+            m_pWriter.Reset();
+            return hr;
+        }
+    }
+    return S_OK;
+}
+
+HRESULT PreRollBuffer::Stop() {
+    ComPtr<IMFSinkWriter> pWriter;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pWriter.Swap(m_pWriter);
+    }
+    if (!pWriter) return S_OK;
+    return pWriter->Finalize();
+}
+
+HRESULT CreateH264PassthroughWriter(const std::wstring& filePath, IMFMediaType* pH264Type,
+    IMFSinkWriter** ppWriter, DWORD* pStreamIndex) {
+    if (pH264Type == nullptr || ppWriter == nullptr || pStreamIndex == nullptr) return E_POINTER;
+
+    ComPtr<IMFSinkWriter> pWriter;
+    HRESULT hr = MFCreateSinkWriterFromURL(filePath.c_str(), nullptr, nullptr, &pWriter);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to create sink writer: 0x%08lx", hr);
+        return hr;
+    }
+
+    hr = pWriter->AddStream(pH264Type, pStreamIndex);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to add H264 stream to sink writer: 0x%08lx", hr);
+        return hr;
+    }
+
+    // 输入类型与流类型相同，写入器不会插入编码器
+    hr = pWriter->SetInputMediaType(*pStreamIndex, pH264Type, nullptr);
+    if (FAILED(hr)) {
+        MFLOG_ERROR("Failed to set sink writer input type: 0x%08lx", hr);
+        return hr;
+    }
+
+    hr = pWriter->BeginWriting();
+    if (FAILED(hr)) return hr;
+
+    *ppWriter = pWriter.Detach();
+    return S_OK;
+}
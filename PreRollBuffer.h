@@ -0,0 +1,70 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <wrl/client.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+// 事件触发录像（DVR 模式）的压缩预录环形缓冲区
+// 以字节预算而非帧数限制内存，存储区在 Initialize 时一次性分配，之后不再增长；
+// 缓冲内容总是从 IDR 开始，触发时把预录内容和之后的实时采样直接写入复用器，不重新编码
+class PreRollBuffer {
+public:
+    PreRollBuffer();
+    ~PreRollBuffer();
+
+    // 分配 byteBudget 字节的环形存储
+    HRESULT Initialize(size_t byteBudget);
+
+    // 放入一个压缩 H.264 访问单元；录像进行中时同时写入复用器
+    HRESULT Push(IMFSample* pSample);
+
+    // 触发录像：先写出预录内容（从最早的 IDR 开始），之后 Push 的采样持续写入 pWriter
+    HRESULT Trigger(IMFSinkWriter* pWriter, DWORD streamIndex);
+
+    // 停止写入复用器并 Finalize，预录缓冲继续工作
+    HRESULT Stop();
+
+    // 丢弃预录内容（码流格式改变后旧内容无法和新码流拼接），不影响录像状态
+    void Clear();
+
+    bool IsRecording() const;
+    size_t GetBufferedBytes() const;
+    LONGLONG GetBufferedDuration() const;
+
+private:
+    struct Entry {
+        size_t offset = 0;
+        DWORD size = 0;
+        LONGLONG sampleTime = 0;
+        LONGLONG duration = 0;
+        bool keyframe = false;
+    };
+
+    bool Reserve(DWORD size, size_t* pOffset);
+    void PopFront();
+    void TrimToKeyframe();
+    HRESULT WriteToSink(const BYTE* pData, DWORD cbData, LONGLONG sampleTime, LONGLONG duration, bool keyframe);
+
+    mutable std::mutex m_mutex;
+    std::vector<BYTE> m_storage;
+    std::deque<Entry> m_entries;
+    size_t m_head = 0;          // 最早一个访问单元的起始偏移
+    size_t m_tail = 0;          // 下一个写入位置
+    size_t m_usedBytes = 0;
+
+    ComPtr<IMFSinkWriter> m_pWriter;
+    DWORD m_streamIndex = 0;
+    LONGLONG m_timeBase = 0;    // 写入复用器时减去的起始时间戳
+    bool m_waitForKeyframe = false;
+};
+
+// 创建 H.264 直通写入器：输入类型与输出类型相同，复用器只封装不编码
+HRESULT CreateH264PassthroughWriter(const std::wstring& filePath, IMFMediaType* pH264Type,
+    IMFSinkWriter** ppWriter, DWORD* pStreamIndex);
@@ -0,0 +1,166 @@
+#include "SamplePool.h"
+#include <mferror.h>
+#include <new>
+
+SamplePool::SamplePool(DWORD bufferSize, DWORD alignment, size_t maxIdle)
+    : m_bufferSize(bufferSize), m_alignment(alignment), m_maxIdle(maxIdle) {}
+
+SamplePool::~SamplePool() {}
+
+HRESULT SamplePool::Create(DWORD bufferSize, DWORD alignment, size_t maxIdle, SamplePool** ppPool) {
+    if (ppPool == nullptr) return E_POINTER;
+    *ppPool = new (std::nothrow) SamplePool(bufferSize, alignment, maxIdle);
+    return (*ppPool != nullptr) ? S_OK : E_OUTOFMEMORY;
+}
+
+HRESULT SamplePool::CreateSampleLocked(IMFSample** ppSample) {
+    ComPtr<IMFMediaBuffer> pBuffer;
+    HRESULT hr = (m_alignment > 1) ?
+        MFCreateAlignedMemoryBuffer(m_bufferSize, m_alignment - 1, &pBuffer) :
+        MFCreateMemoryBuffer(m_bufferSize, &pBuffer);
+    if (FAILED(hr)) return hr;
+
+    ComPtr<IMFTrackedSample> pTracked;
+    hr = MFCreateTrackedSample(&pTracked);
+    if (FAILED(hr)) return hr;
+
+    ComPtr<IMFSample> pSample;
+    hr = pTracked.As(&pSample);
+    if (FAILED(hr)) return hr;
+    hr = pSample->AddBuffer(pBuffer.Get());
+    if (FAILED(hr)) return hr;
+
+    m_stats.allocations++;
+    *ppSample = pSample.Detach();
+    return S_OK;
+}
+
+HRESULT SamplePool::AcquireSample(IMFSample** ppSample) {
+    if (ppSample == nullptr) return E_POINTER;
+    *ppSample = nullptr;
+
+    ComPtr<IMFSample> pSample;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_shutdown) return MF_E_SHUTDOWN;
+
+        if (!m_idle.empty()) {
+            pSample = m_idle.back();
+            m_idle.pop_back();
+            m_stats.reuses++;
+        }
+        else {
+            HRESULT hr = CreateSampleLocked(&pSample);
+            if (FAILED(hr)) return hr;
+        }
+        m_stats.outstandingSamples++;
+    }
+
+    // 回调只触发一次，每次借出都要重新登记；池的引用在 Invoke 中释放，保证采样在外时池不被销毁
+    ComPtr<IMFTrackedSample> pTracked;
+    HRESULT hr = pSample.As(&pTracked);
+    if (SUCCEEDED(hr)) {
+        AddRef();
+        hr = pTracked->SetAllocator(this, nullptr);
+        if (FAILED(hr)) Release();
+    }
+    if (FAILED(hr)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.outstandingSamples--;
+        return hr;
+    }
+
+    *ppSample = pSample.Detach();
+    return S_OK;
+}
+
+void SamplePool::Reconfigure(DWORD bufferSize, DWORD alignment) {
+    // 空闲采样的回调已经触发过，在锁外释放即直接销毁
+    std::vector<ComPtr<IMFSample>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (bufferSize == m_bufferSize && alignment == m_alignment) return;
+        m_bufferSize = bufferSize;
+        m_alignment = alignment;
+        m_stats.discards += m_idle.size();
+        dropped.swap(m_idle);
+    }
+}
+
+void SamplePool::Shutdown() {
+    std::vector<ComPtr<IMFSample>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+        dropped.swap(m_idle);
+    }
+}
+
+SamplePoolStats SamplePool::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SamplePoolStats stats = m_stats;
+    stats.idleSamples = m_idle.size();
+    return stats;
+}
+
+STDMETHODIMP SamplePool::QueryInterface(REFIID riid, void** ppv) {
+    if (ppv == nullptr) return E_POINTER;
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IMFAsyncCallback)) {
+        *ppv = static_cast<IMFAsyncCallback*>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppv = nullptr;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) SamplePool::AddRef() {
+    return InterlockedIncrement(&m_refCount);
+}
+
+STDMETHODIMP_(ULONG) SamplePool::Release() {
+    ULONG count = InterlockedDecrement(&m_refCount);
+    if (count == 0) delete this;
+    return count;
+}
+
+STDMETHODIMP SamplePool::GetParameters(DWORD* pdwFlags, DWORD* pdwQueue) {
+    // 使用默认工作队列
+    return E_NOTIMPL;
+}
+
+STDMETHODIMP SamplePool::Invoke(IMFAsyncResult* pResult) {
+    ComPtr<IUnknown> pObject;
+    ComPtr<IMFSample> pSample;
+    HRESULT hr = pResult->GetObject(&pObject);
+    if (SUCCEEDED(hr)) hr = pObject.As(&pSample);
+
+    if (SUCCEEDED(hr)) {
+        // 清掉上一次使用留下的时间戳和属性（时间戳不属于属性，DeleteAllItems 不会清除），缓冲长度归零后放回空闲列表
+        pSample->DeleteAllItems();
+        pSample->SetSampleTime(0);
+        pSample->SetSampleDuration(0);
+        ComPtr<IMFMediaBuffer> pBuffer;
+        DWORD maxLength = 0;
+        if (SUCCEEDED(pSample->GetBufferByIndex(0, &pBuffer))) {
+            pBuffer->SetCurrentLength(0);
+            pBuffer->GetMaxLength(&maxLength);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.outstandingSamples--;
+        if (!m_shutdown && maxLength >= m_bufferSize && m_idle.size() < m_maxIdle) {
+            m_idle.push_back(pSample);
+            m_stats.returns++;
+        }
+        else {
+            m_stats.discards++;
+        }
+    }
+
+    // 与 AcquireSample 中的 AddRef 配对；采样已不在列表中时随 pSample 一起释放
+    pSample.Reset();
+    pObject.Reset();
+    Release();
+    return S_OK;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#include <mutex>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+struct SamplePoolStats {
+    UINT64 allocations = 0;     // 新建采样和缓冲
+    UINT64 reuses = 0;          // 从空闲列表取出
+    UINT64 returns = 0;         // 最后一个引用释放后回到池中
+    UINT64 discards = 0;        // 缓冲大小已过期或空闲列表已满而丢弃
+    size_t idleSamples = 0;
+    size_t outstandingSamples = 0;
+};
+
+// 单缓冲输出采样池
+// 采样由 MFCreateTrackedSample 创建，最后一个引用（不论在下游 MFT、调用方还是链中间）释放时
+// 通过 IMFTrackedSample 回调回到空闲列表，因此同一个采样可以按引用直接交给下一个 MFT，
+// 不需要在使用结束前拷贝或由池方追踪谁还持有它
+class SamplePool : public IMFAsyncCallback {
+public:
+    // 创建池，引用计数为 1；maxIdle 为保留的空闲采样上限，超出的直接释放
+    static HRESULT Create(DWORD bufferSize, DWORD alignment, size_t maxIdle, SamplePool** ppPool);
+
+    // 取出一个缓冲至少为 bufferSize 字节的空采样，没有空闲采样时新建
+    HRESULT AcquireSample(IMFSample** ppSample);
+
+    // 输出流信息变化后调整缓冲大小，丢弃已不合适的空闲采样；使用中的采样归还时再检查
+    void Reconfigure(DWORD bufferSize, DWORD alignment);
+
+    // 丢弃空闲采样，之后归还的采样直接释放
+    void Shutdown();
+
+    SamplePoolStats GetStats() const;
+
+    // IUnknown
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override;
+    STDMETHODIMP_(ULONG) AddRef() override;
+    STDMETHODIMP_(ULONG) Release() override;
+
+    // IMFAsyncCallback：采样的最后一个引用释放时调用
+    STDMETHODIMP GetParameters(DWORD* pdwFlags, DWORD* pdwQueue) override;
+    STDMETHODIMP Invoke(IMFAsyncResult* pResult) override;
+
+private:
+    SamplePool(DWORD bufferSize, DWORD alignment, size_t maxIdle);
+    ~SamplePool();
+
+    HRESULT CreateSampleLocked(IMFSample** ppSample);
+
+    volatile LONG m_refCount = 1;
+    mutable std::mutex m_mutex;
+    std::vector<ComPtr<IMFSample>> m_idle;
+    DWORD m_bufferSize = 0;
+    DWORD m_alignment = 0;
+    size_t m_maxIdle = 0;
+    bool m_shutdown = false;
+    SamplePoolStats m_stats;
+};
@@ -0,0 +1,153 @@
+#include "SceneCutDetector.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SCENE_CUT_SSE2 1
+#endif
+
+static const UINT32 CELL_SIZE = 16;
+static const UINT32 CELL_ROWS = 4;              // 每个单元取的行数，行距 CELL_SIZE / CELL_ROWS
+static const UINT32 HISTOGRAM_BINS = 64;
+
+bool SceneCutDetector::IsSupported(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void SceneCutDetector::Reset() {
+    m_width = m_height = 0;
+}
+
+void SceneCutDetector::OnKeyframeEncoded() {
+    if (!m_keyframePending) m_stats.encoderKeyframes++;
+    m_keyframePending = false;
+    m_framesSinceKeyframe = 0;
+}
+
+// 一行单元：累加每 16 个样点的和
+static void SumCells(const BYTE* pRow, UINT32 cellsX, UINT32* pSums) {
+#ifdef SCENE_CUT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (UINT32 cx = 0; cx < cellsX; cx++) {
+        __m128i sad = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + cx * CELL_SIZE)), zero);
+        pSums[cx] += static_cast<UINT32>(_mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4));
+    }
+#else
+    for (UINT32 cx = 0; cx < cellsX; cx++) {
+        UINT32 sum = 0;
+        for (UINT32 i = 0; i < CELL_SIZE; i++) sum += pRow[cx * CELL_SIZE + i];
+        pSums[cx] += sum;
+    }
+#endif
+}
+
+HRESULT SceneCutDetector::Analyze(const ImagePlanes& frame, SceneCutResult* pResult) {
+    if (pResult == nullptr || frame.data[0] == nullptr) return E_POINTER;
+    if (!IsSupported(frame.subtype)) return MF_E_INVALIDMEDIATYPE;
+    if (frame.width < CELL_SIZE || frame.height < CELL_SIZE) return MF_E_INVALIDMEDIATYPE;
+
+    auto start = std::chrono::steady_clock::now();
+    const UINT32 cellsX = frame.width / CELL_SIZE, cellsY = frame.height / CELL_SIZE;
+    const UINT32 cellCount = cellsX * cellsY;
+    const UINT32 rowStep = CELL_SIZE / CELL_ROWS;
+
+    // 缩略图：每个单元的均值
+    m_thumbnail.resize(cellCount);
+    std::vector<UINT32> sums(cellsX);
+    for (UINT32 cy = 0; cy < cellsY; cy++) {
+        std::fill(sums.begin(), sums.end(), 0);
+        for (UINT32 k = 0; k < CELL_ROWS; k++) {
+            UINT32 y = cy * CELL_SIZE + k * rowStep + rowStep / 2;
+            SumCells(frame.data[0] + static_cast<ptrdiff_t>(y) * frame.stride[0], cellsX, sums.data());
+        }
+        const UINT32 samples = CELL_SIZE * CELL_ROWS;
+        for (UINT32 cx = 0; cx < cellsX; cx++) {
+            m_thumbnail[cy * cellsX + cx] = static_cast<BYTE>((sums[cx] + samples / 2) / samples);
+        }
+    }
+
+    m_histogram.assign(HISTOGRAM_BINS, 0);
+    for (BYTE value : m_thumbnail) m_histogram[value * HISTOGRAM_BINS / 256]++;
+
+    SceneCutResult result;
+    bool first = (frame.width != m_width || frame.height != m_height);
+    if (first) {
+        m_width = frame.width;
+        m_height = frame.height;
+        m_averageSad = 0.0;
+        m_framesSinceCut = 0;
+    }
+    else {
+        UINT64 histogramDiff = 0;
+        for (UINT32 i = 0; i < HISTOGRAM_BINS; i++) {
+            histogramDiff += static_cast<UINT64>(std::abs(static_cast<INT32>(m_histogram[i]) - static_cast<INT32>(m_previousHistogram[i])));
+        }
+        UINT64 sad = 0;
+        for (UINT32 i = 0; i < cellCount; i++) {
+            sad += static_cast<UINT64>(std::abs(m_thumbnail[i] - m_previousThumbnail[i]));
+        }
+        result.histogramDistance = histogramDiff / (2.0 * cellCount);
+        result.meanSad = static_cast<double>(sad) / cellCount;
+
+        m_framesSinceCut++;
+        result.sceneCut = result.histogramDistance >= m_settings.histogramThreshold &&
+            result.meanSad >= m_settings.sadThreshold &&
+            result.meanSad >= m_averageSad * m_settings.motionRatio &&
+            m_framesSinceCut >= m_settings.minSceneFrames;
+
+        // 切换帧不计入运动水平，新场景从头统计
+        if (result.sceneCut) m_averageSad = 0.0;
+        else m_averageSad = (m_averageSad == 0.0) ? result.meanSad : m_averageSad * 0.9 + result.meanSad * 0.1;
+    }
+
+    m_framesSinceKeyframe++;
+    result.keyframe = first || result.sceneCut || m_framesSinceKeyframe >= m_settings.maxGop;
+    if (result.sceneCut) {
+        m_stats.sceneCuts++;
+        m_framesSinceCut = 0;
+    }
+    if (result.keyframe) {
+        m_stats.keyframes++;
+        m_framesSinceKeyframe = 0;
+        m_keyframePending = true;
+    }
+    m_stats.frames++;
+
+    m_thumbnail.swap(m_previousThumbnail);
+    m_histogram.swap(m_previousHistogram);
+    *pResult = result;
+    m_stats.analyzeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return S_OK;
+}
+
+HRESULT SceneCutDetector::AnalyzeSample(IMFSample* pSample, const VideoFormat& format, SceneCutResult* pResult) {
+    if (pSample == nullptr || pResult == nullptr) return E_POINTER;
+
+    Microsoft::WRL::ComPtr<IMFMediaBuffer> pBuffer;
+    HRESULT hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* pData = nullptr;
+    DWORD length = 0;
+    hr = pBuffer->Lock(&pData, nullptr, &length);
+    if (FAILED(hr)) return hr;
+
+    ImagePlanes planes = {};
+    hr = ImagePlanesFromBuffer(format, pData, length, &planes);
+    if (SUCCEEDED(hr)) hr = Analyze(planes, pResult);
+    pBuffer->Unlock();
+    return hr;
+}
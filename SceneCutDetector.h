@@ -0,0 +1,62 @@
+#pragma once
+#include <windows.h>
+#include <mfidl.h>
+#include <vector>
+#include "VideoFormat.h"
+
+struct SceneCutSettings {
+    double histogramThreshold = 0.30;   // 亮度直方图距离（0..1）超过此值才可能是切换
+    double sadThreshold = 20.0;         // 缩略图平均绝对差（8 位）超过此值才可能是切换
+    double motionRatio = 2.0;           // 同时还须超过近期平均差异的倍数，避免快速运动被当成切换
+    UINT32 minSceneFrames = 12;         // 两次切换之间至少间隔的帧数，闪光等短暂变化不重复插入 IDR
+    UINT32 maxGop = 300;                // 最大关键帧间隔（帧），场景一直不变时到达后照常插入关键帧
+};
+
+struct SceneCutResult {
+    bool sceneCut = false;              // 检测到场景切换
+    bool keyframe = false;              // 本帧应编码为 IDR（首帧、场景切换或到达 maxGop）
+    double histogramDistance = 0.0;
+    double meanSad = 0.0;
+};
+
+struct SceneCutStats {
+    UINT64 frames = 0;
+    UINT64 sceneCuts = 0;
+    UINT64 keyframes = 0;               // 请求的关键帧，包括首帧和 maxGop
+    UINT64 encoderKeyframes = 0;        // 编码器自行插入、经 OnKeyframeEncoded 报告的关键帧
+    double analyzeMs = 0.0;
+};
+
+// 场景切换检测
+// 亮度平面按 16x16 单元取 4 行求均值得到缩略图（SSE2 psadbw），由缩略图计算 64 级直方图；
+// 与上一帧比较直方图距离和缩略图平均绝对差，两者都超过阈值且差异明显高于近期运动水平时判为切换。
+// 编码器的 GOP 设为 maxGop 作为兜底，关键帧只在真正的场景切换时额外插入
+class SceneCutDetector {
+public:
+    static bool IsSupported(VideoSubtype subtype);
+
+    void SetSettings(const SceneCutSettings& settings) { m_settings = settings; }
+    const SceneCutSettings& GetSettings() const { return m_settings; }
+
+    HRESULT Analyze(const ImagePlanes& frame, SceneCutResult* pResult);
+    HRESULT AnalyzeSample(IMFSample* pSample, const VideoFormat& format, SceneCutResult* pResult);
+
+    // 编码器在没有请求时输出了关键帧（例如按自己的 GOP），重新开始计算关键帧间隔
+    void OnKeyframeEncoded();
+
+    // 下一帧按首帧处理（流切换、编码器重建后调用）
+    void Reset();
+
+    const SceneCutStats& GetStats() const { return m_stats; }
+
+private:
+    SceneCutSettings m_settings;
+    SceneCutStats m_stats;
+    UINT32 m_width = 0, m_height = 0;
+    UINT32 m_framesSinceKeyframe = 0;
+    UINT32 m_framesSinceCut = 0;
+    bool m_keyframePending = false;     // 已请求关键帧，尚未从编码器看到
+    double m_averageSad = 0.0;          // 近期缩略图差异的滑动平均
+    std::vector<BYTE> m_thumbnail, m_previousThumbnail;
+    std::vector<UINT32> m_histogram, m_previousHistogram;
+};
@@ -0,0 +1,82 @@
+#include "StartupTimeline.h"
+#include <algorithm>
+#include <cstdio>
+
+StartupTimeline::StartupTimeline() : m_start(std::chrono::steady_clock::now()) {}
+
+void StartupTimeline::Start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_start = std::chrono::steady_clock::now();
+    m_stages.clear();
+    m_firstFrameMs = -1.0;
+}
+
+double StartupTimeline::GetElapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+size_t StartupTimeline::BeginStage(const std::string& name) {
+    Stage stage;
+    stage.name = name;
+    stage.threadId = GetCurrentThreadId();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stage.beginMs = GetElapsedMs();
+    m_stages.push_back(stage);
+    return m_stages.size() - 1;
+}
+
+void StartupTimeline::EndStage(size_t stage, HRESULT hr) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (stage >= m_stages.size()) return;
+    m_stages[stage].endMs = GetElapsedMs();
+    m_stages[stage].hr = hr;
+}
+
+bool StartupTimeline::MarkFirstFrame() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_firstFrameMs >= 0.0) return false;
+    m_firstFrameMs = GetElapsedMs();
+    return true;
+}
+
+double StartupTimeline::GetFirstFrameMs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_firstFrameMs;
+}
+
+std::vector<StartupTimeline::Stage> StartupTimeline::GetStages() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stages;
+}
+
+std::string StartupTimeline::Report() const {
+    std::vector<Stage> stages = GetStages();
+    double firstFrameMs = GetFirstFrameMs();
+    std::stable_sort(stages.begin(), stages.end(),
+        [](const Stage& a, const Stage& b) { return a.beginMs < b.beginMs; });
+
+    std::string report;
+    char line[256];
+    if (firstFrameMs >= 0.0) {
+        snprintf(line, sizeof(line), "Startup timeline (time to first frame %.1f ms):\n", firstFrameMs);
+    }
+    else {
+        snprintf(line, sizeof(line), "Startup timeline (no frame yet):\n");
+    }
+    report += line;
+
+    for (const auto& stage : stages) {
+        if (stage.endMs >= 0.0) {
+            snprintf(line, sizeof(line), "  %-24s %8.1f -> %8.1f ms %8.1f ms  thread %5lu%s\n",
+                stage.name.c_str(), stage.beginMs, stage.endMs, stage.endMs - stage.beginMs,
+                static_cast<unsigned long>(stage.threadId), FAILED(stage.hr) ? "  FAILED" : "");
+        }
+        else {
+            snprintf(line, sizeof(line), "  %-24s %8.1f -> (running)           thread %5lu\n",
+                stage.name.c_str(), stage.beginMs, static_cast<unsigned long>(stage.threadId));
+        }
+        report += line;
+    }
+    return report;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <windows.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 启动时间线：记录各初始化阶段在哪个线程、从何时到何时运行，以及首帧时间
+// 各阶段可在不同线程并发记录
+class StartupTimeline {
+public:
+    struct Stage {
+        std::string name;
+        DWORD threadId = 0;
+        double beginMs = 0.0;   // 相对 Start() 的毫秒数
+        double endMs = -1.0;    // 未结束时为负
+        HRESULT hr = S_OK;
+    };
+
+    StartupTimeline();
+
+    // 重新开始计时并清空记录
+    void Start();
+
+    // 返回阶段编号，传给 EndStage
+    size_t BeginStage(const std::string& name);
+    void EndStage(size_t stage, HRESULT hr = S_OK);
+
+    // 记录首帧时间，只有第一次调用生效；返回是否为第一次
+    bool MarkFirstFrame();
+
+    double GetElapsedMs() const;
+    double GetFirstFrameMs() const;
+    std::vector<Stage> GetStages() const;
+
+    // 按开始时间排列的各阶段耗时报告
+    std::string Report() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<Stage> m_stages;
+    double m_firstFrameMs = -1.0;
+};
+
+// 作用域内计时一个阶段
+class StartupStageScope {
+public:
+    StartupStageScope(StartupTimeline& timeline, const std::string& name)
+        : m_timeline(timeline), m_stage(timeline.BeginStage(name)) {}
+    ~StartupStageScope() { m_timeline.EndStage(m_stage, m_hr); }
+
+    // 记录阶段结果并原样返回，便于 return scope.Result(hr);
+    HRESULT Result(HRESULT hr) { m_hr = hr; return hr; }
+
+private:
+    StartupTimeline& m_timeline;
+    size_t m_stage;
+    HRESULT m_hr = S_OK;
+};
@@ -0,0 +1,281 @@
+/******************************************************************************
+* Filename: TemporalDenoiseBenchmark.cpp
+*
+* Description:
+* Measures what the TemporalDenoiser prefilter buys the H.264 encoder MFT.
+* The clip is encoded twice at the same fixed QP, once as captured and once
+* after denoising, and the bitrate of both runs is reported together with the
+* denoiser's cost per frame. Without a clip, a synthetic low-light 4K
+* sequence (a slowly moving gradient with sensor-like noise) is used.
+*
+* Usage: TemporalDenoiseBenchmark [clip.yuv width height] [qp] [frames]
+*   clip.yuv is raw I420, e.g. the rawframes.yuv written by MFH264RoundTrip.
+*
+* License: Public Domain (no warranty, use at own risk)
+*******************************************************************************/
+
+#include "MFUtility.h"
+#include "TemporalDenoiser.h"
+#include "TransformDriver.h"
+
+#include <codecapi.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfuuid.lib")
+#pragma comment(lib, "wmcodecdspuuid.lib")
+
+#define SYNTHETIC_WIDTH 3840
+#define SYNTHETIC_HEIGHT 2160
+#define FRAME_RATE 30
+
+/**
+* Sets a UINT32 codec property through ICodecAPI.
+*/
+HRESULT SetCodecValue(IMFTransform* pTransform, const GUID& property, ULONG value)
+{
+  ICodecAPI* pCodecApi = NULL;
+  VARIANT var;
+  HRESULT hr = S_OK;
+
+  VariantInit(&var);
+  var.vt = VT_UI4;
+  var.ulVal = value;
+
+  CHECK_HR(pTransform->QueryInterface(IID_PPV_ARGS(&pCodecApi)), "Failed to get ICodecAPI from the encoder.");
+  CHECK_HR(pCodecApi->SetValue(&property, &var), "Failed to set encoder property.");
+
+done:
+  SAFE_RELEASE(pCodecApi);
+  return hr;
+}
+
+/**
+* Creates an H.264 encoder that codes every frame at the same QP, so any size difference comes from the input.
+*/
+HRESULT CreateFixedQpEncoder(UINT32 width, UINT32 height, UINT32 qp, IMFTransform** ppEncoder)
+{
+  IMFTransform* pEncoder = NULL;
+  IMFMediaType* pInType = NULL, * pOutType = NULL;
+  HRESULT hr = S_OK;
+
+  CHECK_HR(CoCreateInstance(CLSID_CMSH264EncoderMFT, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pEncoder)),
+    "Failed to create H.264 encoder MFT.");
+
+  // Rate control has to be chosen before the media types are set.
+  CHECK_HR(SetCodecValue(pEncoder, CODECAPI_AVEncCommonRateControlMode, eAVEncCommonRateControlMode_Quality),
+    "Failed to select constant quality rate control.");
+  CHECK_HR(SetCodecValue(pEncoder, CODECAPI_AVEncVideoEncodeQP, qp), "Failed to set the encoder QP.");
+
+  CHECK_HR(MFCreateMediaType(&pOutType), "Failed to create output type.");
+  CHECK_HR(pOutType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video), "Failed to set major type.");
+  CHECK_HR(pOutType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264), "Failed to set output subtype.");
+  CHECK_HR(pOutType->SetUINT32(MF_MT_AVG_BITRATE, 8000000), "Failed to set bit rate.");
+  CHECK_HR(MFSetAttributeSize(pOutType, MF_MT_FRAME_SIZE, width, height), "Failed to set frame size.");
+  CHECK_HR(MFSetAttributeRatio(pOutType, MF_MT_FRAME_RATE, FRAME_RATE, 1), "Failed to set frame rate.");
+  CHECK_HR(MFSetAttributeRatio(pOutType, MF_MT_PIXEL_ASPECT_RATIO, 1, 1), "Failed to set aspect ratio.");
+  CHECK_HR(pOutType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive), "Failed to set interlace mode.");
+  CHECK_HR(pEncoder->SetOutputType(0, pOutType, 0), "Failed to set encoder output type.");
+
+  CHECK_HR(MFCreateMediaType(&pInType), "Failed to create input type.");
+  CHECK_HR(pOutType->CopyAllItems(pInType), "Failed to copy output type.");
+  CHECK_HR(pInType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_IYUV), "Failed to set input subtype.");
+  CHECK_HR(pEncoder->SetInputType(0, pInType, 0), "Failed to set encoder input type.");
+
+  CHECK_HR(pEncoder->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, NULL), "Failed to begin streaming.");
+  CHECK_HR(pEncoder->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, NULL), "Failed to start stream.");
+
+  *ppEncoder = pEncoder;
+  pEncoder = NULL;
+
+done:
+  SAFE_RELEASE(pEncoder);
+  SAFE_RELEASE(pInType);
+  SAFE_RELEASE(pOutType);
+  return hr;
+}
+
+/**
+* Encodes the frames and returns the total size of the H.264 stream.
+*/
+HRESULT EncodeFrames(const std::vector<ComPtr<IMFSample>>& frames, UINT32 width, UINT32 height, UINT32 qp, UINT64* pBytes)
+{
+  IMFTransform* pEncoder = NULL;
+  TransformDriver driver;
+  std::vector<ComPtr<IMFSample>> outputs;
+
+  HRESULT hr = CreateFixedQpEncoder(width, height, qp, &pEncoder);
+  if (FAILED(hr)) return hr;
+  hr = driver.Attach(pEncoder, MFVideoFormat_H264);
+  SAFE_RELEASE(pEncoder);
+
+  for (size_t i = 0; i < frames.size() && SUCCEEDED(hr); i++) {
+    hr = driver.Process(frames[i].Get(), outputs);
+  }
+  if (SUCCEEDED(hr)) hr = driver.Drain(outputs);
+
+  *pBytes = 0;
+  for (auto& output : outputs) {
+    DWORD length = 0;
+    output->GetTotalLength(&length);
+    *pBytes += length;
+  }
+  return hr;
+}
+
+/**
+* Wraps raw I420 frames in timestamped samples.
+*/
+HRESULT CreateSamples(const std::vector<std::vector<BYTE>>& frames, std::vector<ComPtr<IMFSample>>& samples)
+{
+  const LONGLONG duration = 10000000LL / FRAME_RATE;
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    IMFSample* pSample = NULL;
+    IMFMediaBuffer* pBuffer = NULL;
+    BYTE* pData = NULL;
+    DWORD frameBytes = static_cast<DWORD>(frames[i].size());
+    HRESULT hr = CreateSingleBufferIMFSample(frameBytes, &pSample);
+    if (FAILED(hr)) return hr;
+
+    pSample->GetBufferByIndex(0, &pBuffer);
+    pBuffer->Lock(&pData, NULL, NULL);
+    memcpy(pData, frames[i].data(), frameBytes);
+    pBuffer->Unlock();
+    pBuffer->SetCurrentLength(frameBytes);
+    SAFE_RELEASE(pBuffer);
+
+    pSample->SetSampleTime(static_cast<LONGLONG>(i) * duration);
+    pSample->SetSampleDuration(duration);
+
+    ComPtr<IMFSample> sample;
+    sample.Attach(pSample);
+    samples.push_back(sample);
+  }
+  return S_OK;
+}
+
+/**
+* A dim, slowly panning gradient with per-pixel noise, roughly what a sensor delivers in low light.
+*/
+void CreateSyntheticClip(UINT32 width, UINT32 height, int frameCount, std::vector<std::vector<BYTE>>& frames)
+{
+  std::mt19937 random(1);
+  std::normal_distribution<float> lumaNoise(0.0f, 4.0f), chromaNoise(0.0f, 2.5f);
+  size_t lumaBytes = static_cast<size_t>(width) * height;
+  size_t chromaBytes = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+
+  for (int f = 0; f < frameCount; f++) {
+    std::vector<BYTE> frame(lumaBytes + chromaBytes * 2);
+    for (UINT32 y = 0; y < height; y++) {
+      for (UINT32 x = 0; x < width; x++) {
+        float value = 24.0f + 40.0f * ((x + f * 2) % width) / width + 16.0f * y / height + lumaNoise(random);
+        frame[static_cast<size_t>(y) * width + x] = static_cast<BYTE>((std::min)((std::max)(value, 0.0f), 255.0f));
+      }
+    }
+    for (size_t i = lumaBytes; i < frame.size(); i++) {
+      frame[i] = static_cast<BYTE>((std::min)((std::max)(128.0f + chromaNoise(random), 0.0f), 255.0f));
+    }
+    frames.push_back(std::move(frame));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  const char* clipPath = (argc > 3) ? argv[1] : NULL;
+  UINT32 width = clipPath ? atoi(argv[2]) : SYNTHETIC_WIDTH;
+  UINT32 height = clipPath ? atoi(argv[3]) : SYNTHETIC_HEIGHT;
+  int argBase = clipPath ? 4 : 1;
+  UINT32 qp = (argc > argBase) ? atoi(argv[argBase]) : 28;
+  int frameCount = (argc > argBase + 1) ? atoi(argv[argBase + 1]) : 60;
+  if (width < 16 || height < 16 || frameCount <= 0 || qp > 51) {
+    printf("Usage: TemporalDenoiseBenchmark [clip.yuv width height] [qp] [frames]\n");
+    return 1;
+  }
+
+  // Load the clip (raw I420) or make a synthetic one.
+  std::vector<std::vector<BYTE>> original;
+  size_t frameBytes = static_cast<size_t>(width) * height + 2 * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+  if (clipPath) {
+    std::ifstream clip(clipPath, std::ios::binary);
+    while (clip && static_cast<int>(original.size()) < frameCount) {
+      std::vector<BYTE> frame(frameBytes);
+      if (!clip.read(reinterpret_cast<char*>(frame.data()), frameBytes)) break;
+      original.push_back(std::move(frame));
+    }
+    if (original.empty()) {
+      printf("Could not read any %ux%u I420 frames from %s.\n", width, height, clipPath);
+      return 1;
+    }
+  }
+  else {
+    CreateSyntheticClip(width, height, frameCount, original);
+  }
+
+  // Denoise every frame against the previous output, timing only the kernel.
+  VideoFormat format = {};
+  format.subtype = VideoSubtype::I420;
+  format.width = width;
+  format.height = height;
+  std::vector<std::vector<BYTE>> denoised(original.size(), std::vector<BYTE>(frameBytes));
+  TemporalDenoiser denoiser;
+  double denoiseMs = 0;
+  for (size_t i = 0; i < original.size(); i++) {
+    ImagePlanes src = {}, dst = {}, previous = {};
+    for (int p = 0; p < 3; p++) {
+      size_t offset = (p == 0) ? 0 : static_cast<size_t>(width) * height + (p - 1) * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+      LONG stride = static_cast<LONG>((p == 0) ? width : (width + 1) / 2);
+      src.data[p] = original[i].data() + offset;
+      dst.data[p] = denoised[i].data() + offset;
+      previous.data[p] = (i > 0) ? denoised[i - 1].data() + offset : NULL;
+      src.stride[p] = dst.stride[p] = previous.stride[p] = stride;
+    }
+    src.subtype = dst.subtype = previous.subtype = format.subtype;
+    src.width = dst.width = previous.width = width;
+    src.height = dst.height = previous.height = height;
+    src.planeCount = dst.planeCount = previous.planeCount = 3;
+
+    auto start = std::chrono::steady_clock::now();
+    denoiser.Process(src, (i > 0) ? &previous : NULL, dst);
+    denoiseMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+  if (SUCCEEDED(hr)) hr = MFStartup(MF_VERSION);
+  if (FAILED(hr)) {
+    printf("Media Foundation initialisation failed %.2X.\n", hr);
+    return 1;
+  }
+  MFLogSetLevel(MFLOG_LEVEL_ERROR);
+
+  std::vector<ComPtr<IMFSample>> originalSamples, denoisedSamples;
+  UINT64 originalBytes = 0, denoisedBytes = 0;
+  hr = CreateSamples(original, originalSamples);
+  if (SUCCEEDED(hr)) hr = CreateSamples(denoised, denoisedSamples);
+  if (SUCCEEDED(hr)) hr = EncodeFrames(originalSamples, width, height, qp, &originalBytes);
+  if (SUCCEEDED(hr)) hr = EncodeFrames(denoisedSamples, width, height, qp, &denoisedBytes);
+
+  if (FAILED(hr)) {
+    printf("Benchmark failed %.2X.\n", hr);
+  }
+  else {
+    double seconds = static_cast<double>(original.size()) / FRAME_RATE;
+    printf("%s %ux%u, %zu frames, QP %u.\n", clipPath ? clipPath : "Synthetic low-light clip", width, height,
+      original.size(), qp);
+    printf("Denoiser:  %8.3f ms/frame on %u threads\n", denoiseMs / original.size(), ParallelBands::Shared().GetThreadCount());
+    printf("Original:  %8.1f kbps\n", originalBytes * 8 / seconds / 1000);
+    printf("Denoised:  %8.1f kbps\n", denoisedBytes * 8 / seconds / 1000);
+    printf("Reduction: %8.1f %%\n", originalBytes ? 100.0 * (1.0 - static_cast<double>(denoisedBytes) / originalBytes) : 0.0);
+  }
+
+  originalSamples.clear();
+  denoisedSamples.clear();
+  MFShutdown();
+  CoUninitialize();
+  return FAILED(hr) ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+#include "TemporalDenoiser.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEMPORAL_DENOISE_SSE2 1
+#endif
+
+using Microsoft::WRL::ComPtr;
+
+static const int WEIGHT_BITS = 7;           // 混合权重 0..128，diff * weight 不超出 INT16
+
+TemporalDenoiser::TemporalDenoiser() : m_pBands(&ParallelBands::Shared()) {}
+
+TemporalDenoiser::~TemporalDenoiser() {
+    m_pPrevious.Reset();
+    if (m_pPool) m_pPool->Shutdown();
+}
+
+bool TemporalDenoiser::IsSupported(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void TemporalDenoiser::Reset() {
+    m_pPrevious.Reset();
+}
+
+// 逐样点权重：weight = min(128, base + min(|diff|, threshold) * slope)，out = prev + diff * weight / 128
+struct BlendParams {
+    INT32 base;         // 静止像素取当前帧的权重
+    INT32 slope;        // 每单位差值增加的权重
+    INT32 threshold;
+};
+
+static void BlendRow(const BYTE* pCur, const BYTE* pPrev, BYTE* pOut, UINT32 count, const BlendParams& params) {
+    UINT32 x = 0;
+#ifdef TEMPORAL_DENOISE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i base = _mm_set1_epi16(static_cast<short>(params.base));
+    const __m128i slope = _mm_set1_epi16(static_cast<short>(params.slope));
+    const __m128i threshold = _mm_set1_epi16(static_cast<short>(params.threshold));
+    const __m128i full = _mm_set1_epi16(1 << WEIGHT_BITS);
+    const __m128i round = _mm_set1_epi16(1 << (WEIGHT_BITS - 1));
+    for (; x + 16 <= count; x += 16) {
+        __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCur + x));
+        __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrev + x));
+        __m128i result[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i c = half ? _mm_unpackhi_epi8(cur, zero) : _mm_unpacklo_epi8(cur, zero);
+            __m128i p = half ? _mm_unpackhi_epi8(prev, zero) : _mm_unpacklo_epi8(prev, zero);
+            __m128i diff = _mm_sub_epi16(c, p);
+            __m128i magnitude = _mm_min_epi16(_mm_max_epi16(diff, _mm_sub_epi16(zero, diff)), threshold);
+            __m128i weight = _mm_min_epi16(_mm_add_epi16(base, _mm_mullo_epi16(magnitude, slope)), full);
+            __m128i delta = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(diff, weight), round), WEIGHT_BITS);
+            result[half] = _mm_add_epi16(p, delta);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x), _mm_packus_epi16(result[0], result[1]));
+    }
+#endif
+    for (; x < count; x++) {
+        INT32 diff = pCur[x] - pPrev[x];
+        INT32 magnitude = (std::min)(diff < 0 ? -diff : diff, params.threshold);
+        INT32 weight = (std::min)(params.base + magnitude * params.slope, 1 << WEIGHT_BITS);
+        INT32 value = pPrev[x] + ((diff * weight + (1 << (WEIGHT_BITS - 1))) >> WEIGHT_BITS);
+        pOut[x] = static_cast<BYTE>((std::min)((std::max)(value, 0), 255));
+    }
+}
+
+HRESULT TemporalDenoiser::Process(const ImagePlanes& src, const ImagePlanes* pPrevious, const ImagePlanes& dst) {
+    if (!IsSupported(src.subtype)) return MF_E_INVALIDMEDIATYPE;
+    if (dst.width != src.width || dst.height != src.height || dst.planeCount != src.planeCount) return MF_E_INVALIDMEDIATYPE;
+    if (pPrevious && (pPrevious->width != src.width || pPrevious->height != src.height ||
+        pPrevious->planeCount != src.planeCount)) {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+
+    BlendParams params;
+    params.threshold = static_cast<INT32>((std::max)(m_settings.motionThreshold, 1u));
+    params.base = (1 << WEIGHT_BITS) - static_cast<INT32>((std::min)(m_settings.strength, 127u));
+    params.slope = ((1 << WEIGHT_BITS) - params.base + params.threshold - 1) / params.threshold;
+
+    // 每个平面一行的字节数：NV12 的 UV 平面与亮度同宽，I420 的 U/V 平面为一半
+    const UINT32 chromaWidth = (src.width + 1) / 2;
+    UINT32 rowBytes[VIDEO_FORMAT_MAX_PLANES] = { src.width, chromaWidth, chromaWidth };
+    if (src.planeCount == 2) rowBytes[1] = chromaWidth * 2;
+
+    // 按亮度行分带，色度行 c 归属于包含亮度行 2c 的行带
+    auto band = [&](UINT32 rowBegin, UINT32 rowEnd) {
+        for (UINT32 plane = 0; plane < src.planeCount; plane++) {
+            UINT32 begin = (plane == 0) ? rowBegin : (rowBegin + 1) / 2;
+            UINT32 end = (plane == 0) ? rowEnd : (rowEnd + 1) / 2;
+            for (UINT32 y = begin; y < end; y++) {
+                const BYTE* pCur = src.data[plane] + static_cast<ptrdiff_t>(y) * src.stride[plane];
+                BYTE* pOut = dst.data[plane] + static_cast<ptrdiff_t>(y) * dst.stride[plane];
+                if (pPrevious) {
+                    const BYTE* pPrev = pPrevious->data[plane] + static_cast<ptrdiff_t>(y) * pPrevious->stride[plane];
+                    BlendRow(pCur, pPrev, pOut, rowBytes[plane], params);
+                }
+                else if (pOut != pCur) {
+                    memcpy(pOut, pCur, rowBytes[plane]);
+                }
+            }
+        }
+    };
+    if (m_pBands) m_pBands->Run(src.height, 16, band);
+    else band(0, src.height);
+    return S_OK;
+}
+
+HRESULT TemporalDenoiser::ProcessSample(IMFSample* pInput, const VideoFormat& format, IMFSample** ppOutput) {
+    if (pInput == nullptr || ppOutput == nullptr) return E_POINTER;
+    *ppOutput = nullptr;
+    if (!IsSupported(format.subtype)) return MF_E_INVALIDMEDIATYPE;
+
+    HRESULT hr = S_OK;
+    // 格式变化后旧参考不能再用，池中缓冲按新帧大小调整
+    if (!m_pPool || format.hash != m_formatHash) {
+        m_pPrevious.Reset();
+        if (m_pPool) m_pPool->Reconfigure(format.frameBytes, 16);
+        else hr = SamplePool::Create(format.frameBytes, 16, 2, &m_pPool);
+        if (FAILED(hr)) return hr;
+        m_formatHash = format.hash;
+    }
+
+    ComPtr<IMFMediaBuffer> pInBuffer, pOutBuffer, pPrevBuffer;
+    ComPtr<IMFSample> pOutput;
+    hr = pInput->ConvertToContiguousBuffer(&pInBuffer);
+    if (FAILED(hr)) return hr;
+    hr = m_pPool->AcquireSample(&pOutput);
+    if (FAILED(hr)) return hr;
+    hr = pOutput->GetBufferByIndex(0, &pOutBuffer);
+    if (FAILED(hr)) return hr;
+    if (m_pPrevious) {
+        hr = m_pPrevious->GetBufferByIndex(0, &pPrevBuffer);
+        if (FAILED(hr)) return hr;
+    }
+
+    BYTE* pIn = nullptr;
+    BYTE* pOut = nullptr;
+    BYTE* pPrev = nullptr;
+    DWORD cbIn = 0, cbOutMax = 0, cbPrev = 0;
+    hr = pInBuffer->Lock(&pIn, nullptr, &cbIn);
+    if (FAILED(hr)) return hr;
+    hr = pOutBuffer->Lock(&pOut, &cbOutMax, nullptr);
+    if (SUCCEEDED(hr)) {
+        if (pPrevBuffer) hr = pPrevBuffer->Lock(&pPrev, nullptr, &cbPrev);
+        if (SUCCEEDED(hr)) {
+            ImagePlanes src, dst, previous;
+            hr = ImagePlanesFromBuffer(format, pIn, cbIn, &src);
+            if (SUCCEEDED(hr)) hr = ImagePlanesFromBuffer(format, pOut, cbOutMax, &dst);
+            if (SUCCEEDED(hr) && pPrev) hr = ImagePlanesFromBuffer(format, pPrev, cbPrev, &previous);
+            if (SUCCEEDED(hr)) hr = Process(src, pPrev ? &previous : nullptr, dst);
+            if (pPrev) pPrevBuffer->Unlock();
+        }
+        pOutBuffer->Unlock();
+    }
+    pInBuffer->Unlock();
+    if (FAILED(hr)) return hr;
+
+    hr = pOutBuffer->SetCurrentLength(format.frameBytes);
+    if (FAILED(hr)) return hr;
+
+    // 时间戳和采样属性（关键帧请求、重复帧标记等）随帧传下去
+    hr = pInput->CopyAllItems(pOutput.Get());
+    if (FAILED(hr)) return hr;
+    LONGLONG value = 0;
+    if (SUCCEEDED(pInput->GetSampleTime(&value))) pOutput->SetSampleTime(value);
+    if (SUCCEEDED(pInput->GetSampleDuration(&value))) pOutput->SetSampleDuration(value);
+
+    m_pPrevious = pOutput;
+    *ppOutput = pOutput.Detach();
+    return S_OK;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <windows.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+#include "SamplePool.h"
+
+struct TemporalDenoiseSettings {
+    UINT32 strength = 80;           // 静止像素保留上一帧输出的比例（0..127 对应 0..~100%），越大降噪越强
+    UINT32 motionThreshold = 24;    // 与上一帧的绝对差达到此值视为运动，直接使用当前帧，避免拖影
+};
+
+// 运动自适应时域降噪（NV12 / I420 / IYUV / YV12），放在采集和编码器之间
+// 每个样点按与上一帧输出的差值选择混合权重：差值小时向上一帧收敛（递归平均压低噪声），
+// 差值随接近 motionThreshold 线性过渡到完全使用当前帧。输出采样来自 SamplePool，
+// 上一帧输出同时作为下一帧的参考，不额外拷贝；SSE2 每次 16 个样点，按行带并行
+class TemporalDenoiser {
+public:
+    TemporalDenoiser();
+    ~TemporalDenoiser();
+
+    static bool IsSupported(VideoSubtype subtype);
+
+    void SetSettings(const TemporalDenoiseSettings& settings) { m_settings = settings; }
+    const TemporalDenoiseSettings& GetSettings() const { return m_settings; }
+
+    // 降噪 src 写入 dst；pPrevious 为上一帧输出，nullptr 表示没有参考（直接拷贝）。三者格式相同，dst 可以与 src 相同
+    HRESULT Process(const ImagePlanes& src, const ImagePlanes* pPrevious, const ImagePlanes& dst);
+
+    // 采样接口：输出从池中取，并保留为下一帧的参考；格式变化时重新开始
+    HRESULT ProcessSample(IMFSample* pInput, const VideoFormat& format, IMFSample** ppOutput);
+
+    // 丢弃参考帧（场景切换、流切换后调用）
+    void Reset();
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+private:
+    TemporalDenoiseSettings m_settings;
+    ParallelBands* m_pBands = nullptr;
+    Microsoft::WRL::ComPtr<SamplePool> m_pPool;
+    Microsoft::WRL::ComPtr<IMFSample> m_pPrevious;      // 上一帧输出，持有引用直到下一帧完成
+    UINT64 m_formatHash = 0;
+};
@@ -0,0 +1,131 @@
+#include "TransformChain.h"
+#include <mferror.h>
+
+TransformChain::TransformChain() {}
+
+TransformChain::~TransformChain() {
+    Reset();
+}
+
+HRESULT TransformChain::AttachLink(std::unique_ptr<Link> link, IMFTransform* pTransform, const GUID& preferredOutputSubtype,
+    size_t outputPoolSize) {
+    link->driver.reset(new TransformDriver());
+    link->driver->SetOutputPoolSize(outputPoolSize);
+    HRESULT hr = link->driver->Attach(pTransform, preferredOutputSubtype);
+    if (FAILED(hr)) return hr;
+
+    m_links.push_back(std::move(link));
+    return S_OK;
+}
+
+HRESULT TransformChain::AddLink(IMFTransform* pTransform, ChainLinkOwnership ownership, const GUID& preferredOutputSubtype,
+    size_t outputPoolSize) {
+    if (pTransform == nullptr) return E_POINTER;
+    if (ownership == ChainLinkOwnership::Leased) return E_INVALIDARG;   // 借出的实例须以 MFTLease 传入
+
+    std::unique_ptr<Link> link(new Link());
+    link->ownership = ownership;
+    if (ownership == ChainLinkOwnership::Owned) link->pOwned = pTransform;
+    return AttachLink(std::move(link), pTransform, preferredOutputSubtype, outputPoolSize);
+}
+
+HRESULT TransformChain::AddLink(MFTLease&& lease, const GUID& preferredOutputSubtype, size_t outputPoolSize) {
+    if (!lease) return E_POINTER;
+
+    std::unique_ptr<Link> link(new Link());
+    link->ownership = ChainLinkOwnership::Leased;
+    link->lease = std::move(lease);
+    IMFTransform* pTransform = link->lease.Get();
+    return AttachLink(std::move(link), pTransform, preferredOutputSubtype, outputPoolSize);
+}
+
+void TransformChain::SetTap(size_t linkIndex, const TapCallback& tap) {
+    if (linkIndex < m_links.size()) m_links[linkIndex]->tap = tap;
+}
+
+HRESULT TransformChain::Forward(size_t linkIndex, IMFSample* const* ppInputs, size_t count,
+    std::vector<ComPtr<IMFSample>>& outputs) {
+    Link& link = *m_links[linkIndex];
+    link.outputs.clear();
+    HRESULT hr = link.driver->Process(ppInputs, count, link.outputs);
+    if (FAILED(hr)) return hr;
+    return Deliver(linkIndex, outputs);
+}
+
+HRESULT TransformChain::Deliver(size_t linkIndex, std::vector<ComPtr<IMFSample>>& outputs) {
+    Link& link = *m_links[linkIndex];
+    HRESULT hr = S_OK;
+
+    if (linkIndex + 1 == m_links.size()) {
+        outputs.insert(outputs.end(), link.outputs.begin(), link.outputs.end());
+        link.outputs.clear();
+        return S_OK;
+    }
+    if (link.outputs.empty()) return S_OK;
+
+    link.nextInputs.clear();
+    for (auto& pSample : link.outputs) {
+        if (link.tap) {
+            hr = link.tap(pSample.Get());
+            if (FAILED(hr)) return hr;
+        }
+        link.nextInputs.push_back(pSample.Get());
+    }
+
+    // 下游 MFT 需要保留输入时自己加引用；链这里交出后立即放手，采样在最后一个引用释放时回到本环节的池
+    hr = Forward(linkIndex + 1, link.nextInputs.data(), link.nextInputs.size(), outputs);
+    link.nextInputs.clear();
+    link.outputs.clear();
+    return hr;
+}
+
+HRESULT TransformChain::Process(IMFSample* const* ppInputs, size_t count, std::vector<ComPtr<IMFSample>>& outputs) {
+    if (m_links.empty()) return MF_E_NOT_INITIALIZED;
+    return Forward(0, ppInputs, count, outputs);
+}
+
+HRESULT TransformChain::Drain(std::vector<ComPtr<IMFSample>>& outputs) {
+    if (m_links.empty()) return MF_E_NOT_INITIALIZED;
+
+    // 上游排出的帧先经过下游处理，再排空下游，保证末尾的帧也走完整条链
+    for (size_t i = 0; i < m_links.size(); i++) {
+        Link& link = *m_links[i];
+        link.outputs.clear();
+        HRESULT hr = link.driver->Drain(link.outputs);
+        if (FAILED(hr)) return hr;
+        hr = Deliver(i, outputs);
+        if (FAILED(hr)) return hr;
+    }
+    return S_OK;
+}
+
+HRESULT TransformChain::Flush() {
+    HRESULT result = S_OK;
+    for (auto& link : m_links) {
+        link->outputs.clear();
+        HRESULT hr = link->driver->Flush();
+        if (FAILED(hr) && SUCCEEDED(result)) result = hr;
+    }
+    return result;
+}
+
+void TransformChain::Reset() {
+    for (auto& link : m_links) {
+        link->outputs.clear();
+        link->driver->Detach();
+
+        switch (link->ownership) {
+        case ChainLinkOwnership::Owned:
+            link->pOwned->ProcessMessage(MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0);
+            link->pOwned->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+            link->pOwned.Reset();
+            break;
+        case ChainLinkOwnership::Leased:
+            link->lease.Reset();
+            break;
+        case ChainLinkOwnership::Borrowed:
+            break;
+        }
+    }
+    m_links.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "MFTPool.h"
+#include "TransformDriver.h"
+
+using namespace Microsoft::WRL;
+
+// 链中每个 MFT 由谁负责
+enum class ChainLinkOwnership {
+    Borrowed,   // 调用方持有 MFT 并负责流消息，链只驱动它
+    Owned,      // 链持有引用，Reset 时发送 END_OF_STREAM/END_STREAMING 后释放
+    Leased,     // 从 MFTPool 借出，Reset 时冲刷并归还池
+};
+
+// 把多个同步 MFT 串成一条链：encode→decode、decode→convert、decode→encode 转码等
+// 上一个 MFT 的输出采样按引用直接作为下一个 MFT 的输入，中间不拷贝缓冲；
+// 每个环节的输出采样来自该环节自己的采样池，下游（含调用方）释放最后一个引用后自动回收
+class TransformChain {
+public:
+    // 中间环节的输出在交给下一个 MFT 之前回调一次（例如把编码结果写入录像），返回失败时中止本次处理
+    using TapCallback = std::function<HRESULT(IMFSample* pSample)>;
+
+    TransformChain();
+    ~TransformChain();
+    TransformChain(const TransformChain&) = delete;
+    TransformChain& operator=(const TransformChain&) = delete;
+
+    // 追加一个环节（MFT 的输入/输出类型须已设置），输入类型应与上一环节的输出兼容
+    // outputPoolSize 为该环节保留的空闲输出采样数，MFT 自己分配输出采样时忽略
+    HRESULT AddLink(IMFTransform* pTransform, ChainLinkOwnership ownership,
+        const GUID& preferredOutputSubtype = GUID_NULL, size_t outputPoolSize = 8);
+    HRESULT AddLink(MFTLease&& lease, const GUID& preferredOutputSubtype = GUID_NULL, size_t outputPoolSize = 8);
+
+    void SetTap(size_t linkIndex, const TapCallback& tap);
+
+    // 把输入送入第一个环节，逐级传递，最后一个环节的输出追加到 outputs
+    HRESULT Process(IMFSample* const* ppInputs, size_t count, std::vector<ComPtr<IMFSample>>& outputs);
+    HRESULT Process(IMFSample* pInput, std::vector<ComPtr<IMFSample>>& outputs) { return Process(&pInput, 1, outputs); }
+
+    // 流结束：逐级 DRAIN，前一环节排出的帧先送入下一环节再排空下一环节
+    HRESULT Drain(std::vector<ComPtr<IMFSample>>& outputs);
+
+    // 丢弃所有环节内部缓存的数据
+    HRESULT Flush();
+
+    // 按各环节的所有权释放全部环节
+    void Reset();
+
+    size_t GetLinkCount() const { return m_links.size(); }
+    const TransformDriver& GetLink(size_t linkIndex) const { return *m_links[linkIndex]->driver; }
+
+private:
+    struct Link {
+        std::unique_ptr<TransformDriver> driver;
+        ChainLinkOwnership ownership = ChainLinkOwnership::Borrowed;
+        ComPtr<IMFTransform> pOwned;
+        MFTLease lease;
+        TapCallback tap;
+        std::vector<ComPtr<IMFSample>> outputs;     // 每次处理复用的输出列表，送入下一环节后即释放
+        std::vector<IMFSample*> nextInputs;
+    };
+
+    HRESULT AttachLink(std::unique_ptr<Link> link, IMFTransform* pTransform, const GUID& preferredOutputSubtype, size_t outputPoolSize);
+
+    // 把 ppInputs 送入 linkIndex 环节并逐级传到链尾
+    HRESULT Forward(size_t linkIndex, IMFSample* const* ppInputs, size_t count, std::vector<ComPtr<IMFSample>>& outputs);
+
+    // linkIndex 环节产出的 link.outputs 交给下一环节，链尾则追加到 outputs
+    HRESULT Deliver(size_t linkIndex, std::vector<ComPtr<IMFSample>>& outputs);
+
+    std::vector<std::unique_ptr<Link>> m_links;
+};
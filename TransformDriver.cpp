@@ -0,0 +1,225 @@
+#include "TransformDriver.h"
+#include <mferror.h>
+
+TransformDriver::TransformDriver() {}
+
+TransformDriver::~TransformDriver() {
+    Detach();
+}
+
+HRESULT TransformDriver::Attach(IMFTransform* pTransform, const GUID& preferredOutputSubtype) {
+    if (pTransform == nullptr) return E_POINTER;
+    Detach();
+
+    m_pTransform = pTransform;
+    m_preferredOutputSubtype = preferredOutputSubtype;
+    m_outputStatusSupported = true;
+
+    HRESULT hr = RefreshStreamInfo();
+    if (FAILED(hr)) {
+        Detach();
+        return hr;
+    }
+
+    // 输出类型解析失败不影响驱动（例如尚未协商分辨率的编码器），只是格式字段为空
+    ComPtr<IMFMediaType> pOutputType;
+    if (SUCCEEDED(m_pTransform->GetOutputCurrentType(0, &pOutputType))) {
+        VideoFormatFromMediaType(pOutputType.Get(), &m_outputFormat);
+    }
+    return S_OK;
+}
+
+void TransformDriver::Detach() {
+    m_pSpareOutput.Reset();
+    if (m_pOutputPool) {
+        // 仍在下游的采样释放时直接销毁
+        m_pOutputPool->Shutdown();
+        m_pOutputPool.Reset();
+    }
+    m_pTransform.Reset();
+    m_outputInfo = {};
+    m_providesSamples = false;
+    m_outputFormat = {};
+    m_formatChanged = false;
+}
+
+HRESULT TransformDriver::RefreshStreamInfo() {
+    HRESULT hr = m_pTransform->GetOutputStreamInfo(0, &m_outputInfo);
+    if (FAILED(hr)) return hr;
+
+    // MFT 能自己分配输出采样时交给它分配，省去每次创建缓冲
+    m_providesSamples = (m_outputInfo.dwFlags & (MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES)) != 0;
+    m_pSpareOutput.Reset();
+    return UpdateOutputPool();
+}
+
+HRESULT TransformDriver::UpdateOutputPool() {
+    if (m_providesSamples || m_outputPoolSize == 0) {
+        if (m_pOutputPool) {
+            m_pOutputPool->Shutdown();
+            m_pOutputPool.Reset();
+        }
+        return S_OK;
+    }
+    if (m_pOutputPool) {
+        m_pOutputPool->Reconfigure(m_outputInfo.cbSize, m_outputInfo.cbAlignment);
+        return S_OK;
+    }
+    return SamplePool::Create(m_outputInfo.cbSize, m_outputInfo.cbAlignment, m_outputPoolSize, &m_pOutputPool);
+}
+
+void TransformDriver::SetOutputPoolSize(size_t maxIdle) {
+    if (maxIdle == m_outputPoolSize) return;
+    m_outputPoolSize = maxIdle;
+    if (m_pOutputPool) {
+        m_pOutputPool->Shutdown();
+        m_pOutputPool.Reset();
+    }
+    if (m_pTransform) {
+        m_pSpareOutput.Reset();
+        UpdateOutputPool();
+    }
+}
+
+SamplePoolStats TransformDriver::GetOutputPoolStats() const {
+    return m_pOutputPool ? m_pOutputPool->GetStats() : SamplePoolStats();
+}
+
+HRESULT TransformDriver::HandleStreamChange() {
+    // 优先选择调用方指定的子类型，没有则用 MFT 给出的第一个可用类型
+    ComPtr<IMFMediaType> pChosen;
+    for (DWORD i = 0;; i++) {
+        ComPtr<IMFMediaType> pType;
+        HRESULT hr = m_pTransform->GetOutputAvailableType(0, i, &pType);
+        if (hr == MF_E_NO_MORE_TYPES) break;
+        if (FAILED(hr)) return hr;
+
+        if (!pChosen) pChosen = pType;
+        GUID subtype = GUID_NULL;
+        if (m_preferredOutputSubtype == GUID_NULL) break;
+        if (SUCCEEDED(pType->GetGUID(MF_MT_SUBTYPE, &subtype)) && subtype == m_preferredOutputSubtype) {
+            pChosen = pType;
+            break;
+        }
+    }
+    if (!pChosen) return MF_E_INVALIDMEDIATYPE;
+
+    HRESULT hr = m_pTransform->SetOutputType(0, pChosen.Get(), 0);
+    if (FAILED(hr)) return hr;
+
+    hr = VideoFormatFromMediaType(pChosen.Get(), &m_outputFormat);
+    if (FAILED(hr)) return hr;
+
+    m_formatChanged = true;
+    m_stats.streamChanges++;
+    return RefreshStreamInfo();
+}
+
+HRESULT TransformDriver::PullOutputs(std::vector<ComPtr<IMFSample>>& outputs) {
+    while (true) {
+        MFT_OUTPUT_DATA_BUFFER outputBuffer = {};
+        DWORD status = 0;
+
+        if (!m_providesSamples) {
+            // 上次返回 NEED_MORE_INPUT 时没有被填充的采样留到这里复用
+            if (!m_pSpareOutput && m_pOutputPool) {
+                HRESULT hr = m_pOutputPool->AcquireSample(&m_pSpareOutput);
+                if (FAILED(hr)) return hr;
+            }
+            else if (!m_pSpareOutput) {
+                ComPtr<IMFMediaBuffer> pBuffer;
+                HRESULT hr = (m_outputInfo.cbAlignment > 1) ?
+                    MFCreateAlignedMemoryBuffer(m_outputInfo.cbSize, m_outputInfo.cbAlignment - 1, &pBuffer) :
+                    MFCreateMemoryBuffer(m_outputInfo.cbSize, &pBuffer);
+                if (FAILED(hr)) return hr;
+                hr = MFCreateSample(&m_pSpareOutput);
+                if (FAILED(hr)) return hr;
+                hr = m_pSpareOutput->AddBuffer(pBuffer.Get());
+                if (FAILED(hr)) return hr;
+            }
+            outputBuffer.pSample = m_pSpareOutput.Get();
+        }
+
+        HRESULT hr = m_pTransform->ProcessOutput(0, 1, &outputBuffer, &status);
+        m_stats.processOutputCalls++;
+        if (outputBuffer.pEvents) outputBuffer.pEvents->Release();
+
+        if (hr == S_OK) {
+            ComPtr<IMFSample> pOutput;
+            if (m_providesSamples) {
+                pOutput.Attach(outputBuffer.pSample);
+            }
+            else {
+                pOutput.Swap(m_pSpareOutput);
+            }
+            if (pOutput) {
+                outputs.push_back(pOutput);
+                m_stats.outputs++;
+            }
+            continue;
+        }
+        if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT) return S_OK;
+        if (hr == MF_E_TRANSFORM_STREAM_CHANGE) {
+            hr = HandleStreamChange();
+            if (FAILED(hr)) return hr;
+            continue;
+        }
+        return hr;
+    }
+}
+
+HRESULT TransformDriver::Process(IMFSample* const* ppInputs, size_t count, std::vector<ComPtr<IMFSample>>& outputs) {
+    if (!m_pTransform) return MF_E_NOT_INITIALIZED;
+    m_formatChanged = false;
+
+    HRESULT hr = S_OK;
+    for (size_t i = 0; i < count; i++) {
+        // MFT 明确表示不能再接收时先取输出；不支持 GetInputStatus 的 MFT 直接尝试送入
+        DWORD inputStatus = MFT_INPUT_STATUS_ACCEPT_DATA;
+        if (SUCCEEDED(m_pTransform->GetInputStatus(0, &inputStatus)) && !(inputStatus & MFT_INPUT_STATUS_ACCEPT_DATA)) {
+            m_stats.notAccepting++;
+            hr = PullOutputs(outputs);
+            if (FAILED(hr)) return hr;
+        }
+
+        hr = m_pTransform->ProcessInput(0, ppInputs[i], 0);
+        if (hr == MF_E_NOTACCEPTING) {
+            m_stats.notAccepting++;
+            hr = PullOutputs(outputs);
+            if (FAILED(hr)) return hr;
+            hr = m_pTransform->ProcessInput(0, ppInputs[i], 0);
+        }
+        if (FAILED(hr)) return hr;
+        m_stats.inputs++;
+
+        // 只有 MFT 报告输出就绪时才取，其余时间继续送入，避免空转的 ProcessOutput
+        if (m_outputStatusSupported) {
+            DWORD outputStatus = 0;
+            hr = m_pTransform->GetOutputStatus(&outputStatus);
+            if (hr == E_NOTIMPL) {
+                m_outputStatusSupported = false;
+            }
+            else if (SUCCEEDED(hr) && (outputStatus & MFT_OUTPUT_STATUS_SAMPLE_READY)) {
+                hr = PullOutputs(outputs);
+                if (FAILED(hr)) return hr;
+            }
+        }
+    }
+
+    // 一批结束时取空已就绪的输出，保证调用方拿到这批输入能产出的全部帧
+    return PullOutputs(outputs);
+}
+
+HRESULT TransformDriver::Drain(std::vector<ComPtr<IMFSample>>& outputs) {
+    if (!m_pTransform) return MF_E_NOT_INITIALIZED;
+    m_formatChanged = false;
+
+    HRESULT hr = m_pTransform->ProcessMessage(MFT_MESSAGE_COMMAND_DRAIN, 0);
+    if (FAILED(hr)) return hr;
+    return PullOutputs(outputs);
+}
+
+HRESULT TransformDriver::Flush() {
+    if (!m_pTransform) return MF_E_NOT_INITIALIZED;
+    return m_pTransform->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, 0);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+#include <vector>
+#include "VideoFormat.h"
+#include "SamplePool.h"
+
+using namespace Microsoft::WRL;
+
+struct TransformDriverStats {
+    UINT64 inputs = 0;
+    UINT64 outputs = 0;
+    UINT64 processOutputCalls = 0;  // 含返回 NEED_MORE_INPUT 的空调用
+    UINT64 notAccepting = 0;        // 输入被拒、需要先取输出的次数
+    UINT64 streamChanges = 0;
+};
+
+// 批量驱动一个同步 MFT：一次送入一组输入采样，返回期间产出的全部输出
+// 输出流信息只在绑定和流变化时查询；按 GetInputStatus/GetOutputStatus 交替送入与取出，
+// 让 MFT 内部队列保持满载，而不是每送一个采样就轮询 ProcessOutput 直到 NEED_MORE_INPUT
+class TransformDriver {
+public:
+    TransformDriver();
+    ~TransformDriver();
+
+    // 绑定 MFT（输入/输出类型须已设置）；preferredOutputSubtype 用于流变化后重新选择输出类型
+    HRESULT Attach(IMFTransform* pTransform, const GUID& preferredOutputSubtype = GUID_NULL);
+    void Detach();
+
+    // 送入 count 个输入采样，产出的输出追加到 outputs；
+    // 结束时取空 MFT 已就绪的输出，但不发送 DRAIN，后续输入可继续参考之前的帧
+    HRESULT Process(IMFSample* const* ppInputs, size_t count, std::vector<ComPtr<IMFSample>>& outputs);
+    HRESULT Process(IMFSample* pInput, std::vector<ComPtr<IMFSample>>& outputs) { return Process(&pInput, 1, outputs); }
+
+    // 流结束：发送 DRAIN 并取出剩余全部输出
+    HRESULT Drain(std::vector<ComPtr<IMFSample>>& outputs);
+
+    // 丢弃 MFT 内部缓存的数据
+    HRESULT Flush();
+
+    // 上一次 Process/Drain 期间输出格式是否变化（变化前的输出已全部返回）
+    bool OutputFormatChanged() const { return m_formatChanged; }
+    const VideoFormat& GetOutputFormat() const { return m_outputFormat; }
+
+    const TransformDriverStats& GetStats() const { return m_stats; }
+
+    // 输出采样改从池中分配，下游释放最后一个引用后回收；maxIdle 为 0 时每次新建
+    // 输出可以按引用直接交给下一个 MFT，不需要拷贝（见 TransformChain）
+    void SetOutputPoolSize(size_t maxIdle);
+    SamplePoolStats GetOutputPoolStats() const;
+
+private:
+    HRESULT RefreshStreamInfo();
+    HRESULT HandleStreamChange();
+    HRESULT UpdateOutputPool();
+
+    // 取出输出直到 MFT 需要更多输入
+    HRESULT PullOutputs(std::vector<ComPtr<IMFSample>>& outputs);
+
+    ComPtr<IMFTransform> m_pTransform;
+    GUID m_preferredOutputSubtype = GUID_NULL;
+    MFT_OUTPUT_STREAM_INFO m_outputInfo = {};
+    bool m_providesSamples = false;
+    bool m_outputStatusSupported = true;    // GetOutputStatus 返回 E_NOTIMPL 后不再调用
+    ComPtr<IMFSample> m_pSpareOutput;       // 上次未被填充的输出采样，下次直接复用
+    size_t m_outputPoolSize = 0;
+    ComPtr<SamplePool> m_pOutputPool;       // MFT 自己分配输出采样时不创建
+    VideoFormat m_outputFormat = {};
+    bool m_formatChanged = false;
+    TransformDriverStats m_stats;
+};
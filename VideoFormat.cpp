@@ -0,0 +1,208 @@
+#include "VideoFormat.h"
+#include <mferror.h>
+#include <cstring>
+#include <cstdlib>
+
+// FCC('I010')
+const GUID VideoFormat_I010 = { 0x30313049, 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 } };
+
+VideoSubtype VideoSubtypeFromGUID(const GUID& subtype) {
+    if (subtype == MFVideoFormat_H264) return VideoSubtype::H264;
+    if (subtype == MFVideoFormat_HEVC) return VideoSubtype::HEVC;
+    if (subtype == MFVideoFormat_MJPG) return VideoSubtype::MJPG;
+    if (subtype == MFVideoFormat_NV12) return VideoSubtype::NV12;
+    if (subtype == MFVideoFormat_P010) return VideoSubtype::P010;
+    if (subtype == VideoFormat_I010) return VideoSubtype::I010;
+    if (subtype == MFVideoFormat_YUY2) return VideoSubtype::YUY2;
+    if (subtype == MFVideoFormat_UYVY) return VideoSubtype::UYVY;
+    if (subtype == MFVideoFormat_I420) return VideoSubtype::I420;
+    if (subtype == MFVideoFormat_IYUV) return VideoSubtype::IYUV;
+    if (subtype == MFVideoFormat_YV12) return VideoSubtype::YV12;
+    if (subtype == MFVideoFormat_RGB24) return VideoSubtype::RGB24;
+    if (subtype == MFVideoFormat_RGB32) return VideoSubtype::RGB32;
+    if (subtype == MFVideoFormat_ARGB32) return VideoSubtype::ARGB32;
+    return VideoSubtype::Unknown;
+}
+
+const char* VideoSubtypeName(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::H264: return "H264";
+    case VideoSubtype::HEVC: return "HEVC";
+    case VideoSubtype::MJPG: return "MJPG";
+    case VideoSubtype::NV12: return "NV12";
+    case VideoSubtype::P010: return "P010";
+    case VideoSubtype::I010: return "I010";
+    case VideoSubtype::YUY2: return "YUY2";
+    case VideoSubtype::UYVY: return "UYVY";
+    case VideoSubtype::I420: return "I420";
+    case VideoSubtype::IYUV: return "IYUV";
+    case VideoSubtype::YV12: return "YV12";
+    case VideoSubtype::RGB24: return "RGB24";
+    case VideoSubtype::RGB32: return "RGB32";
+    case VideoSubtype::ARGB32: return "ARGB32";
+    default: return "Unknown";
+    }
+}
+
+static bool IsCompressedSubtype(VideoSubtype subtype) {
+    return subtype == VideoSubtype::H264 || subtype == VideoSubtype::HEVC || subtype == VideoSubtype::MJPG;
+}
+
+// 媒体类型未给出 MF_MT_DEFAULT_STRIDE 时按子类型计算最小行跨度
+static LONG ComputeDefaultStride(VideoSubtype subtype, const GUID& subtypeGuid, UINT32 width) {
+    LONG stride = 0;
+    if (SUCCEEDED(MFGetStrideForBitmapInfoHeader(subtypeGuid.Data1, width, &stride))) return stride;
+
+    switch (subtype) {
+    case VideoSubtype::P010:
+    case VideoSubtype::I010: return static_cast<LONG>(width * 2);
+    case VideoSubtype::YUY2:
+    case VideoSubtype::UYVY: return static_cast<LONG>(width * 2);
+    case VideoSubtype::RGB24: return static_cast<LONG>((width * 3 + 3) & ~3u);
+    case VideoSubtype::RGB32:
+    case VideoSubtype::ARGB32: return static_cast<LONG>(width * 4);
+    default: return static_cast<LONG>(width);
+    }
+}
+
+static void ComputePlaneLayout(VideoFormat* pFormat, LONG stride) {
+    UINT32 rowBytes = static_cast<UINT32>(std::labs(stride));
+    UINT32 chromaHeight = (pFormat->height + 1) / 2;
+    pFormat->bytesPerSample = IsHighBitDepth(pFormat->subtype) ? 2 : 1;
+
+    switch (pFormat->subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::P010:
+        // Y 平面后紧跟交错的 UV 平面，行跨度相同
+        pFormat->planeCount = 2;
+        pFormat->stride[0] = pFormat->stride[1] = stride;
+        pFormat->planeHeight[0] = pFormat->height;
+        pFormat->planeHeight[1] = chromaHeight;
+        pFormat->planeOffset[1] = rowBytes * pFormat->height;
+        pFormat->frameBytes = rowBytes * (pFormat->height + chromaHeight);
+        break;
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+    case VideoSubtype::I010: {
+        // 三个平面，色度行跨度为亮度的一半；YV12 的 V 平面在 U 之前，planeOffset[1]/[2] 始终对应 U/V
+        UINT32 chromaRowBytes = rowBytes / 2;
+        UINT32 lumaBytes = rowBytes * pFormat->height;
+        UINT32 chromaBytes = chromaRowBytes * chromaHeight;
+        pFormat->planeCount = 3;
+        pFormat->stride[0] = stride;
+        pFormat->stride[1] = pFormat->stride[2] = static_cast<LONG>(chromaRowBytes);
+        pFormat->planeHeight[0] = pFormat->height;
+        pFormat->planeHeight[1] = pFormat->planeHeight[2] = chromaHeight;
+        bool vFirst = (pFormat->subtype == VideoSubtype::YV12);
+        pFormat->planeOffset[1] = lumaBytes + (vFirst ? chromaBytes : 0);
+        pFormat->planeOffset[2] = lumaBytes + (vFirst ? 0 : chromaBytes);
+        pFormat->frameBytes = lumaBytes + 2 * chromaBytes;
+        break;
+    }
+    default:
+        // 打包格式只有一个平面
+        pFormat->planeCount = 1;
+        pFormat->stride[0] = stride;
+        pFormat->planeHeight[0] = pFormat->height;
+        pFormat->frameBytes = rowBytes * pFormat->height;
+        break;
+    }
+}
+
+// FNV-1a
+static void HashBytes(UINT64* pHash, const void* pData, size_t size) {
+    const BYTE* p = static_cast<const BYTE*>(pData);
+    for (size_t i = 0; i < size; i++) {
+        *pHash ^= p[i];
+        *pHash *= 1099511628211ull;
+    }
+}
+
+static UINT64 HashVideoFormat(const VideoFormat& format) {
+    // 逐字段哈希，不依赖结构体填充字节的内容
+    UINT64 hash = 14695981039346656037ull;
+    HashBytes(&hash, &format.subtypeGuid, sizeof(format.subtypeGuid));
+    HashBytes(&hash, &format.width, sizeof(format.width));
+    HashBytes(&hash, &format.height, sizeof(format.height));
+    HashBytes(&hash, &format.fpsNum, sizeof(format.fpsNum));
+    HashBytes(&hash, &format.fpsDen, sizeof(format.fpsDen));
+    HashBytes(&hash, &format.parNum, sizeof(format.parNum));
+    HashBytes(&hash, &format.parDen, sizeof(format.parDen));
+    HashBytes(&hash, format.stride, sizeof(format.stride));
+    HashBytes(&hash, &format.interlaceMode, sizeof(format.interlaceMode));
+    HashBytes(&hash, &format.yuvMatrix, sizeof(format.yuvMatrix));
+    HashBytes(&hash, &format.nominalRange, sizeof(format.nominalRange));
+    HashBytes(&hash, &format.primaries, sizeof(format.primaries));
+    HashBytes(&hash, &format.transferFunction, sizeof(format.transferFunction));
+    HashBytes(&hash, &format.chromaSiting, sizeof(format.chromaSiting));
+    return hash;
+}
+
+HRESULT VideoFormatFromMediaType(IMFMediaType* pType, VideoFormat* pFormat) {
+    if (pType == nullptr || pFormat == nullptr) return E_POINTER;
+
+    VideoFormat format;
+    memset(&format, 0, sizeof(format));
+
+    HRESULT hr = pType->GetGUID(MF_MT_SUBTYPE, &format.subtypeGuid);
+    if (FAILED(hr)) return hr;
+    hr = MFGetAttributeSize(pType, MF_MT_FRAME_SIZE, &format.width, &format.height);
+    if (FAILED(hr)) return hr;
+    if (format.width == 0 || format.height == 0) return MF_E_INVALIDMEDIATYPE;
+
+    format.subtype = VideoSubtypeFromGUID(format.subtypeGuid);
+    format.compressed = IsCompressedSubtype(format.subtype) ||
+        MFGetAttributeUINT32(pType, MF_MT_COMPRESSED, FALSE) != FALSE;
+
+    if (SUCCEEDED(MFGetAttributeRatio(pType, MF_MT_FRAME_RATE, &format.fpsNum, &format.fpsDen)) &&
+        format.fpsNum != 0 && format.fpsDen != 0) {
+        format.frameDuration = MFllMulDiv(format.fpsDen, 10000000, format.fpsNum, 0);
+    }
+    if (FAILED(MFGetAttributeRatio(pType, MF_MT_PIXEL_ASPECT_RATIO, &format.parNum, &format.parDen))) {
+        format.parNum = format.parDen = 1;
+    }
+
+    if (!format.compressed) {
+        LONG stride = 0;
+        if (FAILED(pType->GetUINT32(MF_MT_DEFAULT_STRIDE, reinterpret_cast<UINT32*>(&stride))) || stride == 0) {
+            stride = ComputeDefaultStride(format.subtype, format.subtypeGuid, format.width);
+        }
+        ComputePlaneLayout(&format, stride);
+    }
+
+    format.interlaceMode = MFGetAttributeUINT32(pType, MF_MT_INTERLACE_MODE, MFVideoInterlace_Unknown);
+    format.yuvMatrix = MFGetAttributeUINT32(pType, MF_MT_YUV_MATRIX, MFVideoTransferMatrix_Unknown);
+    format.nominalRange = MFGetAttributeUINT32(pType, MF_MT_VIDEO_NOMINAL_RANGE, MFNominalRange_Unknown);
+    format.primaries = MFGetAttributeUINT32(pType, MF_MT_VIDEO_PRIMARIES, MFVideoPrimaries_Unknown);
+    format.transferFunction = MFGetAttributeUINT32(pType, MF_MT_TRANSFER_FUNCTION, MFVideoTransFunc_Unknown);
+    format.chromaSiting = MFGetAttributeUINT32(pType, MF_MT_VIDEO_CHROMA_SITING, MFVideoChromaSubsampling_Unknown);
+
+    format.hash = HashVideoFormat(format);
+    *pFormat = format;
+    return S_OK;
+}
+
+HRESULT ImagePlanesFromBuffer(const VideoFormat& format, BYTE* pBuffer, DWORD cbBuffer, ImagePlanes* pPlanes) {
+    if (pBuffer == nullptr || pPlanes == nullptr) return E_POINTER;
+    if (format.compressed || format.planeCount == 0) return MF_E_INVALIDMEDIATYPE;
+    if (cbBuffer < format.frameBytes) return MF_E_BUFFERTOOSMALL;
+
+    ImagePlanes planes;
+    memset(&planes, 0, sizeof(planes));
+    planes.subtype = format.subtype;
+    planes.width = format.width;
+    planes.height = format.height;
+    planes.planeCount = format.planeCount;
+    for (UINT32 i = 0; i < format.planeCount; i++) {
+        BYTE* pPlane = pBuffer + format.planeOffset[i];
+        if (format.stride[i] < 0) {
+            // 自底向上：缓冲中最后一行是画面顶部
+            pPlane += static_cast<size_t>(-format.stride[i]) * (format.planeHeight[i] - 1);
+        }
+        planes.data[i] = pPlane;
+        planes.stride[i] = format.stride[i];
+    }
+    *pPlanes = planes;
+    return S_OK;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+
+// 常用视频子类型，按值比较代替 16 字节 GUID 比较
+enum class VideoSubtype : UINT8 {
+    Unknown,
+    H264,
+    HEVC,
+    MJPG,
+    NV12,
+    P010,
+    I010,
+    YUY2,
+    UYVY,
+    I420,
+    IYUV,
+    YV12,
+    RGB24,
+    RGB32,
+    ARGB32,
+};
+
+const UINT32 VIDEO_FORMAT_MAX_PLANES = 3;
+
+// 10 位三平面 4:2:0（I420 布局，每个分量 16 位、低 10 位有效）；Media Foundation 没有预定义这个子类型
+extern const GUID VideoFormat_I010;
+
+// 从 IMFMediaType 一次性解析出的视频格式描述（POD）
+// 在设置媒体类型或流变化时解析，逐帧代码只读这里的字段，不再查询 COM 属性存储
+struct VideoFormat {
+    VideoSubtype subtype;
+    GUID subtypeGuid;
+    bool compressed;
+
+    UINT32 width;
+    UINT32 height;
+    UINT32 fpsNum;
+    UINT32 fpsDen;
+    UINT32 parNum;              // 像素宽高比
+    UINT32 parDen;
+    LONGLONG frameDuration;     // 单位 100ns，帧率未知时为 0
+
+    // 平面布局（压缩格式 planeCount 为 0）。stride 为负表示自底向上存储的 RGB
+    UINT32 planeCount;
+    LONG stride[VIDEO_FORMAT_MAX_PLANES];
+    UINT32 planeOffset[VIDEO_FORMAT_MAX_PLANES];
+    UINT32 planeHeight[VIDEO_FORMAT_MAX_PLANES];
+    UINT32 bytesPerSample;      // 每个分量的字节数，P010/I010 为 2
+    UINT32 frameBytes;          // 一帧未压缩数据的字节数
+
+    // 颜色信息，未设置时为对应枚举的 Unknown 值
+    UINT32 interlaceMode;       // MFVideoInterlaceMode
+    UINT32 yuvMatrix;           // MFVideoTransferMatrix
+    UINT32 nominalRange;        // MFNominalRange
+    UINT32 primaries;           // MFVideoPrimaries
+    UINT32 transferFunction;    // MFVideoTransferFunction
+    UINT32 chromaSiting;        // MFVideoChromaSubsampling
+
+    UINT64 hash;                // 以上字段的哈希，快速判断格式是否变化
+};
+
+VideoSubtype VideoSubtypeFromGUID(const GUID& subtype);
+inline bool IsHighBitDepth(VideoSubtype subtype) { return subtype == VideoSubtype::P010 || subtype == VideoSubtype::I010; }
+const char* VideoSubtypeName(VideoSubtype subtype);
+
+// 解析媒体类型；缺少子类型或分辨率时返回错误
+HRESULT VideoFormatFromMediaType(IMFMediaType* pType, VideoFormat* pFormat);
+
+inline bool IsSameVideoFormat(const VideoFormat& a, const VideoFormat& b) { return a.hash == b.hash; }
+
+// 一帧未压缩图像的平面视图，不持有内存
+// data 指向每个平面画面顶部的第一行，自底向上存储的 RGB 行跨度为负
+struct ImagePlanes {
+    VideoSubtype subtype;
+    UINT32 width;
+    UINT32 height;
+    UINT32 planeCount;
+    BYTE* data[VIDEO_FORMAT_MAX_PLANES];
+    LONG stride[VIDEO_FORMAT_MAX_PLANES];
+};
+
+// 画面方向：先（可选）转置，再水平/垂直翻转输出，8 种取值覆盖所有 90 度旋转和镜像
+// 按位组合：FlipHorizontal = 1，FlipVertical = 2，Transpose = 4；旋转角度为顺时针
+enum class FrameOrientation : UINT8 {
+    Identity = 0,
+    FlipHorizontal = 1,
+    FlipVertical = 2,
+    Rotate180 = 3,
+    Transpose = 4,      // 沿主对角线镜像
+    Rotate90 = 5,       // 转置 + 水平翻转
+    Rotate270 = 6,      // 转置 + 垂直翻转
+    Transverse = 7,     // 沿副对角线镜像
+};
+
+inline bool SwapsAxes(FrameOrientation orientation) { return (static_cast<UINT8>(orientation) & 4) != 0; }
+inline bool FlipsHorizontally(FrameOrientation orientation) { return (static_cast<UINT8>(orientation) & 1) != 0; }
+inline bool FlipsVertically(FrameOrientation orientation) { return (static_cast<UINT8>(orientation) & 2) != 0; }
+// 去掉转置后剩下的翻转部分：Rotate90 = Transpose 之后再 FlipHorizontal
+inline FrameOrientation FlipsOf(FrameOrientation orientation) {
+    return static_cast<FrameOrientation>(static_cast<UINT8>(orientation) & 3);
+}
+
+// 按 format 的平面布局在 pBuffer 上建立视图；缓冲小于 frameBytes 时返回错误
+HRESULT ImagePlanesFromBuffer(const VideoFormat& format, BYTE* pBuffer, DWORD cbBuffer, ImagePlanes* pPlanes);
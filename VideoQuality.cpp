@@ -0,0 +1,230 @@
+#include "VideoQuality.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VIDEO_QUALITY_SSE2 1
+#endif
+
+// SSIM 常数（峰值 255），取 x264 / ffmpeg 的 ssim_c1、ssim_c2，保证结果与它们可比
+// （C1 只乘 64 而不是换算到样点和平方的 64 * 64，是 x264 沿用下来的取值）
+static const double SSIM_C1 = (0.01 * 255) * (0.01 * 255) * 64;
+static const double SSIM_C2 = (0.03 * 255) * (0.03 * 255) * 64 * 63;
+
+// MS-SSIM 各尺度的权重（Wang, Simoncelli, Bovik 2003）
+static const double MS_SSIM_WEIGHTS[] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+static const int MS_SSIM_SCALES = 5;
+
+// ---- PSNR ----
+
+uint64_t ComputeSse(const QualityPlane& a, const QualityPlane& b) {
+    uint32_t width = (std::min)(a.width, b.width), height = (std::min)(a.height, b.height);
+    uint64_t sum = 0;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* pA = a.data + static_cast<ptrdiff_t>(y) * a.stride;
+        const uint8_t* pB = b.data + static_cast<ptrdiff_t>(y) * b.stride;
+        uint32_t x = 0;
+#ifdef VIDEO_QUALITY_SSE2
+        // 每次迭代每个 32 位通道最多加 4 * 255^2，一行 64K 个样点以内不会溢出，每行转到 64 位累加
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pA + x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pB + x));
+            __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        sum += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+        for (; x < width; x++) {
+            int d = pA[x] - pB[x];
+            sum += static_cast<uint64_t>(d * d);
+        }
+    }
+    return sum;
+}
+
+double PsnrFromMse(double mse) {
+    if (mse <= 0.0) return VIDEO_QUALITY_MAX_PSNR;
+    return (std::min)(10.0 * std::log10(255.0 * 255.0 / mse), VIDEO_QUALITY_MAX_PSNR);
+}
+
+// ---- SSIM ----
+
+// 一个 4x4 块的样点和：a、b 的和，平方和（a^2 + b^2）与乘积和
+struct BlockSums {
+    uint32_t s1, s2, ss, s12;
+};
+
+// 一行 4x4 块（块行顶部为 pA / pB）
+static void BlockRow(const uint8_t* pA, ptrdiff_t strideA, const uint8_t* pB, ptrdiff_t strideB, uint32_t blocks, BlockSums* pOut) {
+    uint32_t bx = 0;
+#ifdef VIDEO_QUALITY_SSE2
+    // 一次 4 个块（16 个样点宽）：和按 16 位累加，平方和与乘积和用 madd 累加到 32 位；
+    // 4 行之后每个 32 位通道是相邻两个样点列的和，再把通道两两相加得到每块的值
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    auto pairs = [](__m128i v) { return _mm_add_epi32(v, _mm_srli_epi64(v, 32)); };
+    for (; bx + 4 <= blocks; bx += 4) {
+        __m128i sumALo = zero, sumAHi = zero, sumBLo = zero, sumBHi = zero;
+        __m128i sqLo = zero, sqHi = zero, crossLo = zero, crossHi = zero;
+        for (int r = 0; r < 4; r++) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pA + r * strideA + bx * 4));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pB + r * strideB + bx * 4));
+            __m128i aLo = _mm_unpacklo_epi8(va, zero), aHi = _mm_unpackhi_epi8(va, zero);
+            __m128i bLo = _mm_unpacklo_epi8(vb, zero), bHi = _mm_unpackhi_epi8(vb, zero);
+            sumALo = _mm_add_epi16(sumALo, aLo);
+            sumAHi = _mm_add_epi16(sumAHi, aHi);
+            sumBLo = _mm_add_epi16(sumBLo, bLo);
+            sumBHi = _mm_add_epi16(sumBHi, bHi);
+            sqLo = _mm_add_epi32(sqLo, _mm_add_epi32(_mm_madd_epi16(aLo, aLo), _mm_madd_epi16(bLo, bLo)));
+            sqHi = _mm_add_epi32(sqHi, _mm_add_epi32(_mm_madd_epi16(aHi, aHi), _mm_madd_epi16(bHi, bHi)));
+            crossLo = _mm_add_epi32(crossLo, _mm_madd_epi16(aLo, bLo));
+            crossHi = _mm_add_epi32(crossHi, _mm_madd_epi16(aHi, bHi));
+        }
+        // 通道 0 和 2 分别是低半（或高半）两个块的值
+        alignas(16) uint32_t v[8][4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[0]), pairs(_mm_madd_epi16(sumALo, ones)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[1]), pairs(_mm_madd_epi16(sumAHi, ones)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[2]), pairs(_mm_madd_epi16(sumBLo, ones)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[3]), pairs(_mm_madd_epi16(sumBHi, ones)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[4]), pairs(sqLo));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[5]), pairs(sqHi));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[6]), pairs(crossLo));
+        _mm_store_si128(reinterpret_cast<__m128i*>(v[7]), pairs(crossHi));
+        for (int k = 0; k < 4; k++) {
+            int half = k / 2, lane = (k % 2) * 2;
+            pOut[bx + k] = { v[0 + half][lane], v[2 + half][lane], v[4 + half][lane], v[6 + half][lane] };
+        }
+    }
+#endif
+    for (; bx < blocks; bx++) {
+        BlockSums sums = {};
+        for (int r = 0; r < 4; r++) {
+            const uint8_t* a = pA + r * strideA + bx * 4;
+            const uint8_t* b = pB + r * strideB + bx * 4;
+            for (int c = 0; c < 4; c++) {
+                sums.s1 += a[c];
+                sums.s2 += b[c];
+                sums.ss += a[c] * a[c] + b[c] * b[c];
+                sums.s12 += a[c] * b[c];
+            }
+        }
+        pOut[bx] = sums;
+    }
+}
+
+// 一个窗口（2x2 个 4x4 块，64 个样点）的亮度分量和对比度-结构分量
+static void WindowSsim(const BlockSums& a, const BlockSums& b, const BlockSums& c, const BlockSums& d, double* pLuminance,
+    double* pContrastStructure) {
+    double s1 = static_cast<double>(a.s1) + b.s1 + c.s1 + d.s1;
+    double s2 = static_cast<double>(a.s2) + b.s2 + c.s2 + d.s2;
+    double ss = static_cast<double>(a.ss) + b.ss + c.ss + d.ss;
+    double s12 = static_cast<double>(a.s12) + b.s12 + c.s12 + d.s12;
+    double variances = ss * 64 - s1 * s1 - s2 * s2;
+    double covariance = s12 * 64 - s1 * s2;
+    *pLuminance = (2 * s1 * s2 + SSIM_C1) / (s1 * s1 + s2 * s2 + SSIM_C1);
+    *pContrastStructure = (2 * covariance + SSIM_C2) / (variances + SSIM_C2);
+}
+
+double ComputeSsim(const QualityPlane& a, const QualityPlane& b, double* pContrastStructure) {
+    uint32_t width = (std::min)(a.width, b.width), height = (std::min)(a.height, b.height);
+    uint32_t blocksX = width / 4, blocksY = height / 4;
+    if (blocksX < 2 || blocksY < 2) {
+        if (pContrastStructure) *pContrastStructure = 1.0;
+        return 1.0;
+    }
+
+    // 只保留相邻两行块的和
+    std::vector<BlockSums> upper(blocksX), lower(blocksX);
+    BlockRow(a.data, a.stride, b.data, b.stride, blocksX, upper.data());
+    double ssimSum = 0.0, csSum = 0.0;
+    for (uint32_t by = 1; by < blocksY; by++) {
+        BlockRow(a.data + static_cast<ptrdiff_t>(by) * 4 * a.stride, a.stride, b.data + static_cast<ptrdiff_t>(by) * 4 * b.stride,
+            b.stride, blocksX, lower.data());
+        for (uint32_t bx = 0; bx + 1 < blocksX; bx++) {
+            double luminance = 0.0, cs = 0.0;
+            WindowSsim(upper[bx], upper[bx + 1], lower[bx], lower[bx + 1], &luminance, &cs);
+            ssimSum += luminance * cs;
+            csSum += cs;
+        }
+        upper.swap(lower);
+    }
+    double windows = static_cast<double>(blocksX - 1) * (blocksY - 1);
+    if (pContrastStructure) *pContrastStructure = csSum / windows;
+    return ssimSum / windows;
+}
+
+// 2x2 平均下采样（四舍五入），奇数的最后一行 / 一列丢弃
+static void Downsample(const QualityPlane& src, std::vector<uint8_t>& storage, QualityPlane* pDst) {
+    uint32_t width = src.width / 2, height = src.height / 2;
+    storage.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* p0 = src.data + static_cast<ptrdiff_t>(y) * 2 * src.stride;
+        const uint8_t* p1 = p0 + src.stride;
+        uint8_t* pOut = storage.data() + static_cast<size_t>(y) * width;
+        uint32_t x = 0;
+#ifdef VIDEO_QUALITY_SSE2
+        // 先纵向 avg 再横向 avg 会两次进位；这里按和计算保证与标量路径一致
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 8 <= width; x += 8) {
+            __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p0 + x * 2));
+            __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + x * 2));
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+            // 相邻两列相加：madd 得到 32 位和，packs 回 16 位
+            __m128i sum = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(pOut + x), _mm_packus_epi16(sum, sum));
+        }
+#endif
+        for (; x < width; x++) {
+            pOut[x] = static_cast<uint8_t>((p0[x * 2] + p0[x * 2 + 1] + p1[x * 2] + p1[x * 2 + 1] + 2) >> 2);
+        }
+    }
+    pDst->data = storage.data();
+    pDst->stride = width;
+    pDst->width = width;
+    pDst->height = height;
+}
+
+double ComputeMsSsim(const QualityPlane& a, const QualityPlane& b) {
+    QualityPlane scaleA = a, scaleB = b;
+    scaleA.width = scaleB.width = (std::min)(a.width, b.width);
+    scaleA.height = scaleB.height = (std::min)(a.height, b.height);
+    std::vector<uint8_t> storage[4];
+
+    double logSum = 0.0, weightSum = 0.0;
+    for (int scale = 0; scale < MS_SSIM_SCALES; scale++) {
+        if (scaleA.width < 8 || scaleA.height < 8) break;
+        double cs = 1.0;
+        double ssim = ComputeSsim(scaleA, scaleB, &cs);
+        bool last = (scale == MS_SSIM_SCALES - 1) || scaleA.width / 2 < 8 || scaleA.height / 2 < 8;
+        // 亮度分量只在最粗的尺度计入；负的对比度-结构值（画面反相）按 0 处理
+        double term = last ? ssim : cs;
+        if (term <= 0.0) return 0.0;
+        logSum += MS_SSIM_WEIGHTS[scale] * std::log(term);
+        weightSum += MS_SSIM_WEIGHTS[scale];
+        if (last) break;
+
+        QualityPlane nextA, nextB;
+        Downsample(scaleA, storage[(scale % 2) * 2], &nextA);
+        Downsample(scaleB, storage[(scale % 2) * 2 + 1], &nextB);
+        scaleA = nextA;
+        scaleB = nextB;
+    }
+    if (weightSum == 0.0) return 1.0;
+    return std::exp(logSum / weightSum);
+}
+
+double SsimToDb(double ssim) {
+    if (ssim >= 1.0) return VIDEO_QUALITY_MAX_PSNR;
+    return (std::min)(-10.0 * std::log10(1.0 - ssim), VIDEO_QUALITY_MAX_PSNR);
+}
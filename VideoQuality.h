@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 客观画质指标（PSNR / SSIM / MS-SSIM），不依赖 Windows，画质评估工具在 Linux 上也用它
+// 只处理 8 位平面；SSE2 计算平方误差和 SSIM 的 4x4 块和，没有 SSE2 时用等价的标量代码
+
+// 无损（MSE 为 0）时报告的 PSNR 上限
+const double VIDEO_QUALITY_MAX_PSNR = 100.0;
+
+// 一个 8 位平面（不持有内存）
+struct QualityPlane {
+    const uint8_t* data = nullptr;
+    ptrdiff_t stride = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// 两个同尺寸平面的平方误差和
+uint64_t ComputeSse(const QualityPlane& a, const QualityPlane& b);
+
+// 由均方误差得到 PSNR（峰值 255），mse 为 0 时返回 VIDEO_QUALITY_MAX_PSNR
+double PsnrFromMse(double mse);
+
+// SSIM：8x8 窗口按 4 样点步长滑动，窗口和常数都与 x264 / ffmpeg 的 ssim 相同，返回所有窗口的平均值；
+// pContrastStructure 不为空时同时返回对比度-结构分量的平均值（MS-SSIM 使用）。平面小于 8x8 时返回 1
+double ComputeSsim(const QualityPlane& a, const QualityPlane& b, double* pContrastStructure = nullptr);
+
+// MS-SSIM（Wang 2003，5 个尺度，2x2 平均下采样，标准权重）；平面太小放不下 5 个尺度时只用能放下的尺度并重新归一化权重
+double ComputeMsSsim(const QualityPlane& a, const QualityPlane& b);
+
+// SSIM 换算成 dB（-10 log10(1 - ssim)），方便与 PSNR 一起比较
+double SsimToDb(double ssim);
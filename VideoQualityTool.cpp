@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "VideoQuality.h"
+#include "Y4MFile.h"
+
+// 命令行：
+//   VideoQuality <源.y4m> <名称>=<解码.y4m>[,<码流.h264>] [...] [--ms-ssim] [--threads N] [--max-offset N] [--csv <输出.csv>]
+// 每个 <名称>=... 是同一段源视频按一种编码器配置编解码后的结果（MFH264RoundTrip 输出 source.y4m / decoded.y4m / capture.h264），
+// 给出码流文件时按其大小计算码率，输出每种配置的率失真点。只依赖标准库，可以在没有显示器的 Linux 上运行
+
+// 帧头带 XPTS 时按时间戳配对，解码端允许乱序的窗口
+static const size_t PTS_WINDOW_FRAMES = 16;
+// 不带时间戳时按帧序号配对，用开头这么多帧估计编码器延迟造成的帧偏移
+static const size_t OFFSET_PROBE_FRAMES = 8;
+
+struct Config {
+    std::string name;
+    std::string decodedPath;
+    std::string streamPath;
+};
+
+struct Options {
+    std::string sourcePath;
+    std::vector<Config> configs;
+    bool msSsim = false;
+    unsigned threads = 0;
+    int maxOffset = 4;
+    std::string csvPath;
+};
+
+// 一对帧的指标
+struct FrameMetrics {
+    uint64_t sse[3] = {};
+    double psnr[3] = {};
+    double psnrAll = 0.0;       // 三个平面按样点数加权的 MSE 换算
+    double ssim[3] = {};
+    double ssimAll = 0.0;       // 三个平面按样点数加权
+    double msSsim = 0.0;        // 亮度，只在 --ms-ssim 时计算
+};
+
+// 一种配置的率失真点
+struct RdPoint {
+    std::string name;
+    double kbps = -1.0;         // 没有码流文件或帧率时为负
+    size_t frames = 0;
+    size_t unmatchedSource = 0; // 没有对应解码帧的源帧（丢帧、编码器延迟没有排空）
+    size_t unmatchedDecoded = 0;
+    int offset = 0;             // 按帧序号配对时的帧偏移（解码帧 i 对应源帧 i + offset）
+    bool byTimestamp = false;
+    double psnr[3] = {};
+    double psnrAll = 0.0;
+    double minPsnrY = VIDEO_QUALITY_MAX_PSNR;
+    double ssimY = 0.0;
+    double ssimAll = 0.0;
+    double msSsimY = 0.0;
+    double msPerFrame = 0.0;
+};
+
+static void PrintUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  VideoQuality <source.y4m> <name>=<decoded.y4m>[,<stream.h264>] [...]" << std::endl;
+    std::cout << "               [--ms-ssim] [--threads N] [--max-offset N] [--csv <rd.csv>]" << std::endl;
+}
+
+static bool ParseOptions(int argc, char* argv[], Options* pOptions) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--ms-ssim") {
+            pOptions->msSsim = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            pOptions->threads = static_cast<unsigned>(atoi(argv[++i]));
+        }
+        else if (arg == "--max-offset" && i + 1 < argc) {
+            pOptions->maxOffset = (std::max)(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--csv" && i + 1 < argc) {
+            pOptions->csvPath = argv[++i];
+        }
+        else if (arg.compare(0, 2, "--") == 0) {
+            return false;
+        }
+        else if (pOptions->sourcePath.empty()) {
+            pOptions->sourcePath = arg;
+        }
+        else {
+            size_t equals = arg.find('=');
+            if (equals == std::string::npos || equals == 0) return false;
+            Config config;
+            config.name = arg.substr(0, equals);
+            std::string files = arg.substr(equals + 1);
+            size_t comma = files.find(',');
+            config.decodedPath = files.substr(0, comma);
+            if (comma != std::string::npos) config.streamPath = files.substr(comma + 1);
+            pOptions->configs.push_back(config);
+        }
+    }
+    return !pOptions->sourcePath.empty() && !pOptions->configs.empty();
+}
+
+// 一帧的 Y、U、V 平面视图
+static void FramePlanes(const Y4MInfo& info, const Y4MFrame& frame, QualityPlane planes[3]) {
+    size_t lumaBytes = static_cast<size_t>(info.width) * info.height;
+    size_t chromaBytes = static_cast<size_t>(info.ChromaWidth()) * info.ChromaHeight();
+    planes[0] = { frame.data.data(), static_cast<ptrdiff_t>(info.width), info.width, info.height };
+    planes[1] = { frame.data.data() + lumaBytes, static_cast<ptrdiff_t>(info.ChromaWidth()), info.ChromaWidth(), info.ChromaHeight() };
+    planes[2] = { frame.data.data() + lumaBytes + chromaBytes, static_cast<ptrdiff_t>(info.ChromaWidth()), info.ChromaWidth(),
+        info.ChromaHeight() };
+}
+
+static FrameMetrics MeasureFrame(const Y4MInfo& info, const Y4MFrame& source, const Y4MFrame& decoded, bool msSsim) {
+    QualityPlane a[3], b[3];
+    FramePlanes(info, source, a);
+    FramePlanes(info, decoded, b);
+
+    FrameMetrics metrics;
+    int planeCount = info.monochrome ? 1 : 3;
+    uint64_t totalSse = 0, totalSamples = 0;
+    double weightedSsim = 0.0;
+    for (int i = 0; i < planeCount; i++) {
+        uint64_t samples = static_cast<uint64_t>(a[i].width) * a[i].height;
+        metrics.sse[i] = ComputeSse(a[i], b[i]);
+        metrics.psnr[i] = PsnrFromMse(static_cast<double>(metrics.sse[i]) / samples);
+        metrics.ssim[i] = ComputeSsim(a[i], b[i]);
+        totalSse += metrics.sse[i];
+        totalSamples += samples;
+        weightedSsim += metrics.ssim[i] * samples;
+    }
+    metrics.psnrAll = PsnrFromMse(static_cast<double>(totalSse) / totalSamples);
+    metrics.ssimAll = weightedSsim / totalSamples;
+    if (msSsim) metrics.msSsim = ComputeMsSsim(a[0], b[0]);
+    return metrics;
+}
+
+// 按帧并行计算指标：读文件的线程把配好的帧对放进有界队列，工作线程各取一对完整计算
+class MetricWorkers {
+public:
+    MetricWorkers(const Y4MInfo& info, unsigned threads, bool msSsim) : m_info(info), m_msSsim(msSsim) {
+        m_capacity = threads * 2;
+        for (unsigned i = 0; i < threads; i++) m_threads.emplace_back(&MetricWorkers::WorkerLoop, this);
+    }
+
+    ~MetricWorkers() { Finish(); }
+
+    void Submit(Y4MFrame&& source, Y4MFrame&& decoded) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_spaceCV.wait(lock, [this] { return m_queue.size() < m_capacity; });
+        m_queue.push_back({ std::move(source), std::move(decoded) });
+        m_workCV.notify_one();
+    }
+
+    // 等待全部帧对计算完成，返回的结果按提交顺序排列
+    const std::vector<FrameMetrics>& Finish() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done = true;
+        }
+        m_workCV.notify_all();
+        for (auto& thread : m_threads) thread.join();
+        m_threads.clear();
+        return m_results;
+    }
+
+private:
+    struct Pair {
+        Y4MFrame source;
+        Y4MFrame decoded;
+        size_t order = 0;
+    };
+
+    void WorkerLoop() {
+        for (;;) {
+            Pair pair;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCV.wait(lock, [this] { return !m_queue.empty() || m_done; });
+                if (m_queue.empty()) return;
+                pair = std::move(m_queue.front());
+                m_queue.pop_front();
+                pair.order = m_submitted++;
+                m_spaceCV.notify_one();
+            }
+            FrameMetrics metrics = MeasureFrame(m_info, pair.source, pair.decoded, m_msSsim);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_results.size() <= pair.order) m_results.resize(pair.order + 1);
+            m_results[pair.order] = metrics;
+        }
+    }
+
+    Y4MInfo m_info;
+    bool m_msSsim;
+    size_t m_capacity = 2;
+    std::mutex m_mutex;
+    std::condition_variable m_workCV;
+    std::condition_variable m_spaceCV;
+    std::deque<Pair> m_queue;
+    std::vector<std::thread> m_threads;
+    std::vector<FrameMetrics> m_results;
+    size_t m_submitted = 0;
+    bool m_done = false;
+};
+
+// 按帧序号配对时，在开头几帧上找亮度 MSE 最小的偏移（解码帧 i 对应源帧 i + offset）
+static int EstimateOffset(const Y4MInfo& info, const std::vector<Y4MFrame>& sources, const std::vector<Y4MFrame>& decoded,
+    int maxOffset) {
+    int best = 0;
+    double bestMse = -1.0;
+    for (int offset = -maxOffset; offset <= maxOffset; offset++) {
+        uint64_t sse = 0;
+        size_t pairs = 0;
+        for (size_t i = 0; i < decoded.size(); i++) {
+            long long s = static_cast<long long>(i) + offset;
+            if (s < 0 || s >= static_cast<long long>(sources.size())) continue;
+            QualityPlane a[3], b[3];
+            FramePlanes(info, sources[static_cast<size_t>(s)], a);
+            FramePlanes(info, decoded[i], b);
+            sse += ComputeSse(a[0], b[0]);
+            pairs++;
+        }
+        if (pairs == 0) continue;
+        double mse = static_cast<double>(sse) / pairs;
+        if (bestMse < 0.0 || mse < bestMse) {
+            bestMse = mse;
+            best = offset;
+        }
+    }
+    return best;
+}
+
+static bool MeasureConfig(const Options& options, const Config& config, RdPoint* pPoint) {
+    Y4MReader source, decoded;
+    if (!source.Open(options.sourcePath)) {
+        std::cerr << source.GetError() << std::endl;
+        return false;
+    }
+    if (!decoded.Open(config.decodedPath)) {
+        std::cerr << decoded.GetError() << std::endl;
+        return false;
+    }
+    const Y4MInfo& info = source.GetInfo();
+    const Y4MInfo& decodedInfo = decoded.GetInfo();
+    if (info.width != decodedInfo.width || info.height != decodedInfo.height || info.monochrome != decodedInfo.monochrome) {
+        std::cerr << config.name << ": decoded " << decodedInfo.width << "x" << decodedInfo.height << " does not match source "
+            << info.width << "x" << info.height << std::endl;
+        return false;
+    }
+
+    RdPoint point;
+    point.name = config.name;
+    unsigned threads = options.threads ? options.threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+    MetricWorkers workers(info, threads, options.msSsim);
+    auto start = std::chrono::steady_clock::now();
+    size_t decodedFrames = 0;
+
+    Y4MFrame sourceFrame, decodedFrame;
+    bool haveSource = source.ReadFrame(&sourceFrame);
+    bool haveDecoded = decoded.ReadFrame(&decodedFrame);
+    if (haveDecoded) decodedFrames++;
+    point.byTimestamp = haveSource && haveDecoded && sourceFrame.hasPts && decodedFrame.hasPts;
+
+    if (point.byTimestamp) {
+        // 时间戳相差不到半帧算同一帧；解码端保留一个小窗口，容忍静止画面重复帧等造成的轻微乱序
+        int64_t tolerance = (info.fpsNum != 0) ? static_cast<int64_t>(5000000ull * info.fpsDen / info.fpsNum) : 0;
+        std::deque<Y4MFrame> window;
+        if (haveDecoded) window.push_back(std::move(decodedFrame));
+        while (haveSource) {
+            while (window.size() < PTS_WINDOW_FRAMES && decoded.ReadFrame(&decodedFrame)) {
+                window.push_back(std::move(decodedFrame));
+                decodedFrames++;
+            }
+            // 比当前源帧还早的解码帧已经不可能配上
+            while (!window.empty() && window.front().pts < sourceFrame.pts - tolerance) {
+                window.pop_front();
+                point.unmatchedDecoded++;
+            }
+            auto match = std::find_if(window.begin(), window.end(), [&](const Y4MFrame& frame) {
+                return std::llabs(frame.pts - sourceFrame.pts) <= tolerance;
+            });
+            if (match != window.end()) {
+                workers.Submit(std::move(sourceFrame), std::move(*match));
+                window.erase(match);
+                point.frames++;
+            }
+            else {
+                point.unmatchedSource++;
+            }
+            haveSource = source.ReadFrame(&sourceFrame);
+        }
+        point.unmatchedDecoded += window.size();
+        while (decoded.ReadFrame(&decodedFrame)) {
+            decodedFrames++;
+            point.unmatchedDecoded++;
+        }
+    }
+    else {
+        // 没有时间戳：先读开头几帧估计偏移，再按序号一一配对
+        std::vector<Y4MFrame> sources, decodeds;
+        if (haveSource) sources.push_back(std::move(sourceFrame));
+        if (haveDecoded) decodeds.push_back(std::move(decodedFrame));
+        while (sources.size() < OFFSET_PROBE_FRAMES + options.maxOffset && source.ReadFrame(&sourceFrame)) {
+            sources.push_back(std::move(sourceFrame));
+        }
+        while (decodeds.size() < OFFSET_PROBE_FRAMES + options.maxOffset && decoded.ReadFrame(&decodedFrame)) {
+            decodeds.push_back(std::move(decodedFrame));
+            decodedFrames++;
+        }
+        point.offset = EstimateOffset(info, sources, decodeds, options.maxOffset);
+
+        std::deque<Y4MFrame> pendingSource(std::make_move_iterator(sources.begin()), std::make_move_iterator(sources.end()));
+        std::deque<Y4MFrame> pendingDecoded(std::make_move_iterator(decodeds.begin()), std::make_move_iterator(decodeds.end()));
+        for (int i = 0; i < point.offset && !pendingSource.empty(); i++) {
+            pendingSource.pop_front();
+            point.unmatchedSource++;
+        }
+        for (int i = 0; i < -point.offset && !pendingDecoded.empty(); i++) {
+            pendingDecoded.pop_front();
+            point.unmatchedDecoded++;
+        }
+        for (;;) {
+            if (pendingSource.empty() && source.ReadFrame(&sourceFrame)) pendingSource.push_back(std::move(sourceFrame));
+            if (pendingDecoded.empty() && decoded.ReadFrame(&decodedFrame)) {
+                pendingDecoded.push_back(std::move(decodedFrame));
+                decodedFrames++;
+            }
+            if (pendingSource.empty() || pendingDecoded.empty()) break;
+            workers.Submit(std::move(pendingSource.front()), std::move(pendingDecoded.front()));
+            pendingSource.pop_front();
+            pendingDecoded.pop_front();
+            point.frames++;
+        }
+        point.unmatchedSource += pendingSource.size();
+        point.unmatchedDecoded += pendingDecoded.size();
+        while (source.ReadFrame(&sourceFrame)) point.unmatchedSource++;
+        while (decoded.ReadFrame(&decodedFrame)) {
+            decodedFrames++;
+            point.unmatchedDecoded++;
+        }
+    }
+
+    if (source.HasError() || decoded.HasError()) {
+        std::cerr << config.name << ": " << (source.HasError() ? source.GetError() : decoded.GetError()) << std::endl;
+        return false;
+    }
+
+    const std::vector<FrameMetrics>& results = workers.Finish();
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (results.empty()) {
+        std::cerr << config.name << ": no frames could be paired" << std::endl;
+        return false;
+    }
+
+    // PSNR 取逐帧 PSNR 的平均（与 x264 / ffmpeg 的报告一致），另记最差的一帧
+    for (const FrameMetrics& metrics : results) {
+        for (int i = 0; i < 3; i++) point.psnr[i] += metrics.psnr[i];
+        point.psnrAll += metrics.psnrAll;
+        point.minPsnrY = (std::min)(point.minPsnrY, metrics.psnr[0]);
+        point.ssimY += metrics.ssim[0];
+        point.ssimAll += metrics.ssimAll;
+        point.msSsimY += metrics.msSsim;
+    }
+    double count = static_cast<double>(results.size());
+    for (int i = 0; i < 3; i++) point.psnr[i] /= count;
+    point.psnrAll /= count;
+    point.ssimY /= count;
+    point.ssimAll /= count;
+    point.msSsimY /= count;
+    point.msPerFrame = elapsedMs / count;
+
+    // 码率：码流字节数除以解码帧覆盖的时长
+    if (!config.streamPath.empty() && info.fpsNum != 0) {
+        std::ifstream stream(config.streamPath, std::ios::binary | std::ios::ate);
+        if (!stream) {
+            std::cerr << config.name << ": cannot open " << config.streamPath << std::endl;
+            return false;
+        }
+        double seconds = static_cast<double>(decodedFrames) * info.fpsDen / info.fpsNum;
+        if (seconds > 0.0) point.kbps = static_cast<double>(stream.tellg()) * 8.0 / seconds / 1000.0;
+    }
+
+    *pPoint = point;
+    return true;
+}
+
+static void PrintPoints(const std::vector<RdPoint>& points, bool msSsim) {
+    printf("%-16s %9s %7s %9s %8s %7s %7s %7s %7s %7s %7s %8s%s %8s\n", "config", "kbps", "frames", "unmatched", "pairing",
+        "PSNR-Y", "PSNR-U", "PSNR-V", "PSNR", "min-Y", "SSIM-Y", "SSIM(dB)", msSsim ? "  MS-SSIM" : "", "ms/frame");
+    for (const RdPoint& p : points) {
+        char kbps[32], unmatched[32], pairing[32], ms[32] = "";
+        if (p.kbps >= 0.0) snprintf(kbps, sizeof(kbps), "%.1f", p.kbps);
+        else snprintf(kbps, sizeof(kbps), "-");
+        snprintf(unmatched, sizeof(unmatched), "%zu/%zu", p.unmatchedSource, p.unmatchedDecoded);
+        if (p.byTimestamp) snprintf(pairing, sizeof(pairing), "pts");
+        else snprintf(pairing, sizeof(pairing), "idx%+d", p.offset);
+        if (msSsim) snprintf(ms, sizeof(ms), "  %7.5f", p.msSsimY);
+        printf("%-16s %9s %7zu %9s %8s %7.3f %7.3f %7.3f %7.3f %7.3f %7.5f %8.3f%s %8.3f\n", p.name.c_str(), kbps, p.frames, unmatched,
+            pairing, p.psnr[0], p.psnr[1], p.psnr[2], p.psnrAll, p.minPsnrY, p.ssimY, SsimToDb(p.ssimY), ms, p.msPerFrame);
+    }
+}
+
+static bool WriteCsv(const std::string& path, const std::vector<RdPoint>& points, bool msSsim) {
+    std::ofstream csv(path);
+    if (!csv) return false;
+    csv << "config,kbps,frames,unmatched_source,unmatched_decoded,psnr_y,psnr_u,psnr_v,psnr,min_psnr_y,ssim_y,ssim_all";
+    if (msSsim) csv << ",ms_ssim_y";
+    csv << "\n";
+    for (const RdPoint& p : points) {
+        csv << p.name << ",";
+        if (p.kbps >= 0.0) csv << p.kbps;
+        csv << "," << p.frames << "," << p.unmatchedSource << "," << p.unmatchedDecoded << "," << p.psnr[0] << "," << p.psnr[1]
+            << "," << p.psnr[2] << "," << p.psnrAll << "," << p.minPsnrY << "," << p.ssimY << "," << p.ssimAll;
+        if (msSsim) csv << "," << p.msSsimY;
+        csv << "\n";
+    }
+    return static_cast<bool>(csv);
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<RdPoint> points;
+    for (const Config& config : options.configs) {
+        RdPoint point;
+        if (!MeasureConfig(options, config, &point)) return 1;
+        points.push_back(point);
+    }
+
+    // 有码率时按码率排序，即率失真曲线上的点
+    std::stable_sort(points.begin(), points.end(), [](const RdPoint& a, const RdPoint& b) { return a.kbps < b.kbps; });
+    PrintPoints(points, options.msSsim);
+
+    if (!options.csvPath.empty() && !WriteCsv(options.csvPath, points, options.msSsim)) {
+        std::cerr << "cannot write " << options.csvPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,337 @@
+#include "VideoScaler.h"
+#include <mferror.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VIDEO_SCALER_SSE2 1
+#endif
+
+static const int FILTER_BITS = 14;          // 系数定点精度
+static const int INTERMEDIATE_BITS = 6;     // 垂直结果保留的小数位，Lanczos 过冲时仍在 INT16 范围内
+static const int VERTICAL_SHIFT = FILTER_BITS - INTERMEDIATE_BITS;
+static const int HORIZONTAL_SHIFT = FILTER_BITS + INTERMEDIATE_BITS;
+static const double PI = 3.14159265358979323846;
+
+VideoScaler::VideoScaler() : m_pBands(&ParallelBands::Shared()) {}
+
+bool VideoScaler::IsSupported(VideoSubtype subtype) {
+    switch (subtype) {
+    case VideoSubtype::NV12:
+    case VideoSubtype::I420:
+    case VideoSubtype::IYUV:
+    case VideoSubtype::YV12:
+    case VideoSubtype::RGB32:
+    case VideoSubtype::ARGB32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool IsPlanar420(VideoSubtype subtype) {
+    return subtype == VideoSubtype::I420 || subtype == VideoSubtype::IYUV || subtype == VideoSubtype::YV12;
+}
+
+static double Sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= PI;
+    return std::sin(x) / x;
+}
+
+void VideoScaler::BuildFilterTable(UINT32 srcSize, UINT32 dstSize, ScaleFilter filter, FilterTable* pTable) {
+    double scale = static_cast<double>(srcSize) / dstSize;
+    double filterScale = (std::max)(scale, 1.0);    // 缩小时按比例放宽滤波器，相当于先低通
+
+    double support = 0.0;
+    switch (filter) {
+    case ScaleFilter::Box: support = 0.5 * filterScale; break;
+    case ScaleFilter::Bilinear: support = 1.0 * filterScale; break;
+    case ScaleFilter::Lanczos3: support = 3.0 * filterScale; break;
+    }
+
+    UINT32 fullTaps = static_cast<UINT32>(std::ceil(support * 2.0)) + 1;
+    UINT32 taps = (std::min)(fullTaps, srcSize);
+    pTable->taps = taps;
+    pTable->start.resize(dstSize);
+    pTable->weights.assign(static_cast<size_t>(dstSize) * taps, 0);
+
+    std::vector<double> weights(taps);
+    for (UINT32 i = 0; i < dstSize; i++) {
+        double center = (i + 0.5) * scale;          // 源坐标，像素中心位于 j + 0.5
+        // 面积平均看像素区间 [j, j+1) 的重叠，其余滤波看像素中心 j + 0.5 到 center 的距离
+        INT32 first = (filter == ScaleFilter::Box) ?
+            static_cast<INT32>(std::floor(center - support)) :
+            static_cast<INT32>(std::floor(center - support - 0.5)) + 1;
+        INT32 start = (std::min)((std::max)(first, 0), static_cast<INT32>(srcSize - taps));
+        std::fill(weights.begin(), weights.end(), 0.0);
+
+        double sum = 0.0;
+        for (INT32 j = first; j < first + static_cast<INT32>(fullTaps); j++) {
+            double w = 0.0;
+            if (filter == ScaleFilter::Box) {
+                // 源像素 [j, j+1) 与输出像素覆盖区间的重叠长度
+                double overlap = (std::min)(j + 1.0, center + support) - (std::max)(static_cast<double>(j), center - support);
+                w = (std::max)(overlap, 0.0);
+            }
+            else {
+                double x = std::fabs(j + 0.5 - center) / filterScale;
+                if (filter == ScaleFilter::Bilinear) w = (std::max)(1.0 - x, 0.0);
+                else w = (x < 3.0) ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+            }
+            if (w == 0.0) continue;
+
+            // 超出边缘的抽头并入边缘像素
+            INT32 index = (std::min)((std::max)(j, 0), static_cast<INT32>(srcSize) - 1) - start;
+            if (index < 0 || index >= static_cast<INT32>(taps)) continue;
+            weights[index] += w;
+            sum += w;
+        }
+
+        INT16* pWeights = &pTable->weights[static_cast<size_t>(i) * taps];
+        pTable->start[i] = start;
+        if (sum == 0.0) {
+            INT32 nearest = (std::min)((std::max)(static_cast<INT32>(center), start), start + static_cast<INT32>(taps) - 1);
+            pWeights[nearest - start] = 1 << FILTER_BITS;
+            continue;
+        }
+
+        // 量化后把舍入误差补到最大的系数上，保证系数和精确为 1 << FILTER_BITS
+        INT32 total = 0;
+        UINT32 largest = 0;
+        for (UINT32 k = 0; k < taps; k++) {
+            pWeights[k] = static_cast<INT16>(std::lround(weights[k] / sum * (1 << FILTER_BITS)));
+            total += pWeights[k];
+            if (pWeights[k] > pWeights[largest]) largest = k;
+        }
+        pWeights[largest] = static_cast<INT16>(pWeights[largest] + ((1 << FILTER_BITS) - total));
+    }
+}
+
+HRESULT VideoScaler::Configure(VideoSubtype subtype, UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth, UINT32 dstHeight,
+    ScaleFilter filter) {
+    if (!IsSupported(subtype)) return MF_E_INVALIDMEDIATYPE;
+    if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) return E_INVALIDARG;
+
+    bool samePlanar = IsPlanar420(subtype) && IsPlanar420(m_subtype);
+    if ((subtype == m_subtype || samePlanar) && srcWidth == m_srcWidth && srcHeight == m_srcHeight &&
+        dstWidth == m_dstWidth && dstHeight == m_dstHeight && filter == m_filter) {
+        m_subtype = subtype;
+        return S_OK;
+    }
+
+    // 每个平面的尺寸和交错分量数
+    UINT32 planeWidthDiv[VIDEO_FORMAT_MAX_PLANES] = { 1, 2, 2 };
+    UINT32 planeChannels[VIDEO_FORMAT_MAX_PLANES] = { 1, 1, 1 };
+    UINT32 planeCount = 0;
+    if (subtype == VideoSubtype::NV12) {
+        planeCount = 2;
+        planeChannels[1] = 2;
+    }
+    else if (IsPlanar420(subtype)) {
+        planeCount = 3;
+    }
+    else {
+        planeCount = 1;
+        planeChannels[0] = 4;
+    }
+
+    for (UINT32 i = 0; i < planeCount; i++) {
+        PlanePlan& plan = m_planes[i];
+        UINT32 div = planeWidthDiv[i];
+        plan.srcWidth = (srcWidth + div - 1) / div;
+        plan.srcHeight = (srcHeight + div - 1) / div;
+        plan.dstWidth = (dstWidth + div - 1) / div;
+        plan.dstHeight = (dstHeight + div - 1) / div;
+        plan.channels = planeChannels[i];
+
+        plan.decimation = 0;
+        for (UINT32 factor : { 2u, 4u }) {
+            bool exact = plan.srcWidth == plan.dstWidth * factor && plan.srcHeight == plan.dstHeight * factor;
+            // 2x 时三角滤波与 2x2 平均相同；4x 只有面积平均可以直接抽取
+            if (exact && (filter == ScaleFilter::Box || (filter == ScaleFilter::Bilinear && factor == 2))) {
+                plan.decimation = factor;
+            }
+        }
+        if (plan.decimation == 0) {
+            BuildFilterTable(plan.srcWidth, plan.dstWidth, filter, &plan.horizontal);
+            BuildFilterTable(plan.srcHeight, plan.dstHeight, filter, &plan.vertical);
+        }
+    }
+
+    m_subtype = subtype;
+    m_srcWidth = srcWidth;
+    m_srcHeight = srcHeight;
+    m_dstWidth = dstWidth;
+    m_dstHeight = dstHeight;
+    m_filter = filter;
+    m_planeCount = planeCount;
+    return S_OK;
+}
+
+// 垂直卷积：taps 行源像素 -> 一行 INT16 中间结果（放大 1 << INTERMEDIATE_BITS）
+static void VerticalPass(const BYTE* const* ppRows, const INT16* pWeights, UINT32 taps, UINT32 count, INT16* pOut) {
+    UINT32 x = 0;
+#ifdef VIDEO_SCALER_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (VERTICAL_SHIFT - 1));
+    for (; x + 8 <= count; x += 8) {
+        __m128i accLo = round, accHi = round;
+        UINT32 k = 0;
+        // 两行一组交错后用 madd 同时乘加
+        for (; k + 1 < taps; k += 2) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ppRows[k] + x)), zero);
+            __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ppRows[k + 1] + x)), zero);
+            __m128i w = _mm_set1_epi32(static_cast<int>((static_cast<UINT32>(static_cast<UINT16>(pWeights[k + 1])) << 16) | static_cast<UINT16>(pWeights[k])));
+            accLo = _mm_add_epi32(accLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            accHi = _mm_add_epi32(accHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        if (k < taps) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ppRows[k] + x)), zero);
+            __m128i w = _mm_set1_epi32(static_cast<UINT16>(pWeights[k]));
+            accLo = _mm_add_epi32(accLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), w));
+            accHi = _mm_add_epi32(accHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), w));
+        }
+        accLo = _mm_srai_epi32(accLo, VERTICAL_SHIFT);
+        accHi = _mm_srai_epi32(accHi, VERTICAL_SHIFT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x), _mm_packs_epi32(accLo, accHi));
+    }
+#endif
+    for (; x < count; x++) {
+        INT32 sum = 1 << (VERTICAL_SHIFT - 1);
+        for (UINT32 k = 0; k < taps; k++) sum += ppRows[k][x] * pWeights[k];
+        sum >>= VERTICAL_SHIFT;
+        pOut[x] = static_cast<INT16>((std::min)((std::max)(sum, -32768), 32767));
+    }
+}
+
+// 水平卷积：中间结果 -> 8 位输出，channels 个交错分量各自卷积
+template <UINT32 Channels>
+static void HorizontalPass(const INT16* pIn, const INT32* pStart, const INT16* pWeights, UINT32 taps, UINT32 dstWidth, BYTE* pOut) {
+    for (UINT32 x = 0; x < dstWidth; x++) {
+        const INT16* pSrc = pIn + static_cast<size_t>(pStart[x]) * Channels;
+        const INT16* pW = pWeights + static_cast<size_t>(x) * taps;
+        INT32 sum[Channels];
+        for (UINT32 c = 0; c < Channels; c++) sum[c] = 1 << (HORIZONTAL_SHIFT - 1);
+        for (UINT32 k = 0; k < taps; k++) {
+            for (UINT32 c = 0; c < Channels; c++) sum[c] += pSrc[k * Channels + c] * pW[k];
+        }
+        for (UINT32 c = 0; c < Channels; c++) {
+            INT32 value = sum[c] >> HORIZONTAL_SHIFT;
+            pOut[x * Channels + c] = static_cast<BYTE>((std::min)((std::max)(value, 0), 255));
+        }
+    }
+}
+
+void VideoScaler::ScaleRows(const PlanePlan& plan, const BYTE* pSrc, LONG srcStride, BYTE* pDst, LONG dstStride,
+    UINT32 rowBegin, UINT32 rowEnd) {
+    // 每个线程复用自己的中间行缓冲
+    thread_local std::vector<INT16> intermediate;
+    thread_local std::vector<const BYTE*> rows;
+    UINT32 count = plan.srcWidth * plan.channels;
+    intermediate.resize(count);
+    rows.resize(plan.vertical.taps);
+
+    for (UINT32 y = rowBegin; y < rowEnd; y++) {
+        INT32 start = plan.vertical.start[y];
+        for (UINT32 k = 0; k < plan.vertical.taps; k++) {
+            rows[k] = pSrc + static_cast<ptrdiff_t>(start + k) * srcStride;
+        }
+        VerticalPass(rows.data(), &plan.vertical.weights[static_cast<size_t>(y) * plan.vertical.taps], plan.vertical.taps,
+            count, intermediate.data());
+
+        BYTE* pOut = pDst + static_cast<ptrdiff_t>(y) * dstStride;
+        const INT32* pStart = plan.horizontal.start.data();
+        const INT16* pWeights = plan.horizontal.weights.data();
+        switch (plan.channels) {
+        case 1: HorizontalPass<1>(intermediate.data(), pStart, pWeights, plan.horizontal.taps, plan.dstWidth, pOut); break;
+        case 2: HorizontalPass<2>(intermediate.data(), pStart, pWeights, plan.horizontal.taps, plan.dstWidth, pOut); break;
+        default: HorizontalPass<4>(intermediate.data(), pStart, pWeights, plan.horizontal.taps, plan.dstWidth, pOut); break;
+        }
+    }
+}
+
+// 纵向和 -> 每 Factor 个像素横向求和取平均，展开后编译器可以自动向量化
+template <UINT32 Factor, UINT32 Channels>
+static void DecimateColumns(const UINT16* pSums, UINT32 dstWidth, BYTE* pOut) {
+    const UINT32 shift = (Factor == 2) ? 2 : 4;
+    for (UINT32 dx = 0; dx < dstWidth; dx++) {
+        const UINT16* pGroup = pSums + static_cast<size_t>(dx) * Factor * Channels;
+        for (UINT32 c = 0; c < Channels; c++) {
+            UINT32 sum = 1u << (shift - 1);
+            for (UINT32 k = 0; k < Factor; k++) sum += pGroup[k * Channels + c];
+            pOut[dx * Channels + c] = static_cast<BYTE>(sum >> shift);
+        }
+    }
+}
+
+// 精确 2x/4x 缩小：factor 行先用 SIMD 纵向求和，再把每 factor 个像素横向求和取平均
+void VideoScaler::DecimateRows(const PlanePlan& plan, const BYTE* pSrc, LONG srcStride, BYTE* pDst, LONG dstStride,
+    UINT32 rowBegin, UINT32 rowEnd) {
+    thread_local std::vector<UINT16> columnSums;
+    const UINT32 factor = plan.decimation;
+    const UINT32 channels = plan.channels;
+    const UINT32 count = plan.srcWidth * channels;
+    columnSums.resize(count);
+
+    for (UINT32 y = rowBegin; y < rowEnd; y++) {
+        const BYTE* pRow = pSrc + static_cast<ptrdiff_t>(y) * factor * srcStride;
+        UINT32 x = 0;
+#ifdef VIDEO_SCALER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= count; x += 16) {
+            __m128i lo = zero, hi = zero;
+            for (UINT32 k = 0; k < factor; k++) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + static_cast<ptrdiff_t>(k) * srcStride + x));
+                lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+                hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&columnSums[x]), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&columnSums[x + 8]), hi);
+        }
+#endif
+        for (; x < count; x++) {
+            UINT32 sum = 0;
+            for (UINT32 k = 0; k < factor; k++) sum += pRow[static_cast<ptrdiff_t>(k) * srcStride + x];
+            columnSums[x] = static_cast<UINT16>(sum);
+        }
+
+        BYTE* pOut = pDst + static_cast<ptrdiff_t>(y) * dstStride;
+        switch ((factor << 4) | channels) {
+        case 0x21: DecimateColumns<2, 1>(columnSums.data(), plan.dstWidth, pOut); break;
+        case 0x22: DecimateColumns<2, 2>(columnSums.data(), plan.dstWidth, pOut); break;
+        case 0x24: DecimateColumns<2, 4>(columnSums.data(), plan.dstWidth, pOut); break;
+        case 0x41: DecimateColumns<4, 1>(columnSums.data(), plan.dstWidth, pOut); break;
+        case 0x42: DecimateColumns<4, 2>(columnSums.data(), plan.dstWidth, pOut); break;
+        default: DecimateColumns<4, 4>(columnSums.data(), plan.dstWidth, pOut); break;
+        }
+    }
+}
+
+HRESULT VideoScaler::Scale(const ImagePlanes& src, const ImagePlanes& dst) {
+    if (m_planeCount == 0) return MF_E_NOT_INITIALIZED;
+    bool srcMatches = src.subtype == m_subtype || (IsPlanar420(src.subtype) && IsPlanar420(m_subtype));
+    bool dstMatches = dst.subtype == m_subtype || (IsPlanar420(dst.subtype) && IsPlanar420(m_subtype));
+    if (!srcMatches || !dstMatches) return MF_E_INVALIDMEDIATYPE;
+    if (src.width != m_srcWidth || src.height != m_srcHeight || dst.width != m_dstWidth || dst.height != m_dstHeight) {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+
+    for (UINT32 i = 0; i < m_planeCount; i++) {
+        const PlanePlan& plan = m_planes[i];
+        const BYTE* pSrc = src.data[i];
+        BYTE* pDst = dst.data[i];
+        LONG srcStride = src.stride[i], dstStride = dst.stride[i];
+        if (pSrc == nullptr || pDst == nullptr) return E_POINTER;
+
+        // 行带至少覆盖 16 行输出，避免调度开销超过计算量
+        auto band = [&](UINT32 rowBegin, UINT32 rowEnd) {
+            if (plan.decimation != 0) DecimateRows(plan, pSrc, srcStride, pDst, dstStride, rowBegin, rowEnd);
+            else ScaleRows(plan, pSrc, srcStride, pDst, dstStride, rowBegin, rowEnd);
+        };
+        if (m_pBands) m_pBands->Run(plan.dstHeight, 16, band);
+        else band(0, plan.dstHeight);
+    }
+    return S_OK;
+}
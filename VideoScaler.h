@@ -0,0 +1,63 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+#include "VideoFormat.h"
+#include "ParallelBands.h"
+
+enum class ScaleFilter {
+    Box,        // 面积平均，缩小时最快，适合分析用的小图
+    Bilinear,   // 缩小时按比例放宽的三角滤波
+    Lanczos3,   // 质量最好，每个方向 6 个（缩小时更多）抽头
+};
+
+// NV12 / I420(IYUV, YV12) / RGB32(ARGB32) 缩放器
+// Configure 按源/目标几何为每个平面预计算定点滤波系数表，几何不变时逐帧只做卷积；
+// 先垂直（SIMD，整行连续访问）后水平，缩小时水平方向只处理目标宽度；
+// 精确的 2x/4x 缩小走专门的抽取路径；输出行按行带并行
+class VideoScaler {
+public:
+    VideoScaler();
+
+    static bool IsSupported(VideoSubtype subtype);
+
+    // 参数与上一次相同时直接返回
+    HRESULT Configure(VideoSubtype subtype, UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth, UINT32 dstHeight,
+        ScaleFilter filter);
+
+    // src/dst 的子类型和尺寸必须与 Configure 一致（I420/IYUV/YV12 之间可以混用）
+    HRESULT Scale(const ImagePlanes& src, const ImagePlanes& dst);
+
+    // 行带并行使用的线程池，nullptr 表示只在调用线程执行；默认使用 ParallelBands::Shared()
+    void SetParallelBands(ParallelBands* pBands) { m_pBands = pBands; }
+
+private:
+    // 定点系数表：每个输出位置 taps 个系数，和为 1 << 14
+    struct FilterTable {
+        UINT32 taps = 0;
+        std::vector<INT32> start;       // 每个输出位置窗口的第一个源下标（已钳制在源范围内）
+        std::vector<INT16> weights;
+    };
+
+    struct PlanePlan {
+        UINT32 srcWidth = 0, srcHeight = 0;
+        UINT32 dstWidth = 0, dstHeight = 0;
+        UINT32 channels = 1;            // 交错分量数：Y/U/V 为 1，NV12 UV 为 2，RGB32 为 4
+        UINT32 decimation = 0;          // 精确 2x/4x 缩小时为 2 或 4，否则为 0
+        FilterTable horizontal;
+        FilterTable vertical;
+    };
+
+    static void BuildFilterTable(UINT32 srcSize, UINT32 dstSize, ScaleFilter filter, FilterTable* pTable);
+    static void ScaleRows(const PlanePlan& plan, const BYTE* pSrc, LONG srcStride, BYTE* pDst, LONG dstStride,
+        UINT32 rowBegin, UINT32 rowEnd);
+    static void DecimateRows(const PlanePlan& plan, const BYTE* pSrc, LONG srcStride, BYTE* pDst, LONG dstStride,
+        UINT32 rowBegin, UINT32 rowEnd);
+
+    VideoSubtype m_subtype = VideoSubtype::Unknown;
+    UINT32 m_srcWidth = 0, m_srcHeight = 0;
+    UINT32 m_dstWidth = 0, m_dstHeight = 0;
+    ScaleFilter m_filter = ScaleFilter::Bilinear;
+    UINT32 m_planeCount = 0;
+    PlanePlan m_planes[VIDEO_FORMAT_MAX_PLANES];
+    ParallelBands* m_pBands = nullptr;
+};
@@ -0,0 +1,185 @@
+#include "Y4MFile.h"
+#include <cstdlib>
+#include <cstring>
+
+static const char Y4M_MAGIC[] = "YUV4MPEG2";
+static const char Y4M_FRAME[] = "FRAME";
+static const size_t MAX_HEADER_LENGTH = 4096;
+static const size_t FILE_BUFFER_BYTES = 1 << 20;
+
+// ---- 读 ----
+
+bool Y4MReader::ReadLine(std::string* pLine) {
+    pLine->clear();
+    for (;;) {
+        int c = fgetc(m_file);
+        if (c == EOF) return !pLine->empty();
+        if (c == '\n') return true;
+        if (pLine->size() >= MAX_HEADER_LENGTH) return false;
+        pLine->push_back(static_cast<char>(c));
+    }
+}
+
+bool Y4MReader::Open(const std::string& path) {
+    Close();
+    m_error.clear();
+    m_info = Y4MInfo();
+    m_frameIndex = 0;
+
+    m_file = fopen(path.c_str(), "rb");
+    if (m_file == nullptr) {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    setvbuf(m_file, nullptr, _IOFBF, FILE_BUFFER_BYTES);
+
+    std::string header;
+    if (!ReadLine(&header) || header.compare(0, sizeof(Y4M_MAGIC) - 1, Y4M_MAGIC) != 0) {
+        m_error = path + " is not a YUV4MPEG2 file";
+        Close();
+        return false;
+    }
+
+    // 流头参数以空格分隔，首字母为参数名；不认识的参数（A、I、X 等）忽略
+    size_t pos = sizeof(Y4M_MAGIC) - 1;
+    while (pos < header.size()) {
+        size_t end = header.find(' ', pos + 1);
+        if (end == std::string::npos) end = header.size();
+        std::string token = header.substr(pos, end - pos);
+        pos = end;
+        if (!token.empty() && token[0] == ' ') token.erase(0, 1);
+        if (token.empty()) continue;
+
+        const char* value = token.c_str() + 1;
+        switch (token[0]) {
+        case 'W':
+            m_info.width = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            break;
+        case 'H':
+            m_info.height = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            break;
+        case 'F': {
+            char* colon = nullptr;
+            m_info.fpsNum = static_cast<uint32_t>(strtoul(value, &colon, 10));
+            m_info.fpsDen = (colon && *colon == ':') ? static_cast<uint32_t>(strtoul(colon + 1, nullptr, 10)) : 1;
+            break;
+        }
+        case 'C':
+            if (strcmp(value, "mono") == 0) {
+                m_info.monochrome = true;
+            }
+            else if (strcmp(value, "420") != 0 && strcmp(value, "420jpeg") != 0 && strcmp(value, "420mpeg2") != 0 &&
+                strcmp(value, "420paldv") != 0) {
+                // 420p10 等高位深格式和 422 / 444 不支持
+                m_error = path + ": unsupported colour space C" + value;
+                Close();
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (m_info.width == 0 || m_info.height == 0) {
+        m_error = path + ": missing frame size";
+        Close();
+        return false;
+    }
+    if (m_info.fpsNum == 0 || m_info.fpsDen == 0) {
+        m_info.fpsNum = 0;
+        m_info.fpsDen = 0;
+    }
+    return true;
+}
+
+void Y4MReader::Close() {
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool Y4MReader::ReadFrame(Y4MFrame* pFrame) {
+    if (m_file == nullptr || pFrame == nullptr) return false;
+
+    std::string header;
+    if (!ReadLine(&header)) {
+        if (!feof(m_file)) m_error = "frame header too long";
+        return false;
+    }
+    if (header.compare(0, sizeof(Y4M_FRAME) - 1, Y4M_FRAME) != 0) {
+        m_error = "expected FRAME at frame " + std::to_string(m_frameIndex);
+        return false;
+    }
+
+    pFrame->index = m_frameIndex;
+    pFrame->hasPts = false;
+    size_t xpts = header.find(" XPTS=");
+    if (xpts != std::string::npos) {
+        pFrame->pts = strtoll(header.c_str() + xpts + 6, nullptr, 10);
+        pFrame->hasPts = true;
+    }
+    else if (m_info.fpsNum != 0) {
+        // 没有时间戳时按帧率推算，单位与 XPTS 相同（100ns）
+        pFrame->pts = static_cast<int64_t>(m_frameIndex * 10000000ull * m_info.fpsDen / m_info.fpsNum);
+    }
+    else {
+        pFrame->pts = static_cast<int64_t>(m_frameIndex);
+    }
+
+    size_t bytes = m_info.FrameBytes();
+    pFrame->data.resize(bytes);
+    if (fread(pFrame->data.data(), 1, bytes, m_file) != bytes) {
+        m_error = "truncated frame " + std::to_string(m_frameIndex);
+        return false;
+    }
+    m_frameIndex++;
+    return true;
+}
+
+// ---- 写 ----
+
+bool Y4MWriter::Open(const std::string& path, uint32_t width, uint32_t height, uint32_t fpsNum, uint32_t fpsDen) {
+    Close();
+    if (width == 0 || height == 0) return false;
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr) return false;
+    setvbuf(m_file, nullptr, _IOFBF, FILE_BUFFER_BYTES);
+
+    m_info = Y4MInfo();
+    m_info.width = width;
+    m_info.height = height;
+    m_info.fpsNum = fpsNum;
+    m_info.fpsDen = fpsDen;
+    if (fpsNum != 0 && fpsDen != 0) {
+        fprintf(m_file, "%s W%u H%u F%u:%u Ip A1:1 C420jpeg\n", Y4M_MAGIC, width, height, fpsNum, fpsDen);
+    }
+    else {
+        fprintf(m_file, "%s W%u H%u Ip A1:1 C420jpeg\n", Y4M_MAGIC, width, height);
+    }
+    return ferror(m_file) == 0;
+}
+
+void Y4MWriter::Close() {
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool Y4MWriter::WriteFrame(const uint8_t* const planes[3], const ptrdiff_t strides[3], int64_t pts) {
+    if (m_file == nullptr) return false;
+    if (pts >= 0) fprintf(m_file, "%s XPTS=%lld\n", Y4M_FRAME, static_cast<long long>(pts));
+    else fprintf(m_file, "%s\n", Y4M_FRAME);
+
+    for (int i = 0; i < 3; i++) {
+        uint32_t width = (i == 0) ? m_info.width : m_info.ChromaWidth();
+        uint32_t height = (i == 0) ? m_info.height : m_info.ChromaHeight();
+        if (planes[i] == nullptr) return false;
+        for (uint32_t y = 0; y < height; y++) {
+            if (fwrite(planes[i] + static_cast<ptrdiff_t>(y) * strides[i], 1, width, m_file) != width) return false;
+        }
+    }
+    return true;
+}
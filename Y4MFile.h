@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// YUV4MPEG2（.y4m）读写，不依赖 Windows，画质评估工具在 Linux 上也用它
+// 只支持 8 位 4:2:0（C420 / C420jpeg / C420mpeg2 / C420paldv，流头不写色度时默认 4:2:0）和单色（Cmono）。
+// 帧头可以带 XPTS=<时间戳，单位 100ns> 扩展参数：X 参数由应用自定义，ffmpeg 等工具读取时忽略；
+// 画质评估按它把源帧和解码帧配对
+struct Y4MInfo {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t fpsNum = 0;            // 流头没有 F 参数时为 0
+    uint32_t fpsDen = 0;
+    bool monochrome = false;
+
+    uint32_t ChromaWidth() const { return monochrome ? 0 : (width + 1) / 2; }
+    uint32_t ChromaHeight() const { return monochrome ? 0 : (height + 1) / 2; }
+    size_t FrameBytes() const {
+        return static_cast<size_t>(width) * height + 2 * static_cast<size_t>(ChromaWidth()) * ChromaHeight();
+    }
+};
+
+// 一帧：data 为连续的 Y、U、V 平面（行跨度等于平面宽度）
+struct Y4MFrame {
+    std::vector<uint8_t> data;
+    int64_t pts = 0;                // 没有 XPTS 时按帧序号和帧率推算
+    bool hasPts = false;            // 帧头带有 XPTS
+    uint64_t index = 0;             // 文件内的帧序号
+};
+
+class Y4MReader {
+public:
+    Y4MReader() = default;
+    ~Y4MReader() { Close(); }
+    Y4MReader(const Y4MReader&) = delete;
+    Y4MReader& operator=(const Y4MReader&) = delete;
+
+    // 打开文件并解析流头，失败时 GetError 返回原因
+    bool Open(const std::string& path);
+    void Close();
+
+    const Y4MInfo& GetInfo() const { return m_info; }
+
+    // 读下一帧；文件结束或出错时返回 false，HasError 区分两者
+    bool ReadFrame(Y4MFrame* pFrame);
+
+    bool HasError() const { return !m_error.empty(); }
+    const std::string& GetError() const { return m_error; }
+
+private:
+    bool ReadLine(std::string* pLine);
+
+    FILE* m_file = nullptr;
+    Y4MInfo m_info;
+    uint64_t m_frameIndex = 0;
+    std::string m_error;
+};
+
+class Y4MWriter {
+public:
+    Y4MWriter() = default;
+    ~Y4MWriter() { Close(); }
+    Y4MWriter(const Y4MWriter&) = delete;
+    Y4MWriter& operator=(const Y4MWriter&) = delete;
+
+    // 写 4:2:0 流头（C420jpeg）
+    bool Open(const std::string& path, uint32_t width, uint32_t height, uint32_t fpsNum, uint32_t fpsDen);
+    void Close();
+    bool IsOpen() const { return m_file != nullptr; }
+    const Y4MInfo& GetInfo() const { return m_info; }
+
+    // planes / strides 为 Y、U、V 三个平面，每个平面只写画面宽高内的部分（可以从带对齐填充的解码缓冲直接写）；
+    // pts 小于 0 时不写 XPTS
+    bool WriteFrame(const uint8_t* const planes[3], const ptrdiff_t strides[3], int64_t pts);
+
+private:
+    FILE* m_file = nullptr;
+    Y4MInfo m_info;
+};